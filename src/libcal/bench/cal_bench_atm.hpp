@@ -0,0 +1,115 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+
+// Report the seconds per iteration spent in the named profiler regions,
+// summed over all paths and threads that ran them.
+
+static void stage_counters(benchmark::State & state,
+                           std::vector <char const *> const & stages) {
+    auto & prof = cal::Profiler::get();
+    std::vector <double> seconds(stages.size(), 0);
+    for (auto const & st : prof.stats()) {
+        std::string leaf = st.path.substr(st.path.rfind('/') + 1);
+        for (size_t i = 0; i < stages.size(); ++i) {
+            if (leaf == stages[i]) seconds[i] += st.seconds;
+        }
+    }
+    for (size_t i = 0; i < stages.size(); ++i) {
+        state.counters[stages[i]] = benchmark::Counter(
+            seconds[i], benchmark::Counter::kAvgIterations);
+    }
+    return;
+}
+
+// Simulate a 10 minute CES.  The arguments are the half width of the
+// azimuth range in mrad and the maximum number of volume elements per
+// slice.  The counters are the seconds per iteration spent in each stage
+// (summed over the threads that ran it), the number of simulated volume
+// elements and the peak memory in MB.
+
+static void BM_atm_simulate(benchmark::State & state) {
+    double daz = 1e-3 * state.range(0);
+    long nelem_sim_max = state.range(1);
+    double tmax = 600;
+
+    auto & prof = cal::Profiler::get();
+    bool enabled = prof.enabled();
+    prof.set_enabled(true);
+    prof.clear();
+    auto & mem = cal::MemoryTracker::get();
+    mem.reset_peak();
+    int64_t mem_start = mem.stats().back().current;
+
+    for (auto _ : state) {
+        cal::atm_sim sim(-daz, daz, 0.95, 1.05, 0, tmax,
+                         .01, 0, 10, 0, 10, 0, 0, 0, 2000, 0, 280, 0,
+                         40000, 2000, 50, 50, 50, nelem_sim_max, 0,
+                         123, 456, 789, 1011, std::string(), 0, 5000);
+        sim.simulate(false);
+    }
+
+    stage_counters(state, {"initialize_kolmogorov", "compress_volume",
+                           "build_sparse_covariance",
+                           "sqrt_sparse_covariance",
+                           "apply_sparse_covariance"});
+    prof.clear();
+    prof.set_enabled(enabled);
+
+    auto mstats = mem.stats();
+    int64_t realization = 0;
+    for (auto const & st : mstats) {
+        if (st.category == "realization") realization = st.peak;
+    }
+    state.counters["elements"] = realization / sizeof(double);
+    state.counters["peak_MB"] = (mstats.back().peak - mem_start) / 1048576.;
+}
+
+BENCHMARK(BM_atm_simulate)->Args({50, 1000})->Args({100, 1000})
+->Args({200, 1000})->Args({100, 4000})->Unit(benchmark::kSecond)
+->UseRealTime();
+
+// Observe a simulated atmosphere.  The first argument is the huge
+// page threshold in MB (0 disables huge pages), which applies to the
+// realization and index tables allocated by simulate().  The second
+// argument is the number of samples per call.
+
+static void BM_atm_observe(benchmark::State & state) {
+    int64_t nsamp = state.range(1);
+    auto & env = cal::Environment::get();
+    int64_t orig = env.hugepage_threshold();
+    env.set_hugepage_threshold(state.range(0) * 1048576);
+
+    double tmax = 600;
+    cal::AlignedVector <double> t(nsamp);
+    cal::AlignedVector <double> az(nsamp);
+    cal::AlignedVector <double> el(nsamp);
+    cal::AlignedVector <double> tod(nsamp);
+    for (int64_t i = 0; i < nsamp; ++i) {
+        t[i] = tmax * i / nsamp;
+        az[i] = 0.15 * sin(2 * cal::PI * t[i] / 60.0);
+        el[i] = 1.0;
+    }
+
+    cal::atm_sim sim(-0.2, 0.2, 0.95, 1.05, 0, tmax,
+                     .01, 0, 10, 0, 10, 0, 0, 0, 2000, 0, 280, 0,
+                     40000, 2000, 50, 50, 50, 10000, 0,
+                     123, 456, 789, 1011, std::string(), 0, 5000);
+    sim.simulate(false);
+
+    env.set_hugepage_threshold(orig);
+
+    for (auto _ : state) {
+        sim.observe(t.data(), az.data(), el.data(), tod.data(), nsamp);
+    }
+    state.SetItemsProcessed(state.iterations() * nsamp);
+}
+
+BENCHMARK(BM_atm_observe)->Args({0, 100000})->Args({1, 100000})
+->Args({0, 1000000})->Args({1, 1000000})->Unit(benchmark::kMillisecond)
+->UseRealTime();
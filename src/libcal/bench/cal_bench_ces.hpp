@@ -0,0 +1,69 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <algorithm>
+
+
+// Simulate and observe a CES end to end: generate the scan and the
+// detector pointing, simulate the atmosphere over the observed range and
+// observe it with every detector.  The arguments are the number of
+// detectors and the length of the scan in seconds, sampled at 50 Hz.  The
+// items processed counter reports detector samples per second, the
+// other counters the seconds per iteration of each stage.
+
+static void BM_atm_ces(benchmark::State & state) {
+    size_t ndet = state.range(0);
+    double rate = 50;
+    size_t nsamp = state.range(1) * rate;
+
+    cal::AlignedVector <double> t(nsamp);
+    cal::AlignedVector <double> az(nsamp);
+    cal::AlignedVector <double> el(nsamp);
+    cal::AlignedVector <uint8_t> flags(nsamp);
+    cal::AlignedVector <double> detquat(4 * ndet);
+    cal::AlignedVector <double> detaz(ndet * nsamp);
+    cal::AlignedVector <double> detel(ndet * nsamp);
+    cal::AlignedVector <double> tod(nsamp);
+
+    auto & prof = cal::Profiler::get();
+    bool enabled = prof.enabled();
+    prof.set_enabled(true);
+    prof.clear();
+
+    for (auto _ : state) {
+        {
+            cal::ProfileRegion region("scan_ces");
+            cal::scan_ces(0, rate, 0, nsamp, 1.0, 1.2, 1.0,
+                          cal::PI / 180, cal::PI / 180, t.data(), az.data(),
+                          el.data(), flags.data());
+            cal::scan_focalplane(ndet, 0.02, detquat.data());
+            cal::scan_detectors_azel(nsamp, az.data(), el.data(), ndet,
+                                     detquat.data(), detaz.data(),
+                                     detel.data());
+        }
+
+        auto azrange = std::minmax_element(detaz.begin(), detaz.end());
+        auto elrange = std::minmax_element(detel.begin(), detel.end());
+        cal::atm_sim sim(*azrange.first, *azrange.second, *elrange.first,
+                         *elrange.second, t[0], t[nsamp - 1] + 1 / rate,
+                         .01, 0, 10, 0, 10, 0, 0, 0, 2000, 0, 280, 0,
+                         40000, 2000, 50, 50, 50, 1000, 0,
+                         123, 456, 789, 1011, std::string(), 0, 5000);
+        sim.simulate(false);
+
+        for (size_t idet = 0; idet < ndet; ++idet) {
+            sim.observe(t.data(), detaz.data() + idet * nsamp,
+                        detel.data() + idet * nsamp, tod.data(), nsamp);
+        }
+        benchmark::DoNotOptimize(tod.data());
+    }
+
+    stage_counters(state, {"scan_ces", "simulate", "observe"});
+    prof.clear();
+    prof.set_enabled(enabled);
+    state.SetItemsProcessed(state.iterations() * ndet * nsamp);
+}
+
+BENCHMARK(BM_atm_ces)->Args({16, 600})->Args({64, 600})->Args({16, 1800})
+->Unit(benchmark::kSecond)->UseRealTime();
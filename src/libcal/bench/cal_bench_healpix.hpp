@@ -0,0 +1,94 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <cmath>
+
+
+// HEALPix pixelization of 1M random directions.  The argument is NSIDE,
+// the items processed counter reports pixels per second.
+
+static void healpix_input(size_t n, cal::AlignedVector <double> & theta,
+                          cal::AlignedVector <double> & phi,
+                          cal::AlignedVector <double> & vec) {
+    theta.resize(n);
+    phi.resize(n);
+    vec.resize(3 * n);
+    cal::rng_dist_uniform_11(n, 12345, 67890, 0, 0, theta.data());
+    cal::rng_dist_uniform_01(n, 12345, 67890, 1, 0, phi.data());
+    for (size_t i = 0; i < n; ++i) {
+        theta[i] = acos(theta[i]);
+        phi[i] *= cal::TWOPI;
+    }
+    cal::healpix_ang2vec(n, theta.data(), phi.data(), vec.data());
+    return;
+}
+
+static const size_t healpix_nsamp = 1 << 20;
+
+template <bool nest>
+static void BM_healpix_ang2pix(benchmark::State & state) {
+    size_t n = healpix_nsamp;
+    cal::HealpixPixels hpix(state.range(0));
+    cal::AlignedVector <double> theta;
+    cal::AlignedVector <double> phi;
+    cal::AlignedVector <double> vec;
+    healpix_input(n, theta, phi, vec);
+    cal::AlignedVector <int64_t> pix(n);
+    for (auto _ : state) {
+        if (nest) {
+            hpix.ang2nest(n, theta.data(), phi.data(), pix.data());
+        } else {
+            hpix.ang2ring(n, theta.data(), phi.data(), pix.data());
+        }
+        benchmark::DoNotOptimize(pix.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+template <bool nest>
+static void BM_healpix_vec2pix(benchmark::State & state) {
+    size_t n = healpix_nsamp;
+    cal::HealpixPixels hpix(state.range(0));
+    cal::AlignedVector <double> theta;
+    cal::AlignedVector <double> phi;
+    cal::AlignedVector <double> vec;
+    healpix_input(n, theta, phi, vec);
+    cal::AlignedVector <int64_t> pix(n);
+    for (auto _ : state) {
+        if (nest) {
+            hpix.vec2nest(n, vec.data(), pix.data());
+        } else {
+            hpix.vec2ring(n, vec.data(), pix.data());
+        }
+        benchmark::DoNotOptimize(pix.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void BM_healpix_nest2ring(benchmark::State & state) {
+    size_t n = healpix_nsamp;
+    cal::HealpixPixels hpix(state.range(0));
+    cal::AlignedVector <double> theta;
+    cal::AlignedVector <double> phi;
+    cal::AlignedVector <double> vec;
+    healpix_input(n, theta, phi, vec);
+    cal::AlignedVector <int64_t> nestpix(n);
+    cal::AlignedVector <int64_t> ringpix(n);
+    hpix.ang2nest(n, theta.data(), phi.data(), nestpix.data());
+    for (auto _ : state) {
+        hpix.nest2ring(n, nestpix.data(), ringpix.data());
+        benchmark::DoNotOptimize(ringpix.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK_TEMPLATE(BM_healpix_ang2pix, true)->Arg(64)->Arg(1024)
+->Arg(8192);
+BENCHMARK_TEMPLATE(BM_healpix_ang2pix, false)->Arg(64)->Arg(1024)
+->Arg(8192);
+BENCHMARK_TEMPLATE(BM_healpix_vec2pix, true)->Arg(64)->Arg(1024)
+->Arg(8192);
+BENCHMARK_TEMPLATE(BM_healpix_vec2pix, false)->Arg(64)->Arg(1024)
+->Arg(8192);
+BENCHMARK(BM_healpix_nest2ring)->Arg(64)->Arg(1024)->Arg(8192);
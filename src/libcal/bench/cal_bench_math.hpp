@@ -0,0 +1,169 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+
+// Vector math functions.  When built with MKL the "fast" versions are
+// the MKL low accuracy functions, otherwise the portable SIMD kernels.
+// The standard versions loop over the C library functions.
+
+typedef void (*unary_func)(int, double const *, double *);
+
+static void bench_unary(benchmark::State & state, unary_func func,
+                        double scale) {
+    size_t n = state.range(0);
+    cal::AlignedVector <double> in(n);
+    cal::AlignedVector <double> out(n);
+    cal::rng_dist_uniform_01(n, 12345, 67890, 0, 0, in.data());
+    for (size_t i = 0; i < n; ++i) {
+        in[i] *= scale;
+    }
+    for (auto _ : state) {
+        func(n, in.data(), out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void BM_vsin(benchmark::State & state) {
+    bench_unary(state, cal::vsin, cal::TWOPI);
+}
+
+static void BM_vfast_sin(benchmark::State & state) {
+    bench_unary(state, cal::vfast_sin, cal::TWOPI);
+}
+
+static void BM_vexp(benchmark::State & state) {
+    bench_unary(state, cal::vexp, 10.0);
+}
+
+static void BM_vfast_exp(benchmark::State & state) {
+    bench_unary(state, cal::vfast_exp, 10.0);
+}
+
+static void BM_vlog(benchmark::State & state) {
+    bench_unary(state, cal::vlog, 10.0);
+}
+
+static void BM_vfast_log(benchmark::State & state) {
+    bench_unary(state, cal::vfast_log, 10.0);
+}
+
+static void BM_vsqrt(benchmark::State & state) {
+    bench_unary(state, cal::vsqrt, 10.0);
+}
+
+static void BM_vfast_sqrt(benchmark::State & state) {
+    bench_unary(state, cal::vfast_sqrt, 10.0);
+}
+
+template <bool fast>
+static void BM_sincos(benchmark::State & state) {
+    size_t n = state.range(0);
+    cal::AlignedVector <double> in(n);
+    cal::AlignedVector <double> sinout(n);
+    cal::AlignedVector <double> cosout(n);
+    cal::rng_dist_uniform_11(n, 12345, 67890, 0, 0, in.data());
+    for (size_t i = 0; i < n; ++i) {
+        in[i] *= cal::TWOPI;
+    }
+    for (auto _ : state) {
+        if (fast) {
+            cal::vfast_sincos(n, in.data(), sinout.data(), cosout.data());
+        } else {
+            cal::vsincos(n, in.data(), sinout.data(), cosout.data());
+        }
+        benchmark::DoNotOptimize(sinout.data());
+        benchmark::DoNotOptimize(cosout.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+template <bool fast>
+static void BM_atan2(benchmark::State & state) {
+    size_t n = state.range(0);
+    cal::AlignedVector <double> y(n);
+    cal::AlignedVector <double> x(n);
+    cal::AlignedVector <double> out(n);
+    cal::rng_dist_uniform_11(n, 12345, 67890, 0, 0, y.data());
+    cal::rng_dist_uniform_11(n, 12345, 67890, 1, 0, x.data());
+    for (auto _ : state) {
+        if (fast) {
+            cal::vfast_atan2(n, y.data(), x.data(), out.data());
+        } else {
+            cal::vatan2(n, y.data(), x.data(), out.data());
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_vsin)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(BM_vfast_sin)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(BM_sincos, false)->RangeMultiplier(16)
+->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(BM_sincos, true)->RangeMultiplier(16)
+->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(BM_atan2, false)->RangeMultiplier(16)
+->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(BM_atan2, true)->RangeMultiplier(16)
+->Range(1 << 12, 1 << 20);
+BENCHMARK(BM_vexp)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(BM_vfast_exp)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(BM_vlog)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(BM_vfast_log)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(BM_vsqrt)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(BM_vfast_sqrt)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+
+// Inverse error function.  When built with MKL, verfinv and vfast_erfinv
+// are vmdErfInv in HA and LA mode, otherwise they are the portable
+// implementation, which is always benchmarked for comparison.
+
+static void erfinv_input(cal::AlignedVector <double> & in) {
+    size_t n = in.size();
+    cal::rng_dist_uniform_11(n, 12345, 67890, 0, 0, in.data());
+    return;
+}
+
+static void BM_verfinv(benchmark::State & state) {
+    size_t n = state.range(0);
+    cal::AlignedVector <double> in(n);
+    cal::AlignedVector <double> out(n);
+    erfinv_input(in);
+    for (auto _ : state) {
+        cal::verfinv(n, in.data(), out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void BM_vfast_erfinv(benchmark::State & state) {
+    size_t n = state.range(0);
+    cal::AlignedVector <double> in(n);
+    cal::AlignedVector <double> out(n);
+    erfinv_input(in);
+    for (auto _ : state) {
+        cal::vfast_erfinv(n, in.data(), out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Argument 1 selects the vectorized logarithm.
+static void BM_vgeneric_erfinv(benchmark::State & state) {
+    size_t n = state.range(0);
+    bool fast = (state.range(1) != 0);
+    cal::AlignedVector <double> in(n);
+    cal::AlignedVector <double> out(n);
+    erfinv_input(in);
+    for (auto _ : state) {
+        cal::vgeneric_erfinv(n, in.data(), out.data(), fast);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_verfinv)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(BM_vfast_erfinv)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(BM_vgeneric_erfinv)->Args({1 << 12, 0})->Args({1 << 12, 1})
+->Args({1 << 20, 0})->Args({1 << 20, 1});
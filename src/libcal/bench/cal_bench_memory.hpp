@@ -0,0 +1,101 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <algorithm>
+#include <numeric>
+
+
+// Random gathers through an index table into a value table, with the
+// same access pattern and OpenMP schedule as atm_sim::interp called
+// from atm_sim::observe.  On multi-socket hosts the serially touched
+// tables live on a single NUMA node, while the first touched tables
+// are spread over all of them.
+
+template <typename VecLong, typename VecDouble>
+double bench_gather(VecLong const & index, VecDouble const & values,
+                    int64_t nsamp) {
+    int64_t n = index.size();
+    double total = 0;
+
+    # pragma omp parallel for schedule(static, 100) reduction(+ : total)
+    for (int64_t i = 0; i < nsamp; ++i) {
+        // Cheap hash of the sample index standing in for the position
+        // along the line of sight
+        uint64_t h = (uint64_t)i * 6364136223846793005ul + 1442695040888963407ul;
+        int64_t ifull = (h >> 17) % (n - 8);
+        for (int64_t corner = 0; corner < 8; ++corner) {
+            total += values[index[ifull + corner]];
+        }
+    }
+    return total;
+}
+
+static void BM_gather_serial_touch(benchmark::State & state) {
+    int64_t n = state.range(0);
+    int64_t nsamp = 1000000;
+
+    cal::AlignedVector <long> index(n);
+    cal::AlignedVector <double> values(n);
+    std::iota(index.begin(), index.end(), 0);
+    std::reverse(index.begin(), index.end());
+    std::fill(values.begin(), values.end(), 1.0);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bench_gather(index, values, nsamp));
+    }
+    state.SetItemsProcessed(state.iterations() * nsamp);
+}
+
+static void BM_gather_first_touch(benchmark::State & state) {
+    int64_t n = state.range(0);
+    int64_t nsamp = 1000000;
+
+    cal::FirstTouchVector <long> index(n);
+    cal::FirstTouchVector <double> values(n);
+    cal::first_touch_fill(index.data(), n, 0L);
+    cal::first_touch_fill(values.data(), n, 1.0);
+    # pragma omp parallel for schedule(static)
+    for (int64_t i = 0; i < n; ++i) {
+        index[i] = n - 1 - i;
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bench_gather(index, values, nsamp));
+    }
+    state.SetItemsProcessed(state.iterations() * nsamp);
+}
+
+BENCHMARK(BM_gather_serial_touch)->RangeMultiplier(8)->Range(1 << 20, 1 << 25)
+->UseRealTime();
+BENCHMARK(BM_gather_first_touch)->RangeMultiplier(8)->Range(1 << 20, 1 << 25)
+->UseRealTime();
+
+static void BM_gather_hugepages(benchmark::State & state) {
+    int64_t n = state.range(0);
+    int64_t nsamp = 1000000;
+
+    // Back both tables with transparent huge pages
+    auto & env = cal::Environment::get();
+    int64_t orig = env.hugepage_threshold();
+    env.set_hugepage_threshold(1048576);
+
+    cal::FirstTouchVector <long> index(n);
+    cal::FirstTouchVector <double> values(n);
+    cal::first_touch_fill(index.data(), n, 0L);
+    cal::first_touch_fill(values.data(), n, 1.0);
+    # pragma omp parallel for schedule(static)
+    for (int64_t i = 0; i < n; ++i) {
+        index[i] = n - 1 - i;
+    }
+
+    env.set_hugepage_threshold(orig);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bench_gather(index, values, nsamp));
+    }
+    state.SetItemsProcessed(state.iterations() * nsamp);
+}
+
+BENCHMARK(BM_gather_hugepages)->RangeMultiplier(8)->Range(1 << 20, 1 << 25)
+->UseRealTime();
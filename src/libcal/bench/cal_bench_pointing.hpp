@@ -0,0 +1,58 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+
+// Detector pointing.  The items processed counter reports samples per
+// second.  The chunks of the pointing matrix are split across the OpenMP
+// threads, run with OMP_NUM_THREADS=1 to get the rate of a single core.
+
+static void pointing_input(size_t n, cal::AlignedVector <double> & quat,
+                           cal::AlignedVector <double> & hwpang,
+                           cal::AlignedVector <uint8_t> & flags) {
+    cal::AlignedVector <double> theta(n);
+    cal::AlignedVector <double> phi(n);
+    cal::AlignedVector <double> pa(n);
+    cal::rng_dist_uniform_01(n, 12345, 67890, 0, 0, theta.data());
+    cal::rng_dist_uniform_01(n, 12345, 67890, 1, 0, phi.data());
+    cal::rng_dist_uniform_01(n, 12345, 67890, 2, 0, pa.data());
+    quat.resize(4 * n);
+    hwpang.resize(n);
+    flags.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        theta[i] *= cal::PI;
+        phi[i] *= cal::TWOPI;
+        pa[i] *= cal::TWOPI;
+        hwpang[i] = 0.01 * i;
+        flags[i] = (i % 100 == 0) ? 1 : 0;
+    }
+    cal::qa_from_angles(n, theta.data(), phi.data(), pa.data(), quat.data());
+    return;
+}
+
+// Argument 1 selects the IQU mode.
+static void BM_pointing_matrix_healpix(benchmark::State & state) {
+    size_t n = state.range(0);
+    bool iqu = (state.range(1) != 0);
+    std::string mode = iqu ? "IQU" : "I";
+    size_t nnz = iqu ? 3 : 1;
+    cal::HealpixPixels hpix(1024);
+    cal::AlignedVector <double> quat;
+    cal::AlignedVector <double> hwpang;
+    cal::AlignedVector <uint8_t> flags;
+    pointing_input(n, quat, hwpang, flags);
+    cal::AlignedVector <int64_t> pixels(n);
+    cal::AlignedVector <double> weights(nnz * n);
+    for (auto _ : state) {
+        cal::pointing_matrix_healpix(hpix, true, 0.0, 1.0, mode, n,
+                                     quat.data(), hwpang.data(),
+                                     flags.data(), pixels.data(),
+                                     weights.data());
+        benchmark::DoNotOptimize(pixels.data());
+        benchmark::DoNotOptimize(weights.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_pointing_matrix_healpix)->Args({1 << 20, 0})->Args({1 << 20, 1})
+->UseRealTime();
@@ -0,0 +1,135 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <algorithm>
+
+
+// Quaternion arrays.  The items processed counter reports quaternions
+// per second.  The SoA variants take the same input converted to
+// structure-of-arrays layout outside of the timed loop.
+
+static void qarray_input(size_t n, cal::AlignedVector <double> & quat,
+                         cal::AlignedVector <double> & vec) {
+    cal::AlignedVector <double> theta(n);
+    cal::AlignedVector <double> phi(n);
+    cal::AlignedVector <double> pa(n);
+    cal::rng_dist_uniform_01(n, 12345, 67890, 0, 0, theta.data());
+    cal::rng_dist_uniform_01(n, 12345, 67890, 1, 0, phi.data());
+    cal::rng_dist_uniform_01(n, 12345, 67890, 2, 0, pa.data());
+    for (size_t i = 0; i < n; ++i) {
+        theta[i] *= cal::PI;
+        phi[i] *= cal::TWOPI;
+        pa[i] *= cal::TWOPI;
+    }
+    quat.resize(4 * n);
+    cal::qa_from_angles(n, theta.data(), phi.data(), pa.data(), quat.data());
+    vec.resize(3 * n);
+    cal::healpix_ang2vec(n, theta.data(), phi.data(), vec.data());
+    return;
+}
+
+template <bool soa>
+static void BM_qa_mult(benchmark::State & state) {
+    size_t n = state.range(0);
+    cal::AlignedVector <double> p;
+    cal::AlignedVector <double> q;
+    cal::AlignedVector <double> vec;
+    qarray_input(n, p, vec);
+    q = p;
+    std::reverse(q.begin(), q.end());
+    if (soa) {
+        cal::AlignedVector <double> tmp(4 * n);
+        cal::qa_aos_to_soa(n, 4, p.data(), tmp.data());
+        p.swap(tmp);
+        cal::qa_aos_to_soa(n, 4, q.data(), tmp.data());
+        q.swap(tmp);
+    }
+    cal::AlignedVector <double> r(4 * n);
+    for (auto _ : state) {
+        if (soa) {
+            cal::qa_mult_soa(n, p.data(), n, q.data(), r.data());
+        } else {
+            cal::qa_mult(n, p.data(), n, q.data(), r.data());
+        }
+        benchmark::DoNotOptimize(r.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+template <bool soa>
+static void BM_qa_rotate(benchmark::State & state) {
+    size_t n = state.range(0);
+    cal::AlignedVector <double> q;
+    cal::AlignedVector <double> v;
+    qarray_input(n, q, v);
+    if (soa) {
+        cal::AlignedVector <double> tmp(4 * n);
+        cal::qa_aos_to_soa(n, 4, q.data(), tmp.data());
+        q.swap(tmp);
+        tmp.resize(3 * n);
+        cal::qa_aos_to_soa(n, 3, v.data(), tmp.data());
+        v.swap(tmp);
+    }
+    cal::AlignedVector <double> out(3 * n);
+    for (auto _ : state) {
+        if (soa) {
+            cal::qa_rotate_soa(n, q.data(), n, v.data(), out.data());
+        } else {
+            cal::qa_rotate(n, q.data(), n, v.data(), out.data());
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void BM_qa_from_angles(benchmark::State & state) {
+    size_t n = state.range(0);
+    cal::AlignedVector <double> theta(n);
+    cal::AlignedVector <double> phi(n);
+    cal::AlignedVector <double> pa(n);
+    cal::rng_dist_uniform_01(n, 12345, 67890, 0, 0, theta.data());
+    cal::rng_dist_uniform_01(n, 12345, 67890, 1, 0, phi.data());
+    cal::rng_dist_uniform_01(n, 12345, 67890, 2, 0, pa.data());
+    for (size_t i = 0; i < n; ++i) {
+        theta[i] *= cal::PI;
+        phi[i] *= cal::TWOPI;
+        pa[i] *= cal::TWOPI;
+    }
+    cal::AlignedVector <double> quat(4 * n);
+    for (auto _ : state) {
+        cal::qa_from_angles(n, theta.data(), phi.data(), pa.data(),
+                            quat.data());
+        benchmark::DoNotOptimize(quat.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void BM_qa_to_angles(benchmark::State & state) {
+    size_t n = state.range(0);
+    cal::AlignedVector <double> quat;
+    cal::AlignedVector <double> vec;
+    qarray_input(n, quat, vec);
+    cal::AlignedVector <double> theta(n);
+    cal::AlignedVector <double> phi(n);
+    cal::AlignedVector <double> pa(n);
+    for (auto _ : state) {
+        cal::qa_to_angles(n, quat.data(), theta.data(), phi.data(),
+                          pa.data());
+        benchmark::DoNotOptimize(theta.data());
+        benchmark::DoNotOptimize(phi.data());
+        benchmark::DoNotOptimize(pa.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK_TEMPLATE(BM_qa_mult, false)->RangeMultiplier(16)
+->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(BM_qa_mult, true)->RangeMultiplier(16)
+->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(BM_qa_rotate, false)->RangeMultiplier(16)
+->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(BM_qa_rotate, true)->RangeMultiplier(16)
+->Range(1 << 12, 1 << 20);
+BENCHMARK(BM_qa_from_angles)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(BM_qa_to_angles)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
@@ -0,0 +1,78 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+
+// Random number generation.  The bytes processed counter reports the
+// generated output, so the rate is in bytes of random data per second.
+// Large draws are split across the OpenMP threads, run with
+// OMP_NUM_THREADS=1 to get the rate of a single core.
+
+static void BM_rng_uint64(benchmark::State & state) {
+    size_t n = state.range(0);
+    cal::AlignedVector <uint64_t> data(n);
+    uint64_t counter2 = 0;
+    for (auto _ : state) {
+        cal::rng_dist_uint64(n, 12345, 67890, 0, counter2, data.data());
+        benchmark::DoNotOptimize(data.data());
+        counter2 += n;
+    }
+    state.SetBytesProcessed(state.iterations() * n * sizeof(uint64_t));
+}
+
+static void BM_rng_threefry2x64(benchmark::State & state) {
+    size_t n = state.range(0);
+    cal::AlignedVector <uint64_t> data0(n);
+    cal::AlignedVector <uint64_t> data1(n);
+    uint64_t counter2 = 0;
+    for (auto _ : state) {
+        cal::rng_threefry2x64(n, 12345, 67890, 0, counter2, data0.data(),
+                                data1.data());
+        benchmark::DoNotOptimize(data0.data());
+        benchmark::DoNotOptimize(data1.data());
+        counter2 += n;
+    }
+    state.SetBytesProcessed(state.iterations() * 2 * n * sizeof(uint64_t));
+}
+
+static void BM_rng_philox4x32(benchmark::State & state) {
+    size_t n = state.range(0);
+    cal::AlignedVector <uint32_t> data(n);
+    uint64_t counter2 = 0;
+    for (auto _ : state) {
+        cal::rng_philox4x32_uint32(n, 12345, 0, counter2, data.data());
+        benchmark::DoNotOptimize(data.data());
+        counter2 += n / 4;
+    }
+    state.SetBytesProcessed(state.iterations() * n * sizeof(uint32_t));
+}
+
+static void BM_rng_uniform_01(benchmark::State & state) {
+    size_t n = state.range(0);
+    cal::AlignedVector <double> data(n);
+    uint64_t counter2 = 0;
+    for (auto _ : state) {
+        cal::rng_dist_uniform_01(n, 12345, 67890, 0, counter2, data.data());
+        benchmark::DoNotOptimize(data.data());
+        counter2 += n;
+    }
+    state.SetBytesProcessed(state.iterations() * n * sizeof(double));
+}
+
+static void BM_rng_normal(benchmark::State & state) {
+    size_t n = state.range(0);
+    cal::AlignedVector <double> data(n);
+    uint64_t counter2 = 0;
+    for (auto _ : state) {
+        cal::rng_dist_normal(n, 12345, 67890, 0, counter2, data.data());
+        benchmark::DoNotOptimize(data.data());
+        counter2 += n;
+    }
+    state.SetBytesProcessed(state.iterations() * n * sizeof(double));
+}
+
+BENCHMARK(BM_rng_uint64)->Range(1 << 10, 1 << 20)->UseRealTime();
+BENCHMARK(BM_rng_threefry2x64)->Range(1 << 10, 1 << 20)->UseRealTime();
+BENCHMARK(BM_rng_philox4x32)->Range(1 << 10, 1 << 20)->UseRealTime();
+BENCHMARK(BM_rng_uniform_01)->Range(1 << 10, 1 << 20)->UseRealTime();
+BENCHMARK(BM_rng_normal)->Range(1 << 10, 1 << 20)->UseRealTime();
@@ -0,0 +1,62 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+// Batch atmosphere production without Python: for every observation of
+// the configuration (see AtmConfig), generate the CES and the detector
+// pointing, simulate the atmosphere in time chunks and line-of-sight
+// shells as OpSimAtmosphere does, observe it with every detector and
+// write the TOD to <outdir>/<name>.bin with a <name>.txt description.
+// Samples that could not be observed are zero and flagged in
+// <name>.flags, and the exit status is then 2.
+
+#include <cal.hpp>
+
+#include <iostream>
+#include <sstream>
+
+
+namespace {
+size_t run_observation(cal::AtmObservation const & obs) {
+    cal::Timer tm;
+    tm.start();
+
+    cal::AtmTOD tod;
+    cal::atm_run_observation(obs, tod);
+    cal::atm_write_tod(obs, tod);
+
+    std::ostringstream o;
+    o << "Observation " << obs.name << ": " << obs.ndet << " x " << obs.nsamp
+      << " samples written in";
+    tm.stop();
+    tm.report(o.str().c_str());
+    return tod.nbad;
+}
+}
+
+
+int main(int argc, char * argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <config>" << std::endl;
+        return 1;
+    }
+
+    size_t nbad = 0;
+    try {
+        cal::AtmConfig config;
+        config.load(argv[1]);
+        for (size_t iobs = 0; iobs < config.size(); ++iobs) {
+            nbad += run_observation(config.observation(iobs));
+        }
+    } catch (std::exception const & e) {
+        std::cerr << argv[0] << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (nbad > 0) {
+        std::cerr << argv[0] << ": " << nbad << " samples are flagged"
+                  << std::endl;
+        return 2;
+    }
+    return 0;
+}
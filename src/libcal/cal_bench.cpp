@@ -0,0 +1,34 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <cal.hpp>
+#include <benchmark/benchmark.h>
+
+#include <bench/cal_bench_atm.hpp>
+#include <bench/cal_bench_ces.hpp>
+#include <bench/cal_bench_healpix.hpp>
+#include <bench/cal_bench_math.hpp>
+#include <bench/cal_bench_memory.hpp>
+#include <bench/cal_bench_pointing.hpp>
+#include <bench/cal_bench_qarray.hpp>
+#include <bench/cal_bench_rng.hpp>
+
+
+int main(int argc, char ** argv) {
+    // Record the build and runtime configuration in the context of the
+    // report, so that results written with --benchmark_out are comparable
+    // across releases.
+    auto & env = cal::Environment::get();
+    benchmark::AddCustomContext("cal_version", env.version());
+    benchmark::AddCustomContext("cal_simd_target", env.simd_target());
+    benchmark::AddCustomContext("cal_max_threads",
+                                std::to_string(env.max_threads()));
+    benchmark::AddCustomContext("cal_hugepage_threshold",
+                                std::to_string(env.hugepage_threshold()));
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
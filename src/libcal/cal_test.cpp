@@ -7,10 +7,14 @@
 #include <gtest/gtest.h>
 #include <tests/cal_test.hpp>
 
+#include <tests/cal_atm_test.hpp>
+#include <tests/cal_atm_config_test.hpp>
+#include <tests/cal_atm_table_test.hpp>
 #include <tests/cal_env_test.hpp>
 #include <tests/cal_healpix_test.hpp>
 #include <tests/cal_qarray_test.hpp>
 #include <tests/cal_rng_test.hpp>
+#include <tests/cal_scan_test.hpp>
 #include <tests/cal_sf_test.hpp>
 #include <tests/cal_utils_test.hpp>
 
@@ -7,13 +7,18 @@
 
 #include <cal/sys_env.hpp>
 #include <cal/sys_utils.hpp>
+#include <cal/sys_profile.hpp>
+#include <cal/sys_memory.hpp>
 #include <cal/AATM_fun.hpp>
+#include <cal/AATM_table.hpp>
 #include <cal/CALAtmSim.hpp>
+#include <cal/atm_config.hpp>
 #include <cal/math_sf.hpp>
 #include <cal/math_rng.hpp>
 #include <cal/math_qarray.hpp>
 #include <cal/math_healpix.hpp>
 #include <cal/test.hpp>
 #include <cal/tod_pointings.hpp>
+#include <cal/tod_scan.hpp>
 
 #endif // ifndef CAL_HPP
@@ -9,6 +9,7 @@
 
 #include <cmath>
 #include <cstddef>
+#include <memory>
 
 namespace cal {
 /**
@@ -66,6 +67,121 @@ int atm_get_atmospheric_loading_vec(double altitude, double temperature,
                                     double pressure, double pwv,
                                     double freqmin, double freqmax, size_t nfreq,
                                     double * loading);
+
+/**
+* Return the band-averaged absorption coefficients and equivalent black
+* body temperatures of nband bandpasses for a zenith line of sight.
+*
+*   Args:\n
+*      altitude : Observation altitude in meters.\n
+*      temperature : Observing temperature in Kelvins.\n
+*      pressure : Observing pressure in Pascals.\n
+*      pwv : Precipitable water vapor column height in mm.\n
+*      nband : Number of bandpasses.\n
+*      offsets : Band b uses the samples offsets[b] to offsets[b + 1].\n
+*      freq : Increasing bandpass frequencies in GHz.\n
+*      weight : Bandpass response at freq.\n
+*      absorption, loading : Outputs of size nband.
+*/
+int atm_get_band_averages(double altitude, double temperature,
+                          double pressure, double pwv, size_t nband,
+                          size_t const * offsets, double const * freq,
+                          double const * weight, double * absorption,
+                          double * loading);
+
+/**
+* Return the absorption coefficients and equivalent black body
+* temperatures of n atmospheric states at one frequency.  The states are
+* evaluated in parallel, each thread with its own radiative transfer model,
+* unless CAL_AATM_THREADS=0 is set in the environment.
+*
+*   Args:\n
+*      n : Number of states.\n
+*      altitude : Observation altitudes in meters.\n
+*      temperature : Observing temperatures in Kelvins.\n
+*      pressure : Observing pressures in Pascals.\n
+*      pwv : Precipitable water vapor column heights in mm.\n
+*      freq : Observing frequency in GHz.\n
+*      absorption, loading : Outputs of size n, either may be NULL.
+*/
+int atm_get_absorption_loading_batch(size_t n, double const * altitude,
+                                     double const * temperature,
+                                     double const * pressure,
+                                     double const * pwv, double freq,
+                                     double * absorption, double * loading);
+
+/**
+* \class AtmSpectrum
+* \brief Reusable radiative transfer model for one atmospheric state.
+*
+* The atmospheric profile for (altitude, temperature, pressure) is built
+* once and the refractive index profile once per frequency grid.  Changing
+* the PWV only rescales the water vapor column, so sweeps over PWV and
+* repeated queries on the same grids do not rebuild the model.  Not
+* thread safe.
+*/
+class AtmSpectrum {
+    public:
+
+        typedef std::shared_ptr <AtmSpectrum> pshr;
+        typedef std::unique_ptr <AtmSpectrum> puniq;
+
+        /**
+        * Args:\n
+        *   altitude : Observation altitude in meters.\n
+        *   temperature : Observing temperature in Kelvins.\n
+        *   pressure : Observing pressure in Pascals.
+        */
+        AtmSpectrum(double altitude, double temperature, double pressure);
+        ~AtmSpectrum();
+
+        /** Change the state.  The cached model is kept if it is unchanged. */
+        void set_state(double altitude, double temperature, double pressure);
+
+        double altitude() const {
+            return altitude_;
+        }
+
+        double temperature() const {
+            return temperature_;
+        }
+
+        double pressure() const {
+            return pressure_;
+        }
+
+        /**
+        * Absorption coefficients and equivalent black body temperatures
+        * for npwv PWV values at nfreq frequencies between freqmin and
+        * freqmax (inclusive).  The outputs are npwv x nfreq, frequency
+        * fastest.  Either output may be NULL.
+        */
+        void evaluate(size_t npwv, double const * pwv, double freqmin,
+                      double freqmax, size_t nfreq, double * absorption,
+                      double * loading);
+
+        /**
+        * Band averages of the absorption and loading for npwv PWV values
+        * and nband bandpasses, see atm_get_band_averages.  The spectrum of
+        * every band is evaluated on a regular grid covering its
+        * frequencies, and band frequencies between its nodes are linearly
+        * interpolated.  The response is integrated with the trapezoidal
+        * rule.  The outputs are npwv x nband, band fastest.
+        */
+        void band_average(size_t npwv, double const * pwv, size_t nband,
+                          size_t const * offsets, double const * freq,
+                          double const * weight, double * absorption,
+                          double * loading);
+
+    private:
+
+        struct model;
+
+        double altitude_;
+        double temperature_;
+        double pressure_;
+        std::unique_ptr <model> model_;
+};
 }
 
 #endif // ifndef CAL_AATM_UTILS_HPP
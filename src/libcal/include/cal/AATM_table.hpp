@@ -0,0 +1,148 @@
+/*
+   Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+   All rights reserved.  Use of this source code is governed by
+   a BSD-style license that can be found in the LICENSE file.
+ */
+
+#ifndef CAL_AATM_TABLE_HPP
+#define CAL_AATM_TABLE_HPP
+
+#include <cal/sys_utils.hpp>
+
+#include <functional>
+#include <string>
+
+namespace cal {
+/**
+* \class AtmTable
+* \brief Absorption and loading tabulated on a regular grid.
+*
+* Every call to the AATM utilities builds the atmospheric profile from
+* scratch.  This class evaluates the absorption coefficient and the
+* equivalent black body temperature once on a regular (altitude,
+* temperature, pressure, pwv, freq) grid and answers queries by
+* multilinear interpolation.  An axis with a single node is constant and
+* its value is not checked on queries.
+*/
+class AtmTable {
+    public:
+
+        typedef std::shared_ptr <AtmTable> pshr;
+        typedef std::unique_ptr <AtmTable> puniq;
+
+        /**
+        * Fill the absorption and loading at nfreq frequencies between
+        * freqmin and freqmax (inclusive) for one atmospheric state.
+        */
+        typedef std::function <void (double altitude, double temperature,
+                                     double pressure, double pwv,
+                                     double freqmin, double freqmax,
+                                     size_t nfreq, double * absorption,
+                                     double * loading)> generator;
+
+        static const size_t NAXIS = 5;
+
+        /**
+        * Args:\n
+        *   altmin, altmax, nalt : Altitude grid in meters.\n
+        *   Tmin, Tmax, nT : Temperature grid in Kelvins.\n
+        *   Pmin, Pmax, nP : Pressure grid in Pascals.\n
+        *   pwvmin, pwvmax, npwv : PWV grid in mm.\n
+        *   freqmin, freqmax, nfreq : Frequency grid in GHz.
+        */
+        AtmTable(double altmin, double altmax, size_t nalt,
+                 double Tmin, double Tmax, size_t nT,
+                 double Pmin, double Pmax, size_t nP,
+                 double pwvmin, double pwvmax, size_t npwv,
+                 double freqmin, double freqmax, size_t nfreq);
+
+        ~AtmTable() {}
+
+        /**
+        * Evaluate the table.  After each pass the interpolation is checked
+        * at the midpoints between the nodes of every axis and the axes
+        * whose relative error exceeds tol are refined by halving the node
+        * spacing, at most max_refine times.  A tol <= 0 disables the
+        * check.  The default generator calls the AATM utilities.
+        * Returns the largest relative error found in the last check.
+        */
+        double build(double tol = 1e-3, int max_refine = 3,
+                     generator gen = generator());
+
+        /**
+        * Load the table from cachedir if a table with the same nominal
+        * grid and tolerance was saved there, otherwise build and save it.
+        * An empty cachedir only builds.
+        */
+        void load_or_build(std::string const & cachedir, double tol = 1e-3,
+                           int max_refine = 3, generator gen = generator());
+
+        /** Unique file name for the nominal grid and tolerance. */
+        std::string cache_name(double tol) const;
+
+        void save(std::string const & path) const;
+
+        /** Returns false if path does not exist or is not a table. */
+        bool load(std::string const & path);
+
+        bool built() const {
+            return built_;
+        }
+
+        double tolerance() const {
+            return tol_;
+        }
+
+        double axis_min(size_t axis) const;
+        double axis_max(size_t axis) const;
+        size_t axis_size(size_t axis) const;
+
+        double absorption(double altitude, double temperature,
+                          double pressure, double pwv, double freq) const;
+
+        double loading(double altitude, double temperature, double pressure,
+                       double pwv, double freq) const;
+
+        /** Same frequency sampling as atm_get_absorption_coefficient_vec. */
+        void absorption_vec(double altitude, double temperature,
+                            double pressure, double pwv, double freqmin,
+                            double freqmax, size_t nfreq,
+                            double * absorption) const;
+
+        /** Same frequency sampling as atm_get_atmospheric_loading_vec. */
+        void loading_vec(double altitude, double temperature, double pressure,
+                         double pwv, double freqmin, double freqmax,
+                         size_t nfreq, double * loading) const;
+
+    private:
+
+        void locate_(size_t axis, double x, size_t & i0, double & w) const;
+        void state_weights_(double altitude, double temperature,
+                            double pressure, double pwv, size_t * offset,
+                            double * weight) const;
+        void interpolate_(AlignedVector <double> const & table,
+                          double altitude, double temperature,
+                          double pressure, double pwv, double freqmin,
+                          double freqmax, size_t nfreq, double * out) const;
+        void evaluate_(generator const & gen);
+        void refine_(generator const & gen, bool const * refine);
+        double check_(generator const & gen, double * axis_err) const;
+        double node_(size_t axis, size_t i) const;
+
+        // Nominal grid requested by the caller and the refined grid that
+        // is actually tabulated.
+        double nom_min_[NAXIS];
+        double nom_max_[NAXIS];
+        size_t nom_n_[NAXIS];
+        double min_[NAXIS];
+        double max_[NAXIS];
+        size_t n_[NAXIS];
+        size_t stride_[NAXIS];
+        double tol_;
+        bool built_;
+        AlignedVector <double> absorption_;
+        AlignedVector <double> loading_;
+};
+}
+
+#endif // ifndef CAL_AATM_TABLE_HPP
@@ -12,6 +12,8 @@ extern "C" {
 }
 #include <cal/sys_env.hpp>
 #include <cal/sys_utils.hpp>
+#include <cal/sys_profile.hpp>
+#include <cal/sys_memory.hpp>
 
 /**
 *@namespace cal
@@ -20,8 +22,8 @@ extern "C" {
 namespace cal{
 
 
-using vec_long = std::unique_ptr <AlignedVector <long> >;
-using vec_double = std::unique_ptr <AlignedVector <double> >;
+using vec_long = std::unique_ptr <FirstTouchVector <long> >;
+using vec_double = std::unique_ptr <FirstTouchVector <double> >;
 
 /**
 * \class atm_sim
@@ -108,6 +110,18 @@ class atm_sim{
         /**Helper function for print*/
         void print(std::ostream & out = std::cout) const;
 
+        /**
+        * Predict the memory used by simulate() without simulating (a dry
+        * run).  The parameters are drawn and the observed volume is found
+        * as in simulate(), then the random number counters are restored.
+        * Returns the peak bytes of every category and the "total" peak,
+        * which is less than the sum since the categories do not peak
+        * together.  The CHOLMOD peak comes from the covariance pattern of
+        * the largest slice and the factor size cholmod_analyze() predicts
+        * for it, so it is an estimate rather than a bound.
+        */
+        std::vector <MemoryStat> estimate_memory();
+
     private:
 
         std::string cachedir;
@@ -167,6 +181,8 @@ class atm_sim{
 
         cholmod_common cholcommon;
         cholmod_common * chcommon;
+        /**CHOLMOD memory last reported to the MemoryTracker*/
+        int64_t cholmod_held = 0;
         /**Draw values of lmin, lmax, w, wdir T0 (and optionally z0).*/
         void draw();
         /**Determine the rectangular volume needed*/
@@ -177,6 +193,15 @@ class atm_sim{
         /** Find the volume elements really needed*/
         void compress_volume();
 
+        /** Flag the elements in the cone and their neighbors*/
+        void flag_hits(AlignedU8 & hit);
+
+        /** Report the memory held by CHOLMOD to the MemoryTracker*/
+        void sample_cholmod_memory();
+
+        /** CHOLMOD bytes for the slice of the given full indices*/
+        int64_t cholmod_bytes(std::vector <long> const & slice);
+
         vec_double realization;
 
         /**Find the next range of compressed indices to simulate*/
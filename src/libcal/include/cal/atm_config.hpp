@@ -0,0 +1,275 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#ifndef CAL_ATM_CONFIG_HPP
+#define CAL_ATM_CONFIG_HPP
+
+#include <cal/sys_utils.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <sstream>
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace cal {
+/**
+* \struct AtmObservation
+* \brief One observation of a batch atmosphere production.
+*
+* Angles are in radians, times in seconds and distances in meters.  The
+* defaults and the RNG keys key1 and key2 follow OpSimAtmosphere, the
+* counters do not, see atm_shells().
+*/
+struct AtmObservation {
+    std::string name;
+    size_t index;
+
+    /**Constant elevation scan, see scan_ces()*/
+    double t0;
+    double rate;
+    size_t nsamp;
+    double azmin;
+    double azmax;
+    double el;
+    double scanrate;
+    double scan_accel;
+
+    /**Detectors on a square grid inscribed in the focal plane radius*/
+    size_t ndet;
+    double fp_radius;
+
+    /**Weather and the absorption at freq [GHz], not applied if freq = 0*/
+    double T0;
+    double wind_speed;
+    double wind_dir;
+    double altitude;
+    double pressure;
+    double pwv;
+    double freq;
+
+    /**Parameters of atm_sim*/
+    double lmin_center;
+    double lmin_sigma;
+    double lmax_center;
+    double lmax_sigma;
+    double z0_center;
+    double z0_sigma;
+    double zatm;
+    double zmax;
+    double xstep;
+    double ystep;
+    double zstep;
+    long nelem_sim_max;
+    int verbosity;
+    uint64_t key1;
+    uint64_t key2;
+    std::string cachedir;
+
+    /**
+    * The line of sight is split into nshell shells, the first one ends at
+    * shell_rmax.  Every further shell is shell_scale times longer and
+    * its volume elements are sqrt(shell_scale) times larger.
+    */
+    int nshell;
+    double shell_rmax;
+    double shell_scale;
+
+    /**Length of the independent simulations, 0 for the whole scan*/
+    double chunk_length;
+
+    double gain;
+    std::string outdir;
+};
+
+/**
+* \class AtmConfig
+* \brief Batch atmosphere production read from a text configuration.
+*
+* Every line is "key = value".  The lines before the first "[name]"
+* section are the defaults, every section is an observation and may
+* override any of them.  '#' starts a comment.  Unknown keys are an error,
+* so that misspelled parameters do not silently fall back to defaults.
+*/
+class AtmConfig {
+    public:
+
+        AtmConfig() {}
+
+        void load(std::string const & path);
+
+        /**Parse the configuration, source names it in the errors.*/
+        void parse(std::istream & in, std::string const & source);
+
+        size_t size() const;
+
+        AtmObservation observation(size_t iobs) const;
+
+    private:
+
+        typedef std::map <std::string, std::string> section;
+
+        double number_(size_t iobs, std::string const & key,
+                       double const * def) const;
+        int64_t integer_(size_t iobs, std::string const & key,
+                         int64_t const * def) const;
+        std::string string_(size_t iobs, std::string const & key,
+                            std::string const & def) const;
+        std::string const * find_(size_t iobs, std::string const & key) const;
+
+        section defaults_;
+        std::vector <std::string> names_;
+        std::vector <section> observations_;
+};
+
+/**Flag of the samples that could not be observed*/
+const uint8_t ATM_FLAG_BAD = 255;
+
+/**
+* \struct AtmTOD
+* \brief Pointing and atmosphere TOD of the detectors [det0, det0 + ndet)
+* of an observation, detector major.
+*/
+struct AtmTOD {
+    size_t det0;
+    size_t ndet;
+    AlignedVector <double> times;
+    AlignedVector <double> az;
+    AlignedVector <double> el;
+    AlignedVector <double> tod;
+
+    /**ATM_FLAG_BAD where a simulation failed to observe, 0 elsewhere*/
+    AlignedVector <uint8_t> flags;
+
+    /**Number of flagged samples, their TOD is zero*/
+    size_t nbad;
+};
+
+/**
+* \struct AtmShell
+* \brief One simulation of an observation: a line-of-sight shell of a
+* time chunk, observed by the samples [istart, istart + nsamp).
+*/
+struct AtmShell {
+    size_t istart;
+    size_t nsamp;
+    int ishell;
+    double azmin;
+    double azmax;
+    double elmin;
+    double elmax;
+    double tmin;
+    double tmax;
+    double rmin;
+    double rmax;
+    double xstep;
+    double ystep;
+    double zstep;
+    uint64_t counter1;
+    uint64_t counter2;
+};
+
+/**
+* Azimuth and elevation range of the atmosphere observed by an
+* observation, including the turnarounds and the focal plane.
+*/
+void atm_scan_range(AtmObservation const & obs, double & azmin,
+                    double & azmax, double & elmin, double & elmax);
+
+/**Scan and pointing of the detectors [det0, det0 + ndet), zero TOD.*/
+void atm_pointing(AtmObservation const & obs, size_t det0, size_t ndet,
+                  AtmTOD & tod);
+
+/**
+* The simulations of an observation in the order they are run.  Shell
+* ishell of time chunk ichunk uses counter1 = ichunk * nshell + ishell and
+* starts at counter2 = 0, so that no two simulations share random numbers.
+*/
+std::vector <AtmShell> atm_shells(AtmObservation const & obs,
+                                  double const * times);
+
+/**Gain and absorption coefficient applied to the observed atmosphere.*/
+double atm_gain(AtmObservation const & obs);
+
+/**
+* Simulate an observation and observe it with the detectors
+* [det0, det0 + ndet).  make_sim(shell) returns a std::unique_ptr to an
+* atm_sim or mpi_atm_sim constructed for the AtmShell, which is how the
+* serial and MPI drivers share the chunks, the shells and the absorption.
+* A failed simulation is an error.  observe() does not tell which samples
+* it failed on, so a failed observe() flags the whole chunk of the
+* detector.
+*/
+template <class MakeSim>
+void atm_run_observation(AtmObservation const & obs, size_t det0,
+                         size_t ndet, MakeSim make_sim, AtmTOD & tod) {
+    atm_pointing(obs, det0, ndet, tod);
+    double gain = atm_gain(obs);
+    size_t nsamp = obs.nsamp;
+    AlignedVector <double> buf(nsamp);
+
+    for (auto const & shell : atm_shells(obs, tod.times.data())) {
+        auto sim = make_sim(shell);
+        if (sim->simulate(!obs.cachedir.empty()) != 0) {
+            auto here = cal_HERE();
+            auto log = Logger::get();
+            std::string msg = "Observation " + obs.name
+                              + ": simulation failed";
+            log.error(msg.c_str(), here);
+            throw std::runtime_error(msg.c_str());
+        }
+
+        size_t n = shell.nsamp;
+        for (size_t idet = 0; idet < ndet; ++idet) {
+            size_t off = idet * nsamp + shell.istart;
+            int err = sim->observe(tod.times.data() + shell.istart,
+                                   tod.az.data() + off, tod.el.data() + off,
+                                   buf.data(), n);
+            if (err != 0) {
+                std::fill(tod.flags.begin() + off,
+                          tod.flags.begin() + off + n, ATM_FLAG_BAD);
+                continue;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                tod.tod[off + i] += gain * buf[i];
+            }
+        }
+    }
+
+    tod.nbad = 0;
+    for (size_t i = 0; i < tod.flags.size(); ++i) {
+        if (tod.flags[i] != 0) {
+            tod.tod[i] = 0;
+            ++tod.nbad;
+        }
+    }
+
+    if (tod.nbad > 0) {
+        std::ostringstream o;
+        o << "Observation " << obs.name << ": observing failed for "
+          << tod.nbad << " samples of detectors " << det0 << " - "
+          << det0 + ndet - 1;
+        Logger::get().warning(o.str().c_str());
+    }
+    return;
+}
+
+/**Run an observation with atm_sim and all of its detectors.*/
+void atm_run_observation(AtmObservation const & obs, AtmTOD & tod);
+
+/**Write <outdir>/<name>.txt, the description of the TOD.*/
+void atm_write_metadata(AtmObservation const & obs, size_t nbad);
+
+/**
+* Write the TOD of all detectors to <outdir>/<name>.bin, their flags to
+* <name>.flags, one byte per sample in the same order, and the .txt.
+*/
+void atm_write_tod(AtmObservation const & obs, AtmTOD const & tod);
+}
+
+#endif // ifndef CAL_ATM_CONFIG_HPP
@@ -43,6 +43,12 @@ class HealpixPixels {
                        double const * z, double const * rtz,
                        int64_t * pix) const;
 
+        void nest2zphi(int64_t n, int64_t const * pix, double * z,
+                       double * sth, double * phi) const;
+
+        void ring2zphi(int64_t n, int64_t const * pix, double * z,
+                       double * sth, double * phi) const;
+
         void ang2nest(int64_t n, double const * theta, double const * phi,
                       int64_t * pix) const;
 
@@ -53,6 +59,35 @@ class HealpixPixels {
 
         void vec2ring(int64_t n, double const * vec, int64_t * pix) const;
 
+        void nest2ang(int64_t n, int64_t const * pix, double * theta,
+                      double * phi) const;
+
+        void ring2ang(int64_t n, int64_t const * pix, double * theta,
+                      double * phi) const;
+
+        void nest2vec(int64_t n, int64_t const * pix, double * vec) const;
+
+        void ring2vec(int64_t n, int64_t const * pix, double * vec) const;
+
+        // The 8 neighbours of each pixel in the order SW, W, NW, N, NE, E,
+        // SE, S.  Missing neighbours are -1.
+        void neighbours_nest(int64_t n, int64_t const * pix,
+                             int64_t * neighbours) const;
+
+        void neighbours_ring(int64_t n, int64_t const * pix,
+                             int64_t * neighbours) const;
+
+        // Sorted pixels with centers within radius of the unit vector.  If
+        // inclusive is true, pixels overlapping the disc are also returned,
+        // possibly with a few more that are close to its edge.
+        void query_disc_nest(double const * vec, double radius,
+                             bool inclusive,
+                             std::vector <int64_t> & pix) const;
+
+        void query_disc_ring(double const * vec, double radius,
+                             bool inclusive,
+                             std::vector <int64_t> & pix) const;
+
         void ring2nest(int64_t n, int64_t const * ringpix,
                        int64_t * nestpix) const;
 
@@ -96,6 +131,14 @@ class HealpixPixels {
                    (utab_[(y >> 24) & 0xff] << 49);
         }
 
+        uint64_t xyf2nest_(int64_t x, int64_t y, int64_t face) const {
+            return xy2pix_(static_cast <uint64_t> (x),
+                           static_cast <uint64_t> (y)) +
+                   (static_cast <uint64_t> (face) << (2 * factor_));
+        }
+
+        double max_pixrad_() const;
+
         void pix2xy_(uint64_t pix, uint64_t & x, uint64_t & y) const {
             uint64_t raw;
             raw = (pix & 0x5555ull) | ((pix & 0x55550000ull) >> 15) |
@@ -60,6 +60,10 @@ void qa_slerp(size_t n_time, size_t n_targettime, double const * time,
               double const * targettime, double const * q_in,
               double * q_interp);
 
+void qa_slerp_mult(size_t n_time, size_t n_targettime, double const * time,
+                   double const * targettime, double const * q_in,
+                   size_t ndet, double const * q_det, double * q_out);
+
 void qa_exp(size_t n, double const * q_in, double * q_out);
 
 void qa_ln(size_t n, double const * q_in, double * q_out);
@@ -105,6 +109,41 @@ void qa_from_position(size_t n, double const * theta, double const * phi,
 
 void qa_to_position(size_t n, double const * quat, double * theta,
                     double * phi);
+
+// Structure-of-arrays (SoA) variants.  An array of n quaternions is
+// stored as the streams x[0 ... n-1], y, z, w and an array of vectors as
+// the streams x, y, z.
+
+void qa_aos_to_soa(size_t n, size_t d, double const * aos, double * soa);
+
+void qa_soa_to_aos(size_t n, size_t d, double const * soa, double * aos);
+
+void qa_normalize_soa(size_t n, double const * q_in, double * q_out);
+
+void qa_rotate_many_one_soa(size_t nq, double const * q,
+                            double const * v_in, double * v_out);
+
+void qa_rotate_many_many_soa(size_t n, double const * q,
+                             double const * v_in, double * v_out);
+
+void qa_rotate_soa(size_t nq, double const * q, size_t nv,
+                   double const * v_in, double * v_out);
+
+void qa_mult_many_one_soa(size_t np, double const * p, double const * q,
+                          double * r);
+
+void qa_mult_one_many_soa(double const * p, size_t nq, double const * q,
+                          double * r);
+
+void qa_mult_many_many_soa(size_t n, double const * p, double const * q,
+                           double * r);
+
+void qa_mult_soa(size_t np, double const * p, size_t nq, double const * q,
+                 double * r);
+
+void qa_slerp_soa(size_t n_time, size_t n_targettime, double const * time,
+                  double const * targettime, double const * q_in,
+                  double * q_interp);
 }
 
 #endif // ifndef CAL_QARRAY_HPP
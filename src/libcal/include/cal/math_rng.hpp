@@ -24,6 +24,13 @@ void rng_dist_uniform_11(size_t n, uint64_t key1, uint64_t key2,
 void rng_dist_normal(size_t n, uint64_t key1, uint64_t key2, uint64_t counter1,
                      uint64_t counter2, double * data);
 
+void rng_threefry2x64(size_t n, uint64_t key1, uint64_t key2,
+                      uint64_t counter1, uint64_t counter2, uint64_t * data0,
+                      uint64_t * data1);
+
+void rng_philox4x32_uint32(size_t n, uint64_t key, uint64_t counter1,
+                           uint64_t counter2, uint32_t * data);
+
 void rng_multi_dist_uint64(size_t nstream, size_t const * ndata,
                            uint64_t const * key1, uint64_t const * key2,
                            uint64_t const * counter1,
@@ -42,6 +42,11 @@ class Environment {
         void set_threads(int nthread);
         std::string version() const;
         int64_t tod_buffer_length() const;
+        int64_t hugepage_threshold() const;
+        void set_hugepage_threshold(int64_t nbytes);
+        std::string simd_target() const;
+        std::string trace_file() const;
+        bool aatm_threads() const;
 
     private:
 
@@ -63,6 +68,10 @@ class Environment {
         std::string release_version_;
         std::string version_;
         int64_t tod_buffer_length_;
+        int64_t hugepage_threshold_;
+        std::string simd_target_;
+        std::string trace_file_;
+        bool aatm_threads_;
 };
 }
 
@@ -0,0 +1,95 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#ifndef CAL_SYS_MEMORY_HPP
+#define CAL_SYS_MEMORY_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace cal {
+/**
+* \struct MemoryStat
+* \brief Memory held by one category of allocations, in bytes.
+*/
+struct MemoryStat {
+    std::string category;
+    int64_t current;
+    int64_t peak;
+    size_t allocs;
+};
+
+/**
+* \class MemoryTracker
+* \brief Singleton accounting of the memory held per category.
+*
+* The aligned allocators and the MPI shared memory windows report their
+* allocations to the category they were constructed with.  Memory that
+* is managed elsewhere (e.g. CHOLMOD workspaces) is sampled with
+* sample().  Updates are lock free, only the registration of a new
+* category takes a lock.
+*/
+class MemoryTracker {
+    public:
+
+        static const int MAX_CATEGORY = 64;
+
+        /**Category of the allocators constructed without one*/
+        static const int ALIGNED = 0;
+
+        static MemoryTracker & get();
+
+        /**Id of the named category, registered on first use.*/
+        int category(std::string const & name);
+
+        std::string name(int id) const;
+
+        void allocated(int id, size_t bytes);
+        void freed(int id, size_t bytes);
+
+        /**
+        * Report the bytes currently held by an owner of sampled memory.
+        * held is what the owner reported last and is updated, peak is the
+        * high water mark of the owner since then.
+        */
+        void sample(int id, int64_t & held, size_t current, size_t peak = 0);
+
+        int64_t current(int id) const;
+        int64_t peak(int id) const;
+
+        /**
+        * Categories that were ever used, followed by "total", the sum
+        * over all categories.
+        */
+        std::vector <MemoryStat> stats() const;
+
+        /**Set the peaks to the current values.*/
+        void reset_peak();
+
+        /**Print the statistics to STDOUT.*/
+        void report() const;
+
+    private:
+
+        struct counter {
+            std::atomic <int64_t> current;
+            std::atomic <int64_t> peak;
+            std::atomic <size_t> allocs;
+        };
+
+        MemoryTracker();
+        void add_(int id, int64_t bytes, int64_t excess);
+
+        counter counters_[MAX_CATEGORY];
+        counter total_;
+        mutable std::mutex lock_;
+        std::vector <std::string> names_;
+};
+}
+
+#endif // ifndef CAL_SYS_MEMORY_HPP
@@ -0,0 +1,155 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#ifndef CAL_SYS_PROFILE_HPP
+#define CAL_SYS_PROFILE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace cal {
+/**
+* \struct ProfileStat
+* \brief Accumulated statistics of one profiled region.
+*/
+struct ProfileStat {
+    /**Names of the enclosing regions and the region, separated by '/'*/
+    std::string path;
+    int depth;
+    /**Thread index, or -1 when accumulated over all threads*/
+    int thread;
+    int rank;
+    size_t calls;
+    double seconds;
+    double min;
+    double max;
+};
+
+/**
+* \class Profiler
+* \brief Singleton hierarchical region profiler.
+*
+* Regions are opened and closed on the calling thread, usually through a
+* ProfileRegion, and nest into a per-thread tree, so the hot path takes
+* no lock.  Regions opened by worker threads inside a parallel section
+* are the roots of that thread's tree.  The statistics should be read
+* when no region is open, e.g. after simulate() or observe().
+*/
+class Profiler {
+    public:
+
+        static Profiler & get();
+
+        bool enabled() const;
+        void set_enabled(bool enabled);
+
+        /**World rank recorded with the statistics, set by cal::mpi_init*/
+        int rank() const;
+        void set_rank(int rank);
+
+        /**Open a region.  name must outlive the profiler (a literal).*/
+        void start(char const * name);
+
+        /**Close the innermost region of the calling thread.*/
+        void stop();
+
+        /**Statistics in depth-first order, optionally per thread.*/
+        std::vector <ProfileStat> stats(bool per_thread = false) const;
+
+        /**Print the accumulated tree to STDOUT.*/
+        void report() const;
+
+        /**Reset all statistics and drop the recorded timeline.*/
+        void clear();
+
+        /**
+        * When tracing, every closed region is also recorded as an event
+        * of a timeline.  Tracing is enabled at startup by CAL_TRACE, and
+        * the timeline is then written to $CAL_TRACE_<rank>.json at exit.
+        */
+        bool tracing() const;
+        void set_tracing(bool tracing);
+
+        /**Write the timeline as Chrome trace event JSON.*/
+        void write_trace(std::string const & path) const;
+
+    private:
+
+        typedef std::chrono::steady_clock clock;
+
+        struct event {
+            char const * name;
+            clock::time_point start;
+            clock::time_point stop;
+        };
+
+        struct node {
+            char const * name;
+            node * parent;
+            std::vector <node *> children;
+            size_t calls;
+            double seconds;
+            double min;
+            double max;
+            clock::time_point start;
+        };
+
+        struct thread_data {
+            int index;
+            node root;
+            node * current;
+            std::deque <node> nodes;
+            std::vector <event> events;
+        };
+
+        Profiler();
+        thread_data & local_();
+        static void write_trace_at_exit_();
+
+        std::atomic <bool> enabled_;
+        std::atomic <bool> tracing_;
+        int rank_;
+        std::string trace_file_;
+
+        // Trace timestamps are wall clock microseconds, so that the
+        // timelines of different processes line up.
+        clock::time_point trace_epoch_;
+        double trace_epoch_us_;
+        mutable std::mutex lock_;
+        std::vector <std::unique_ptr <thread_data> > threads_;
+};
+
+/**
+* \class ProfileRegion
+* \brief Profile the enclosing scope.
+*/
+class ProfileRegion {
+    public:
+
+        ProfileRegion(char const * name) {
+            auto & prof = Profiler::get();
+            active_ = prof.enabled();
+            if (active_) prof.start(name);
+        }
+
+        ~ProfileRegion() {
+            if (active_) Profiler::get().stop();
+        }
+
+    private:
+
+        bool active_;
+
+        ProfileRegion(ProfileRegion const &) = delete;
+        ProfileRegion & operator=(ProfileRegion const &) = delete;
+};
+}
+
+#endif // ifndef CAL_SYS_PROFILE_HPP
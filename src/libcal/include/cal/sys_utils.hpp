@@ -14,8 +14,12 @@
 #include <chrono>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <type_traits>
 #include <vector>
 
+#include <cal/sys_memory.hpp>
+
 
 namespace cal {
 // Constants
@@ -67,6 +71,26 @@ static double const DEG2RAD = 1.74532925199432957692e-2;
 
 std::string format_here(std::pair <std::string, int> const & here);
 
+// Functions marked with this are compiled for several x86 instruction
+// sets and the best one for the running CPU is selected when the library
+// is loaded.  This needs GCC and the GNU ifunc loader support.
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__INTEL_COMPILER) \
+    && defined(__x86_64__) && defined(__linux__) \
+    && !defined(CAL_NO_TARGET_CLONES)
+# define CAL_HAVE_TARGET_CLONES
+# define CAL_TARGET_CLONES \
+    __attribute__((target_clones("avx512f", "avx2", "sse4.2", "default")))
+#else // if defined(__GNUC__) && ...
+# define CAL_TARGET_CLONES
+#endif // if defined(__GNUC__) && ...
+
+/**
+* Instruction set used by the runtime dispatched kernels on this CPU:
+* one of "avx512f", "avx2", "sse4.2" or "default".  Returns "native"
+* if the library was built without runtime dispatch.
+*/
+std::string simd_target();
+
 /**
 * \class Timer
 * \brief Simple timer class that tracks elapsed seconds and number of times
@@ -134,6 +158,9 @@ class GlobalTimers {
 
         /**The timer data*/
         std::map <std::string, Timer> data;
+
+        /**Serializes access from several threads*/
+        mutable std::mutex lock_;
 };
 
 
@@ -194,6 +221,12 @@ void * aligned_alloc(size_t size, size_t align);
 /** Low-level C aligned malloc / free.*/
 void aligned_free(void * ptr);
 
+/**
+* Low-level C aligned malloc that does not touch the memory.  The pages
+* are placed on the NUMA node of the thread that first writes them.
+*/
+void * aligned_alloc_untouched(size_t size, size_t align);
+
 /** Check for alignment of a pointer*/
 template <typename T>
 bool is_aligned(T * ptr) {
@@ -223,6 +256,10 @@ class AlignedAllocator {
         typedef std::size_t size_type;
         typedef std::ptrdiff_t difference_type;
 
+        // The memory keeps its category when it changes owner
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
         /**
         * \struct rebind
         * \brief allocator to type U
@@ -241,12 +278,22 @@ class AlignedAllocator {
             return &value;
         }
 
-        AlignedAllocator() throw() {}
+        AlignedAllocator() throw() : category_(MemoryTracker::ALIGNED) {}
+
+        /** account the allocations to a MemoryTracker category */
+        explicit AlignedAllocator(int category) throw()
+            : category_(category) {}
 
-        AlignedAllocator(AlignedAllocator const &) throw() {}
+        AlignedAllocator(AlignedAllocator const & other) throw()
+            : category_(other.category_) {}
 
         template <typename U>
-        AlignedAllocator(AlignedAllocator <U> const &) throw() {}
+        AlignedAllocator(AlignedAllocator <U> const & other) throw()
+            : category_(other.category()) {}
+
+        int category() const {
+            return category_;
+        }
 
         ~AlignedAllocator() throw() {}
 
@@ -260,6 +307,7 @@ class AlignedAllocator {
             pointer align_ptr =
                 static_cast <pointer> (aligned_alloc(num * sizeof(T),
                                                      SIMD_ALIGN));
+            MemoryTracker::get().allocated(category_, num * sizeof(T));
 
             return align_ptr;
         }
@@ -279,20 +327,25 @@ class AlignedAllocator {
         /** deallocate storage p of deleted elements */
         void deallocate(pointer p, size_type num) {
             aligned_free(static_cast <void *> (p));
+            MemoryTracker::get().freed(category_, num * sizeof(T));
         }
+
+    private:
+
+        int category_;
 };
 
-/** return that all specializations of this allocator are interchangeable */
+/** allocators of the same category are interchangeable */
 template <typename T1, class T2>
-bool operator==(AlignedAllocator <T1> const &,
-                AlignedAllocator <T2> const &) throw() {
-    return true;
+bool operator==(AlignedAllocator <T1> const & a,
+                AlignedAllocator <T2> const & b) throw() {
+    return a.category() == b.category();
 }
 
 template <typename T1, class T2>
-bool operator!=(AlignedAllocator <T1> const &,
-                AlignedAllocator <T2> const &) throw() {
-    return false;
+bool operator!=(AlignedAllocator <T1> const & a,
+                AlignedAllocator <T2> const & b) throw() {
+    return a.category() != b.category();
 }
 
 // Helper aliases for std::vector of a type with a AlignedAllocator for that
@@ -314,6 +367,129 @@ using AlignedI64 = std::vector <int64_t, cal::AlignedAllocator <int64_t> >;
 using AlignedU64 = std::vector <uint64_t, cal::AlignedAllocator <uint64_t> >;
 using AlignedF32 = std::vector <float, cal::AlignedAllocator <float> >;
 using AlignedF64 = std::vector <double, cal::AlignedAllocator <double> >;
+
+/**
+* \class FirstTouchAllocator
+* \brief Aligned allocator that leaves the memory untouched
+*
+* Elements are default-initialized, so a std::vector of a trivial type
+* does not write to its storage when it is created.  The caller is
+* expected to initialize it with first_touch_fill(), which spreads the
+* pages over the NUMA nodes of all OpenMP threads.
+*/
+template <typename T>
+class FirstTouchAllocator {
+    public:
+
+        // type definitions
+        typedef T value_type;
+        typedef T * pointer;
+        typedef T const * const_pointer;
+        typedef T & reference;
+        typedef T const & const_reference;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+
+        // The memory keeps its category when it changes owner
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        /**
+        * \struct rebind
+        * \brief allocator to type U
+        */
+        template <typename U>
+        struct rebind {
+            typedef FirstTouchAllocator <U> other;
+        };
+
+        FirstTouchAllocator() throw() : category_(MemoryTracker::ALIGNED) {}
+
+        /** account the allocations to a MemoryTracker category */
+        explicit FirstTouchAllocator(int category) throw()
+            : category_(category) {}
+
+        FirstTouchAllocator(FirstTouchAllocator const & other) throw()
+            : category_(other.category_) {}
+
+        template <typename U>
+        FirstTouchAllocator(FirstTouchAllocator <U> const & other) throw()
+            : category_(other.category()) {}
+
+        int category() const {
+            return category_;
+        }
+
+        ~FirstTouchAllocator() throw() {}
+
+        /** return maximum number of elements that can be allocated */
+        size_type max_size() const throw() {
+            return std::numeric_limits <std::size_t>::max() / sizeof(T);
+        }
+
+        /** allocate but don't touch num elements of type T */
+        pointer allocate(size_type const num, const void * hint = 0) {
+            pointer align_ptr =
+                static_cast <pointer> (aligned_alloc_untouched(num * sizeof(T),
+                                                               SIMD_ALIGN));
+            MemoryTracker::get().allocated(category_, num * sizeof(T));
+
+            return align_ptr;
+        }
+
+        /** default-initialize elements, which is a no-op for trivial types */
+        template <typename U>
+        void construct(U * p) {
+            new (static_cast <void *> (p)) U;
+        }
+
+        /** initialize elements of allocated storage p with value value */
+        void construct(pointer p, T const & value) {
+            new (static_cast <void *> (p)) T(value);
+        }
+
+        /** destroy elements of initialized storage p */
+        void destroy(pointer p) {
+            p->~T();
+        }
+
+        /** deallocate storage p of deleted elements */
+        void deallocate(pointer p, size_type num) {
+            aligned_free(static_cast <void *> (p));
+            MemoryTracker::get().freed(category_, num * sizeof(T));
+        }
+
+    private:
+
+        int category_;
+};
+
+template <typename T1, class T2>
+bool operator==(FirstTouchAllocator <T1> const & a,
+                FirstTouchAllocator <T2> const & b) throw() {
+    return a.category() == b.category();
+}
+
+template <typename T1, class T2>
+bool operator!=(FirstTouchAllocator <T1> const & a,
+                FirstTouchAllocator <T2> const & b) throw() {
+    return a.category() != b.category();
+}
+
+template <typename T>
+using FirstTouchVector = std::vector <T, cal::FirstTouchAllocator <T> >;
+
+/**
+* Fill n elements with a value using a static OpenMP schedule, so that
+* every thread is the first to touch a contiguous share of the pages.
+*/
+template <typename T>
+void first_touch_fill(T * data, size_t n, T const & value) {
+    # pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; ++i) {
+        data[i] = value;
+    }
+}
 }
 
 #endif // ifndef CAL_UTILS_HPP
@@ -16,6 +16,14 @@ void pointing_matrix_healpix(cal::HealpixPixels const & hpix,
                              double const * pdata, double const * hwpang,
                              uint8_t const * flags,
                              int64_t * pixels, double * weights);
+
+// Compute the detector Azimuth and Elevation from the boresight Az/El
+// quaternions and the detector offset quaternion.  If good is not NULL,
+// only samples with a nonzero good value are written, contiguously, to
+// az and el.  Returns the number of samples written.
+size_t pointing_azel(size_t n, double const * boresight,
+                     double const * detquat, uint8_t const * good,
+                     double * az, double * el);
 }
 
 #endif // ifndef CAL_TOD_POINTING_HPP
\ No newline at end of file
@@ -0,0 +1,41 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#ifndef CAL_TOD_SCAN_HPP
+#define CAL_TOD_SCAN_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cal {
+// Common flags of a ground scan, the same bits as TODGround.
+uint8_t const SCAN_TURNAROUND = 1;
+uint8_t const SCAN_LEFTRIGHT = 2;
+uint8_t const SCAN_RIGHTLEFT = 4;
+
+// Simulate the samples [first, first + n) of a constant elevation scan
+// (CES) at the elevation el_ces [rad], sampled at rate [Hz] from t0 [s].
+// The scan starts at azmin moving towards azmax [rad] and sweeps the range
+// at the sky scan rate scanrate [rad/s].  The turnarounds outside of the
+// range have the constant mount acceleration scan_accel [rad/s^2].  Each
+// sample is a closed form of its index, so any span of samples can be
+// generated independently.
+void scan_ces(double t0, double rate, size_t first, size_t n, double azmin,
+              double azmax, double el_ces, double scanrate,
+              double scan_accel, double * times, double * az, double * el,
+              uint8_t * flags);
+
+// Offset quaternions of ndet detectors on a square grid that spans
+// [-radius, radius] [rad] around the boresight in both directions.
+void scan_focalplane(size_t ndet, double radius, double * detquat);
+
+// Azimuth and elevation of ndet detectors from n samples of boresight
+// Az/El.  detaz and detel hold n samples per detector, the azimuth is in
+// (0, 2pi].
+void scan_detectors_azel(size_t n, double const * az, double const * el,
+                         size_t ndet, double const * detquat,
+                         double * detaz, double * detel);
+}
+
+#endif // ifndef CAL_TOD_SCAN_HPP
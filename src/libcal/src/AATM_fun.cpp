@@ -10,9 +10,14 @@
 * that are provided by libAATM
 */
 
+#include <cal/sys_env.hpp>
 #include <cal/sys_utils.hpp>
 #include <cal/AATM_fun.hpp>
 
+#include <algorithm>
+#include <exception>
+#include <sstream>
+
 #ifdef HAVE_AATM
 
 # include "ATMRefractiveIndexProfile.h"
@@ -79,6 +84,21 @@ atm::SkyStatus get_sky_status(double altitude, double temperature,
     return atm::SkyStatus(rip);
 }
 
+/**
+* Return nfreq frequencies between freqmin and freqmax (inclusive).
+*/
+atm::SpectralGrid get_spectral_grid(double freqmin, double freqmax,
+                                    size_t nfreq) {
+    double freqstep = 0;
+    if (nfreq > 1) freqstep = (freqmax - freqmin) / (nfreq - 1);
+
+    // aatm SpectralGrid seems to have a bug.  The first grid point is
+    // a whole grid step after the reference frequency.
+    return atm::SpectralGrid(nfreq, 0,
+                             atm::Frequency(freqmin - freqstep, "GHz"),
+                             atm::Frequency(freqstep, "GHz"));
+}
+
 /**
 * See get_sky_status. Return the frequency-band response.
 */
@@ -90,15 +110,8 @@ atm::SkyStatus get_sky_status_vec(double altitude, double temperature,
        Create an ATM SkyStatus object for the observing altitude and frequency.
      */
     atm::AtmProfile atmo = get_atmprofile(altitude, temperature, pressure);
-    double freqstep = 0;
-    if (nfreq > 1) freqstep = (freqmax - freqmin) / (nfreq - 1);
-
-    // aatm SpectralGrid seems to have a bug.  The first grid point is
-    // a whole grid step after the reference frequency.
-    atm::SpectralGrid grid(nfreq, 0,
-                           atm::Frequency(freqmin - freqstep, "GHz"),
-                           atm::Frequency(freqstep, "GHz"));
-    atm::RefractiveIndexProfile rip(grid, atmo);
+    atm::RefractiveIndexProfile rip(get_spectral_grid(freqmin, freqmax, nfreq),
+                                    atmo);
     atm::SkyStatus ss(rip);
     return ss;
 }
@@ -167,6 +180,98 @@ int cal::atm_get_atmospheric_loading_vec(double altitude,
     return 0;
 }
 
+namespace {
+// Frequency grids kept for one atmospheric profile
+size_t const ATM_SPECTRUM_MAX_GRIDS = 16;
+}
+
+struct cal::AtmSpectrum::model {
+    struct grid {
+        double freqmin;
+        double freqmax;
+        size_t nfreq;
+        std::unique_ptr <atm::SkyStatus> status;
+    };
+
+    std::unique_ptr <atm::AtmProfile> profile;
+    std::vector <grid> grids;
+};
+
+cal::AtmSpectrum::AtmSpectrum(double altitude, double temperature,
+                              double pressure) : model_(new model()) {
+    altitude_ = altitude;
+    temperature_ = temperature;
+    pressure_ = pressure;
+}
+
+cal::AtmSpectrum::~AtmSpectrum() {}
+
+void cal::AtmSpectrum::set_state(double altitude, double temperature,
+                                 double pressure) {
+    if ((altitude == altitude_) && (temperature == temperature_)
+        && (pressure == pressure_)) return;
+    altitude_ = altitude;
+    temperature_ = temperature;
+    pressure_ = pressure;
+    model_->profile.reset();
+    model_->grids.clear();
+    return;
+}
+
+void cal::AtmSpectrum::evaluate(size_t npwv, double const * pwv,
+                                double freqmin, double freqmax, size_t nfreq,
+                                double * absorption, double * loading) {
+    if ((npwv == 0) || (nfreq == 0)) return;
+
+    // The profile is built on first use
+    if (!model_->profile) {
+        model_->profile.reset(new atm::AtmProfile(
+                                  get_atmprofile(altitude_, temperature_,
+                                                 pressure_)));
+    }
+
+    atm::SkyStatus * ss = nullptr;
+    for (auto & g : model_->grids) {
+        if ((g.freqmin == freqmin) && (g.freqmax == freqmax)
+            && (g.nfreq == nfreq)) {
+            ss = g.status.get();
+            break;
+        }
+    }
+    if (ss == nullptr) {
+        if (model_->grids.size() == ATM_SPECTRUM_MAX_GRIDS) {
+            model_->grids.erase(model_->grids.begin());
+        }
+        atm::RefractiveIndexProfile rip(
+            get_spectral_grid(freqmin, freqmax, nfreq), *model_->profile);
+        model_->grids.push_back(model::grid());
+        auto & g = model_->grids.back();
+        g.freqmin = freqmin;
+        g.freqmax = freqmax;
+        g.nfreq = nfreq;
+        g.status.reset(new atm::SkyStatus(rip));
+        ss = g.status.get();
+    }
+
+    // Only the water vapor column changes between the PWV values
+    for (size_t p = 0; p < npwv; ++p) {
+        ss->setUserWH2O(pwv[p], "mm");
+        size_t off = p * nfreq;
+        if (absorption != nullptr) {
+            for (size_t i = 0; i < nfreq; ++i) {
+                double opacity = ss->getTotalOpacity(i).get();
+                absorption[off + i] = 1 - exp(-opacity);
+            }
+        }
+        if (loading != nullptr) {
+            for (size_t i = 0; i < nfreq; ++i) {
+                loading[off + i] = ss->getTebbSky(i).get();
+            }
+        }
+    }
+    return;
+}
+
 #else // ifdef HAVE_AATM
 
 double cal::atm_get_absorption_coefficient(double altitude,
@@ -224,4 +329,268 @@ int cal::atm_get_atmospheric_loading_vec(double altitude,
     return 0;
 }
 
+struct cal::AtmSpectrum::model {};
+
+cal::AtmSpectrum::AtmSpectrum(double altitude, double temperature,
+                              double pressure) : model_(new model()) {
+    altitude_ = altitude;
+    temperature_ = temperature;
+    pressure_ = pressure;
+}
+
+cal::AtmSpectrum::~AtmSpectrum() {}
+
+void cal::AtmSpectrum::set_state(double altitude, double temperature,
+                                 double pressure) {
+    altitude_ = altitude;
+    temperature_ = temperature;
+    pressure_ = pressure;
+    return;
+}
+
+void cal::AtmSpectrum::evaluate(size_t npwv, double const * pwv,
+                                double freqmin, double freqmax, size_t nfreq,
+                                double * absorption, double * loading) {
+    auto here = cal_HERE();
+    auto log = cal::Logger::get();
+    std::string msg = "Atmosphere utilities require libaatm";
+    log.error(msg.c_str(), here);
+    throw std::runtime_error(msg.c_str());
+    return;
+}
+
 #endif // ifdef HAVE_AATM
+
+namespace {
+// Largest regular grid used to cover one bandpass
+size_t const ATM_BAND_MAX_FREQ = 16384;
+
+void band_fail(std::string const & msg) {
+    auto here = cal_HERE();
+    auto log = cal::Logger::get();
+    log.error(msg.c_str(), here);
+    throw std::runtime_error(msg.c_str());
+}
+}
+
+void cal::AtmSpectrum::band_average(size_t npwv, double const * pwv,
+                                    size_t nband, size_t const * offsets,
+                                    double const * freq,
+                                    double const * weight,
+                                    double * absorption, double * loading) {
+    if ((npwv == 0) || (nband == 0)) return;
+
+    size_t const first = offsets[0];
+    size_t const nsamp = offsets[nband] - first;
+
+    // Every band has its own regular grid over its frequencies, with the
+    // smallest distinct frequency spacing of the band as the step, so
+    // that distant or narrow bands do not inflate each other's grids.
+    // The trapezoidal quadrature weight of every sample is normalized by
+    // the band integral and split between the two enclosing grid nodes.
+
+    AlignedVector <double> fmin(nband);
+    AlignedVector <double> fmax(nband);
+    AlignedVector <size_t> nfreq(nband);
+    AlignedVector <size_t> grid_off(nband + 1);
+    AlignedVector <size_t> node(nsamp);
+    AlignedVector <double> w0(nsamp);
+    AlignedVector <double> w1(nsamp);
+    grid_off[0] = 0;
+    for (size_t b = 0; b < nband; ++b) {
+        size_t start = offsets[b] - first;
+        size_t stop = offsets[b + 1] - first;
+        if (stop <= start) {
+            std::ostringstream o;
+            o << "Bandpass " << b << " has no samples";
+            band_fail(o.str());
+        }
+
+        double lo = freq[first + start];
+        double hi = freq[first + stop - 1];
+        double same = 1e-9 * std::max(1.0, std::fabs(hi));
+        double minstep = hi - lo;
+        double norm = 0;
+        for (size_t k = start; k < stop; ++k) {
+            double q = weight[first + k];
+            if (k > start) {
+                double df = freq[first + k] - freq[first + k - 1];
+                if (df <= 0) {
+                    std::ostringstream o;
+                    o << "Bandpass " << b << " frequencies are not increasing";
+                    band_fail(o.str());
+                }
+                if (df > same) minstep = std::min(minstep, df);
+            }
+            if (stop - start > 1) {
+                double flo = freq[first + std::max(k, start + 1) - 1];
+                double fhi = freq[first + std::min(k + 1, stop - 1)];
+                q *= 0.5 * (fhi - flo);
+            }
+            w0[k] = q;
+            norm += q;
+        }
+        if (norm == 0) {
+            std::ostringstream o;
+            o << "Bandpass " << b << " has zero integrated response";
+            band_fail(o.str());
+        }
+
+        size_t nf = 1;
+        double step = 0;
+        if (hi - lo > same) {
+            nf = static_cast <size_t> (std::round((hi - lo) / minstep)) + 1;
+            if (nf > ATM_BAND_MAX_FREQ) {
+                auto log = cal::Logger::get();
+                std::ostringstream o;
+                o << "Bandpass " << b << " needs " << nf
+                  << " frequencies, limited to " << ATM_BAND_MAX_FREQ
+                  << ".  The band average is interpolated.";
+                log.warning(o.str().c_str());
+                nf = ATM_BAND_MAX_FREQ;
+            }
+            step = (hi - lo) / (nf - 1);
+        }
+        fmin[b] = lo;
+        fmax[b] = hi;
+        nfreq[b] = nf;
+        grid_off[b + 1] = grid_off[b] + npwv * nf;
+
+        for (size_t k = start; k < stop; ++k) {
+            double q = w0[k] / norm;
+            double t = 0;
+            if (nf > 1) t = (freq[first + k] - lo) / step;
+            double fl = std::floor(t);
+            double frac = t - fl;
+            if (frac < 1e-6) {
+                frac = 0;
+            } else if (frac > 1 - 1e-6) {
+                fl += 1;
+                frac = 0;
+            }
+            size_t j = std::min(static_cast <size_t> (fl), nf - 1);
+            if ((nf > 1) && (j == nf - 1)) {
+                // Last node, keep the upper neighbour inside the grid
+                j -= 1;
+                frac = 1;
+            }
+            node[k] = j;
+            w0[k] = q * (1 - frac);
+            w1[k] = q * frac;
+        }
+    }
+
+    // The grids are npwv x nfreq[b], one band after the other
+    AlignedVector <double> abs_grid;
+    AlignedVector <double> load_grid;
+    if (absorption != nullptr) abs_grid.resize(grid_off[nband]);
+    if (loading != nullptr) load_grid.resize(grid_off[nband]);
+    for (size_t b = 0; b < nband; ++b) {
+        evaluate(npwv, pwv, fmin[b], fmax[b], nfreq[b],
+                 (absorption != nullptr) ? abs_grid.data() + grid_off[b]
+                 : nullptr,
+                 (loading != nullptr) ? load_grid.data() + grid_off[b]
+                 : nullptr);
+    }
+
+    size_t const * pnode = node.data();
+    double const * pw0 = w0.data();
+    double const * pw1 = w1.data();
+    for (size_t p = 0; p < npwv; ++p) {
+        for (size_t b = 0; b < nband; ++b) {
+            size_t start = offsets[b] - first;
+            size_t stop = offsets[b + 1] - first;
+            size_t goff = grid_off[b] + p * nfreq[b];
+            size_t gstep = (nfreq[b] > 1) ? 1 : 0;
+            if (absorption != nullptr) {
+                double const * g = abs_grid.data() + goff;
+                double const * g1 = g + gstep;
+                double acc = 0;
+                #pragma omp simd reduction(+:acc)
+                for (size_t k = start; k < stop; ++k) {
+                    acc += pw0[k] * g[pnode[k]] + pw1[k] * g1[pnode[k]];
+                }
+                absorption[p * nband + b] = acc;
+            }
+            if (loading != nullptr) {
+                double const * g = load_grid.data() + goff;
+                double const * g1 = g + gstep;
+                double acc = 0;
+                #pragma omp simd reduction(+:acc)
+                for (size_t k = start; k < stop; ++k) {
+                    acc += pw0[k] * g[pnode[k]] + pw1[k] * g1[pnode[k]];
+                }
+                loading[p * nband + b] = acc;
+            }
+        }
+    }
+    return;
+}
+
+int cal::atm_get_band_averages(double altitude, double temperature,
+                               double pressure, double pwv, size_t nband,
+                               size_t const * offsets, double const * freq,
+                               double const * weight, double * absorption,
+                               double * loading) {
+    cal::AtmSpectrum spec(altitude, temperature, pressure);
+    spec.band_average(1, &pwv, nband, offsets, freq, weight, absorption,
+                      loading);
+    return 0;
+}
+
+int cal::atm_get_absorption_loading_batch(size_t n, double const * altitude,
+                                          double const * temperature,
+                                          double const * pressure,
+                                          double const * pwv, double freq,
+                                          double * absorption,
+                                          double * loading) {
+    if (n == 0) return 0;
+
+    // The first state is evaluated alone so that any state libaatm
+    // initializes on first use is in place before the threads start.
+    cal::AtmSpectrum first(altitude[0], temperature[0], pressure[0]);
+    first.evaluate(1, pwv, freq, freq, 1, absorption, loading);
+
+    std::exception_ptr error = nullptr;
+    int failed = 0;
+
+    // libaatm keeps the model in the AtmProfile, RefractiveIndexProfile
+    // and SkyStatus instances, and every thread builds its own through
+    // its AtmSpectrum, so the threads only share the constant tables of
+    // the library.  CAL_AATM_THREADS=0 evaluates the batch serially, in
+    // case a libaatm build is not thread safe after all.
+    auto & env = cal::Environment::get();
+    bool threaded = env.aatm_threads();
+
+    #pragma omp parallel if (threaded)
+    {
+        // Every thread gets a contiguous range of states, so consecutive
+        // states that share (altitude, temperature, pressure) reuse the
+        // model.
+        cal::AtmSpectrum spec(altitude[0], temperature[0], pressure[0]);
+
+        #pragma omp for schedule(static)
+        for (size_t i = 1; i < n; ++i) {
+            int stop;
+            #pragma omp atomic read
+            stop = failed;
+            if (stop) continue;
+            try {
+                spec.set_state(altitude[i], temperature[i], pressure[i]);
+                spec.evaluate(1, pwv + i, freq, freq, 1,
+                              (absorption != nullptr) ? absorption + i : nullptr,
+                              (loading != nullptr) ? loading + i : nullptr);
+            } catch (...) {
+                #pragma omp critical (atm_batch_error)
+                {
+                    if (error == nullptr) error = std::current_exception();
+                }
+                #pragma omp atomic write
+                failed = 1;
+            }
+        }
+    }
+
+    if (error != nullptr) std::rethrow_exception(error);
+    return 0;
+}
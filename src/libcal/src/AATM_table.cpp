@@ -0,0 +1,584 @@
+/*
+   Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+   All rights reserved.  Use of this source code is governed by
+   a BSD-style license that can be found in the LICENSE file.
+ */
+
+#include <cal/AATM_table.hpp>
+#include <cal/AATM_fun.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <unistd.h>
+
+
+namespace {
+char const atm_table_magic[8] = {'C', 'A', 'L', 'A', 'T', 'M', '0', '1'};
+
+// Corners of the (altitude, temperature, pressure, pwv) cell
+size_t const ATM_TABLE_CORNERS = 16;
+
+void atm_table_fail(std::string const & msg) {
+    auto here = cal_HERE();
+    auto log = cal::Logger::get();
+    log.error(msg.c_str(), here);
+    throw std::runtime_error(msg.c_str());
+}
+
+double relative_error(double const * interp, double const * exact, size_t n,
+                      double scale) {
+    // Values many orders of magnitude below the table maximum (deep in
+    // the transmission windows) are compared on an absolute scale.
+    double floor = 1e-6 * scale;
+    double err = 0;
+    for (size_t i = 0; i < n; ++i) {
+        double ref = std::max(std::fabs(exact[i]), floor);
+        if (ref == 0) continue;
+        err = std::max(err, std::fabs(interp[i] - exact[i]) / ref);
+    }
+    return err;
+}
+
+double max_abs(cal::AlignedVector <double> const & v) {
+    double m = 0;
+    for (auto const & x : v) m = std::max(m, std::fabs(x));
+    return m;
+}
+}
+
+const size_t cal::AtmTable::NAXIS;
+
+cal::AtmTable::AtmTable(double altmin, double altmax, size_t nalt,
+                        double Tmin, double Tmax, size_t nT,
+                        double Pmin, double Pmax, size_t nP,
+                        double pwvmin, double pwvmax, size_t npwv,
+                        double freqmin, double freqmax, size_t nfreq) {
+    double const mins[NAXIS] = {altmin, Tmin, Pmin, pwvmin, freqmin};
+    double const maxs[NAXIS] = {altmax, Tmax, Pmax, pwvmax, freqmax};
+    size_t const ns[NAXIS] = {nalt, nT, nP, npwv, nfreq};
+    for (size_t a = 0; a < NAXIS; ++a) {
+        if ((ns[a] == 0) || (maxs[a] < mins[a])
+            || ((ns[a] == 1) && (maxs[a] != mins[a]))
+            || ((ns[a] > 1) && (maxs[a] == mins[a]))) {
+            std::ostringstream o;
+            o << "Invalid AtmTable axis " << a << ": [" << mins[a] << ", "
+              << maxs[a] << "] with " << ns[a] << " nodes";
+            atm_table_fail(o.str());
+        }
+        nom_min_[a] = mins[a];
+        nom_max_[a] = maxs[a];
+        nom_n_[a] = ns[a];
+        min_[a] = mins[a];
+        max_[a] = maxs[a];
+        n_[a] = ns[a];
+    }
+    tol_ = 0;
+    built_ = false;
+}
+
+double cal::AtmTable::axis_min(size_t axis) const {
+    return min_[axis];
+}
+
+double cal::AtmTable::axis_max(size_t axis) const {
+    return max_[axis];
+}
+
+size_t cal::AtmTable::axis_size(size_t axis) const {
+    return n_[axis];
+}
+
+double cal::AtmTable::node_(size_t axis, size_t i) const {
+    if (n_[axis] == 1) return min_[axis];
+    return min_[axis] + i * (max_[axis] - min_[axis]) / (n_[axis] - 1);
+}
+
+void cal::AtmTable::locate_(size_t axis, double x, size_t & i0,
+                            double & w) const {
+    i0 = 0;
+    w = 0;
+    if (n_[axis] == 1) return;
+    double span = max_[axis] - min_[axis];
+    double slack = 1e-9 * span;
+    if ((x < min_[axis] - slack) || (x > max_[axis] + slack)) {
+        std::ostringstream o;
+        o << "AtmTable query " << x << " is outside of axis " << axis
+          << " range [" << min_[axis] << ", " << max_[axis] << "]";
+        atm_table_fail(o.str());
+    }
+    double t = (x - min_[axis]) * (n_[axis] - 1) / span;
+    double fl = std::floor(t);
+    if (fl < 0) fl = 0;
+    if (fl > n_[axis] - 2) fl = n_[axis] - 2;
+    i0 = static_cast <size_t> (fl);
+    w = t - fl;
+    return;
+}
+
+void cal::AtmTable::state_weights_(double altitude, double temperature,
+                                   double pressure, double pwv,
+                                   size_t * offset, double * weight) const {
+    double const x[NAXIS - 1] = {altitude, temperature, pressure, pwv};
+    size_t i0[NAXIS - 1];
+    double w[NAXIS - 1];
+    for (size_t a = 0; a < NAXIS - 1; ++a) locate_(a, x[a], i0[a], w[a]);
+
+    for (size_t c = 0; c < ATM_TABLE_CORNERS; ++c) {
+        size_t off = 0;
+        double wt = 1;
+        for (size_t a = 0; a < NAXIS - 1; ++a) {
+            if ((c >> a) & 1) {
+                // Degenerate axes have zero weight on the upper corner
+                if (n_[a] > 1) off += (i0[a] + 1) * stride_[a];
+                else off += i0[a] * stride_[a];
+                wt *= w[a];
+            } else {
+                off += i0[a] * stride_[a];
+                wt *= 1 - w[a];
+            }
+        }
+        offset[c] = off;
+        weight[c] = wt;
+    }
+    return;
+}
+
+void cal::AtmTable::interpolate_(AlignedVector <double> const & table,
+                                 double altitude, double temperature,
+                                 double pressure, double pwv, double freqmin,
+                                 double freqmax, size_t nfreq,
+                                 double * out) const {
+    if (!built_) atm_table_fail("AtmTable has not been built or loaded");
+
+    size_t offset[ATM_TABLE_CORNERS];
+    double weight[ATM_TABLE_CORNERS];
+    state_weights_(altitude, temperature, pressure, pwv, offset, weight);
+
+    double const * tab = table.data();
+    size_t const fa = NAXIS - 1;
+    size_t fstep = (n_[fa] > 1) ? 1 : 0;
+    double freqstep = 0;
+    if (nfreq > 1) freqstep = (freqmax - freqmin) / (nfreq - 1);
+
+    for (size_t i = 0; i < nfreq; ++i) {
+        size_t j0;
+        double wf;
+        locate_(fa, freqmin + i * freqstep, j0, wf);
+        double val = 0;
+        for (size_t c = 0; c < ATM_TABLE_CORNERS; ++c) {
+            if (weight[c] == 0) continue;
+            double const * row = tab + offset[c] + j0;
+            val += weight[c] * ((1 - wf) * row[0] + wf * row[fstep]);
+        }
+        out[i] = val;
+    }
+    return;
+}
+
+void cal::AtmTable::evaluate_(generator const & gen) {
+    stride_[NAXIS - 1] = 1;
+    for (size_t a = NAXIS - 1; a > 0; --a) {
+        stride_[a - 1] = stride_[a] * n_[a];
+    }
+    size_t ntot = stride_[0] * n_[0];
+    absorption_.resize(ntot);
+    loading_.resize(ntot);
+
+    size_t const fa = NAXIS - 1;
+    for (size_t ialt = 0; ialt < n_[0]; ++ialt) {
+        for (size_t iT = 0; iT < n_[1]; ++iT) {
+            for (size_t iP = 0; iP < n_[2]; ++iP) {
+                for (size_t ipwv = 0; ipwv < n_[3]; ++ipwv) {
+                    size_t off = ialt * stride_[0] + iT * stride_[1]
+                                 + iP * stride_[2] + ipwv * stride_[3];
+                    gen(node_(0, ialt), node_(1, iT), node_(2, iP),
+                        node_(3, ipwv), min_[fa], max_[fa], n_[fa],
+                        absorption_.data() + off, loading_.data() + off);
+                }
+            }
+        }
+    }
+    return;
+}
+
+void cal::AtmTable::refine_(generator const & gen, bool const * refine) {
+    // An axis refined from n to 2n - 1 nodes keeps the old nodes at the
+    // even indices, only the new nodes are evaluated.
+    size_t old_n[NAXIS];
+    size_t old_stride[NAXIS];
+    for (size_t a = 0; a < NAXIS; ++a) {
+        old_n[a] = n_[a];
+        old_stride[a] = stride_[a];
+        if (refine[a]) n_[a] = 2 * n_[a] - 1;
+    }
+    AlignedVector <double> old_abs;
+    AlignedVector <double> old_load;
+    old_abs.swap(absorption_);
+    old_load.swap(loading_);
+
+    stride_[NAXIS - 1] = 1;
+    for (size_t a = NAXIS - 1; a > 0; --a) {
+        stride_[a - 1] = stride_[a] * n_[a];
+    }
+    size_t ntot = stride_[0] * n_[0];
+    absorption_.resize(ntot);
+    loading_.resize(ntot);
+
+    // With a refined frequency axis, the new frequencies of an old state
+    // are the midpoints between the old ones.
+    size_t const fa = NAXIS - 1;
+    size_t nmid = refine[fa] ? old_n[fa] - 1 : 0;
+    double half = refine[fa] ? 0.5 * (max_[fa] - min_[fa]) / nmid : 0;
+    AlignedVector <double> mid_abs(nmid);
+    AlignedVector <double> mid_load(nmid);
+
+    size_t idx[NAXIS - 1];
+    for (idx[0] = 0; idx[0] < n_[0]; ++idx[0]) {
+        for (idx[1] = 0; idx[1] < n_[1]; ++idx[1]) {
+            for (idx[2] = 0; idx[2] < n_[2]; ++idx[2]) {
+                for (idx[3] = 0; idx[3] < n_[3]; ++idx[3]) {
+                    size_t off = 0;
+                    size_t old_off = 0;
+                    bool old = true;
+                    for (size_t a = 0; a < NAXIS - 1; ++a) {
+                        off += idx[a] * stride_[a];
+                        size_t i = idx[a];
+                        if (refine[a]) {
+                            if (i % 2 != 0) old = false;
+                            i /= 2;
+                        }
+                        old_off += i * old_stride[a];
+                    }
+                    double alt = node_(0, idx[0]);
+                    double T = node_(1, idx[1]);
+                    double P = node_(2, idx[2]);
+                    double pwv = node_(3, idx[3]);
+                    if (!old) {
+                        gen(alt, T, P, pwv, min_[fa], max_[fa], n_[fa],
+                            absorption_.data() + off, loading_.data() + off);
+                        continue;
+                    }
+                    if (!refine[fa]) {
+                        std::copy(old_abs.data() + old_off,
+                                  old_abs.data() + old_off + n_[fa],
+                                  absorption_.data() + off);
+                        std::copy(old_load.data() + old_off,
+                                  old_load.data() + old_off + n_[fa],
+                                  loading_.data() + off);
+                        continue;
+                    }
+                    gen(alt, T, P, pwv, min_[fa] + half, max_[fa] - half,
+                        nmid, mid_abs.data(), mid_load.data());
+                    for (size_t j = 0; j < old_n[fa]; ++j) {
+                        absorption_[off + 2 * j] = old_abs[old_off + j];
+                        loading_[off + 2 * j] = old_load[old_off + j];
+                    }
+                    for (size_t j = 0; j < nmid; ++j) {
+                        absorption_[off + 2 * j + 1] = mid_abs[j];
+                        loading_[off + 2 * j + 1] = mid_load[j];
+                    }
+                }
+            }
+        }
+    }
+    return;
+}
+
+double cal::AtmTable::check_(generator const & gen, double * axis_err) const {
+    // Probe the midpoints of every axis interval with the other
+    // coordinates at their central node.
+    size_t const fa = NAXIS - 1;
+    double abs_scale = max_abs(absorption_);
+    double load_scale = max_abs(loading_);
+
+    AlignedVector <double> exact_abs(n_[fa]);
+    AlignedVector <double> exact_load(n_[fa]);
+    AlignedVector <double> interp(n_[fa]);
+
+    double maxerr = 0;
+    for (size_t a = 0; a < NAXIS; ++a) {
+        axis_err[a] = 0;
+        if (n_[a] == 1) continue;
+        double x[NAXIS];
+        for (size_t b = 0; b < NAXIS; ++b) x[b] = node_(b, n_[b] / 2);
+        for (size_t i = 0; i + 1 < n_[a]; ++i) {
+            double fmin = min_[fa];
+            double fmax = max_[fa];
+            size_t nf = n_[fa];
+            if (a == fa) {
+                // All frequency midpoints at once
+                double half = 0.5 * (max_[fa] - min_[fa]) / (n_[fa] - 1);
+                fmin += half;
+                fmax -= half;
+                nf -= 1;
+            } else {
+                x[a] = 0.5 * (node_(a, i) + node_(a, i + 1));
+            }
+            gen(x[0], x[1], x[2], x[3], fmin, fmax, nf, exact_abs.data(),
+                exact_load.data());
+
+            interpolate_(absorption_, x[0], x[1], x[2], x[3], fmin, fmax, nf,
+                         interp.data());
+            double err = relative_error(interp.data(), exact_abs.data(), nf,
+                                        abs_scale);
+            interpolate_(loading_, x[0], x[1], x[2], x[3], fmin, fmax, nf,
+                         interp.data());
+            err = std::max(err, relative_error(interp.data(),
+                                               exact_load.data(), nf,
+                                               load_scale));
+            axis_err[a] = std::max(axis_err[a], err);
+            if (a == fa) break;
+        }
+        maxerr = std::max(maxerr, axis_err[a]);
+    }
+    return maxerr;
+}
+
+double cal::AtmTable::build(double tol, int max_refine, generator gen) {
+    if (!gen) {
+        // The table is filled with the PWV fastest after the frequency so
+        // the model is only rebuilt when the rest of the state changes.
+        auto spec = std::make_shared <cal::AtmSpectrum> (
+            nom_min_[0], nom_min_[1], nom_min_[2]);
+        gen = [spec](double altitude, double temperature, double pressure,
+                     double pwv, double freqmin, double freqmax,
+                     size_t nfreq, double * absorption, double * loading) {
+                  spec->set_state(altitude, temperature, pressure);
+                  spec->evaluate(1, &pwv, freqmin, freqmax, nfreq,
+                                 absorption, loading);
+              };
+    }
+    auto log = cal::Logger::get();
+
+    for (size_t a = 0; a < NAXIS; ++a) {
+        min_[a] = nom_min_[a];
+        max_[a] = nom_max_[a];
+        n_[a] = nom_n_[a];
+    }
+    tol_ = tol;
+
+    double axis_err[NAXIS];
+    bool refine_axis[NAXIS];
+    double maxerr = 0;
+    int refine = 0;
+    built_ = false;
+    evaluate_(gen);
+    built_ = true;
+    while (tol > 0) {
+        maxerr = check_(gen, axis_err);
+        if ((maxerr <= tol) || (refine == max_refine)) break;
+
+        for (size_t a = 0; a < NAXIS; ++a) {
+            refine_axis[a] = (axis_err[a] > tol);
+        }
+        built_ = false;
+        refine_(gen, refine_axis);
+        built_ = true;
+        ++refine;
+    }
+
+    std::ostringstream o;
+    o << "AtmTable built with " << n_[0] << " x " << n_[1] << " x " << n_[2]
+      << " x " << n_[3] << " x " << n_[4] << " nodes";
+    if (tol > 0) {
+        o << ", interpolation error " << maxerr;
+        if (maxerr > tol) {
+            o << " exceeds the tolerance " << tol;
+            log.warning(o.str().c_str());
+            return maxerr;
+        }
+    }
+    log.debug(o.str().c_str());
+    return maxerr;
+}
+
+std::string cal::AtmTable::cache_name(double tol) const {
+    // FNV-1a hash of the nominal grid
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](void const * data, size_t nbytes) {
+                   auto bytes = static_cast <unsigned char const *> (data);
+                   for (size_t i = 0; i < nbytes; ++i) {
+                       hash ^= bytes[i];
+                       hash *= 1099511628211ULL;
+                   }
+               };
+    for (size_t a = 0; a < NAXIS; ++a) {
+        uint64_t n = nom_n_[a];
+        mix(&nom_min_[a], sizeof(double));
+        mix(&nom_max_[a], sizeof(double));
+        mix(&n, sizeof(uint64_t));
+    }
+    mix(&tol, sizeof(double));
+
+    std::ostringstream o;
+    o << "atm_table_" << std::hex << std::setw(16) << std::setfill('0')
+      << hash << ".dat";
+    return o.str();
+}
+
+void cal::AtmTable::save(std::string const & path) const {
+    if (!built_) atm_table_fail("AtmTable has not been built or loaded");
+
+    // Write to a private file and rename it so that concurrent readers
+    // never see a partial table.
+    std::ostringstream tmpname;
+    tmpname << path << ".tmp." << getpid();
+
+    std::ofstream f(tmpname.str(), std::ios::out | std::ios::binary);
+    if (!f.good()) atm_table_fail("Cannot open " + tmpname.str());
+
+    f.write(atm_table_magic, sizeof(atm_table_magic));
+    for (size_t a = 0; a < NAXIS; ++a) {
+        uint64_t nom_n = nom_n_[a];
+        uint64_t n = n_[a];
+        f.write((char *)&nom_min_[a], sizeof(double));
+        f.write((char *)&nom_max_[a], sizeof(double));
+        f.write((char *)&nom_n, sizeof(uint64_t));
+        f.write((char *)&min_[a], sizeof(double));
+        f.write((char *)&max_[a], sizeof(double));
+        f.write((char *)&n, sizeof(uint64_t));
+    }
+    f.write((char *)&tol_, sizeof(double));
+    f.write((char *)absorption_.data(), absorption_.size() * sizeof(double));
+    f.write((char *)loading_.data(), loading_.size() * sizeof(double));
+    f.close();
+    if (!f.good()) atm_table_fail("Failed to write " + tmpname.str());
+
+    if (std::rename(tmpname.str().c_str(), path.c_str()) != 0) {
+        std::remove(tmpname.str().c_str());
+        atm_table_fail("Failed to rename " + tmpname.str() + " to " + path);
+    }
+    return;
+}
+
+bool cal::AtmTable::load(std::string const & path) {
+    // Everything is read into local buffers and only committed to the
+    // table once the whole file is valid, a bad file leaves it unchanged.
+    std::ifstream f(path, std::ios::in | std::ios::binary);
+    if (!f.good()) return false;
+
+    char magic[sizeof(atm_table_magic)];
+    f.read(magic, sizeof(magic));
+    if (!f.good() || std::memcmp(magic, atm_table_magic, sizeof(magic))) {
+        return false;
+    }
+
+    double mins[NAXIS];
+    double maxs[NAXIS];
+    uint64_t ns[NAXIS];
+    for (size_t a = 0; a < NAXIS; ++a) {
+        double nom_min;
+        double nom_max;
+        uint64_t nom_n;
+        f.read((char *)&nom_min, sizeof(double));
+        f.read((char *)&nom_max, sizeof(double));
+        f.read((char *)&nom_n, sizeof(uint64_t));
+        f.read((char *)&mins[a], sizeof(double));
+        f.read((char *)&maxs[a], sizeof(double));
+        f.read((char *)&ns[a], sizeof(uint64_t));
+        if (!f.good() || (nom_min != nom_min_[a]) || (nom_max != nom_max_[a])
+            || (nom_n != nom_n_[a]) || (ns[a] == 0)) {
+            return false;
+        }
+    }
+    double tol;
+    f.read((char *)&tol, sizeof(double));
+    if (!f.good()) return false;
+
+    // The two tables must fill the rest of the file exactly.  Checking
+    // the size first also keeps a corrupt header from allocating.
+    std::streamoff here = f.tellg();
+    f.seekg(0, std::ios::end);
+    std::streamoff nbytes = f.tellg() - here;
+    f.seekg(here);
+    if (!f.good() || (nbytes % (2 * sizeof(double)) != 0)) return false;
+    uint64_t nfile = nbytes / (2 * sizeof(double));
+    size_t stride[NAXIS];
+    stride[NAXIS - 1] = 1;
+    for (size_t a = NAXIS - 1; a > 0; --a) {
+        if (stride[a] > nfile / ns[a]) return false;
+        stride[a - 1] = stride[a] * ns[a];
+    }
+    if (stride[0] * ns[0] != nfile) return false;
+    size_t ntot = nfile;
+
+    AlignedVector <double> absorption(ntot);
+    AlignedVector <double> loading(ntot);
+    f.read((char *)absorption.data(), ntot * sizeof(double));
+    f.read((char *)loading.data(), ntot * sizeof(double));
+    if (!f.good()) return false;
+
+    for (size_t a = 0; a < NAXIS; ++a) {
+        min_[a] = mins[a];
+        max_[a] = maxs[a];
+        n_[a] = ns[a];
+        stride_[a] = stride[a];
+    }
+    absorption_.swap(absorption);
+    loading_.swap(loading);
+    tol_ = tol;
+    built_ = true;
+    return true;
+}
+
+void cal::AtmTable::load_or_build(std::string const & cachedir, double tol,
+                                  int max_refine, generator gen) {
+    auto log = cal::Logger::get();
+    if (cachedir.empty()) {
+        build(tol, max_refine, gen);
+        return;
+    }
+    std::string path = cachedir + "/" + cache_name(tol);
+    if (load(path) && (tol_ == tol)) {
+        std::string msg = "Loaded AtmTable from " + path;
+        log.debug(msg.c_str());
+        return;
+    }
+    build(tol, max_refine, gen);
+    save(path);
+    std::string msg = "Saved AtmTable to " + path;
+    log.debug(msg.c_str());
+    return;
+}
+
+double cal::AtmTable::absorption(double altitude, double temperature,
+                                 double pressure, double pwv,
+                                 double freq) const {
+    double ret;
+    interpolate_(absorption_, altitude, temperature, pressure, pwv, freq, freq,
+                 1, &ret);
+    return ret;
+}
+
+double cal::AtmTable::loading(double altitude, double temperature,
+                              double pressure, double pwv, double freq) const {
+    double ret;
+    interpolate_(loading_, altitude, temperature, pressure, pwv, freq, freq,
+                 1, &ret);
+    return ret;
+}
+
+void cal::AtmTable::absorption_vec(double altitude, double temperature,
+                                   double pressure, double pwv,
+                                   double freqmin, double freqmax,
+                                   size_t nfreq, double * absorption) const {
+    interpolate_(absorption_, altitude, temperature, pressure, pwv, freqmin,
+                 freqmax, nfreq, absorption);
+    return;
+}
+
+void cal::AtmTable::loading_vec(double altitude, double temperature,
+                                double pressure, double pwv, double freqmin,
+                                double freqmax, size_t nfreq,
+                                double * loading) const {
+    interpolate_(loading_, altitude, temperature, pressure, pwv, freqmin,
+                 freqmax, nfreq, loading);
+    return;
+}
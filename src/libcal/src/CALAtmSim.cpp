@@ -208,4 +208,17 @@ cal::atm_sim::~atm_sim()
     full_index.reset();
     realization.reset();
     cholmod_finish(chcommon);
+    sample_cholmod_memory();
+}
+
+/**
+ * @brief Report the memory held by CHOLMOD and its high water mark since
+ * the previous call to the MemoryTracker.
+ */
+void cal::atm_sim::sample_cholmod_memory()
+{
+    auto & mem = cal::MemoryTracker::get();
+    mem.sample(mem.category("cholmod"), cholmod_held,
+               chcommon->memory_inuse, chcommon->memory_usage);
+    chcommon->memory_usage = chcommon->memory_inuse;
 }
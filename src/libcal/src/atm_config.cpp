@@ -0,0 +1,437 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <cal/sys_utils.hpp>
+#include <cal/atm_config.hpp>
+#include <cal/AATM_fun.hpp>
+#include <cal/CALAtmSim.hpp>
+#include <cal/tod_scan.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+
+namespace {
+char const * const known_keys[] = {
+    "t0", "rate", "duration", "azmin", "azmax", "el", "scanrate",
+    "scan_accel", "ndet", "fp_radius", "T0", "west_wind", "south_wind",
+    "altitude", "pressure", "pwv", "freq", "lmin_center", "lmin_sigma",
+    "lmax_center", "lmax_sigma", "z0_center", "z0_sigma", "zatm", "zmax",
+    "xstep", "ystep", "zstep", "nelem_sim_max", "verbosity", "realization",
+    "component", "telescope", "site", "obsindx", "cachedir", "nshell",
+    "shell_rmax", "shell_scale", "chunk_length", "gain", "outdir"
+};
+
+std::string trim(std::string const & s) {
+    size_t first = s.find_first_not_of(" \t\r");
+    if (first == std::string::npos) return std::string();
+    size_t last = s.find_last_not_of(" \t\r");
+    return s.substr(first, last - first + 1);
+}
+
+void config_error(std::string const & msg) {
+    auto here = cal_HERE();
+    auto log = cal::Logger::get();
+    log.error(msg.c_str(), here);
+    throw std::runtime_error(msg.c_str());
+}
+}
+
+void cal::AtmConfig::load(std::string const & path) {
+    std::ifstream in(path);
+    if (!in.good()) {
+        config_error("Cannot open atmosphere configuration " + path);
+    }
+    parse(in, path);
+    return;
+}
+
+void cal::AtmConfig::parse(std::istream & in, std::string const & source) {
+    section * current = &defaults_;
+    std::string line;
+    size_t lineno = 0;
+    while (std::getline(in, line)) {
+        ++lineno;
+        std::ostringstream where;
+        where << source << ":" << lineno << ": ";
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        if (line[0] == '[') {
+            if (line.back() != ']') {
+                config_error(where.str() + "unterminated section " + line);
+            }
+            std::string name = trim(line.substr(1, line.size() - 2));
+            if (name.empty() ||
+                (std::find(names_.begin(), names_.end(), name) !=
+                 names_.end())) {
+                config_error(where.str() + "empty or duplicate observation "
+                             + line);
+            }
+            names_.push_back(name);
+            observations_.push_back(section());
+            current = &observations_.back();
+            continue;
+        }
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            config_error(where.str() + "expected key = value, got " + line);
+        }
+        std::string key = trim(line.substr(0, eq));
+        std::string value = trim(line.substr(eq + 1));
+        if (std::find_if(std::begin(known_keys), std::end(known_keys),
+                         [&](char const * k) {
+                             return key == k;
+                         }) == std::end(known_keys)) {
+            config_error(where.str() + "unknown key " + key);
+        }
+        (*current)[key] = value;
+    }
+    return;
+}
+
+size_t cal::AtmConfig::size() const {
+    return observations_.size();
+}
+
+std::string const * cal::AtmConfig::find_(size_t iobs,
+                                          std::string const & key) const {
+    auto const & obs = observations_[iobs];
+    auto it = obs.find(key);
+    if (it != obs.end()) return &it->second;
+    it = defaults_.find(key);
+    if (it != defaults_.end()) return &it->second;
+    return NULL;
+}
+
+double cal::AtmConfig::number_(size_t iobs, std::string const & key,
+                               double const * def) const {
+    std::string const * value = find_(iobs, key);
+    if (value == NULL) {
+        if (def == NULL) {
+            config_error("Observation " + names_[iobs] + " has no " + key);
+        }
+        return *def;
+    }
+    char * end;
+    double ret = std::strtod(value->c_str(), &end);
+    if (value->empty() || (*end != '\0')) {
+        config_error("Observation " + names_[iobs] + ": " + key + " = "
+                     + *value + " is not a number");
+    }
+    return ret;
+}
+
+int64_t cal::AtmConfig::integer_(size_t iobs, std::string const & key,
+                                 int64_t const * def) const {
+    std::string const * value = find_(iobs, key);
+    if (value == NULL) {
+        if (def == NULL) {
+            config_error("Observation " + names_[iobs] + " has no " + key);
+        }
+        return *def;
+    }
+    char * end;
+    int64_t ret = std::strtoll(value->c_str(), &end, 10);
+    if (value->empty() || (*end != '\0')) {
+        config_error("Observation " + names_[iobs] + ": " + key + " = "
+                     + *value + " is not an integer");
+    }
+    return ret;
+}
+
+std::string cal::AtmConfig::string_(size_t iobs, std::string const & key,
+                                    std::string const & def) const {
+    std::string const * value = find_(iobs, key);
+    return (value == NULL) ? def : *value;
+}
+
+cal::AtmObservation cal::AtmConfig::observation(size_t iobs) const {
+    if (iobs >= size()) {
+        std::ostringstream o;
+        o << "Observation " << iobs << " out of range, there are " << size();
+        config_error(o.str());
+    }
+
+    // Optional values take their default from the pointer to it, the
+    // values without one are required.
+    auto num = [&](char const * key, double def) {
+                   return number_(iobs, key, &def);
+               };
+    auto req = [&](char const * key) {
+                   return number_(iobs, key, NULL);
+               };
+    auto integer = [&](char const * key, int64_t def) {
+                       return integer_(iobs, key, &def);
+                   };
+
+    AtmObservation obs;
+    obs.name = names_[iobs];
+    obs.index = integer("obsindx", iobs);
+
+    obs.t0 = num("t0", 0);
+    obs.rate = req("rate");
+    double duration = req("duration");
+    if (!((obs.rate > 0) && (duration > 0))) {
+        std::ostringstream o;
+        o << "Observation " << obs.name << ": no samples with duration = "
+          << duration << " and rate = " << obs.rate;
+        config_error(o.str());
+    }
+    obs.nsamp = (size_t)::llround(duration * obs.rate);
+    obs.azmin = req("azmin");
+    obs.azmax = req("azmax");
+    obs.el = req("el");
+    obs.scanrate = num("scanrate", cal::PI / 180);
+    obs.scan_accel = num("scan_accel", cal::PI / 180);
+
+    int64_t ndet = integer("ndet", 1);
+    if (ndet < 1) {
+        std::ostringstream o;
+        o << "Observation " << obs.name << ": ndet = " << ndet
+          << " is not positive";
+        config_error(o.str());
+    }
+    obs.ndet = ndet;
+    obs.fp_radius = num("fp_radius", 0);
+
+    double wx = req("west_wind");
+    double wy = req("south_wind");
+    obs.T0 = req("T0");
+    obs.wind_speed = ::sqrt(wx * wx + wy * wy);
+    obs.wind_dir = ::atan2(wy, wx);
+    obs.altitude = num("altitude", 0);
+    obs.pressure = num("pressure", 0);
+    obs.pwv = num("pwv", 0);
+    obs.freq = num("freq", 0);
+
+    obs.lmin_center = num("lmin_center", 0.01);
+    obs.lmin_sigma = num("lmin_sigma", 0.001);
+    obs.lmax_center = num("lmax_center", 10);
+    obs.lmax_sigma = num("lmax_sigma", 10);
+    obs.z0_center = num("z0_center", 2000);
+    obs.z0_sigma = num("z0_sigma", 0);
+    obs.zatm = num("zatm", 40000);
+    obs.zmax = num("zmax", 2000);
+    obs.xstep = num("xstep", 100);
+    obs.ystep = num("ystep", 100);
+    obs.zstep = num("zstep", 100);
+    obs.nelem_sim_max = integer("nelem_sim_max", 10000);
+    obs.verbosity = integer("verbosity", 0);
+
+    // key1 = realization * 2^32 + telescope * 2^16 + component
+    // key2 = site * 2^16 + obsindx
+    uint64_t realization = integer("realization", 0);
+    uint64_t telescope = integer("telescope", 0);
+    uint64_t component = integer("component", 123456);
+    uint64_t site = integer("site", 0);
+    obs.key1 = (realization << 32) + (telescope << 16) + component;
+    obs.key2 = (site << 16) + obs.index;
+    obs.cachedir = string_(iobs, "cachedir", "");
+
+    obs.nshell = integer("nshell", 3);
+    obs.shell_rmax = num("shell_rmax", 100);
+    obs.shell_scale = num("shell_scale", 10);
+    obs.chunk_length = num("chunk_length", 0);
+
+    obs.gain = num("gain", 1);
+    obs.outdir = string_(iobs, "outdir", ".");
+
+    std::ostringstream o;
+    if ((obs.rate <= 0) || (obs.nsamp == 0)) {
+        o << "no samples at rate = " << obs.rate;
+    } else if ((obs.ndet == 0) || (obs.fp_radius < 0)) {
+        o << "no focal plane with ndet = " << obs.ndet << ", fp_radius = "
+          << obs.fp_radius;
+    } else if ((obs.nshell < 1) || (obs.shell_rmax <= 0) ||
+               (obs.shell_scale <= 1)) {
+        o << "invalid shells: nshell = " << obs.nshell << ", shell_rmax = "
+          << obs.shell_rmax << ", shell_scale = " << obs.shell_scale;
+    } else if ((obs.freq > 0) && ((obs.pressure <= 0) || (obs.pwv <= 0))) {
+        o << "absorption at " << obs.freq
+          << " GHz needs a positive pressure and pwv";
+    }
+    if (!o.str().empty()) {
+        config_error("Observation " + obs.name + ": " + o.str());
+    }
+
+    return obs;
+}
+
+void cal::atm_scan_range(AtmObservation const & obs, double & azmin,
+                         double & azmax, double & elmin, double & elmax) {
+    // The boresight overshoots the scan by v^2 / 2a in the turnarounds.
+    // As in OpSimAtmosphere, the focal plane radius is fixed so that the
+    // set of simulated detectors does not change the atmosphere.
+
+    double v = obs.scanrate / ::cos(obs.el);
+    double overshoot = 0.5 * v * v / obs.scan_accel;
+    double elfac = 1 / ::cos(obs.el + obs.fp_radius);
+    azmin = obs.azmin - overshoot - obs.fp_radius * elfac;
+    azmax = obs.azmax + overshoot + obs.fp_radius * elfac;
+    if (azmin < -cal::TWOPI) {
+        azmin += cal::TWOPI;
+        azmax += cal::TWOPI;
+    } else if (azmax > cal::TWOPI) {
+        azmin -= cal::TWOPI;
+        azmax -= cal::TWOPI;
+    }
+    elmin = obs.el - obs.fp_radius;
+    elmax = obs.el + obs.fp_radius;
+
+    if ((elmin < 0) || (elmax > cal::PI_2)) {
+        std::ostringstream o;
+        o << "Observation " << obs.name << ": elevation range " << elmin
+          << " - " << elmax << " is not above the horizon";
+        config_error(o.str());
+    }
+    return;
+}
+
+void cal::atm_pointing(AtmObservation const & obs, size_t det0, size_t ndet,
+                       AtmTOD & tod) {
+    size_t nsamp = obs.nsamp;
+    tod.det0 = det0;
+    tod.ndet = ndet;
+    tod.times.resize(nsamp);
+    tod.az.resize(ndet * nsamp);
+    tod.el.resize(ndet * nsamp);
+    tod.tod.assign(ndet * nsamp, 0.0);
+    tod.flags.assign(ndet * nsamp, 0);
+    tod.nbad = 0;
+
+    AlignedVector <double> az(nsamp);
+    AlignedVector <double> el(nsamp);
+    AlignedVector <uint8_t> flags(nsamp);
+    cal::scan_ces(obs.t0, obs.rate, 0, nsamp, obs.azmin, obs.azmax, obs.el,
+                  obs.scanrate, obs.scan_accel, tod.times.data(), az.data(),
+                  el.data(), flags.data());
+
+    // The detector grid is inscribed in the focal plane radius
+    AlignedVector <double> detquat(4 * obs.ndet);
+    cal::scan_focalplane(obs.ndet, obs.fp_radius / ::sqrt(2), detquat.data());
+    cal::scan_detectors_azel(nsamp, az.data(), el.data(), ndet,
+                             detquat.data() + 4 * det0, tod.az.data(),
+                             tod.el.data());
+    return;
+}
+
+std::vector <cal::AtmShell> cal::atm_shells(AtmObservation const & obs,
+                                            double const * times) {
+    double azmin, azmax, elmin, elmax;
+    atm_scan_range(obs, azmin, azmax, elmin, elmax);
+
+    std::vector <AtmShell> shells;
+    size_t nsamp = obs.nsamp;
+    double tmax_tot = obs.t0 + nsamp / obs.rate;
+    double tmin = obs.t0;
+    size_t istart = 0;
+    uint64_t ichunk = 0;
+    while (istart < nsamp) {
+        double tmax = tmax_tot;
+        if (obs.chunk_length > 0) {
+            tmax = std::min(tmin + obs.chunk_length, tmax_tot);
+        }
+        size_t istop = istart;
+        while ((istop < nsamp) && (times[istop] < tmax)) ++istop;
+
+        AtmShell shell;
+        shell.istart = istart;
+        shell.nsamp = istop - istart;
+        shell.azmin = azmin;
+        shell.azmax = azmax;
+        shell.elmin = elmin;
+        shell.elmax = elmax;
+        shell.tmin = tmin;
+        shell.tmax = tmax;
+        shell.rmin = 0;
+        shell.rmax = obs.shell_rmax;
+        double step = 1;
+        for (int ishell = 0; ishell < obs.nshell; ++ishell) {
+            shell.ishell = ishell;
+            shell.xstep = obs.xstep * step;
+            shell.ystep = obs.ystep * step;
+            shell.zstep = obs.zstep * step;
+            // Every simulation has its own counter1 and draws counter2 =
+            // 0, 1, 2, ...  The streams are disjoint whatever the number
+            // of volume elements, and do not depend on whether the other
+            // simulations were loaded from the cache.
+            shell.counter1 = ichunk * obs.nshell + ishell;
+            shell.counter2 = 0;
+            shells.push_back(shell);
+
+            shell.rmin = shell.rmax;
+            shell.rmax *= obs.shell_scale;
+            step *= ::sqrt(obs.shell_scale);
+        }
+
+        ++ichunk;
+        istart = istop;
+        tmin = tmax;
+    }
+    return shells;
+}
+
+double cal::atm_gain(AtmObservation const & obs) {
+    double gain = obs.gain;
+    if (obs.freq > 0) {
+        gain *= cal::atm_get_absorption_coefficient(obs.altitude, obs.T0,
+                                                    obs.pressure, obs.pwv,
+                                                    obs.freq);
+    }
+    return gain;
+}
+
+void cal::atm_run_observation(AtmObservation const & obs, AtmTOD & tod) {
+    auto make_sim = [&](AtmShell const & s) {
+                        return std::unique_ptr <atm_sim> (new atm_sim(
+                            s.azmin, s.azmax, s.elmin, s.elmax, s.tmin,
+                            s.tmax, obs.lmin_center, obs.lmin_sigma,
+                            obs.lmax_center, obs.lmax_sigma, obs.wind_speed,
+                            0, obs.wind_dir, 0, obs.z0_center, obs.z0_sigma,
+                            obs.T0, 0, obs.zatm, obs.zmax, s.xstep, s.ystep,
+                            s.zstep, obs.nelem_sim_max, obs.verbosity,
+                            obs.key1, obs.key2, s.counter1, s.counter2,
+                            obs.cachedir, s.rmin, s.rmax));
+                    };
+    atm_run_observation(obs, 0, obs.ndet, make_sim, tod);
+    return;
+}
+
+void cal::atm_write_metadata(AtmObservation const & obs, size_t nbad) {
+    std::string base = obs.outdir + "/" + obs.name;
+    std::ofstream meta(base + ".txt");
+    meta.precision(16);
+    meta << "name = " << obs.name << std::endl
+         << "ndet = " << obs.ndet << std::endl
+         << "nsamp = " << obs.nsamp << std::endl
+         << "t0 = " << obs.t0 << std::endl
+         << "rate = " << obs.rate << std::endl
+         << "layout = float64, detector major" << std::endl
+         << "flags = uint8, " << (int)ATM_FLAG_BAD << " if not observed"
+         << std::endl
+         << "nbad = " << nbad << std::endl;
+    if (!meta.good()) {
+        config_error("Failed to write " + base + ".txt");
+    }
+    return;
+}
+
+void cal::atm_write_tod(AtmObservation const & obs, AtmTOD const & tod) {
+    std::string base = obs.outdir + "/" + obs.name;
+    std::ofstream out(base + ".bin", std::ios::binary);
+    out.write(reinterpret_cast <char const *> (tod.tod.data()),
+              tod.tod.size() * sizeof(double));
+    std::ofstream flags(base + ".flags", std::ios::binary);
+    flags.write(reinterpret_cast <char const *> (tod.flags.data()),
+                tod.flags.size());
+    if (!out.good() || !flags.good()) {
+        config_error("Failed to write the TOD to " + base);
+    }
+    atm_write_metadata(obs, tod.nbad);
+    return;
+}
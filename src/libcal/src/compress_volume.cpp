@@ -8,6 +8,7 @@
 
 void cal::atm_sim::compress_volume()
 {
+    cal::ProfileRegion region("compress_volume");
     // Establish a mapping between full volume indices and observed
     // volume indices
     cal::Timer tm;
@@ -17,13 +18,22 @@ void cal::atm_sim::compress_volume()
         std::cerr << "Compressing volume, N = " << nn << std::endl;
     }
 
-    std::vector <unsigned char> hit;
+    auto & mem = cal::MemoryTracker::get();
+    AlignedU8 hit(AlignedAllocator <uint8_t> (mem.category("hit_mask")));
     try {
-        compressed_index.reset(new AlignedVector <long> (nn));
-        std::fill(compressed_index->begin(), compressed_index->end(), -1);
-
-        full_index.reset(new AlignedVector <long> (nn));
-        std::fill(full_index->begin(), full_index->end(), -1);
+        // Touch the pages in parallel so that the random gathers in
+        // observe are served from all NUMA nodes
+        compressed_index.reset(new FirstTouchVector <long> (
+                                   FirstTouchAllocator <long> (
+                                       mem.category("compressed_index"))));
+        compressed_index->resize(nn);
+        first_touch_fill(compressed_index->data(), nn, -1L);
+
+        full_index.reset(new FirstTouchVector <long> (
+                             FirstTouchAllocator <long> (
+                                 mem.category("full_index"))));
+        full_index->resize(nn);
+        first_touch_fill(full_index->data(), nn, -1L);
 
         hit.resize(nn, false);
     } catch (...) {
@@ -32,6 +42,52 @@ void cal::atm_sim::compress_volume()
                   << nn << std::endl;
         throw;
     }
+
+    flag_hits(hit);
+
+    if ((rank == 0) && (verbosity > 0)) {
+        std::cerr << "Creating compression table" << std::endl;
+    }
+
+    // Then create the mappings between the compressed and full indices
+
+    long i = 0;
+    for (long ifull = 0; ifull < nn; ++ifull) {
+        if (hit[ifull]) {
+            (*full_index)[i] = ifull;
+            (*compressed_index)[ifull] = i;
+            ++i;
+        }
+    }
+
+    hit.clear();
+    hit.shrink_to_fit();
+    nelem = i;
+
+    full_index->resize(nelem);
+    full_index->shrink_to_fit();
+
+    tm.stop();
+
+    if (rank == 0) {
+        // if ( verbosity > 0 ) {
+        tm.report("Volume compressed in");
+        std::cout << i << " / " << nn << "(" << i * 100. / nn << " %)"
+                  << " volume elements are needed for the simulation"
+                  << std::endl
+                  << "nx = " << nx << " ny = " << ny << " nz = " << nz
+                  << std::endl
+                  << "wx = " << wx << " wy = " << wy << " wz = " << wz
+                  << std::endl;
+
+        // }
+    }
+
+    if (nelem == 0) throw std::runtime_error("No elements in the observation cone.");
+}
+
+void cal::atm_sim::flag_hits(AlignedU8 & hit)
+{
     // Start by flagging all elements that are hit
 
     for (long ix = 0; ix < nx - 1; ++ix) {
@@ -61,7 +117,7 @@ void cal::atm_sim::compress_volume()
 
     // For extra margin, flag all the neighbors of the hit elements
 
-    std::vector <unsigned char> hit2 = hit;
+    AlignedU8 hit2 = hit;
 
     for (long ix = 1; ix < nx - 1; ++ix) {
         if (ix % ntask != rank) continue;
@@ -99,43 +155,5 @@ void cal::atm_sim::compress_volume()
         }
     }
 
-    hit2.resize(0);
-
-    if ((rank == 0) && (verbosity > 0)) {
-        std::cerr << "Creating compression table" << std::endl;
-    }
-
-    // Then create the mappings between the compressed and full indices
-
-    long i = 0;
-    for (long ifull = 0; ifull < nn; ++ifull) {
-        if (hit[ifull]) {
-            (*full_index)[i] = ifull;
-            (*compressed_index)[ifull] = i;
-            ++i;
-        }
-    }
-
-    hit.resize(0);
-    nelem = i;
-
-    full_index->resize(nelem);
-
-    tm.stop();
-
-    if (rank == 0) {
-        // if ( verbosity > 0 ) {
-        tm.report("Volume compressed in");
-        std::cout << i << " / " << nn << "(" << i * 100. / nn << " %)"
-                  << " volume elements are needed for the simulation"
-                  << std::endl
-                  << "nx = " << nx << " ny = " << ny << " nz = " << nz
-                  << std::endl
-                  << "wx = " << wx << " wy = " << wy << " wz = " << wz
-                  << std::endl;
-
-        // }
-    }
-
-    if (nelem == 0) throw std::runtime_error("No elements in the observation cone.");
+    return;
 }
@@ -11,6 +11,7 @@
 void cal::atm_sim::apply_sparse_covariance(cholmod_sparse * sqrt_cov,
                              long ind_start, long ind_stop)
 {
+    cal::ProfileRegion region("apply_sparse_covariance");
     // Apply the Cholesky-decomposed (square-root) sparse covariance
     // matrix to a vector of Gaussian random numbers to impose the
     // desired correlation properties.
@@ -24,6 +24,7 @@
 */
 void cal::atm_sim::draw()
 {
+    cal::ProfileRegion region("draw");
     const uint64_t nrand = 10000;
     double randn[nrand];
     cal::rng_dist_normal(nrand, key1, key2, counter1, counter2, randn);
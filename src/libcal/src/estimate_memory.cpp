@@ -0,0 +1,220 @@
+/*
+   Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+   All rights reserved.  Use of this source code is governed by
+   a BSD-style license that can be found in the LICENSE file.
+ */
+
+#include <cal/CALAtmSim.hpp>
+
+#include <algorithm>
+
+std::vector <cal::MemoryStat> cal::atm_sim::estimate_memory()
+{
+    cal::ProfileRegion region("estimate_memory");
+
+    // draw() advances the counters, restore them so that simulate()
+    // draws the same parameters
+    uint64_t c1 = counter1;
+    uint64_t c2 = counter2;
+    draw();
+    get_volume();
+    counter1 = c1;
+    counter2 = c2;
+
+    auto & mem = cal::MemoryTracker::get();
+    AlignedU8 hit(AlignedAllocator <uint8_t> (mem.category("hit_mask")));
+    hit.resize(nn, false);
+    flag_hits(hit);
+
+    // Observed elements per X layer
+    std::vector <size_t> layer(nx, 0);
+    size_t nobs = 0;
+    for (long ifull = 0; ifull < nn; ++ifull) {
+        if (hit[ifull]) {
+            ++layer[ifull / xstride];
+            ++nobs;
+        }
+    }
+
+    // Largest slice, following get_slice()
+    const long nlayer_sim_max = 10;
+    size_t nslice_max = 0;
+    long ix_max = 0, ix_max_stop = 0;
+    long ix = 0;
+    while (true) {
+        while ((ix < nx) && (layer[ix] == 0)) ++ix;
+        if (ix == nx) break;
+        long ix_start = ix;
+        size_t nslice = 0;
+        while (true) {
+            nslice += layer[ix++];
+            while ((ix < nx) && (layer[ix] == 0)) ++ix;
+            if (ix == nx) break;
+            if (nslice >= nelem_sim_max) break;
+            if (ix - ix_start >= nlayer_sim_max) break;
+        }
+        if (nslice > nslice_max) {
+            nslice_max = nslice;
+            ix_max = ix_start;
+            ix_max_stop = ix;
+        }
+    }
+
+    std::vector <long> slice_max;
+    slice_max.reserve(nslice_max);
+    for (long ifull = ix_max * xstride; ifull < ix_max_stop * xstride;
+         ++ifull) {
+        if (hit[ifull]) slice_max.push_back(ifull);
+    }
+    hit.clear();
+    hit.shrink_to_fit();
+
+    int64_t nbytes_cholmod = cholmod_bytes(slice_max);
+
+    int64_t nbytes_compressed = nn * sizeof(long);
+    int64_t nbytes_full = nn * sizeof(long);
+    int64_t nbytes_hit = 2 * nn * sizeof(uint8_t);
+    int64_t nbytes_realization = nobs * sizeof(double);
+
+    // The full index is copied when it shrinks to the observed elements
+    int64_t nbytes_shrunk = ((long)nobs < nn) ? nobs * sizeof(long) : 0;
+
+    // Flagging the hits, shrinking the full index and simulating
+    int64_t nbytes_total = nbytes_compressed + nbytes_full + nbytes_hit;
+    nbytes_total = std::max(nbytes_total,
+                            nbytes_compressed + nbytes_full + nbytes_shrunk);
+    nbytes_total = std::max(nbytes_total,
+                            nbytes_compressed
+                            + (int64_t)(nobs * sizeof(long))
+                            + nbytes_realization + nbytes_cholmod);
+
+    std::vector <MemoryStat> ret;
+    auto add = [&](std::string const & category, int64_t bytes) {
+        MemoryStat st;
+        st.category = category;
+        st.current = 0;
+        st.peak = bytes;
+        st.allocs = 0;
+        ret.push_back(st);
+    };
+    add("compressed_index", nbytes_compressed);
+    add("full_index", nbytes_full + nbytes_shrunk);
+    add("hit_mask", nbytes_hit);
+    add("realization", nbytes_realization);
+    add("cholmod", nbytes_cholmod);
+    add("total", nbytes_total);
+
+    if ((rank == 0) && (verbosity > 0)) {
+        std::cerr << "Estimated peak memory: " << nbytes_total / 1048576.
+                  << " MB for " << nobs << " / " << nn
+                  << " volume elements, largest slice " << nslice_max
+                  << std::endl;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Bytes held by CHOLMOD while simulating a slice, given by the
+ * full indices of its elements.
+ *
+ * The sparsity pattern of the covariance follows build_sparse_covariance()
+ * and cholmod_analyze() predicts the size of its factor with the ordering
+ * that the simulation will use.  Nothing is factorized.
+ */
+int64_t cal::atm_sim::cholmod_bytes(std::vector <long> const & slice)
+{
+    cal::ProfileRegion region("cholmod_bytes");
+
+    size_t nelem = slice.size();
+    if (nelem == 0) return 0;
+
+    // Coordinates in the horizontal frame, as ind2coord()
+    std::vector <double> coord(3 * nelem);
+    for (size_t i = 0; i < nelem; ++i) {
+        long ifull = slice[i];
+        long ix = ifull * xstrideinv;
+        long iy = (ifull - ix * xstride) * ystrideinv;
+        long iz = ifull - ix * xstride - iy * ystride;
+        double x = xstart + ix * xstep;
+        double y = ystart + iy * ystep;
+        double z = zstart + iz * zstep;
+        coord[3 * i] = x * cosel0 - z * sinel0;
+        coord[3 * i + 1] = y;
+        coord[3 * i + 2] = x * sinel0 + z * cosel0;
+    }
+
+    // The covariance keeps the pairs correlated above corrlim.  The
+    // altitude factors cancel in the correlation, which only depends on
+    // the distance.
+    double kolmo0 = kolmogorov(0);
+    auto correlated = [&](size_t i, size_t j) {
+                          double dx = coord[3 * i] - coord[3 * j];
+                          double dy = coord[3 * i + 1] - coord[3 * j + 1];
+                          double dz = coord[3 * i + 2] - coord[3 * j + 2];
+                          double r2 = dx * dx + dy * dy + dz * dz;
+                          if (r2 >= rcorrsq) return (i == j);
+                          double val = kolmogorov(sqrt(r2));
+                          return val * val > 1e-6 * kolmo0 * kolmo0;
+                      };
+
+    // Upper triangle of the pattern, in columns
+    std::vector <int> colstart(nelem + 1, 0);
+    # pragma omp parallel for schedule(dynamic, 10)
+    for (size_t icol = 0; icol < nelem; ++icol) {
+        int n = 0;
+        for (size_t irow = 0; irow <= icol; ++irow) {
+            if (correlated(irow, icol)) ++n;
+        }
+        colstart[icol + 1] = n;
+    }
+    for (size_t icol = 0; icol < nelem; ++icol) {
+        colstart[icol + 1] += colstart[icol];
+    }
+    int64_t nnz = colstart[nelem];
+
+    cholmod_sparse * pattern = cholmod_allocate_sparse(nelem, nelem, nnz, 1,
+                                                       1, 1, CHOLMOD_PATTERN,
+                                                       chcommon);
+    if (chcommon->status != CHOLMOD_OK) throw std::runtime_error(
+                  "cholmod_allocate_sparse failed.");
+    int * colptr = static_cast <int *> (pattern->p);
+    int * rowind = static_cast <int *> (pattern->i);
+    std::copy(colstart.begin(), colstart.end(), colptr);
+    # pragma omp parallel for schedule(dynamic, 10)
+    for (size_t icol = 0; icol < nelem; ++icol) {
+        int offset = colstart[icol];
+        for (size_t irow = 0; irow <= icol; ++irow) {
+            if (correlated(irow, icol)) rowind[offset++] = irow;
+        }
+    }
+
+    cholmod_factor * factorization = cholmod_analyze(pattern, chcommon);
+    if (chcommon->status != CHOLMOD_OK) throw std::runtime_error(
+                  "cholmod_analyze failed.");
+    double nfactor = factorization->is_super ? factorization->xsize
+                     : chcommon->lnz;
+    cholmod_free_factor(&factorization, chcommon);
+    cholmod_free_sparse(&pattern, chcommon);
+
+    // The dry run is not part of the high water mark of the simulation
+    chcommon->memory_usage = chcommon->memory_inuse;
+
+    // Every entry is an int row index and a double.  Building the
+    // covariance holds its triplet form and the compressed copy, then
+    // the covariance, the factor and the sparse square root are held
+    // together.  The column pointers, the permutation and the CHOLMOD
+    // workspace add a few ints per element.
+    int64_t entry = sizeof(int) + sizeof(double);
+    int64_t nbytes_build = nnz * (entry + sizeof(int) + entry);
+    int64_t nbytes_factor = (nnz + 2 * (int64_t)nfactor) * entry;
+    int64_t nbytes_columns = 16 * (nelem + 1) * sizeof(int);
+
+    if ((rank == 0) && (verbosity > 0)) {
+        std::cerr << "Largest slice: " << nelem << " elements, "
+                  << nnz << " covariance and " << nfactor
+                  << " factor entries" << std::endl;
+    }
+
+    return std::max(nbytes_build, nbytes_factor) + nbytes_columns;
+}
@@ -14,6 +14,7 @@
 
 void cal::atm_sim::get_volume()
 {
+    cal::ProfileRegion region("get_volume");
     // Trim zmax if rmax sets a more stringent limit
     double zmax_from_rmax = rmax * sin(elmax);
     if (zmax > zmax_from_rmax) zmax = zmax_from_rmax;
@@ -8,6 +8,7 @@
 #include <fstream>
 
 void cal::atm_sim::initialize_kolmogorov(){
+    cal::ProfileRegion region("initialize_kolmogorov");
     auto & logger = cal::Logger::get();
     cal::Timer tm;
     tm.start();
@@ -9,6 +9,7 @@
 
 void cal::atm_sim::load_realization()
 {
+    cal::ProfileRegion region("load_realization");
     cached = false;
 
     std::ostringstream name;
@@ -97,12 +98,19 @@ void cal::atm_sim::load_realization()
 
     // Load realization
 
+    auto & mem = cal::MemoryTracker::get();
     try {
-        compressed_index.reset(new AlignedVector <long> (nn));
-        std::fill(compressed_index->begin(), compressed_index->end(), -1);
-
-        full_index.reset(new AlignedVector <long> (nelem));
-        std::fill(full_index->begin(), full_index->end(), -1);
+        compressed_index.reset(new FirstTouchVector <long> (
+                                   FirstTouchAllocator <long> (
+                                       mem.category("compressed_index"))));
+        compressed_index->resize(nn);
+        first_touch_fill(compressed_index->data(), nn, -1L);
+
+        full_index.reset(new FirstTouchVector <long> (
+                             FirstTouchAllocator <long> (
+                                 mem.category("full_index"))));
+        full_index->resize(nelem);
+        first_touch_fill(full_index->data(), nelem, -1L);
     } catch (...) {
         std::cerr << rank
                   << " : Failed to allocate element indices. nn = "
@@ -110,8 +118,11 @@ void cal::atm_sim::load_realization()
         throw;
     }
     try {
-        realization.reset(new AlignedVector <double> (nelem));
-        std::fill(realization->begin(), realization->end(), 0.0);
+        realization.reset(new FirstTouchVector <double> (
+                              FirstTouchAllocator <double> (
+                                  mem.category("realization"))));
+        realization->resize(nelem);
+        first_touch_fill(realization->data(), nelem, 0.0);
     } catch (...) {
         std::cerr << rank
                   << " : Failed to allocate realization. nelem = "
@@ -147,6 +158,7 @@ void cal::atm_sim::load_realization()
 }
 void cal::atm_sim::save_realization()
 {
+    cal::ProfileRegion region("save_realization");
     if (rank == 0) {
         std::ostringstream name;
         name << key1 << "_" << key2 << "_"
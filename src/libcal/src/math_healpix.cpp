@@ -8,6 +8,48 @@
 #include <cal/math_healpix.hpp>
 
 #include <cmath>
+#include <algorithm>
+
+
+namespace {
+// Number of pixels converted together by the pixel to angle / vector
+// functions.  Chunks are distributed over the OpenMP threads.
+int64_t const HPIX_CHUNK = 512;
+
+// Neighbour offsets in the face, in the order SW, W, NW, N, NE, E, SE, S.
+int const nb_xoffset[] = {-1, -1, 0, 1, 1, 1, 0, -1};
+int const nb_yoffset[] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+// Face of a neighbour that is across a face boundary, indexed by the
+// direction of the crossing and the current face.  The direction is
+// 4 + (-1 / +1 for the x edge) + (-3 / +3 for the y edge).
+int const nb_facearray[][12] = {
+    {8, 9, 10, 11, -1, -1, -1, -1, 10, 11, 8, 9},  // S
+    {5, 6, 7, 4, 8, 9, 10, 11, 9, 10, 11, 8},      // SE
+    {-1, -1, -1, -1, 5, 6, 7, 4, -1, -1, -1, -1},  // E
+    {4, 5, 6, 7, 11, 8, 9, 10, 11, 8, 9, 10},      // SW
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11},        // center
+    {1, 2, 3, 0, 0, 1, 2, 3, 5, 6, 7, 4},          // NE
+    {-1, -1, -1, -1, 7, 4, 5, 6, -1, -1, -1, -1},  // W
+    {3, 0, 1, 2, 3, 0, 1, 2, 4, 5, 6, 7},          // NW
+    {2, 3, 0, 1, -1, -1, -1, -1, 0, 1, 2, 3}       // N
+};
+
+// Coordinate flips needed in the neighbouring face, indexed by the
+// direction and the face row.  Bit 1 flips x, bit 2 flips y and bit 4
+// swaps x and y.
+int const nb_swaparray[][3] = {
+    {0, 0, 3},  // S
+    {0, 0, 6},  // SE
+    {0, 0, 0},  // E
+    {0, 0, 5},  // SW
+    {0, 0, 0},  // center
+    {5, 0, 0},  // NE
+    {0, 0, 0},  // W
+    {6, 0, 0},  // NW
+    {3, 0, 0}   // N
+};
+}
 
 
 const int64_t cal::HealpixPixels::jr_[] =
@@ -1105,3 +1147,454 @@ void cal::HealpixPixels::upgrade_nest(int factor, int64_t n,
 
     return;
 }
+
+void cal::HealpixPixels::nest2zphi(int64_t n, int64_t const * pix, double * z,
+                                     double * sth, double * phi) const {
+    if (n > std::numeric_limits <int>::max()) {
+        auto here = cal_HERE();
+        auto log = cal::Logger::get();
+        std::string msg("healpix vector conversion must be in chunks of < 2^31");
+        log.error(msg.c_str(), here);
+        throw std::runtime_error(msg.c_str());
+    }
+
+    // The sine of the colatitude is computed from the distance to the pole
+    // in the polar caps, where it is more accurate than from z.
+
+    double fact2 = 4.0 / static_cast <double> (npix_);
+    double fact1 = static_cast <double> (twonside_) * fact2;
+    int64_t npface = nside_ * nside_;
+
+    #pragma omp simd
+    for (int64_t i = 0; i < n; ++i) {
+        int64_t face = pix[i] >> (2 * factor_);
+        uint64_t x;
+        uint64_t y;
+        pix2xy_(pix[i] & (npface - 1), x, y);
+        int64_t ix = static_cast <int64_t> (x);
+        int64_t iy = static_cast <int64_t> (y);
+
+        int64_t jr = jr_[face] * nside_ - ix - iy - 1;
+        int64_t nr;
+        if (jr < nside_) {
+            nr = jr;
+            double tmp = static_cast <double> (nr * nr) * fact2;
+            z[i] = 1.0 - tmp;
+            sth[i] = ::sqrt(tmp * (2.0 - tmp));
+        } else if (jr > 3 * nside_) {
+            nr = fournside_ - jr;
+            double tmp = static_cast <double> (nr * nr) * fact2;
+            z[i] = tmp - 1.0;
+            sth[i] = ::sqrt(tmp * (2.0 - tmp));
+        } else {
+            nr = nside_;
+            z[i] = static_cast <double> (twonside_ - jr) * fact1;
+            sth[i] = ::sqrt((1.0 - z[i]) * (1.0 + z[i]));
+        }
+
+        int64_t tmp = jp_[face] * nr + ix - iy;
+        if (tmp < 0) {
+            tmp += 8 * nr;
+        }
+        phi[i] = (nr == nside_)
+                 ? 0.75 * PI_2 * static_cast <double> (tmp) * fact1
+                 : (0.5 * PI_2 * static_cast <double> (tmp)) /
+                 static_cast <double> (nr);
+    }
+
+    return;
+}
+
+void cal::HealpixPixels::ring2zphi(int64_t n, int64_t const * pix, double * z,
+                                     double * sth, double * phi) const {
+    if (n > std::numeric_limits <int>::max()) {
+        auto here = cal_HERE();
+        auto log = cal::Logger::get();
+        std::string msg("healpix vector conversion must be in chunks of < 2^31");
+        log.error(msg.c_str(), here);
+        throw std::runtime_error(msg.c_str());
+    }
+
+    double fact2 = 4.0 / static_cast <double> (npix_);
+    double fact1 = static_cast <double> (twonside_) * fact2;
+
+    #pragma omp simd
+    for (int64_t i = 0; i < n; ++i) {
+        int64_t iring;
+        int64_t iphi;
+        if (pix[i] < ncap_) {
+            iring = static_cast <int64_t> (
+                0.5 * (1.0 + ::sqrt(static_cast <double> (1 + 2 * pix[i]))));
+            iphi = (pix[i] + 1) - 2 * iring * (iring - 1);
+            double tmp = static_cast <double> (iring * iring) * fact2;
+            z[i] = 1.0 - tmp;
+            sth[i] = ::sqrt(tmp * (2.0 - tmp));
+            phi[i] = (static_cast <double> (iphi) - 0.5) * PI_2 /
+                     static_cast <double> (iring);
+        } else if (pix[i] < (npix_ - ncap_)) {
+            int64_t ip = pix[i] - ncap_;
+            int64_t tmp = ip >> (factor_ + 2);
+            iring = tmp + nside_;
+            iphi = ip - fournside_ * tmp + 1;
+            double fodd = ((iring + nside_) & 1) ? 1.0 : 0.5;
+            z[i] = static_cast <double> (twonside_ - iring) * fact1;
+            sth[i] = ::sqrt((1.0 - z[i]) * (1.0 + z[i]));
+            phi[i] = (static_cast <double> (iphi) - fodd) * PI * 0.75 * fact1;
+        } else {
+            int64_t ip = npix_ - pix[i];
+            iring = static_cast <int64_t> (
+                0.5 * (1.0 + ::sqrt(static_cast <double> (2 * ip - 1))));
+            iphi = 4 * iring + 1 - (ip - 2 * iring * (iring - 1));
+            double tmp = static_cast <double> (iring * iring) * fact2;
+            z[i] = tmp - 1.0;
+            sth[i] = ::sqrt(tmp * (2.0 - tmp));
+            phi[i] = (static_cast <double> (iphi) - 0.5) * PI_2 /
+                     static_cast <double> (iring);
+        }
+    }
+
+    return;
+}
+
+void cal::HealpixPixels::nest2ang(int64_t n, int64_t const * pix,
+                                    double * theta, double * phi) const {
+    int64_t nchunk = (n + HPIX_CHUNK - 1) / HPIX_CHUNK;
+
+    #pragma omp parallel if (nchunk > 1)
+    {
+        cal::AlignedVector <double> z(HPIX_CHUNK);
+        cal::AlignedVector <double> sth(HPIX_CHUNK);
+
+        #pragma omp for schedule(static)
+        for (int64_t c = 0; c < nchunk; ++c) {
+            int64_t off = c * HPIX_CHUNK;
+            int64_t nc = std::min(HPIX_CHUNK, n - off);
+            nest2zphi(nc, pix + off, z.data(), sth.data(), phi + off);
+            cal::vatan2(nc, sth.data(), z.data(), theta + off);
+        }
+    }
+
+    return;
+}
+
+void cal::HealpixPixels::ring2ang(int64_t n, int64_t const * pix,
+                                    double * theta, double * phi) const {
+    int64_t nchunk = (n + HPIX_CHUNK - 1) / HPIX_CHUNK;
+
+    #pragma omp parallel if (nchunk > 1)
+    {
+        cal::AlignedVector <double> z(HPIX_CHUNK);
+        cal::AlignedVector <double> sth(HPIX_CHUNK);
+
+        #pragma omp for schedule(static)
+        for (int64_t c = 0; c < nchunk; ++c) {
+            int64_t off = c * HPIX_CHUNK;
+            int64_t nc = std::min(HPIX_CHUNK, n - off);
+            ring2zphi(nc, pix + off, z.data(), sth.data(), phi + off);
+            cal::vatan2(nc, sth.data(), z.data(), theta + off);
+        }
+    }
+
+    return;
+}
+
+void cal::HealpixPixels::nest2vec(int64_t n, int64_t const * pix,
+                                    double * vec) const {
+    int64_t nchunk = (n + HPIX_CHUNK - 1) / HPIX_CHUNK;
+
+    #pragma omp parallel if (nchunk > 1)
+    {
+        cal::AlignedVector <double> z(HPIX_CHUNK);
+        cal::AlignedVector <double> sth(HPIX_CHUNK);
+        cal::AlignedVector <double> phi(HPIX_CHUNK);
+        cal::AlignedVector <double> sinphi(HPIX_CHUNK);
+        cal::AlignedVector <double> cosphi(HPIX_CHUNK);
+
+        #pragma omp for schedule(static)
+        for (int64_t c = 0; c < nchunk; ++c) {
+            int64_t off = c * HPIX_CHUNK;
+            int64_t nc = std::min(HPIX_CHUNK, n - off);
+            nest2zphi(nc, pix + off, z.data(), sth.data(), phi.data());
+            cal::vsincos(nc, phi.data(), sinphi.data(), cosphi.data());
+            double * v = vec + 3 * off;
+            #pragma omp simd
+            for (int64_t i = 0; i < nc; ++i) {
+                v[3 * i] = sth[i] * cosphi[i];
+                v[3 * i + 1] = sth[i] * sinphi[i];
+                v[3 * i + 2] = z[i];
+            }
+        }
+    }
+
+    return;
+}
+
+void cal::HealpixPixels::ring2vec(int64_t n, int64_t const * pix,
+                                    double * vec) const {
+    int64_t nchunk = (n + HPIX_CHUNK - 1) / HPIX_CHUNK;
+
+    #pragma omp parallel if (nchunk > 1)
+    {
+        cal::AlignedVector <double> z(HPIX_CHUNK);
+        cal::AlignedVector <double> sth(HPIX_CHUNK);
+        cal::AlignedVector <double> phi(HPIX_CHUNK);
+        cal::AlignedVector <double> sinphi(HPIX_CHUNK);
+        cal::AlignedVector <double> cosphi(HPIX_CHUNK);
+
+        #pragma omp for schedule(static)
+        for (int64_t c = 0; c < nchunk; ++c) {
+            int64_t off = c * HPIX_CHUNK;
+            int64_t nc = std::min(HPIX_CHUNK, n - off);
+            ring2zphi(nc, pix + off, z.data(), sth.data(), phi.data());
+            cal::vsincos(nc, phi.data(), sinphi.data(), cosphi.data());
+            double * v = vec + 3 * off;
+            #pragma omp simd
+            for (int64_t i = 0; i < nc; ++i) {
+                v[3 * i] = sth[i] * cosphi[i];
+                v[3 * i + 1] = sth[i] * sinphi[i];
+                v[3 * i + 2] = z[i];
+            }
+        }
+    }
+
+    return;
+}
+
+void cal::HealpixPixels::neighbours_nest(int64_t n, int64_t const * pix,
+                                           int64_t * neighbours) const {
+    int64_t npface = nside_ * nside_;
+
+    #pragma omp parallel for schedule(static)
+    for (int64_t i = 0; i < n; ++i) {
+        int64_t face = pix[i] >> (2 * factor_);
+        uint64_t x;
+        uint64_t y;
+        pix2xy_(pix[i] & (npface - 1), x, y);
+        int64_t ix = static_cast <int64_t> (x);
+        int64_t iy = static_cast <int64_t> (y);
+        int64_t * nb = neighbours + 8 * i;
+
+        if ((ix > 0) && (ix < nsideminusone_) && (iy > 0) &&
+            (iy < nsideminusone_)) {
+            for (int m = 0; m < 8; ++m) {
+                nb[m] = xyf2nest_(ix + nb_xoffset[m], iy + nb_yoffset[m],
+                                  face);
+            }
+            continue;
+        }
+
+        // Along the face edges, the neighbours may be in another face, with
+        // rotated coordinates.
+
+        for (int m = 0; m < 8; ++m) {
+            int64_t nx = ix + nb_xoffset[m];
+            int64_t ny = iy + nb_yoffset[m];
+            int dir = 4;
+            if (nx < 0) {
+                nx += nside_;
+                dir -= 1;
+            } else if (nx >= nside_) {
+                nx -= nside_;
+                dir += 1;
+            }
+            if (ny < 0) {
+                ny += nside_;
+                dir -= 3;
+            } else if (ny >= nside_) {
+                ny -= nside_;
+                dir += 3;
+            }
+            int nbface = nb_facearray[dir][face];
+            if (nbface < 0) {
+                nb[m] = -1;
+                continue;
+            }
+            int bits = nb_swaparray[dir][face >> 2];
+            if (bits & 1) {
+                nx = nside_ - nx - 1;
+            }
+            if (bits & 2) {
+                ny = nside_ - ny - 1;
+            }
+            if (bits & 4) {
+                std::swap(nx, ny);
+            }
+            nb[m] = xyf2nest_(nx, ny, nbface);
+        }
+    }
+
+    return;
+}
+
+void cal::HealpixPixels::neighbours_ring(int64_t n, int64_t const * pix,
+                                           int64_t * neighbours) const {
+    cal::AlignedVector <int64_t> nestpix(n);
+    cal::AlignedVector <int64_t> nestnb(8 * n);
+
+    ring2nest(n, pix, nestpix.data());
+    neighbours_nest(n, nestpix.data(), nestnb.data());
+
+    // Missing neighbours are converted as pixel zero and restored after.
+
+    for (int64_t i = 0; i < 8 * n; ++i) {
+        neighbours[i] = (nestnb[i] < 0) ? 0 : nestnb[i];
+    }
+    nest2ring(8 * n, neighbours, neighbours);
+    for (int64_t i = 0; i < 8 * n; ++i) {
+        neighbours[i] = (nestnb[i] < 0) ? -1 : neighbours[i];
+    }
+
+    return;
+}
+
+double cal::HealpixPixels::max_pixrad_() const {
+    // Distance between the center and the farthest corner of the pixels
+    // on the boundary of the polar caps, which are the largest.
+
+    double za = TWOTHIRDS;
+    double pa = PI / static_cast <double> (fournside_);
+    double sa = ::sqrt((1.0 - za) * (1.0 + za));
+    double t1 = 1.0 - 1.0 / dnside_;
+    t1 *= t1;
+    double zb = 1.0 - t1 / 3.0;
+    double sb = ::sqrt((1.0 - zb) * (1.0 + zb));
+
+    double va[3] = {sa * ::cos(pa), sa * ::sin(pa), za};
+    double vb[3] = {sb, 0.0, zb};
+    double cross[3] = {
+        va[1] * vb[2] - va[2] * vb[1],
+        va[2] * vb[0] - va[0] * vb[2],
+        va[0] * vb[1] - va[1] * vb[0]
+    };
+    double cnorm = ::sqrt(cross[0] * cross[0] + cross[1] * cross[1] +
+                          cross[2] * cross[2]);
+    double dot = va[0] * vb[0] + va[1] * vb[1] + va[2] * vb[2];
+    return ::atan2(cnorm, dot);
+}
+
+void cal::HealpixPixels::query_disc_ring(double const * vec, double radius,
+                                           bool inclusive,
+                                           std::vector <int64_t> & pix) const {
+    pix.clear();
+
+    double vnorm = ::sqrt(vec[0] * vec[0] + vec[1] * vec[1] +
+                          vec[2] * vec[2]);
+    if (vnorm == 0.0) {
+        auto here = cal_HERE();
+        auto log = cal::Logger::get();
+        std::string msg("query_disc center must be a nonzero vector");
+        log.error(msg.c_str(), here);
+        throw std::runtime_error(msg.c_str());
+    }
+
+    double rad = inclusive ? radius + max_pixrad_() : radius;
+    if (rad < 0.0) {
+        return;
+    }
+    if (rad >= PI) {
+        pix.resize(npix_);
+        for (int64_t i = 0; i < npix_; ++i) {
+            pix[i] = i;
+        }
+        return;
+    }
+
+    double z0 = std::max(-1.0, std::min(1.0, vec[2] / vnorm));
+    double sth0 = ::sqrt((1.0 - z0) * (1.0 + z0));
+    double theta0 = ::atan2(sth0, z0);
+    double phi0 = ::atan2(vec[1], vec[0]);
+    double cosrad = ::cos(rad);
+
+    // Rings are numbered from 1 at the North pole.  ring_above returns the
+    // last ring at or north of a given z.
+
+    auto ring_above = [&](double z) -> int64_t {
+                          double az = ::fabs(z);
+                          if (az <= TWOTHIRDS) {
+                              return static_cast <int64_t> (
+                                  dnside_ * (2.0 - 1.5 * z));
+                          }
+                          int64_t iring = static_cast <int64_t> (
+                              dnside_ * ::sqrt(3.0 * (1.0 - az)));
+                          return (z > 0) ? iring : fournside_ - iring - 1;
+                      };
+
+    double rlat1 = theta0 - rad;
+    double rlat2 = theta0 + rad;
+    int64_t irmin = (rlat1 <= 0.0) ? 1 : ring_above(::cos(rlat1)) + 1;
+    int64_t irmax = (rlat2 >= PI) ? fournside_ - 1 : ring_above(::cos(rlat2));
+
+    double fact2 = 4.0 / static_cast <double> (npix_);
+    double fact1 = static_cast <double> (twonside_) * fact2;
+
+    for (int64_t iring = irmin; iring <= irmax; ++iring) {
+        int64_t nr;
+        int64_t start;
+        double z;
+        double shift = 0.5;
+        if (iring < nside_) {
+            nr = 4 * iring;
+            start = 2 * iring * (iring - 1);
+            z = 1.0 - static_cast <double> (iring * iring) * fact2;
+        } else if (iring <= 3 * nside_) {
+            nr = fournside_;
+            start = ncap_ + (iring - nside_) * fournside_;
+            z = static_cast <double> (twonside_ - iring) * fact1;
+            shift = ((iring - nside_) & 1) ? 0.0 : 0.5;
+        } else {
+            int64_t ir = fournside_ - iring;
+            nr = 4 * ir;
+            start = npix_ - 2 * ir * (ir + 1);
+            z = static_cast <double> (ir * ir) * fact2 - 1.0;
+        }
+
+        // Half width in phi of the disc at this ring.
+
+        double sth = ::sqrt((1.0 - z) * (1.0 + z));
+        double x = cosrad - z * z0;
+        double ssth = sth * sth0;
+        double dphi;
+        if (ssth <= 0.0) {
+            if (x > 0.0) {
+                continue;
+            }
+            dphi = PI;
+        } else {
+            double cdphi = x / ssth;
+            if (cdphi > 1.0) {
+                continue;
+            }
+            dphi = (cdphi <= -1.0) ? PI : ::acos(cdphi);
+        }
+
+        double pixphi = TWOPI / static_cast <double> (nr);
+        int64_t kmin = static_cast <int64_t> (
+            ::ceil((phi0 - dphi) / pixphi - shift));
+        int64_t kmax = static_cast <int64_t> (
+            ::floor((phi0 + dphi) / pixphi - shift));
+        if ((dphi >= PI) || (kmax - kmin + 1 >= nr)) {
+            for (int64_t k = 0; k < nr; ++k) {
+                pix.push_back(start + k);
+            }
+        } else {
+            for (int64_t k = kmin; k <= kmax; ++k) {
+                pix.push_back(start + ((k % nr) + nr) % nr);
+            }
+        }
+    }
+
+    std::sort(pix.begin(), pix.end());
+
+    return;
+}
+
+void cal::HealpixPixels::query_disc_nest(double const * vec, double radius,
+                                           bool inclusive,
+                                           std::vector <int64_t> & pix) const {
+    query_disc_ring(vec, radius, inclusive, pix);
+    int64_t n = pix.size();
+    cal::AlignedVector <int64_t> ringpix(pix.begin(), pix.end());
+    ring2nest(n, ringpix.data(), pix.data());
+    std::sort(pix.begin(), pix.end());
+    return;
+}
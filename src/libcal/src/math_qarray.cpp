@@ -8,10 +8,131 @@
 #include <cal/math_sf.hpp>
 #include <cal/math_qarray.hpp>
 
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
 
+namespace {
+// Number of target samples interpolated together by the SLERP kernels.
+size_t const SLERP_BLOCK = 512;
+
+/** Access to interleaved quaternions. */
+struct quat_aos {
+    double const * q;
+
+    double get(size_t i, size_t k) const {
+        return q[4 * i + k];
+    }
+};
+
+/** Access to SoA quaternion streams of length n. */
+struct quat_soa {
+    double const * q;
+    size_t n;
+
+    double get(size_t i, size_t k) const {
+        return q[k * n + i];
+    }
+};
+
+/**
+* Check the SLERP arguments.  At least two input samples are needed to
+* define an interval.
+*/
+void slerp_check(size_t n_time) {
+    if (n_time < 2) {
+        auto here = cal_HERE();
+        auto log = cal::Logger::get();
+        std::string msg("SLERP input times must have at least two values");
+        log.error(msg.c_str(), here);
+        throw std::runtime_error(msg.c_str());
+    }
+    return;
+}
+
+/**
+* Interpolate the quaternions at targettime[first ... first + nb - 1],
+* nb <= SLERP_BLOCK, to the normalized SoA block (x, y, z, w).
+*
+* The target times are monotone, so the input interval of the first one
+* is found with a binary search and the others by walking forward.
+* Targets outside of the input times are extrapolated from the first or
+* last interval.  With theta the angle between the bracketing
+* quaternions and f the fractional position,
+*
+*   sin((1 - f) theta) / sin(theta) = cos(f theta) - cos(theta) r2
+*   r2 = sin(f theta) / sin(theta)
+*
+* so that the whole block needs one vfast_atan2 and one vfast_sincos.
+*/
+template <class Q>
+void slerp_block(size_t n_time, double const * time,
+                 double const * targettime, Q const & q_in, size_t first,
+                 size_t nb, double * x, double * y, double * z, double * w) {
+    size_t lo[SLERP_BLOCK];
+    double frac[SLERP_BLOCK];
+    double costheta[SLERP_BLOCK] = {0};
+    double sintheta[SLERP_BLOCK] = {0};
+    double theta[SLERP_BLOCK];
+    double sin_ft[SLERP_BLOCK];
+    double cos_ft[SLERP_BLOCK];
+
+    size_t last = n_time - 2;
+    size_t off = std::lower_bound(time, time + n_time, targettime[first]) -
+                 time;
+    off = (off == 0) ? 0 : std::min(off - 1, last);
+
+    for (size_t j = 0; j < nb; ++j) {
+        double tgt = targettime[first + j];
+        while ((off < last) && (time[off + 1] < tgt)) {
+            ++off;
+        }
+        lo[j] = off;
+        frac[j] = (tgt - time[off]) / (time[off + 1] - time[off]);
+        double c = 0.0;
+        for (size_t k = 0; k < 4; ++k) {
+            c += q_in.get(off, k) * q_in.get(off + 1, k);
+        }
+        costheta[j] = c;
+    }
+
+    #pragma omp simd
+    for (size_t j = 0; j < nb; ++j) {
+        sintheta[j] = ::sqrt(1.0 - costheta[j] * costheta[j]);
+    }
+
+    cal::vfast_atan2(nb, sintheta, costheta, theta);
+
+    #pragma omp simd
+    for (size_t j = 0; j < nb; ++j) {
+        theta[j] *= frac[j];
+    }
+
+    cal::vfast_sincos(nb, theta, sin_ft, cos_ft);
+
+    #pragma omp simd
+    for (size_t j = 0; j < nb; ++j) {
+        // Nearly identical quaternions are not interpolated.
+        bool same = (::fabs(costheta[j] - 1.0) < 1.0e-10);
+        double r2 = same ? 0.0 : sin_ft[j] / sintheta[j];
+        double r1 = same ? 1.0 : cos_ft[j] - costheta[j] * r2;
+        size_t i = lo[j];
+        double qx = r1 * q_in.get(i, 0) + r2 * q_in.get(i + 1, 0);
+        double qy = r1 * q_in.get(i, 1) + r2 * q_in.get(i + 1, 1);
+        double qz = r1 * q_in.get(i, 2) + r2 * q_in.get(i + 1, 2);
+        double qw = r1 * q_in.get(i, 3) + r2 * q_in.get(i + 1, 3);
+        double norm = 1.0 / ::sqrt(qx * qx + qy * qy + qz * qz + qw * qw);
+        x[j] = qx * norm;
+        y[j] = qy * norm;
+        z[j] = qz * norm;
+        w[j] = qw * norm;
+    }
+    return;
+}
+}
+
+
 // Dot product of lists of arrays.
 
 void cal::qa_list_dot(size_t n, size_t m, size_t d, double const * a,
@@ -531,65 +652,73 @@ void cal::qa_mult(size_t np, double const * p, size_t nq,
 }
 
 // Spherical interpolation of quaternion array from time to targettime.
+// The target times must be sorted.
 
 void cal::qa_slerp(size_t n_time, size_t n_targettime,
                      double const * time, double const * targettime,
                      double const * q_in, double * q_interp) {
-    #pragma \
-    omp parallel default(none) shared(n_time, n_targettime, time, targettime, q_in, q_interp)
-    {
-        double diff;
-        double frac;
-        double costheta;
-        double const * qlow;
-        double const * qhigh;
-        double theta;
-        double invsintheta;
-        double norm;
-        double * q;
-        double ratio1;
-        double ratio2;
-
-        size_t off = 0;
-
-        #pragma omp for schedule(static)
-        for (size_t i = 0; i < n_targettime; ++i) {
-            // scroll forward to the correct time sample
-            while ((off + 1 < n_time) && (time[off + 1] < targettime[i])) {
-                ++off;
-            }
-            diff = time[off + 1] - time[off];
-            frac = (targettime[i] - time[off]) / diff;
-
-            qlow = &(q_in[4 * off]);
-            qhigh = &(q_in[4 * (off + 1)]);
-            q = &(q_interp[4 * i]);
+    slerp_check(n_time);
+
+    quat_aos qa = {q_in};
+    int64_t nblock = (n_targettime + SLERP_BLOCK - 1) / SLERP_BLOCK;
+
+    #pragma omp parallel for schedule(static)
+    for (int64_t b = 0; b < nblock; ++b) {
+        double x[SLERP_BLOCK];
+        double y[SLERP_BLOCK];
+        double z[SLERP_BLOCK];
+        double w[SLERP_BLOCK];
+        size_t first = b * SLERP_BLOCK;
+        size_t nb = std::min(SLERP_BLOCK, n_targettime - first);
+        slerp_block(n_time, time, targettime, qa, first, nb, x, y, z, w);
+        double * q = q_interp + 4 * first;
+        for (size_t j = 0; j < nb; ++j) {
+            q[4 * j + 0] = x[j];
+            q[4 * j + 1] = y[j];
+            q[4 * j + 2] = z[j];
+            q[4 * j + 3] = w[j];
+        }
+    }
 
-            costheta = qlow[0] * qhigh[0] + qlow[1] * qhigh[1] + qlow[2] *
-                       qhigh[2] + qlow[3] * qhigh[3];
+    return;
+}
 
-            if (::fabs(costheta - 1.0) < 1.0e-10) {
-                q[0] = qlow[0];
-                q[1] = qlow[1];
-                q[2] = qlow[2];
-                q[3] = qlow[3];
-            } else {
-                theta = ::acos(costheta);
-                invsintheta = 1.0 / ::sqrt(1.0 - costheta * costheta);
-                ratio1 = ::sin((1.0 - frac) * theta) * invsintheta;
-                ratio2 = ::sin(frac * theta) * invsintheta;
-                q[0] = ratio1 * qlow[0] + ratio2 * qhigh[0];
-                q[1] = ratio1 * qlow[1] + ratio2 * qhigh[1];
-                q[2] = ratio1 * qlow[2] + ratio2 * qhigh[2];
-                q[3] = ratio1 * qlow[3] + ratio2 * qhigh[3];
+// Interpolate the boresight quaternions to targettime and rotate them by
+// each of the ndet detector offsets, q_out[idet] = slerp(q_in) * q_det[idet].
+// q_out has ndet consecutive arrays of n_targettime quaternions.
+
+void cal::qa_slerp_mult(size_t n_time, size_t n_targettime,
+                          double const * time, double const * targettime,
+                          double const * q_in, size_t ndet,
+                          double const * q_det, double * q_out) {
+    slerp_check(n_time);
+
+    quat_aos qa = {q_in};
+    int64_t nblock = (n_targettime + SLERP_BLOCK - 1) / SLERP_BLOCK;
+
+    #pragma omp parallel for schedule(static)
+    for (int64_t b = 0; b < nblock; ++b) {
+        double x[SLERP_BLOCK];
+        double y[SLERP_BLOCK];
+        double z[SLERP_BLOCK];
+        double w[SLERP_BLOCK];
+        size_t first = b * SLERP_BLOCK;
+        size_t nb = std::min(SLERP_BLOCK, n_targettime - first);
+        slerp_block(n_time, time, targettime, qa, first, nb, x, y, z, w);
+        for (size_t idet = 0; idet < ndet; ++idet) {
+            double const * d = q_det + 4 * idet;
+            double * r = q_out + 4 * (idet * n_targettime + first);
+            #pragma omp simd
+            for (size_t j = 0; j < nb; ++j) {
+                r[4 * j + 0] =  x[j] * d[3] + y[j] * d[2] - z[j] * d[1] +
+                               w[j] * d[0];
+                r[4 * j + 1] = -x[j] * d[2] + y[j] * d[3] + z[j] * d[0] +
+                               w[j] * d[1];
+                r[4 * j + 2] =  x[j] * d[1] - y[j] * d[0] + z[j] * d[3] +
+                               w[j] * d[2];
+                r[4 * j + 3] = -x[j] * d[0] - y[j] * d[1] - z[j] * d[2] +
+                               w[j] * d[3];
             }
-
-            norm = 1.0 / ::sqrt(
-                q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
-            q[0] *= norm;
-            q[1] *= norm;
-            q[2] *= norm;
-            q[3] *= norm;
         }
     }
 
@@ -1371,3 +1500,340 @@ void cal::qa_to_position(size_t n, double const * quat, double * theta,
 
     return;
 }
+
+// Structure-of-arrays (SoA) kernels.  An array of n quaternions is
+// stored as the four streams x[0 ... n-1], y, z, w, one after the
+// other, and an array of vectors as the streams x, y, z.  With one
+// element the layout is the same as the interleaved one.  Every loop
+// reads and writes unit stride streams, which vectorize cleanly for the
+// instruction set of each CAL_TARGET_CLONES version.
+
+CAL_TARGET_CLONES
+void cal::qa_aos_to_soa(size_t n, size_t d, double const * aos,
+                          double * soa) {
+    if (d == 4) {
+        double * x = soa;
+        double * y = soa + n;
+        double * z = soa + 2 * n;
+        double * w = soa + 3 * n;
+        #pragma omp simd
+        for (size_t i = 0; i < n; ++i) {
+            x[i] = aos[4 * i + 0];
+            y[i] = aos[4 * i + 1];
+            z[i] = aos[4 * i + 2];
+            w[i] = aos[4 * i + 3];
+        }
+    } else if (d == 3) {
+        double * x = soa;
+        double * y = soa + n;
+        double * z = soa + 2 * n;
+        #pragma omp simd
+        for (size_t i = 0; i < n; ++i) {
+            x[i] = aos[3 * i + 0];
+            y[i] = aos[3 * i + 1];
+            z[i] = aos[3 * i + 2];
+        }
+    } else {
+        for (size_t j = 0; j < d; ++j) {
+            double * s = soa + j * n;
+            for (size_t i = 0; i < n; ++i) {
+                s[i] = aos[d * i + j];
+            }
+        }
+    }
+    return;
+}
+
+CAL_TARGET_CLONES
+void cal::qa_soa_to_aos(size_t n, size_t d, double const * soa,
+                          double * aos) {
+    if (d == 4) {
+        double const * x = soa;
+        double const * y = soa + n;
+        double const * z = soa + 2 * n;
+        double const * w = soa + 3 * n;
+        #pragma omp simd
+        for (size_t i = 0; i < n; ++i) {
+            aos[4 * i + 0] = x[i];
+            aos[4 * i + 1] = y[i];
+            aos[4 * i + 2] = z[i];
+            aos[4 * i + 3] = w[i];
+        }
+    } else if (d == 3) {
+        double const * x = soa;
+        double const * y = soa + n;
+        double const * z = soa + 2 * n;
+        #pragma omp simd
+        for (size_t i = 0; i < n; ++i) {
+            aos[3 * i + 0] = x[i];
+            aos[3 * i + 1] = y[i];
+            aos[3 * i + 2] = z[i];
+        }
+    } else {
+        for (size_t j = 0; j < d; ++j) {
+            double const * s = soa + j * n;
+            for (size_t i = 0; i < n; ++i) {
+                aos[d * i + j] = s[i];
+            }
+        }
+    }
+    return;
+}
+
+// Normalize a SoA quaternion array, q_in and q_out may be the same.
+
+CAL_TARGET_CLONES
+void cal::qa_normalize_soa(size_t n, double const * q_in, double * q_out) {
+    double const * xi = q_in;
+    double const * yi = q_in + n;
+    double const * zi = q_in + 2 * n;
+    double const * wi = q_in + 3 * n;
+    double * xo = q_out;
+    double * yo = q_out + n;
+    double * zo = q_out + 2 * n;
+    double * wo = q_out + 3 * n;
+
+    #pragma omp simd
+    for (size_t i = 0; i < n; ++i) {
+        double norm = ::sqrt(xi[i] * xi[i] + yi[i] * yi[i] +
+                             zi[i] * zi[i] + wi[i] * wi[i]);
+        xo[i] = xi[i] / norm;
+        yo[i] = yi[i] / norm;
+        zo[i] = zi[i] / norm;
+        wo[i] = wi[i] / norm;
+    }
+    return;
+}
+
+// Rotate one vector by a SoA array of quaternions, which are normalized
+// on the fly.  The output is a SoA vector array.
+
+CAL_TARGET_CLONES
+void cal::qa_rotate_many_one_soa(size_t nq, double const * q,
+                                   double const * v_in, double * v_out) {
+    double const * qx = q;
+    double const * qy = q + nq;
+    double const * qz = q + 2 * nq;
+    double const * qw = q + 3 * nq;
+    double * vx = v_out;
+    double * vy = v_out + nq;
+    double * vz = v_out + 2 * nq;
+
+    #pragma omp simd
+    for (size_t i = 0; i < nq; ++i) {
+        double norm = ::sqrt(qx[i] * qx[i] + qy[i] * qy[i] +
+                             qz[i] * qz[i] + qw[i] * qw[i]);
+        double x = qx[i] / norm;
+        double y = qy[i] / norm;
+        double z = qz[i] / norm;
+        double w = qw[i] / norm;
+
+        double xw =  w * x;
+        double yw =  w * y;
+        double zw =  w * z;
+        double x2 = -x * x;
+        double xy =  x * y;
+        double xz =  x * z;
+        double y2 = -y * y;
+        double yz =  y * z;
+        double z2 = -z * z;
+
+        vx[i] = 2 * ((y2 + z2) * v_in[0] + (xy - zw) * v_in[1] +
+                     (yw + xz) * v_in[2]) + v_in[0];
+        vy[i] = 2 * ((zw + xy) * v_in[0] + (x2 + z2) * v_in[1] +
+                     (yz - xw) * v_in[2]) + v_in[1];
+        vz[i] = 2 * ((xz - yw) * v_in[0] + (xw + yz) * v_in[1] +
+                     (x2 + y2) * v_in[2]) + v_in[2];
+    }
+    return;
+}
+
+// Rotate a SoA vector array by a SoA quaternion array of the same length.
+
+CAL_TARGET_CLONES
+void cal::qa_rotate_many_many_soa(size_t n, double const * q,
+                                    double const * v_in, double * v_out) {
+    double const * qx = q;
+    double const * qy = q + n;
+    double const * qz = q + 2 * n;
+    double const * qw = q + 3 * n;
+    double const * ux = v_in;
+    double const * uy = v_in + n;
+    double const * uz = v_in + 2 * n;
+    double * vx = v_out;
+    double * vy = v_out + n;
+    double * vz = v_out + 2 * n;
+
+    #pragma omp simd
+    for (size_t i = 0; i < n; ++i) {
+        double norm = ::sqrt(qx[i] * qx[i] + qy[i] * qy[i] +
+                             qz[i] * qz[i] + qw[i] * qw[i]);
+        double x = qx[i] / norm;
+        double y = qy[i] / norm;
+        double z = qz[i] / norm;
+        double w = qw[i] / norm;
+
+        double xw =  w * x;
+        double yw =  w * y;
+        double zw =  w * z;
+        double x2 = -x * x;
+        double xy =  x * y;
+        double xz =  x * z;
+        double y2 = -y * y;
+        double yz =  y * z;
+        double z2 = -z * z;
+
+        double u0 = ux[i];
+        double u1 = uy[i];
+        double u2 = uz[i];
+
+        vx[i] = 2 * ((y2 + z2) * u0 + (xy - zw) * u1 +
+                     (yw + xz) * u2) + u0;
+        vy[i] = 2 * ((zw + xy) * u0 + (x2 + z2) * u1 +
+                     (yz - xw) * u2) + u1;
+        vz[i] = 2 * ((xz - yw) * u0 + (xw + yz) * u1 +
+                     (x2 + y2) * u2) + u2;
+    }
+    return;
+}
+
+void cal::qa_rotate_soa(size_t nq, double const * q, size_t nv,
+                          double const * v_in, double * v_out) {
+    if (nv == 1) {
+        cal::qa_rotate_many_one_soa(nq, q, v_in, v_out);
+    } else if (nq == nv) {
+        cal::qa_rotate_many_many_soa(nq, q, v_in, v_out);
+    } else {
+        auto here = cal_HERE();
+        auto log = cal::Logger::get();
+        std::string msg("incompatible quaternion and vector array dimensions");
+        log.error(msg.c_str(), here);
+        throw std::runtime_error(msg.c_str());
+    }
+
+    return;
+}
+
+// Multiply SoA quaternion arrays.  A single quaternion p or q is
+// broadcast to the whole array.
+
+CAL_TARGET_CLONES
+void cal::qa_mult_many_one_soa(size_t np, double const * p,
+                                 double const * q, double * r) {
+    double const * px = p;
+    double const * py = p + np;
+    double const * pz = p + 2 * np;
+    double const * pw = p + 3 * np;
+    double * rx = r;
+    double * ry = r + np;
+    double * rz = r + 2 * np;
+    double * rw = r + 3 * np;
+
+    #pragma omp simd
+    for (size_t i = 0; i < np; ++i) {
+        rx[i] =  px[i] * q[3] + py[i] * q[2] - pz[i] * q[1] + pw[i] * q[0];
+        ry[i] = -px[i] * q[2] + py[i] * q[3] + pz[i] * q[0] + pw[i] * q[1];
+        rz[i] =  px[i] * q[1] - py[i] * q[0] + pz[i] * q[3] + pw[i] * q[2];
+        rw[i] = -px[i] * q[0] - py[i] * q[1] - pz[i] * q[2] + pw[i] * q[3];
+    }
+    return;
+}
+
+CAL_TARGET_CLONES
+void cal::qa_mult_one_many_soa(double const * p, size_t nq,
+                                 double const * q, double * r) {
+    double const * qx = q;
+    double const * qy = q + nq;
+    double const * qz = q + 2 * nq;
+    double const * qw = q + 3 * nq;
+    double * rx = r;
+    double * ry = r + nq;
+    double * rz = r + 2 * nq;
+    double * rw = r + 3 * nq;
+
+    #pragma omp simd
+    for (size_t i = 0; i < nq; ++i) {
+        rx[i] =  p[0] * qw[i] + p[1] * qz[i] - p[2] * qy[i] + p[3] * qx[i];
+        ry[i] = -p[0] * qz[i] + p[1] * qw[i] + p[2] * qx[i] + p[3] * qy[i];
+        rz[i] =  p[0] * qy[i] - p[1] * qx[i] + p[2] * qw[i] + p[3] * qz[i];
+        rw[i] = -p[0] * qx[i] - p[1] * qy[i] - p[2] * qz[i] + p[3] * qw[i];
+    }
+    return;
+}
+
+CAL_TARGET_CLONES
+void cal::qa_mult_many_many_soa(size_t n, double const * p,
+                                  double const * q, double * r) {
+    double const * px = p;
+    double const * py = p + n;
+    double const * pz = p + 2 * n;
+    double const * pw = p + 3 * n;
+    double const * qx = q;
+    double const * qy = q + n;
+    double const * qz = q + 2 * n;
+    double const * qw = q + 3 * n;
+    double * rx = r;
+    double * ry = r + n;
+    double * rz = r + 2 * n;
+    double * rw = r + 3 * n;
+
+    #pragma omp simd
+    for (size_t i = 0; i < n; ++i) {
+        double x = px[i];
+        double y = py[i];
+        double z = pz[i];
+        double w = pw[i];
+        rx[i] =  x * qw[i] + y * qz[i] - z * qy[i] + w * qx[i];
+        ry[i] = -x * qz[i] + y * qw[i] + z * qx[i] + w * qy[i];
+        rz[i] =  x * qy[i] - y * qx[i] + z * qw[i] + w * qz[i];
+        rw[i] = -x * qx[i] - y * qy[i] - z * qz[i] + w * qw[i];
+    }
+    return;
+}
+
+void cal::qa_mult_soa(size_t np, double const * p, size_t nq,
+                        double const * q, double * r) {
+    if ((np == 1) && (nq == 1)) {
+        cal::qa_mult_one_one(p, q, r);
+    } else if (np == 1) {
+        cal::qa_mult_one_many_soa(p, nq, q, r);
+    } else if (nq == 1) {
+        cal::qa_mult_many_one_soa(np, p, q, r);
+    } else if (np == nq) {
+        cal::qa_mult_many_many_soa(np, p, q, r);
+    } else {
+        auto here = cal_HERE();
+        auto log = cal::Logger::get();
+        std::string msg("incompatible quaternion array dimensions");
+        log.error(msg.c_str(), here);
+        throw std::runtime_error(msg.c_str());
+    }
+
+    return;
+}
+
+// Spherical interpolation of a SoA quaternion array from time to
+// targettime.  The interpolated quaternions are normalized.
+
+void cal::qa_slerp_soa(size_t n_time, size_t n_targettime,
+                         double const * time, double const * targettime,
+                         double const * q_in, double * q_interp) {
+    slerp_check(n_time);
+
+    quat_soa qs = {q_in, n_time};
+    double * rx = q_interp;
+    double * ry = q_interp + n_targettime;
+    double * rz = q_interp + 2 * n_targettime;
+    double * rw = q_interp + 3 * n_targettime;
+    int64_t nblock = (n_targettime + SLERP_BLOCK - 1) / SLERP_BLOCK;
+
+    #pragma omp parallel for schedule(static)
+    for (int64_t b = 0; b < nblock; ++b) {
+        size_t first = b * SLERP_BLOCK;
+        size_t nb = std::min(SLERP_BLOCK, n_targettime - first);
+        slerp_block(n_time, time, targettime, qs, first, nb, rx + first,
+                    ry + first, rz + first, rw + first);
+    }
+
+    return;
+}
@@ -7,123 +7,577 @@
 #include <cal/sys_utils.hpp>
 #include <cal/math_sf.hpp>
 #include <cal/math_rng.hpp>
+
+#include <algorithm>
 #include <Random123/threefry.h>
+#include <Random123/philox.h>
 #include <Random123/uniform.hpp>
 
+#ifdef _OPENMP
+# include <omp.h>
+#endif // ifdef _OPENMP
+
+// With runtime dispatch the intrinsic lanes are always compiled, each
+// for its own instruction set, and selected on the running CPU.
+// Otherwise only the lanes enabled by the compiler flags exist.
+#ifdef CAL_HAVE_TARGET_CLONES
+# define RNG_AVX2
+# define RNG_AVX512
+#else // ifdef CAL_HAVE_TARGET_CLONES
+# ifdef __AVX2__
+#  define RNG_AVX2
+# endif // ifdef __AVX2__
+# ifdef __AVX512F__
+#  define RNG_AVX512
+# endif // ifdef __AVX512F__
+#endif // ifdef CAL_HAVE_TARGET_CLONES
+
+#if defined(RNG_AVX2) || defined(RNG_AVX512)
+# include <immintrin.h>
+#endif // if defined(RNG_AVX2) || defined(RNG_AVX512)
+
 typedef r123::Threefry2x64 RNG;
 
-/** Unsigned 64bit random integers */
-void cal::rng_dist_uint64(size_t n, uint64_t key1, uint64_t key2,
-                            uint64_t counter1, uint64_t counter2,
-                            uint64_t * data) {
-    RNG rng;
-    RNG::ukey_type uk = {{key1, key2}};
+// Batched counter-based generators.  Consecutive counters are
+// independent, so they are evaluated several at a time in SIMD lanes.
+// The arithmetic is the same as the Random123 reference implementation
+// and the outputs are bit-identical to calling the functor once per
+// counter.
 
-    if (cal::is_aligned(data)) {
-        #pragma omp simd
-        for (size_t i = 0; i < n; ++i) {
-            data[i] = rng(
-                RNG::ctr_type({{counter1, counter2 + i}}),
-                RNG::key_type(uk))[0];
-        }
-    } else {
-        for (size_t i = 0; i < n; ++i) {
-            data[i] = rng(
-                RNG::ctr_type({{counter1, counter2 + i}}),
-                RNG::key_type(uk))[0];
+namespace {
+// Block of counters processed together by the portable kernels.  The
+// fixed trip count loops are vectorized by the compiler for any ISA.
+size_t const RNG_LANES = 8;
+
+// Number of values generated on the stack before conversion to
+// floating point.
+size_t const RNG_BLOCK = 512;
+
+/** Portable lanes, a fixed size array the compiler can vectorize. */
+struct lanes_generic {
+    static size_t const width = RNG_LANES;
+    struct type {
+        uint64_t v[RNG_LANES];
+    };
+
+    static inline type set1(uint64_t a) {
+        type r;
+        for (size_t l = 0; l < width; ++l) r.v[l] = a;
+        return r;
+    }
+
+    static inline type iota(uint64_t a) {
+        type r;
+        for (size_t l = 0; l < width; ++l) r.v[l] = a + l;
+        return r;
+    }
+
+    static inline type add(type const & a, type const & b) {
+        type r;
+        for (size_t l = 0; l < width; ++l) r.v[l] = a.v[l] + b.v[l];
+        return r;
+    }
+
+    static inline type bxor(type const & a, type const & b) {
+        type r;
+        for (size_t l = 0; l < width; ++l) r.v[l] = a.v[l] ^ b.v[l];
+        return r;
+    }
+
+    template <int R>
+    static inline type rotl(type const & a) {
+        type r;
+        for (size_t l = 0; l < width; ++l) {
+            r.v[l] = (a.v[l] << R) | (a.v[l] >> (64 - R));
         }
+        return r;
     }
-    return;
+
+    static inline void store(uint64_t * out, type const & a) {
+        for (size_t l = 0; l < width; ++l) out[l] = a.v[l];
+    }
+};
+
+#ifdef RNG_AVX2
+# ifdef CAL_HAVE_TARGET_CLONES
+#  pragma GCC push_options
+#  pragma GCC target("avx2")
+# endif // ifdef CAL_HAVE_TARGET_CLONES
+
+/** AVX2 lanes.  There is no 64bit rotate, so it is done with shifts. */
+struct lanes_avx2 {
+    static size_t const width = 4;
+    typedef __m256i type;
+
+    static inline type set1(uint64_t a) {
+        return _mm256_set1_epi64x((long long)a);
+    }
+
+    static inline type iota(uint64_t a) {
+        return _mm256_add_epi64(set1(a), _mm256_setr_epi64x(0, 1, 2, 3));
+    }
+
+    static inline type add(type a, type b) {
+        return _mm256_add_epi64(a, b);
+    }
+
+    static inline type bxor(type a, type b) {
+        return _mm256_xor_si256(a, b);
+    }
+
+    template <int R>
+    static inline type rotl(type a) {
+        return _mm256_or_si256(_mm256_slli_epi64(a, R),
+                               _mm256_srli_epi64(a, 64 - R));
+    }
+
+    static inline void store(uint64_t * out, type a) {
+        _mm256_storeu_si256((__m256i *)out, a);
+    }
+};
+
+# ifdef CAL_HAVE_TARGET_CLONES
+#  pragma GCC pop_options
+# endif // ifdef CAL_HAVE_TARGET_CLONES
+#endif // ifdef RNG_AVX2
+
+#ifdef RNG_AVX512
+# ifdef CAL_HAVE_TARGET_CLONES
+#  pragma GCC push_options
+#  pragma GCC target("avx512f")
+# endif // ifdef CAL_HAVE_TARGET_CLONES
+
+/** AVX-512 lanes, with the native 64bit rotate. */
+struct lanes_avx512 {
+    static size_t const width = 8;
+    typedef __m512i type;
+
+    static inline type set1(uint64_t a) {
+        return _mm512_set1_epi64((long long)a);
+    }
+
+    static inline type iota(uint64_t a) {
+        return _mm512_add_epi64(set1(a),
+                                _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+    }
+
+    static inline type add(type a, type b) {
+        return _mm512_add_epi64(a, b);
+    }
+
+    static inline type bxor(type a, type b) {
+        return _mm512_xor_si512(a, b);
+    }
+
+    template <int R>
+    static inline type rotl(type a) {
+        return _mm512_rol_epi64(a, R);
+    }
+
+    static inline void store(uint64_t * out, type a) {
+        _mm512_storeu_si512((void *)out, a);
+    }
+};
+
+# ifdef CAL_HAVE_TARGET_CLONES
+#  pragma GCC pop_options
+# endif // ifdef CAL_HAVE_TARGET_CLONES
+#endif // ifdef RNG_AVX512
+
+#if defined(__AVX512F__)
+typedef lanes_avx512 lanes_native;
+#elif defined(__AVX2__)
+typedef lanes_avx2 lanes_native;
+#else // if defined(__AVX512F__)
+typedef lanes_generic lanes_native;
+#endif // if defined(__AVX512F__)
+
+// The kernels below are instantiated outside of the ISA specific
+// regions.  They are always inlined into the dispatched wrappers, so
+// that the lanes are only ever called from code compiled for their ISA,
+// even without optimization.  GCC still warns about the vector ABI, and
+// the AVX-512 rotate triggers a spurious uninitialized warning from the
+// intrinsic headers.
+#ifdef CAL_HAVE_TARGET_CLONES
+# define RNG_KERNEL inline __attribute__((always_inline))
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wpsabi"
+# pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#else // ifdef CAL_HAVE_TARGET_CLONES
+# define RNG_KERNEL inline
+#endif // ifdef CAL_HAVE_TARGET_CLONES
+
+template <class L, int R>
+RNG_KERNEL void threefry_round(typename L::type & x0, typename L::type & x1) {
+    x0 = L::add(x0, x1);
+    x1 = L::template rotl <R> (x1);
+    x1 = L::bxor(x1, x0);
 }
 
-/** Uniform double precision values on [0.0, 1.0] */
-void cal::rng_dist_uniform_01(size_t n,
-                                uint64_t key1, uint64_t key2,
-                                uint64_t counter1, uint64_t counter2,
-                                double * data) {
+template <class L>
+RNG_KERNEL void threefry_inject(typename L::type & x0, typename L::type & x1,
+                            uint64_t const * ks, uint64_t s) {
+    x0 = L::add(x0, L::set1(ks[s % 3]));
+    x1 = L::add(x1, L::set1(ks[(s + 1) % 3] + s));
+}
+
+/**
+* Threefry2x64 with 20 rounds on consecutive counters
+* (counter1, counter2 + i), i = 0 ... n - 1.  Both output words are
+* stored, data1 may be NULL.  Returns the number of counters processed,
+* which is a multiple of the lane width.
+*/
+template <class L>
+RNG_KERNEL size_t threefry2x64_lanes(size_t n, uint64_t key1, uint64_t key2,
+                          uint64_t counter1, uint64_t counter2,
+                          uint64_t * data0, uint64_t * data1) {
+    uint64_t ks[3] = {key1, key2, SKEIN_KS_PARITY64 ^ key1 ^ key2};
+    size_t nvec = n - n % L::width;
+    typename L::type c0 = L::set1(counter1 + ks[0]);
+
+    for (size_t i = 0; i < nvec; i += L::width) {
+        typename L::type x0 = c0;
+        typename L::type x1 = L::add(L::iota(counter2 + i), L::set1(ks[1]));
+
+        threefry_round <L, 16> (x0, x1);
+        threefry_round <L, 42> (x0, x1);
+        threefry_round <L, 12> (x0, x1);
+        threefry_round <L, 31> (x0, x1);
+        threefry_inject <L> (x0, x1, ks, 1);
+        threefry_round <L, 16> (x0, x1);
+        threefry_round <L, 32> (x0, x1);
+        threefry_round <L, 24> (x0, x1);
+        threefry_round <L, 21> (x0, x1);
+        threefry_inject <L> (x0, x1, ks, 2);
+        threefry_round <L, 16> (x0, x1);
+        threefry_round <L, 42> (x0, x1);
+        threefry_round <L, 12> (x0, x1);
+        threefry_round <L, 31> (x0, x1);
+        threefry_inject <L> (x0, x1, ks, 3);
+        threefry_round <L, 16> (x0, x1);
+        threefry_round <L, 32> (x0, x1);
+        threefry_round <L, 24> (x0, x1);
+        threefry_round <L, 21> (x0, x1);
+        threefry_inject <L> (x0, x1, ks, 4);
+        threefry_round <L, 16> (x0, x1);
+        threefry_round <L, 42> (x0, x1);
+        threefry_round <L, 12> (x0, x1);
+        threefry_round <L, 31> (x0, x1);
+        threefry_inject <L> (x0, x1, ks, 5);
+
+        L::store(data0 + i, x0);
+        if (data1 != NULL) L::store(data1 + i, x1);
+    }
+    return nvec;
+}
+
+#ifdef CAL_HAVE_TARGET_CLONES
+
+// One Threefry kernel per instruction set.  Flattening also inlines the
+// lanes, which are left as calls at low optimization levels.
+
+__attribute__((target("avx512f"), flatten))
+size_t threefry2x64_avx512(size_t n, uint64_t key1, uint64_t key2,
+                           uint64_t counter1, uint64_t counter2,
+                           uint64_t * data0, uint64_t * data1) {
+    return threefry2x64_lanes <lanes_avx512> (
+        n, key1, key2, counter1, counter2, data0, data1);
+}
+
+__attribute__((target("avx2"), flatten))
+size_t threefry2x64_avx2(size_t n, uint64_t key1, uint64_t key2,
+                         uint64_t counter1, uint64_t counter2,
+                         uint64_t * data0, uint64_t * data1) {
+    return threefry2x64_lanes <lanes_avx2> (
+        n, key1, key2, counter1, counter2, data0, data1);
+}
+
+CAL_TARGET_CLONES
+size_t threefry2x64_generic(size_t n, uint64_t key1, uint64_t key2,
+                            uint64_t counter1, uint64_t counter2,
+                            uint64_t * data0, uint64_t * data1) {
+    return threefry2x64_lanes <lanes_generic> (
+        n, key1, key2, counter1, counter2, data0, data1);
+}
+
+# pragma GCC diagnostic pop
+#endif // ifdef CAL_HAVE_TARGET_CLONES
+
+/** Threefry2x64 on consecutive counters, vector body and scalar tail. */
+void threefry2x64_batch(size_t n, uint64_t key1, uint64_t key2,
+                        uint64_t counter1, uint64_t counter2,
+                        uint64_t * data0, uint64_t * data1) {
+    #ifdef CAL_HAVE_TARGET_CLONES
+    size_t nvec;
+    if (__builtin_cpu_supports("avx512f")) {
+        nvec = threefry2x64_avx512(n, key1, key2, counter1, counter2,
+                                   data0, data1);
+    } else if (__builtin_cpu_supports("avx2")) {
+        nvec = threefry2x64_avx2(n, key1, key2, counter1, counter2,
+                                 data0, data1);
+    } else {
+        nvec = threefry2x64_generic(n, key1, key2, counter1, counter2,
+                                    data0, data1);
+    }
+    #else // ifdef CAL_HAVE_TARGET_CLONES
+    size_t nvec = threefry2x64_lanes <lanes_native> (
+        n, key1, key2, counter1, counter2, data0, data1);
+    #endif // ifdef CAL_HAVE_TARGET_CLONES
+
     RNG rng;
     RNG::ukey_type uk = {{key1, key2}};
+    for (size_t i = nvec; i < n; ++i) {
+        RNG::ctr_type out = rng(RNG::ctr_type({{counter1, counter2 + i}}),
+                                RNG::key_type(uk));
+        data0[i] = out[0];
+        if (data1 != NULL) data1[i] = out[1];
+    }
+    return;
+}
+
+/**
+* Philox4x32 with 10 rounds on consecutive counters.  The 32bit
+* multiplies widen to 64bit products, which vectorize on every SIMD ISA.
+*/
+CAL_TARGET_CLONES
+void philox4x32_batch(size_t ncounter, uint64_t key,
+                      uint64_t counter1, uint64_t counter2,
+                      uint32_t * data) {
+    uint32_t const M0 = PHILOX_M4x32_0;
+    uint32_t const M1 = PHILOX_M4x32_1;
+    uint32_t const W0 = PHILOX_W32_0;
+    uint32_t const W1 = PHILOX_W32_1;
+
+    size_t nvec = ncounter - ncounter % RNG_LANES;
 
-    if (cal::is_aligned(data)) {
-        #pragma omp simd
-        for (size_t i = 0; i < n; ++i) {
-            data[i] = r123::u01 <double, uint64_t> (
-                rng(RNG::ctr_type({{counter1, counter2 + i}}),
-                    RNG::key_type(uk))[0]);
+    for (size_t i = 0; i < nvec; i += RNG_LANES) {
+        uint32_t x0[RNG_LANES], x1[RNG_LANES], x2[RNG_LANES], x3[RNG_LANES];
+        for (size_t l = 0; l < RNG_LANES; ++l) {
+            uint64_t c = counter2 + i + l;
+            x0[l] = (uint32_t)c;
+            x1[l] = (uint32_t)(c >> 32);
+            x2[l] = (uint32_t)counter1;
+            x3[l] = (uint32_t)(counter1 >> 32);
         }
-    } else {
-        for (size_t i = 0; i < n; ++i) {
-            data[i] = r123::u01 <double, uint64_t> (
-                rng(RNG::ctr_type({{counter1, counter2 + i}}),
-                    RNG::key_type(uk))[0]);
+        uint32_t k0 = (uint32_t)key;
+        uint32_t k1 = (uint32_t)(key >> 32);
+        for (int r = 0; r < 10; ++r) {
+            if (r > 0) {
+                k0 += W0;
+                k1 += W1;
+            }
+            for (size_t l = 0; l < RNG_LANES; ++l) {
+                uint64_t p0 = (uint64_t)M0 * x0[l];
+                uint64_t p1 = (uint64_t)M1 * x2[l];
+                uint32_t y0 = (uint32_t)(p1 >> 32) ^ x1[l] ^ k0;
+                uint32_t y2 = (uint32_t)(p0 >> 32) ^ x3[l] ^ k1;
+                x0[l] = y0;
+                x1[l] = (uint32_t)p1;
+                x2[l] = y2;
+                x3[l] = (uint32_t)p0;
+            }
+        }
+        for (size_t l = 0; l < RNG_LANES; ++l) {
+            uint32_t * out = data + 4 * (i + l);
+            out[0] = x0[l];
+            out[1] = x1[l];
+            out[2] = x2[l];
+            out[3] = x3[l];
         }
     }
 
+    typedef r123::Philox4x32 PRNG;
+    PRNG prng;
+    PRNG::key_type pk = {{(uint32_t)key, (uint32_t)(key >> 32)}};
+    for (size_t i = nvec; i < ncounter; ++i) {
+        uint64_t c = counter2 + i;
+        PRNG::ctr_type out = prng(
+            PRNG::ctr_type({{(uint32_t)c, (uint32_t)(c >> 32),
+                             (uint32_t)counter1,
+                             (uint32_t)(counter1 >> 32)}}), pk);
+        for (size_t w = 0; w < 4; ++w) data[4 * i + w] = out[w];
+    }
     return;
 }
 
-/** Uniform double precision values on [-1.0, 1.0] */
-void cal::rng_dist_uniform_11(size_t n,
-                                uint64_t key1, uint64_t key2,
-                                uint64_t counter1, uint64_t counter2,
-                                double * data) {
-    RNG rng;
-    RNG::ukey_type uk = {{key1, key2}};
+// Draws shorter than this are not worth waking up the thread team.
+size_t const RNG_PARALLEL_MIN = 16 * RNG_BLOCK;
 
-    if (cal::is_aligned(data)) {
-        #pragma omp simd
-        for (size_t i = 0; i < n; ++i) {
-            data[i] = r123::uneg11 <double, uint64_t> (
-                rng(RNG::ctr_type({{counter1, counter2 + i}}),
-                    RNG::key_type(uk))[0]);
-        }
-    } else {
-        for (size_t i = 0; i < n; ++i) {
-            data[i] = r123::uneg11 <double, uint64_t> (
-                rng(RNG::ctr_type({{counter1, counter2 + i}}),
-                    RNG::key_type(uk))[0]);
+/**
+* Split the streams into blocks of RNG_BLOCK values and call
+* kernel(stream, offset, nvalue) for each of them.  The blocks are
+* assigned to threads in contiguous ranges, so that each thread writes
+* (and first touches) a contiguous part of the output.  Every value
+* depends only on its counter, so the result does not depend on the
+* number of threads.  Calls from inside a parallel region run serially.
+*/
+template <typename F>
+void rng_blocks(size_t nstream, size_t const * ndata, F const & kernel) {
+    size_t nblock = 0;
+    size_t ntotal = 0;
+    for (size_t s = 0; s < nstream; ++s) {
+        nblock += (ndata[s] + RNG_BLOCK - 1) / RNG_BLOCK;
+        ntotal += ndata[s];
+    }
+
+    bool threaded = (ntotal >= RNG_PARALLEL_MIN);
+#ifdef _OPENMP
+    threaded = threaded && !omp_in_parallel();
+#endif // ifdef _OPENMP
+
+    #pragma omp parallel if(threaded)
+    {
+        size_t nthread = 1;
+        size_t thread = 0;
+#ifdef _OPENMP
+        nthread = omp_get_num_threads();
+        thread = omp_get_thread_num();
+#endif // ifdef _OPENMP
+        size_t bfirst = nblock * thread / nthread;
+        size_t blast = nblock * (thread + 1) / nthread;
+
+        size_t b = 0;
+        for (size_t s = 0; (s < nstream) && (b < blast); ++s) {
+            size_t ns = (ndata[s] + RNG_BLOCK - 1) / RNG_BLOCK;
+            size_t sfirst = (bfirst > b) ? bfirst - b : 0;
+            size_t slast = std::min(ns, blast - b);
+            for (size_t sb = sfirst; sb < slast; ++sb) {
+                size_t off = sb * RNG_BLOCK;
+                kernel(s, off, std::min(RNG_BLOCK, ndata[s] - off));
+            }
+            b += ns;
         }
     }
     return;
 }
 
-/** Normal distribution. */
-void cal::rng_dist_normal(size_t n,
-                            uint64_t key1, uint64_t key2,
-                            uint64_t counter1, uint64_t counter2,
-                            double * data) {
-    /**First compute uniform randoms on [0.0, 1.0)*/
-    cal::AlignedVector <double> uni(n);
+/** One block of uniform values on [0.0, 1.0]. */
+inline void uniform_01_block(size_t n, uint64_t key1, uint64_t key2,
+                             uint64_t counter1, uint64_t counter2,
+                             double * data) {
+    uint64_t buf[RNG_BLOCK];
+    threefry2x64_batch(n, key1, key2, counter1, counter2, buf, NULL);
+    for (size_t i = 0; i < n; ++i) {
+        data[i] = r123::u01 <double, uint64_t> (buf[i]);
+    }
+    return;
+}
 
-    cal::rng_dist_uniform_01(n, key1, key2, counter1, counter2,
-                               uni.data());
+/** One block of uniform values on [-1.0, 1.0]. */
+inline void uniform_11_block(size_t n, uint64_t key1, uint64_t key2,
+                             uint64_t counter1, uint64_t counter2,
+                             double * data) {
+    uint64_t buf[RNG_BLOCK];
+    threefry2x64_batch(n, key1, key2, counter1, counter2, buf, NULL);
+    for (size_t i = 0; i < n; ++i) {
+        data[i] = r123::uneg11 <double, uint64_t> (buf[i]);
+    }
+    return;
+}
+
+/** One block of unit variance normal values. */
+inline void normal_block(size_t n, uint64_t key1, uint64_t key2,
+                         uint64_t counter1, uint64_t counter2,
+                         double * data) {
+    alignas(64) double uni[RNG_BLOCK];
+    uniform_01_block(n, key1, key2, counter1, counter2, uni);
 
     #pragma omp simd
     for (size_t i = 0; i < n; ++i) {
         uni[i] = 2.0 * uni[i] - 1.0;
     }
 
-    /** now use the inverse error function */
+    // Use the inverse error function.  This must stay the accurate one:
+    // every realization and cached atmosphere depends on these values, so
+    // they may not change by even an ulp.
+    #ifdef HAVE_MKL
+    cal::vfast_erfinv(n, uni, data);
+    #else // ifdef HAVE_MKL
+    cal::verfinv(n, uni, data);
+    #endif // ifdef HAVE_MKL
 
-    double * ldata = &(data[0]);
+    double rttwo = ::sqrt(2.0);
+    for (size_t i = 0; i < n; ++i) {
+        data[i] *= rttwo;
+    }
+    return;
+}
 
-    cal::vfast_erfinv(n, uni.data(), ldata);
+}
 
-    double rttwo = ::sqrt(2.0);
+/** Unsigned 64bit random integers */
+void cal::rng_dist_uint64(size_t n, uint64_t key1, uint64_t key2,
+                            uint64_t counter1, uint64_t counter2,
+                            uint64_t * data) {
+    rng_blocks(1, &n, [&](size_t, size_t off, size_t nb) {
+        threefry2x64_batch(nb, key1, key2, counter1, counter2 + off,
+                           data + off, NULL);
+    });
+    return;
+}
 
-    if (cal::is_aligned(data)) {
-        #pragma omp simd
-        for (size_t i = 0; i < n; ++i) {
-            data[i] *= rttwo;
-        }
-    } else {
-        for (size_t i = 0; i < n; ++i) {
-            data[i] *= rttwo;
-        }
+/** Uniform double precision values on [0.0, 1.0] */
+void cal::rng_dist_uniform_01(size_t n,
+                                uint64_t key1, uint64_t key2,
+                                uint64_t counter1, uint64_t counter2,
+                                double * data) {
+    rng_blocks(1, &n, [&](size_t, size_t off, size_t nb) {
+        uniform_01_block(nb, key1, key2, counter1, counter2 + off, data + off);
+    });
+    return;
+}
+
+/** Uniform double precision values on [-1.0, 1.0] */
+void cal::rng_dist_uniform_11(size_t n,
+                                uint64_t key1, uint64_t key2,
+                                uint64_t counter1, uint64_t counter2,
+                                double * data) {
+    rng_blocks(1, &n, [&](size_t, size_t off, size_t nb) {
+        uniform_11_block(nb, key1, key2, counter1, counter2 + off, data + off);
+    });
+    return;
+}
+
+/**
+* Both 64bit output words of Threefry2x64 for the counters
+* (counter1, counter2 + i).  data0 holds the first word, which is the
+* value returned by rng_dist_uint64, and data1 the second one.
+*/
+void cal::rng_threefry2x64(size_t n, uint64_t key1, uint64_t key2,
+                             uint64_t counter1, uint64_t counter2,
+                             uint64_t * data0, uint64_t * data1) {
+    threefry2x64_batch(n, key1, key2, counter1, counter2, data0, data1);
+    return;
+}
+
+/**
+* Unsigned 32bit random integers from Philox4x32.  Every counter
+* (counter1, counter2 + i / 4) yields four consecutive values.
+*/
+void cal::rng_philox4x32_uint32(size_t n, uint64_t key,
+                                  uint64_t counter1, uint64_t counter2,
+                                  uint32_t * data) {
+    size_t nfull = n / 4;
+    philox4x32_batch(nfull, key, counter1, counter2, data);
+    if (nfull * 4 < n) {
+        uint32_t last[4];
+        philox4x32_batch(1, key, counter1, counter2 + nfull, last);
+        for (size_t i = nfull * 4; i < n; ++i) data[i] = last[i - nfull * 4];
     }
     return;
 }
 
+/** Normal distribution. */
+void cal::rng_dist_normal(size_t n,
+                            uint64_t key1, uint64_t key2,
+                            uint64_t counter1, uint64_t counter2,
+                            double * data) {
+    rng_blocks(1, &n, [&](size_t, size_t off, size_t nb) {
+        normal_block(nb, key1, key2, counter1, counter2 + off, data + off);
+    });
+    return;
+}
+
 /**
 * Unsigned 64bit random integers, multiple streams.  The streams may be
 * arbitrary lengths with arbitrary starting counters.  Note that with suitable
@@ -138,13 +592,10 @@ void cal::rng_multi_dist_uint64(size_t nstream,
                                   uint64_t const * counter1,
                                   uint64_t const * counter2,
                                   uint64_t ** data) {
-    #pragma omp parallel for schedule(dynamic) default(none) shared(nstream, \
-    ndata, key1, key2, counter1, counter2, data)
-    for (size_t s = 0; s < nstream; ++s) {
-        cal::rng_dist_uint64(ndata[s], key1[s], key2[s],
-                               counter1[s], counter2[s],
-                               data[s]);
-    }
+    rng_blocks(nstream, ndata, [&](size_t s, size_t off, size_t nb) {
+        threefry2x64_batch(nb, key1[s], key2[s], counter1[s],
+                           counter2[s] + off, data[s] + off, NULL);
+    });
     return;
 }
 
@@ -162,13 +613,10 @@ void cal::rng_multi_dist_uniform_01(size_t nstream,
                                       uint64_t const * counter1,
                                       uint64_t const * counter2,
                                       double ** data) {
-    #pragma omp parallel for schedule(dynamic) default(none) shared(nstream, \
-    ndata, key1, key2, counter1, counter2, data)
-    for (size_t s = 0; s < nstream; ++s) {
-        cal::rng_dist_uniform_01(ndata[s], key1[s], key2[s],
-                                   counter1[s], counter2[s],
-                                   data[s]);
-    }
+    rng_blocks(nstream, ndata, [&](size_t s, size_t off, size_t nb) {
+        uniform_01_block(nb, key1[s], key2[s], counter1[s], counter2[s] + off,
+                         data[s] + off);
+    });
     return;
 }
 
@@ -186,13 +634,10 @@ void cal::rng_multi_dist_uniform_11(size_t nstream,
                                       uint64_t const * counter1,
                                       uint64_t const * counter2,
                                       double ** data) {
-    #pragma omp parallel for schedule(dynamic) default(none) shared(nstream, \
-    ndata, key1, key2, counter1, counter2, data)
-    for (size_t s = 0; s < nstream; ++s) {
-        cal::rng_dist_uniform_11(ndata[s], key1[s], key2[s],
-                                   counter1[s], counter2[s],
-                                   data[s]);
-    }
+    rng_blocks(nstream, ndata, [&](size_t s, size_t off, size_t nb) {
+        uniform_11_block(nb, key1[s], key2[s], counter1[s], counter2[s] + off,
+                         data[s] + off);
+    });
     return;
 }
 
@@ -209,12 +654,9 @@ void cal::rng_multi_dist_normal(size_t nstream,
                                   uint64_t const * counter1,
                                   uint64_t const * counter2,
                                   double ** data) {
-    #pragma omp parallel for schedule(dynamic) default(none) shared(nstream, \
-    ndata, key1, key2, counter1, counter2, data)
-    for (size_t s = 0; s < nstream; ++s) {
-        cal::rng_dist_normal(ndata[s], key1[s], key2[s],
-                               counter1[s], counter2[s],
-                               data[s]);
-    }
+    rng_blocks(nstream, ndata, [&](size_t s, size_t off, size_t nb) {
+        normal_block(nb, key1[s], key2[s], counter1[s], counter2[s] + off,
+                     data[s] + off);
+    });
     return;
 }
@@ -7,10 +7,241 @@
 #include <cal/sys_utils.hpp>
 #include <cal/math_sf.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+
 #ifdef HAVE_MKL
 # include <mkl.h>
 #endif // ifdef HAVE_MKL
 
+// Branch-free scalar kernels for the portable "fast" functions.  They
+// are only called from "omp simd" loops, where the compiler turns them
+// into SIMD code for the instruction set of each CAL_TARGET_CLONES
+// version.  Bit patterns are accessed with memcpy, which is free.
+
+namespace {
+inline uint64_t as_bits(double x) {
+    uint64_t u;
+    std::memcpy(&u, &x, sizeof(double));
+    return u;
+}
+
+inline double as_double(uint64_t u) {
+    double x;
+    std::memcpy(&x, &u, sizeof(double));
+    return x;
+}
+
+// Adding and subtracting 1.5 * 2^52 rounds to the nearest integer, which
+// then sits in the low bits of the mantissa of the sum.
+double const ROUND_SHIFT = 6755399441055744.0;
+
+/**
+* Natural logarithm of a positive, normal double.  This is the fdlibm
+* algorithm without the special cases, accurate to 1 ulp, written so
+* that the compiler can vectorize it.
+*/
+inline double log_positive(double x) {
+    double const ln2_hi = 6.93147180369123816490e-01;
+    double const ln2_lo = 1.90821492927058770002e-10;
+    double const Lg1 = 6.666666666666735130e-01;
+    double const Lg2 = 3.999999999940941908e-01;
+    double const Lg3 = 2.857142874366239149e-01;
+    double const Lg4 = 2.222219843214978396e-01;
+    double const Lg5 = 1.818357216161805012e-01;
+    double const Lg6 = 1.531383769920937332e-01;
+    double const Lg7 = 1.479819860511658591e-01;
+
+    // x = m * 2^k with m in [sqrt(2)/2, sqrt(2)).  The offset is the
+    // bit pattern of sqrt(2)/2.
+    uint64_t ix = as_bits(x);
+    uint64_t tmp = ix - 0x3fe6a09e667f3bcdULL;
+    int32_t k = (int32_t)((int64_t)tmp >> 52);
+    double m = as_double(ix - (tmp & 0xfff0000000000000ULL));
+
+    double f = m - 1.0;
+    double s = f / (2.0 + f);
+    double z = s * s;
+    double R = z * (Lg1 + z * (Lg2 + z * (Lg3 + z * (Lg4 + z * (Lg5
+               + z * (Lg6 + z * Lg7))))));
+    double hfsq = 0.5 * f * f;
+    double dk = (double)k;
+    return dk * ln2_hi - ((hfsq - (s * (hfsq + R) + dk * ln2_lo)) - f);
+}
+
+/** Natural logarithm with the IEEE special cases.  Error < 1 ulp. */
+inline double log_kernel(double x) {
+    double const two54 = 18014398509481984.0;
+    double const ln2_54 = 37.429947750237047;
+
+    // Subnormal inputs are scaled into the normal range first.
+    bool sub = (x < std::numeric_limits <double>::min());
+    double r = log_positive(sub ? x * two54 : x);
+    r = sub ? r - ln2_54 : r;
+
+    r = (x == std::numeric_limits <double>::infinity()) ? x : r;
+    r = (x == 0.0) ? -std::numeric_limits <double>::infinity() : r;
+    r = (x < 0.0) ? std::numeric_limits <double>::quiet_NaN() : r;
+    r = (x != x) ? x : r;
+    return r;
+}
+
+/**
+* Exponential.  The argument is reduced to k ln(2) + r with |r| below
+* ln(2) / 2 and exp(r) is a degree 13 Taylor polynomial.  The scale
+* 2^k is applied in two steps, so that overflow to infinity and
+* gradual underflow come out right.  Error < 1 ulp.
+*/
+inline double exp_kernel(double x) {
+    double const log2e = 1.44269504088896338700e+00;
+    double const ln2_hi = 6.93147180369123816490e-01;
+    double const ln2_lo = 1.90821492927058770002e-10;
+
+    // Beyond these the result is infinity or zero anyway, and the
+    // clamp keeps the exponent arithmetic in range.
+    double xc = (x > 710.0) ? 710.0 : x;
+    xc = (xc < -746.0) ? -746.0 : xc;
+
+    double kd = (xc * log2e + ROUND_SHIFT) - ROUND_SHIFT;
+    double r = (xc - kd * ln2_hi) - kd * ln2_lo;
+
+    double p = 1.0 / 6227020800.0;
+    p = p * r + 1.0 / 479001600.0;
+    p = p * r + 1.0 / 39916800.0;
+    p = p * r + 1.0 / 3628800.0;
+    p = p * r + 1.0 / 362880.0;
+    p = p * r + 1.0 / 40320.0;
+    p = p * r + 1.0 / 5040.0;
+    p = p * r + 1.0 / 720.0;
+    p = p * r + 1.0 / 120.0;
+    p = p * r + 1.0 / 24.0;
+    p = p * r + 1.0 / 6.0;
+    p = p * r + 0.5;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+
+    int32_t k = (int32_t)kd;
+    int32_t k1 = k / 2;
+    int32_t k2 = k - k1;
+    double s1 = as_double((uint64_t)(int64_t)(k1 + 1023) << 52);
+    double s2 = as_double((uint64_t)(int64_t)(k2 + 1023) << 52);
+    double res = (p * s1) * s2;
+
+    return (x != x) ? x : res;
+}
+
+// Cody-Waite split of pi / 2, the first two parts have 33 significant
+// bits so that their products with the quadrant number are exact.
+double const PIO2_1 = 1.57079632673412561417e+00;
+double const PIO2_2 = 6.07710050630396597660e-11;
+double const PIO2_3 = 2.02226624879595063154e-21;
+
+// Larger arguments are passed to the C library.
+double const SINCOS_MAX = 1.0e5;
+
+/**
+* Sine and cosine.  The argument is reduced to [-pi/4, pi/4] and the
+* fdlibm kernel polynomials are used.  Error < 1.5 ulp for |x| < 2 pi and
+* < 2.5 ulp for |x| < SINCOS_MAX.  Other arguments give NaN and must be
+* redone by the caller.
+*/
+inline void sincos_kernel(double x, double & s, double & c) {
+    double const S1 = -1.66666666666666324348e-01;
+    double const S2 = 8.33333333332248946124e-03;
+    double const S3 = -1.98412698298579493134e-04;
+    double const S4 = 2.75573137070700676789e-06;
+    double const S5 = -2.50507602534068634195e-08;
+    double const S6 = 1.58969099521155010221e-10;
+    double const C1 = 4.16666666666666019037e-02;
+    double const C2 = -1.38888888888741095749e-03;
+    double const C3 = 2.48015872894767294178e-05;
+    double const C4 = -2.75573143513906633035e-07;
+    double const C5 = 2.08757232129817482790e-09;
+    double const C6 = -1.13596475577881948265e-11;
+
+    bool ok = (::fabs(x) <= SINCOS_MAX);
+    double xr = ok ? x : 0.0;
+
+    double shifted = xr * cal::TWOINVPI + ROUND_SHIFT;
+    uint64_t quad = as_bits(shifted) & 3;
+    double jd = shifted - ROUND_SHIFT;
+
+    double r = ((xr - jd * PIO2_1) - jd * PIO2_2) - jd * PIO2_3;
+    double z = r * r;
+
+    double v = z * r;
+    double ps = S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)));
+    double sr = r + v * (S1 + z * ps);
+    sr = (r == 0.0) ? r : sr;
+
+    double pc = z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * C6)))));
+    double hz = 0.5 * z;
+    double w = 1.0 - hz;
+    double cr = w + (((1.0 - w) - hz) + z * pc);
+
+    // Quadrant 0: ( s,  c), 1: ( c, -s), 2: (-s, -c), 3: (-c,  s)
+    double sq = (quad & 1) ? cr : sr;
+    double cq = (quad & 1) ? sr : cr;
+    sq = (quad & 2) ? -sq : sq;
+    cq = ((quad + 1) & 2) ? -cq : cq;
+
+    double nan = std::numeric_limits <double>::quiet_NaN();
+    s = ok ? sq : nan;
+    c = ok ? cq : nan;
+    return;
+}
+
+/**
+* Arc tangent of y / x in the correct quadrant.  The ratio of the
+* smaller to the larger magnitude is in [0, 1], where the cephes
+* rational approximation is used.  Error < 2 ulp.
+*/
+inline double atan2_kernel(double y, double x) {
+    double const P0 = -8.750608600031904122785e-01;
+    double const P1 = -1.615753718733365076637e+01;
+    double const P2 = -7.500855792314704667340e+01;
+    double const P3 = -1.228866684490136173410e+02;
+    double const P4 = -6.485021904942025371773e+01;
+    double const Q0 = 2.485846490142306297962e+01;
+    double const Q1 = 1.650270098316988542046e+02;
+    double const Q2 = 4.328810604912902668951e+02;
+    double const Q3 = 4.853903996359136964868e+02;
+    double const Q4 = 1.945506571482613964425e+02;
+    double const PIO4 = 7.85398163397448278999e-01;
+    double const MOREBITS = 6.123233995736765886130e-17;
+
+    double ax = ::fabs(x);
+    double ay = ::fabs(y);
+    bool swap = (ay > ax);
+    double mn = swap ? ax : ay;
+    double mx = swap ? ay : ax;
+
+    // Both zero gives zero, both infinite gives one.
+    double t = mn / mx;
+    t = (mx == 0.0) ? 0.0 : t;
+    t = (mn == std::numeric_limits <double>::infinity()) ? 1.0 : t;
+
+    // atan(t) for t in [0, 1], above tan(3 pi / 8) - 1 the argument is
+    // shifted by pi / 4.
+    bool big = (t > 0.66);
+    double xr = big ? (t - 1.0) / (t + 1.0) : t;
+    double z = xr * xr;
+    double p = z * ((((P0 * z + P1) * z + P2) * z + P3) * z + P4)
+               / (((((z + Q0) * z + Q1) * z + Q2) * z + Q3) * z + Q4);
+    double a = xr * p + xr;
+    a = big ? PIO4 + (a + 0.5 * MOREBITS) : a;
+
+    a = swap ? (cal::PI_2 - a) + MOREBITS : a;
+    a = (as_bits(x) >> 63) ? (cal::PI - a) + 2.0 * MOREBITS : a;
+    a = (as_bits(y) >> 63) ? -a : a;
+
+    return ((x != x) || (y != y)) ? x + y : a;
+}
+}
+
+
 #ifdef HAVE_MKL
 
 /**These call MKL VM functions with "High Accuracy" mode.*/
@@ -57,6 +288,11 @@ void cal::vlog(int n, double const * in, double * out) {
     return;
 }
 
+void cal::verfinv(int n, double const * in, double * out) {
+    vmdErfInv(n, in, out, VML_HA | VML_FTZDAZ_OFF | VML_ERRMODE_DEFAULT);
+    return;
+}
+
 /** These call MKL VM functions with "Low Accuracy" mode.*/
 void cal::vfast_sin(int n, double const * ang, double * sinout) {
     vmdSin(n, ang, sinout, VML_LA | VML_FTZDAZ_OFF | VML_ERRMODE_DEFAULT);
@@ -231,645 +467,384 @@ void cal::vlog(int n, double const * in, double * out) {
     return;
 }
 
-// These use polynomial approximations for some functions.
+// The "fast" versions use the SIMD kernels above.  The loops over each
+// chunk are compiled for several instruction sets, the chunks are
+// distributed over the OpenMP threads.
 
-void cal::vfast_sin(int n, double const * ang, double * sinout) {
-    double const SC1 = 0.99999999999999806767;
-    double const SC2 = -0.4999999999998996568;
-    double const SC3 = 0.04166666666581174292;
-    double const SC4 = -0.001388888886113613522;
-    double const SC5 = 0.000024801582876042427;
-    double const SC6 = -0.0000002755693576863181;
-    double const SC7 = 0.0000000020858327958707;
-    double const SC8 = -0.000000000011080716368;
-    double sx;
-    double ssign;
-    double sx2;
-    double quot;
-    double rem;
-    double x;
-    double rang;
-    int quad;
-    int i;
-    double eps = std::numeric_limits <float>::epsilon();
-
-    # pragma \
-    omp parallel for default(shared) private(i, sx, sx2, ssign, quot, rem, x, quad, rang) schedule(static)
-    for (i = 0; i < n; i++) {
-        rang = ang[i];
-        while (rang < 0.0) {
-            rang += cal::TWOPI;
-        }
-        while (rang > cal::TWOPI) {
-            rang -= cal::TWOPI;
-        }
-        if ((fabs(rang) < eps) || (fabs(rang - cal::TWOPI) < eps)) {
-            sinout[i] = 0.0;
-            continue;
-        }
-        quot = ang[i] * cal::INV_TWOPI;
-        rem = quot - floor(quot);
-        x = rem * cal::TWOPI;
-        while (x < 0.0) {
-            x += cal::TWOPI;
-        }
-        quad = static_cast <int> (x * cal::TWOINVPI);
-
-        switch (quad) {
-            case 1:
-                sx = x - cal::PI_2;
-                ssign = 1.0;
-                break;
-
-            case 2:
-                sx = cal::THREEPI_2 - x;
-                ssign = -1.0;
-                break;
-
-            case 3:
-                sx = x - cal::THREEPI_2;
-                ssign = -1.0;
-                break;
-
-            default:
-                sx = cal::PI_2 - x;
-                ssign = 1.0;
-                break;
-        }
+namespace {
+int const FAST_CHUNK = 4096;
 
-        sx2 = sx * sx;
-        sinout[i] = ssign * (SC1 + sx2 *
-                             (SC2 + sx2 *
-                              (SC3 + sx2 *
-                               (SC4 + sx2 *
-                                (SC5 + sx2 *
-                                 (SC6 + sx2 * (SC7 + sx2 * SC8)))))));
+template <typename F>
+void fast_chunks(int n, F const & chunk) {
+    int nchunk = (n + FAST_CHUNK - 1) / FAST_CHUNK;
+    # pragma omp parallel for schedule(static) if (nchunk > 1)
+    for (int c = 0; c < nchunk; ++c) {
+        int off = c * FAST_CHUNK;
+        chunk(std::min(FAST_CHUNK, n - off), off);
     }
     return;
 }
 
-void cal::vfast_cos(int n, double const * ang, double * cosout) {
-    double const SC1 = 0.99999999999999806767;
-    double const SC2 = -0.4999999999998996568;
-    double const SC3 = 0.04166666666581174292;
-    double const SC4 = -0.001388888886113613522;
-    double const SC5 = 0.000024801582876042427;
-    double const SC6 = -0.0000002755693576863181;
-    double const SC7 = 0.0000000020858327958707;
-    double const SC8 = -0.000000000011080716368;
-    double cx;
-    double cx2;
-    double csign;
-    double quot;
-    double rem;
-    double x;
-    double rang;
-    int quad;
-    int i;
-    double eps = std::numeric_limits <float>::epsilon();
-
-    # pragma \
-    omp parallel for default(shared) private(i, cx, cx2, csign, quot, rem, x, quad, rang) schedule(static)
-    for (i = 0; i < n; i++) {
-        rang = ang[i];
-        while (rang < 0.0) {
-            rang += cal::TWOPI;
-        }
-        while (rang > cal::TWOPI) {
-            rang -= cal::TWOPI;
+// Fix up the arguments that are too large for the sine / cosine
+// reduction, these are rare in practice.  The outputs may be the
+// arguments, so the angle is loaded before either output is written.
+void sincos_fixup(int n, double const * ang, double * sinout,
+                  double * cosout) {
+    for (int i = 0; i < n; ++i) {
+        double a = ang[i];
+        if (!(::fabs(a) <= SINCOS_MAX)) {
+            if (sinout != NULL) sinout[i] = ::sin(a);
+            if (cosout != NULL) cosout[i] = ::cos(a);
         }
-        if ((fabs(rang) < eps) || (fabs(rang - cal::TWOPI) < eps)) {
-            cosout[i] = 1.0;
-            continue;
-        }
-        quot = rang * cal::INV_TWOPI;
-        rem = quot - floor(quot);
-        x = rem * cal::TWOPI;
-        while (x < 0.0) {
-            x += cal::TWOPI;
-        }
-        quad = static_cast <int> (x * cal::TWOINVPI);
-        switch (quad) {
-            case 1:
-                cx = cal::PI - x;
-                csign = -1.0;
-                break;
-
-            case 2:
-                cx = x - cal::PI;
-                csign = -1.0;
-                break;
-
-            case 3:
-                cx = cal::TWOPI - x;
-                csign = 1.0;
-                break;
-
-            default:
-                cx = x;
-                csign = 1.0;
-                break;
-        }
-        cx2 = cx * cx;
-        cosout[i] = csign * (SC1 + cx2 *
-                             (SC2 + cx2 *
-                              (SC3 + cx2 *
-                               (SC4 + cx2 *
-                                (SC5 + cx2 *
-                                 (SC6 + cx2 * (SC7 + cx2 * SC8)))))));
     }
     return;
 }
 
-void cal::vfast_sincos(int n, double const * ang, double * sinout,
-                         double * cosout) {
-    double const SC1 = 0.99999999999999806767;
-    double const SC2 = -0.4999999999998996568;
-    double const SC3 = 0.04166666666581174292;
-    double const SC4 = -0.001388888886113613522;
-    double const SC5 = 0.000024801582876042427;
-    double const SC6 = -0.0000002755693576863181;
-    double const SC7 = 0.0000000020858327958707;
-    double const SC8 = -0.000000000011080716368;
-    double sx;
-    double cx;
-    double sx2;
-    double cx2;
-    double ssign;
-    double csign;
-    double quot;
-    double rem;
-    double x;
-    double rang;
-    int quad;
-    int i;
-    double eps = std::numeric_limits <float>::epsilon();
-
-    # pragma \
-    omp parallel for default(shared) private(i, sx, cx, sx2, cx2, ssign, csign, quot, rem, x, quad, rang) schedule(static)
-    for (i = 0; i < n; i++) {
-        rang = ang[i];
-        while (rang < 0.0) {
-            rang += cal::TWOPI;
-        }
-        while (rang > cal::TWOPI) {
-            rang -= cal::TWOPI;
-        }
-        if ((fabs(rang) < eps) || (fabs(rang - cal::TWOPI) < eps)) {
-            sinout[i] = 0.0;
-            cosout[i] = 1.0;
-            continue;
-        }
-        quot = rang * cal::INV_TWOPI;
-        rem = quot - floor(quot);
-        x = rem * cal::TWOPI;
-        while (x < 0.0) {
-            x += cal::TWOPI;
-        }
-        quad = static_cast <int> (x * cal::TWOINVPI);
-        switch (quad) {
-            case 1:
-                sx = x - cal::PI_2;
-                ssign = 1.0;
-                cx = cal::PI - x;
-                csign = -1.0;
-                break;
-
-            case 2:
-                sx = cal::THREEPI_2 - x;
-                ssign = -1.0;
-                cx = x - cal::PI;
-                csign = -1.0;
-                break;
-
-            case 3:
-                sx = x - cal::THREEPI_2;
-                ssign = -1.0;
-                cx = cal::TWOPI - x;
-                csign = 1.0;
-                break;
-
-            default:
-                sx = cal::PI_2 - x;
-                ssign = 1.0;
-                cx = x;
-                csign = 1.0;
-                break;
-        }
-        sx2 = sx * sx;
-        cx2 = cx * cx;
-
-        sinout[i] = ssign * (SC1 + sx2 *
-                             (SC2 + sx2 *
-                              (SC3 + sx2 *
-                               (SC4 + sx2 *
-                                (SC5 + sx2 *
-                                 (SC6 + sx2 * (SC7 + sx2 * SC8)))))));
-        cosout[i] = csign * (SC1 + cx2 *
-                             (SC2 + cx2 *
-                              (SC3 + cx2 *
-                               (SC4 + cx2 *
-                                (SC5 + cx2 *
-                                 (SC6 + cx2 * (SC7 + cx2 * SC8)))))));
+// The kernel overwrites in-place arguments with NaN where they are too
+// large, keep a copy of the chunk for sincos_fixup if there are any.
+double const * sincos_keep(int n, double const * ang,
+                           std::vector <double> & keep) {
+    int nlarge = 0;
+    # pragma omp simd reduction(+:nlarge)
+    for (int i = 0; i < n; ++i) {
+        nlarge += (::fabs(ang[i]) <= SINCOS_MAX) ? 0 : 1;
+    }
+    if (nlarge == 0) return ang;
+    keep.assign(ang, ang + n);
+    return keep.data();
+}
+
+CAL_TARGET_CLONES
+void sin_chunk(int n, double const * ang, double * sinout) {
+    std::vector <double> keep;
+    double const * arg = sincos_keep(n, ang, keep);
+    # pragma omp simd
+    for (int i = 0; i < n; ++i) {
+        double c;
+        sincos_kernel(ang[i], sinout[i], c);
     }
+    sincos_fixup(n, arg, sinout, NULL);
     return;
 }
 
-void cal::vfast_atan2(int n, double const * y, double const * x,
-                        double * ang) {
-    double const ATCHEB1 = 48.70107004404898384;
-    double const ATCHEB2 = 49.5326263772254345;
-    double const ATCHEB3 = 9.40604244231624;
-    double const ATCHEB4 = 48.70107004404996166;
-    double const ATCHEB5 = 65.7663163908956299;
-    double const ATCHEB6 = 21.587934067020262;
-    int i;
-    double r2;
-    double r;
-    int complement;
-    int region;
-    int sign;
-
-    # pragma \
-    omp parallel for default(shared) private(i, r, r2, complement, region, sign) schedule(static)
-    for (i = 0; i < n; i++) {
-        r = y[i] / x[i];
-
-        // reduce range to PI/12
-
-        complement = 0;
-        region = 0;
-        sign = 0;
-        if (r < 0) {
-            r = -r;
-            sign = 1;
-        }
-        if (r > 1.0) {
-            r = 1.0 / r;
-            complement = 1;
-        }
-        if (r > cal::TANTWELFTHPI) {
-            r = (r - cal::TANSIXTHPI) / (1 + cal::TANSIXTHPI * r);
-            region = 1;
-        }
-        r2 = r * r;
-        r = (r * (ATCHEB1 + r2 * (ATCHEB2 + r2 * ATCHEB3))) /
-            (ATCHEB4 + r2 * (ATCHEB5 + r2 * (ATCHEB6 + r2)));
-        if (region) {
-            r += cal::SIXTHPI;
-        }
-        if (complement) {
-            r = cal::PI_2 - r;
-        }
-        if (sign) {
-            r = -r;
-        }
+CAL_TARGET_CLONES
+void cos_chunk(int n, double const * ang, double * cosout) {
+    std::vector <double> keep;
+    double const * arg = sincos_keep(n, ang, keep);
+    # pragma omp simd
+    for (int i = 0; i < n; ++i) {
+        double s;
+        sincos_kernel(ang[i], s, cosout[i]);
+    }
+    sincos_fixup(n, arg, NULL, cosout);
+    return;
+}
 
-        // adjust quadrant
+CAL_TARGET_CLONES
+void sincos_chunk(int n, double const * ang, double * sinout,
+                  double * cosout) {
+    std::vector <double> keep;
+    double const * arg = sincos_keep(n, ang, keep);
+    # pragma omp simd
+    for (int i = 0; i < n; ++i) {
+        sincos_kernel(ang[i], sinout[i], cosout[i]);
+    }
+    sincos_fixup(n, arg, sinout, cosout);
+    return;
+}
 
-        if (x[i] > 0.0) {
-            ang[i] = r;
-        } else if (x[i] < 0.0) {
-            ang[i] = r + cal::PI;
-            if (ang[i] > cal::PI) {
-                ang[i] -= cal::TWOPI;
-            }
-        } else if (y[i] > 0.0) {
-            ang[i] = cal::PI_2;
-        } else if (y[i] < 0.0) {
-            ang[i] = -cal::PI_2;
-        } else {
-            ang[i] = 0.0;
-        }
+CAL_TARGET_CLONES
+void atan2_chunk(int n, double const * y, double const * x, double * ang) {
+    # pragma omp simd
+    for (int i = 0; i < n; ++i) {
+        ang[i] = atan2_kernel(y[i], x[i]);
     }
     return;
 }
 
+CAL_TARGET_CLONES
+void sqrt_chunk(int n, double const * in, double * out) {
+    # pragma omp simd
+    for (int i = 0; i < n; ++i) {
+        out[i] = ::sqrt(in[i]);
+    }
+    return;
+}
+
+CAL_TARGET_CLONES
+void rsqrt_chunk(int n, double const * in, double * out) {
+    # pragma omp simd
+    for (int i = 0; i < n; ++i) {
+        out[i] = 1.0 / ::sqrt(in[i]);
+    }
+    return;
+}
+
+CAL_TARGET_CLONES
+void exp_chunk(int n, double const * in, double * out) {
+    # pragma omp simd
+    for (int i = 0; i < n; ++i) {
+        out[i] = exp_kernel(in[i]);
+    }
+    return;
+}
+
+CAL_TARGET_CLONES
+void log_chunk(int n, double const * in, double * out) {
+    # pragma omp simd
+    for (int i = 0; i < n; ++i) {
+        out[i] = log_kernel(in[i]);
+    }
+    return;
+}
+}
+
+void cal::vfast_sin(int n, double const * ang, double * sinout) {
+    fast_chunks(n, [&](int nc, int off) {
+        sin_chunk(nc, ang + off, sinout + off);
+    });
+    return;
+}
+
+void cal::vfast_cos(int n, double const * ang, double * cosout) {
+    fast_chunks(n, [&](int nc, int off) {
+        cos_chunk(nc, ang + off, cosout + off);
+    });
+    return;
+}
+
+void cal::vfast_sincos(int n, double const * ang, double * sinout,
+                         double * cosout) {
+    fast_chunks(n, [&](int nc, int off) {
+        sincos_chunk(nc, ang + off, sinout + off, cosout + off);
+    });
+    return;
+}
+
+void cal::vfast_atan2(int n, double const * y, double const * x,
+                        double * ang) {
+    fast_chunks(n, [&](int nc, int off) {
+        atan2_chunk(nc, y + off, x + off, ang + off);
+    });
+    return;
+}
+
 void cal::vfast_sqrt(int n, double const * in, double * out) {
-    cal::vsqrt(n, in, out);
+    fast_chunks(n, [&](int nc, int off) {
+        sqrt_chunk(nc, in + off, out + off);
+    });
     return;
 }
 
 void cal::vfast_rsqrt(int n, double const * in, double * out) {
-    cal::vrsqrt(n, in, out);
+    fast_chunks(n, [&](int nc, int off) {
+        rsqrt_chunk(nc, in + off, out + off);
+    });
     return;
 }
 
 void cal::vfast_exp(int n, double const * in, double * out) {
-    cal::vexp(n, in, out);
+    fast_chunks(n, [&](int nc, int off) {
+        exp_chunk(nc, in + off, out + off);
+    });
     return;
 }
 
 void cal::vfast_log(int n, double const * in, double * out) {
-    cal::vlog(n, in, out);
+    fast_chunks(n, [&](int nc, int off) {
+        log_chunk(nc, in + off, out + off);
+    });
+    return;
+}
+
+void cal::verfinv(int n, double const * in, double * out) {
+    cal::vgeneric_erfinv(n, in, out, false);
     return;
 }
 
 void cal::vfast_erfinv(int n, double const * in, double * out) {
-    // Based on domain decomposition by Mike Giles here:
-    // https://people.maths.ox.ac.uk/gilesm/files/gems_erfinv.pdf
-    //
-    // With numerical constants obtained from:
-    // https://people.maths.ox.ac.uk/gilesm/codes/erfinv/
-    //
-    cal::AlignedVector <double> arg(n);
-    cal::AlignedVector <double> lg(n);
-
-    if (cal::is_aligned(in)) {
+    cal::vgeneric_erfinv(n, in, out, true);
+    return;
+}
+
+#endif // ifdef HAVE_MKL
+
+
+// Portable inverse error function.  This is built with or without MKL,
+// so that the two can be compared.
+
+namespace {
+// Inputs are processed in blocks of this size, so that the scratch
+// space lives on the stack instead of being allocated for every call.
+const int ERFINV_BLOCK = 512;
+
+// Based on domain decomposition by Mike Giles here:
+// https://people.maths.ox.ac.uk/gilesm/files/gems_erfinv.pdf
+//
+// With numerical constants obtained from:
+// https://people.maths.ox.ac.uk/gilesm/codes/erfinv/
+//
+// The central polynomial is used for w = -log(1 - x^2) < 6.25, which
+// is |x| < 0.999, the other two cover the tails.
+
+double const ERFINV_CENTRAL[] = {
+    -3.6444120640178196996e-21,
+    -1.685059138182016589e-19,
+    1.2858480715256400167e-18,
+    1.115787767802518096e-17,
+    -1.333171662854620906e-16,
+    2.0972767875968561637e-17,
+    6.6376381343583238325e-15,
+    -4.0545662729752068639e-14,
+    -8.1519341976054721522e-14,
+    2.6335093153082322977e-12,
+    -1.2975133253453532498e-11,
+    -5.4154120542946279317e-11,
+    1.051212273321532285e-09,
+    -4.1126339803469836976e-09,
+    -2.9070369957882005086e-08,
+    4.2347877827932403518e-07,
+    -1.3654692000834678645e-06,
+    -1.3882523362786468719e-05,
+    0.0001867342080340571352,
+    -0.00074070253416626697512,
+    -0.0060336708714301490533,
+    0.24015818242558961693,
+    1.6536545626831027356
+};
+
+double const ERFINV_MID[] = {
+    2.2137376921775787049e-09,
+    9.0756561938885390979e-08,
+    -2.7517406297064545428e-07,
+    1.8239629214389227755e-08,
+    1.5027403968909827627e-06,
+    -4.013867526981545969e-06,
+    2.9234449089955446044e-06,
+    1.2475304481671778723e-05,
+    -4.7318229009055733981e-05,
+    6.8284851459573175448e-05,
+    2.4031110387097893999e-05,
+    -0.0003550375203628474796,
+    0.00095328937973738049703,
+    -0.0016882755560235047313,
+    0.0024914420961078508066,
+    -0.0037512085075692412107,
+    0.005370914553590063617,
+    1.0052589676941592334,
+    3.0838856104922207635
+};
+
+double const ERFINV_TAIL[] = {
+    -2.7109920616438573243e-11,
+    -2.5556418169965252055e-10,
+    1.5076572693500548083e-09,
+    -2.5556418169965252055e-10,
+    1.5076572693500548083e-09,
+    -3.7894654401267369937e-09,
+    7.6157012080783393804e-09,
+    -1.4960026627149240478e-08,
+    2.9147953450901080826e-08,
+    -6.7711997758452339498e-08,
+    2.2900482228026654717e-07,
+    -6.7711997758452339498e-08,
+    2.2900482228026654717e-07,
+    -9.9298272942317002539e-07,
+    4.5260625972231537039e-06,
+    -1.9681778105531670567e-05,
+    7.5995277030017761139e-05,
+    -0.00021503011930044477347,
+    -0.00013871931833623122026,
+    1.0103004648645343977,
+    4.8499064014085844221
+};
+
+template <size_t N>
+inline double horner(double const (&coeff)[N], double w) {
+    double p = coeff[0];
+    for (size_t k = 1; k < N; ++k) {
+        p *= w;
+        p += coeff[k];
+    }
+    return p;
+}
+
+/** Scalar inverse error function, used for the tails. */
+double erfinv_scalar(double x) {
+    double ab = ::fabs(x);
+    double w = -::log((1.0 - ab) * (1.0 + ab));
+    double p;
+    if (w < 6.250000) {
+        p = horner(ERFINV_CENTRAL, w - 3.125000);
+    } else if (w < 16.000000) {
+        p = horner(ERFINV_MID, ::sqrt(w) - 3.250000);
+    } else {
+        p = horner(ERFINV_TAIL, ::sqrt(w) - 5.000000);
+    }
+    return p * x;
+}
+
+/**
+* One block of the inverse error function.  The central polynomial is
+* evaluated for every input in branch-free loops, then the rare inputs
+* in the tails are redone with the scalar code.
+*/
+inline void erfinv_block(int n, double const * in, double * out,
+                         bool fast) {
+    alignas(64) double w[ERFINV_BLOCK];
+    alignas(64) double res[ERFINV_BLOCK];
+
+    # pragma omp simd
+    for (int i = 0; i < n; ++i) {
+        double ab = ::fabs(in[i]);
+        w[i] = (1.0 - ab) * (1.0 + ab);
+    }
+
+    if (fast) {
         # pragma omp simd
         for (int i = 0; i < n; ++i) {
-            double ab = ::fabs(in[i]);
-            arg[i] = (1.0 - ab) * (1.0 + ab);
+            w[i] = -log_positive(w[i]);
         }
     } else {
         for (int i = 0; i < n; ++i) {
-            double ab = ::fabs(in[i]);
-            arg[i] = (1.0 - ab) * (1.0 + ab);
+            w[i] = -::log(w[i]);
         }
     }
 
-    cal::vfast_log(n, arg.data(), lg.data());
+    # pragma omp simd
+    for (int i = 0; i < n; ++i) {
+        res[i] = horner(ERFINV_CENTRAL, w[i] - 3.125000) * in[i];
+    }
 
-    if (cal::is_aligned(out)) {
-        # pragma omp simd
-        for (int i = 0; i < n; ++i) {
-            double w = -lg[i];
-            double p;
-
-            if (w < 6.250000) {
-                w = w - 3.125000;
-                p =  -3.6444120640178196996e-21;
-                p *= w;
-                p += -1.685059138182016589e-19;
-                p *= w;
-                p += 1.2858480715256400167e-18;
-                p *= w;
-                p += 1.115787767802518096e-17;
-                p *= w;
-                p += -1.333171662854620906e-16;
-                p *= w;
-                p += 2.0972767875968561637e-17;
-                p *= w;
-                p += 6.6376381343583238325e-15;
-                p *= w;
-                p += -4.0545662729752068639e-14;
-                p *= w;
-                p += -8.1519341976054721522e-14;
-                p *= w;
-                p += 2.6335093153082322977e-12;
-                p *= w;
-                p += -1.2975133253453532498e-11;
-                p *= w;
-                p += -5.4154120542946279317e-11;
-                p *= w;
-                p += 1.051212273321532285e-09;
-                p *= w;
-                p += -4.1126339803469836976e-09;
-                p *= w;
-                p += -2.9070369957882005086e-08;
-                p *= w;
-                p += 4.2347877827932403518e-07;
-                p *= w;
-                p += -1.3654692000834678645e-06;
-                p *= w;
-                p += -1.3882523362786468719e-05;
-                p *= w;
-                p += 0.0001867342080340571352;
-                p *= w;
-                p += -0.00074070253416626697512;
-                p *= w;
-                p += -0.0060336708714301490533;
-                p *= w;
-                p += 0.24015818242558961693;
-                p *= w;
-                p += 1.6536545626831027356;
-            } else if (w < 16.000000) {
-                w = ::sqrt(w) - 3.250000;
-                p = 2.2137376921775787049e-09;
-                p *= w;
-                p += 9.0756561938885390979e-08;
-                p *= w;
-                p += -2.7517406297064545428e-07;
-                p *= w;
-                p += 1.8239629214389227755e-08;
-                p *= w;
-                p += 1.5027403968909827627e-06;
-                p *= w;
-                p += -4.013867526981545969e-06;
-                p *= w;
-                p += 2.9234449089955446044e-06;
-                p *= w;
-                p += 1.2475304481671778723e-05;
-                p *= w;
-                p += -4.7318229009055733981e-05;
-                p *= w;
-                p += 6.8284851459573175448e-05;
-                p *= w;
-                p += 2.4031110387097893999e-05;
-                p *= w;
-                p += -0.0003550375203628474796;
-                p *= w;
-                p += 0.00095328937973738049703;
-                p *= w;
-                p += -0.0016882755560235047313;
-                p *= w;
-                p += 0.0024914420961078508066;
-                p *= w;
-                p += -0.0037512085075692412107;
-                p *= w;
-                p += 0.005370914553590063617;
-                p *= w;
-                p += 1.0052589676941592334;
-                p *= w;
-                p += 3.0838856104922207635;
-            } else {
-                w = ::sqrt(w) - 5.000000;
-                p = -2.7109920616438573243e-11;
-                p *= w;
-                p += -2.5556418169965252055e-10;
-                p *= w;
-                p += 1.5076572693500548083e-09;
-                p *= w;
-                p += -2.5556418169965252055e-10;
-                p *= w;
-                p += 1.5076572693500548083e-09;
-                p *= w;
-                p += -3.7894654401267369937e-09;
-                p *= w;
-                p += 7.6157012080783393804e-09;
-                p *= w;
-                p += -1.4960026627149240478e-08;
-                p *= w;
-                p += 2.9147953450901080826e-08;
-                p *= w;
-                p += -6.7711997758452339498e-08;
-                p *= w;
-                p += 2.2900482228026654717e-07;
-                p *= w;
-                p += -6.7711997758452339498e-08;
-                p *= w;
-                p += 2.2900482228026654717e-07;
-                p *= w;
-                p += -9.9298272942317002539e-07;
-                p *= w;
-                p += 4.5260625972231537039e-06;
-                p *= w;
-                p += -1.9681778105531670567e-05;
-                p *= w;
-                p += 7.5995277030017761139e-05;
-                p *= w;
-                p += -0.00021503011930044477347;
-                p *= w;
-                p += -0.00013871931833623122026;
-                p *= w;
-                p += 1.0103004648645343977;
-                p *= w;
-                p += 4.8499064014085844221;
-            }
+    // Counted in a separate loop, a reduction in the loop above keeps
+    // the compiler from vectorizing the polynomial.
+    int ntail = 0;
+    for (int i = 0; i < n; ++i) {
+        ntail += (w[i] >= 6.250000) ? 1 : 0;
+    }
 
-            out[i] = p * in[i];
-        }
-    } else {
+    if (ntail > 0) {
         for (int i = 0; i < n; ++i) {
-            double w = -lg[i];
-            double p;
-
-            if (w < 6.250000) {
-                w = w - 3.125000;
-                p =  -3.6444120640178196996e-21;
-                p *= w;
-                p += -1.685059138182016589e-19;
-                p *= w;
-                p += 1.2858480715256400167e-18;
-                p *= w;
-                p += 1.115787767802518096e-17;
-                p *= w;
-                p += -1.333171662854620906e-16;
-                p *= w;
-                p += 2.0972767875968561637e-17;
-                p *= w;
-                p += 6.6376381343583238325e-15;
-                p *= w;
-                p += -4.0545662729752068639e-14;
-                p *= w;
-                p += -8.1519341976054721522e-14;
-                p *= w;
-                p += 2.6335093153082322977e-12;
-                p *= w;
-                p += -1.2975133253453532498e-11;
-                p *= w;
-                p += -5.4154120542946279317e-11;
-                p *= w;
-                p += 1.051212273321532285e-09;
-                p *= w;
-                p += -4.1126339803469836976e-09;
-                p *= w;
-                p += -2.9070369957882005086e-08;
-                p *= w;
-                p += 4.2347877827932403518e-07;
-                p *= w;
-                p += -1.3654692000834678645e-06;
-                p *= w;
-                p += -1.3882523362786468719e-05;
-                p *= w;
-                p += 0.0001867342080340571352;
-                p *= w;
-                p += -0.00074070253416626697512;
-                p *= w;
-                p += -0.0060336708714301490533;
-                p *= w;
-                p += 0.24015818242558961693;
-                p *= w;
-                p += 1.6536545626831027356;
-            } else if (w < 16.000000) {
-                w = ::sqrt(w) - 3.250000;
-                p = 2.2137376921775787049e-09;
-                p *= w;
-                p += 9.0756561938885390979e-08;
-                p *= w;
-                p += -2.7517406297064545428e-07;
-                p *= w;
-                p += 1.8239629214389227755e-08;
-                p *= w;
-                p += 1.5027403968909827627e-06;
-                p *= w;
-                p += -4.013867526981545969e-06;
-                p *= w;
-                p += 2.9234449089955446044e-06;
-                p *= w;
-                p += 1.2475304481671778723e-05;
-                p *= w;
-                p += -4.7318229009055733981e-05;
-                p *= w;
-                p += 6.8284851459573175448e-05;
-                p *= w;
-                p += 2.4031110387097893999e-05;
-                p *= w;
-                p += -0.0003550375203628474796;
-                p *= w;
-                p += 0.00095328937973738049703;
-                p *= w;
-                p += -0.0016882755560235047313;
-                p *= w;
-                p += 0.0024914420961078508066;
-                p *= w;
-                p += -0.0037512085075692412107;
-                p *= w;
-                p += 0.005370914553590063617;
-                p *= w;
-                p += 1.0052589676941592334;
-                p *= w;
-                p += 3.0838856104922207635;
-            } else {
-                w = ::sqrt(w) - 5.000000;
-                p = -2.7109920616438573243e-11;
-                p *= w;
-                p += -2.5556418169965252055e-10;
-                p *= w;
-                p += 1.5076572693500548083e-09;
-                p *= w;
-                p += -2.5556418169965252055e-10;
-                p *= w;
-                p += 1.5076572693500548083e-09;
-                p *= w;
-                p += -3.7894654401267369937e-09;
-                p *= w;
-                p += 7.6157012080783393804e-09;
-                p *= w;
-                p += -1.4960026627149240478e-08;
-                p *= w;
-                p += 2.9147953450901080826e-08;
-                p *= w;
-                p += -6.7711997758452339498e-08;
-                p *= w;
-                p += 2.2900482228026654717e-07;
-                p *= w;
-                p += -6.7711997758452339498e-08;
-                p *= w;
-                p += 2.2900482228026654717e-07;
-                p *= w;
-                p += -9.9298272942317002539e-07;
-                p *= w;
-                p += 4.5260625972231537039e-06;
-                p *= w;
-                p += -1.9681778105531670567e-05;
-                p *= w;
-                p += 7.5995277030017761139e-05;
-                p *= w;
-                p += -0.00021503011930044477347;
-                p *= w;
-                p += -0.00013871931833623122026;
-                p *= w;
-                p += 1.0103004648645343977;
-                p *= w;
-                p += 4.8499064014085844221;
+            if (w[i] >= 6.250000) {
+                res[i] = erfinv_scalar(in[i]);
             }
-
-            out[i] = p * in[i];
         }
     }
 
+    // Written last, so that the input and output may be the same array.
+    for (int i = 0; i < n; ++i) {
+        out[i] = res[i];
+    }
     return;
 }
+}
 
-#endif // ifdef HAVE_MKL
+CAL_TARGET_CLONES
+void cal::vgeneric_erfinv(int n, double const * in, double * out,
+                          bool fast) {
+    for (int off = 0; off < n; off += ERFINV_BLOCK) {
+        int nb = std::min(ERFINV_BLOCK, n - off);
+        erfinv_block(nb, in + off, out + off, fast);
+    }
+    return;
+}
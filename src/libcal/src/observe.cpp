@@ -36,6 +36,7 @@
 int cal::atm_sim::observe(double * t, double * az, double * el, double * tod,
             long nsamp, double fixed_r)
 {
+    cal::ProfileRegion region("observe");
     if(!cached){
         throw std::runtime_error("There is no cached observation to observe.");
     }
@@ -10,10 +10,11 @@
  * @brief Simulate the atmosphere in indipendent slices, each slice is assigned at one process. 
  * 
  * @param use_cache 
- * @return int 
+ * @return int 0, or -1 if the simulation failed
  */
 int cal::atm_sim::simulate(bool use_cache)
 {
+    cal::ProfileRegion region("simulate");
     if (use_cache) load_realization();
     if (cached) return 0;
 
@@ -22,8 +23,12 @@ int cal::atm_sim::simulate(bool use_cache)
         get_volume();
         compress_volume();
         try {
-            realization.reset(new AlignedVector <double> (nelem));
-            std:fill(realization->begin(), realization->end(), 0.0);
+            realization.reset(new FirstTouchVector <double> (
+                                  FirstTouchAllocator <double> (
+                                      cal::MemoryTracker::get().category(
+                                          "realization"))));
+            realization->resize(nelem);
+            first_touch_fill(realization->data(), nelem, 0.0);
         } catch (...) {
             std::cerr << rank << " : Allocation failed. nelem = " << nelem << std::endl;
             throw;
@@ -51,6 +56,7 @@ int cal::atm_sim::simulate(bool use_cache)
                                         ind_start,
                                         ind_stop);
                 cholmod_free_sparse(&sqrt_cov, chcommon);
+                sample_cholmod_memory();
             }
             counter2 += ind_stop - ind_start;
 
@@ -63,8 +69,10 @@ int cal::atm_sim::simulate(bool use_cache)
             tm.report("Realization constructed in");
         }
     } catch (const std::exception & e) {
+        // Leave nothing to observe or to cache
         std::cerr << "WARNING: atm::simulate failed with: " << e.what()
                   << std::endl;
+        return -1;
     }
     cached = true;
 
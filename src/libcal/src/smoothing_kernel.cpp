@@ -28,6 +28,7 @@ double mean(std::vector <double> vec) {
 
 void cal::atm_sim::smooth()
 {
+    cal::ProfileRegion region("smooth");
     // Replace each vertex with a mean of its immediate vicinity
 
     cal::Timer tm;
@@ -221,6 +221,32 @@ cal::Environment::Environment() {
     } else {
         tod_buffer_length_ = 1048576;
     }
+
+    // Allocations of at least this many bytes are backed by transparent
+    // huge pages.  Zero disables huge pages.
+    hugepage_threshold_ = 0;
+    envval = ::getenv("CAL_HUGEPAGES");
+    if (envval != NULL) {
+        hugepage_threshold_ = ::atol(envval);
+        if (hugepage_threshold_ < 0) hugepage_threshold_ = 0;
+    }
+
+    // Instruction set of the runtime dispatched kernels.
+    simd_target_ = cal::simd_target();
+
+    // Write a timeline of the profiled regions to this file at exit.
+    trace_file_ = "";
+    envval = ::getenv("CAL_TRACE");
+    if (envval != NULL) {
+        trace_file_ = std::string(envval);
+    }
+
+    // Batches of AATM models are evaluated in parallel unless disabled.
+    aatm_threads_ = true;
+    envval = ::getenv("CAL_AATM_THREADS");
+    if (envval != NULL) {
+        aatm_threads_ = (::atoi(envval) != 0);
+    }
 }
 
 cal::Environment & cal::Environment::get() {
@@ -253,6 +279,28 @@ int64_t cal::Environment::tod_buffer_length() const {
     return tod_buffer_length_;
 }
 
+int64_t cal::Environment::hugepage_threshold() const {
+    return hugepage_threshold_;
+}
+
+void cal::Environment::set_hugepage_threshold(int64_t nbytes) {
+    if (nbytes < 0) nbytes = 0;
+    hugepage_threshold_ = nbytes;
+    return;
+}
+
+std::string cal::Environment::simd_target() const {
+    return simd_target_;
+}
+
+std::string cal::Environment::trace_file() const {
+    return trace_file_;
+}
+
+bool cal::Environment::aatm_threads() const {
+    return aatm_threads_;
+}
+
 int cal::Environment::max_threads() const {
     return max_threads_;
 }
@@ -317,6 +365,35 @@ std::vector <std::string> cal::Environment::info() const {
     o << "Max threads = " << max_threads_;
     ret.push_back(o.str());
 
+    o.str("");
+    o << "SIMD dispatch = " << simd_target_;
+    ret.push_back(o.str());
+
+    o.str("");
+    if (hugepage_threshold_ > 0) {
+        o << "Huge pages enabled for allocations >= "
+          << hugepage_threshold_ << " bytes";
+    } else {
+        o << "Huge pages disabled";
+    }
+    ret.push_back(o.str());
+
+    o.str("");
+    if (trace_file_.empty()) {
+        o << "Tracing disabled";
+    } else {
+        o << "Tracing to " << trace_file_ << "_<rank>.json";
+    }
+    ret.push_back(o.str());
+
+    o.str("");
+    if (aatm_threads_) {
+        o << "AATM batches threaded";
+    } else {
+        o << "AATM batches serial";
+    }
+    ret.push_back(o.str());
+
     o.str("");
     if (have_mpi_) {
         o << "MPI build enabled";
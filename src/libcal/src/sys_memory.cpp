@@ -0,0 +1,157 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <cal/sys_memory.hpp>
+#include <cal/sys_utils.hpp>
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+namespace {
+void raise_peak(std::atomic <int64_t> & peak, int64_t value) {
+    int64_t old = peak.load(std::memory_order_relaxed);
+    while ((value > old) &&
+           !peak.compare_exchange_weak(old, value,
+                                       std::memory_order_relaxed)) {}
+    return;
+}
+}
+
+const int cal::MemoryTracker::MAX_CATEGORY;
+const int cal::MemoryTracker::ALIGNED;
+
+cal::MemoryTracker::MemoryTracker() {
+    for (int i = 0; i < MAX_CATEGORY; ++i) {
+        counters_[i].current = 0;
+        counters_[i].peak = 0;
+        counters_[i].allocs = 0;
+    }
+    total_.current = 0;
+    total_.peak = 0;
+    total_.allocs = 0;
+    names_.push_back("aligned");
+}
+
+cal::MemoryTracker & cal::MemoryTracker::get() {
+    static cal::MemoryTracker instance;
+
+    return instance;
+}
+
+int cal::MemoryTracker::category(std::string const & name) {
+    std::lock_guard <std::mutex> guard(lock_);
+    for (size_t i = 0; i < names_.size(); ++i) {
+        if (names_[i] == name) return i;
+    }
+    if (names_.size() == (size_t)MAX_CATEGORY) {
+        auto here = cal_HERE();
+        auto log = cal::Logger::get();
+        std::ostringstream o;
+        o << "Cannot register memory category " << name << ", all "
+          << MAX_CATEGORY << " categories are in use";
+        log.error(o.str().c_str(), here);
+        throw std::runtime_error(o.str().c_str());
+    }
+    names_.push_back(name);
+    return names_.size() - 1;
+}
+
+std::string cal::MemoryTracker::name(int id) const {
+    std::lock_guard <std::mutex> guard(lock_);
+    if ((id < 0) || (id >= (int)names_.size())) {
+        auto here = cal_HERE();
+        auto log = cal::Logger::get();
+        std::ostringstream o;
+        o << "Unknown memory category " << id;
+        log.error(o.str().c_str(), here);
+        throw std::runtime_error(o.str().c_str());
+    }
+    return names_[id];
+}
+
+void cal::MemoryTracker::add_(int id, int64_t bytes, int64_t excess) {
+    // excess is held on top of the current value at the peak of a
+    // sampled category
+    auto & cnt = counters_[id];
+    int64_t cur = cnt.current.fetch_add(bytes, std::memory_order_relaxed)
+                  + bytes;
+    raise_peak(cnt.peak, cur + excess);
+    int64_t tot = total_.current.fetch_add(bytes, std::memory_order_relaxed)
+                  + bytes;
+    raise_peak(total_.peak, tot + excess);
+    return;
+}
+
+void cal::MemoryTracker::allocated(int id, size_t bytes) {
+    counters_[id].allocs.fetch_add(1, std::memory_order_relaxed);
+    total_.allocs.fetch_add(1, std::memory_order_relaxed);
+    add_(id, bytes, 0);
+    return;
+}
+
+void cal::MemoryTracker::freed(int id, size_t bytes) {
+    add_(id, -(int64_t)bytes, 0);
+    return;
+}
+
+void cal::MemoryTracker::sample(int id, int64_t & held, size_t current,
+                                size_t peak) {
+    int64_t excess = (peak > current) ? peak - current : 0;
+    add_(id, (int64_t)current - held, excess);
+    held = current;
+    return;
+}
+
+int64_t cal::MemoryTracker::current(int id) const {
+    return counters_[id].current;
+}
+
+int64_t cal::MemoryTracker::peak(int id) const {
+    return counters_[id].peak;
+}
+
+std::vector <cal::MemoryStat> cal::MemoryTracker::stats() const {
+    std::vector <MemoryStat> ret;
+    std::lock_guard <std::mutex> guard(lock_);
+    for (size_t i = 0; i < names_.size(); ++i) {
+        auto const & cnt = counters_[i];
+        MemoryStat st;
+        st.category = names_[i];
+        st.current = cnt.current;
+        st.peak = cnt.peak;
+        st.allocs = cnt.allocs;
+        if ((st.allocs == 0) && (st.peak == 0)) continue;
+        ret.push_back(st);
+    }
+    MemoryStat st;
+    st.category = "total";
+    st.current = total_.current;
+    st.peak = total_.peak;
+    st.allocs = total_.allocs;
+    ret.push_back(st);
+    return ret;
+}
+
+void cal::MemoryTracker::reset_peak() {
+    for (int i = 0; i < MAX_CATEGORY; ++i) {
+        counters_[i].peak = counters_[i].current.load();
+    }
+    total_.peak = total_.current.load();
+    return;
+}
+
+void cal::MemoryTracker::report() const {
+    auto st = stats();
+    std::ostringstream o;
+    o << std::fixed << std::setprecision(2);
+    for (auto const & s : st) {
+        o << "Memory " << s.category << ": " << s.current / 1048576.
+          << " MB (peak " << s.peak / 1048576. << " MB, " << s.allocs
+          << " allocations)" << std::endl;
+    }
+    std::cout << o.str() << std::flush;
+    return;
+}
@@ -0,0 +1,270 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <cal/sys_profile.hpp>
+#include <cal/sys_env.hpp>
+#include <cal/sys_utils.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+
+
+namespace {
+// Each thread caches its own tree so that opening a region takes no lock
+thread_local void * profile_local = nullptr;
+}
+
+cal::Profiler::Profiler() {
+    enabled_ = true;
+    rank_ = 0;
+    trace_epoch_ = clock::now();
+    trace_epoch_us_ = std::chrono::duration <double, std::micro> (
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    auto & env = cal::Environment::get();
+    trace_file_ = env.trace_file();
+    tracing_ = !trace_file_.empty();
+}
+
+cal::Profiler & cal::Profiler::get() {
+    static cal::Profiler instance;
+
+    // Registered after the instance is constructed, so the timeline is
+    // written before the instance is destroyed.
+    static bool trace_at_exit = instance.tracing_ &&
+                                (std::atexit(write_trace_at_exit_) == 0);
+    (void)trace_at_exit;
+
+    return instance;
+}
+
+void cal::Profiler::write_trace_at_exit_() {
+    auto & prof = cal::Profiler::get();
+    std::ostringstream path;
+    path << prof.trace_file_ << "_" << prof.rank_ << ".json";
+    try {
+        prof.write_trace(path.str());
+    } catch (std::exception & e) {
+        // Nothing can be done at exit
+    }
+    return;
+}
+
+bool cal::Profiler::tracing() const {
+    return tracing_;
+}
+
+void cal::Profiler::set_tracing(bool tracing) {
+    tracing_ = tracing;
+    return;
+}
+
+bool cal::Profiler::enabled() const {
+    return enabled_;
+}
+
+void cal::Profiler::set_enabled(bool enabled) {
+    enabled_ = enabled;
+    return;
+}
+
+int cal::Profiler::rank() const {
+    return rank_;
+}
+
+void cal::Profiler::set_rank(int rank) {
+    rank_ = rank;
+    return;
+}
+
+cal::Profiler::thread_data & cal::Profiler::local_() {
+    if (profile_local == nullptr) {
+        std::lock_guard <std::mutex> guard(lock_);
+        threads_.emplace_back(new thread_data());
+        thread_data * td = threads_.back().get();
+        td->index = threads_.size() - 1;
+        td->root.name = "";
+        td->root.parent = nullptr;
+        td->current = &td->root;
+        profile_local = td;
+    }
+    return *static_cast <thread_data *> (profile_local);
+}
+
+void cal::Profiler::start(char const * name) {
+    thread_data & td = local_();
+    node * cur = td.current;
+    node * child = nullptr;
+    for (auto c : cur->children) {
+        if ((c->name == name) || (std::strcmp(c->name, name) == 0)) {
+            child = c;
+            break;
+        }
+    }
+    if (child == nullptr) {
+        // The tree is only read by stats(), which must not run while
+        // regions are open, so growing it needs no lock.
+        td.nodes.emplace_back();
+        child = &td.nodes.back();
+        child->name = name;
+        child->parent = cur;
+        child->calls = 0;
+        child->seconds = 0;
+        child->min = std::numeric_limits <double>::max();
+        child->max = 0;
+        cur->children.push_back(child);
+    }
+    td.current = child;
+    child->start = clock::now();
+    return;
+}
+
+void cal::Profiler::stop() {
+    auto now = clock::now();
+    thread_data & td = local_();
+    node * cur = td.current;
+    if (cur == &td.root) return;
+    double dt = std::chrono::duration <double> (now - cur->start).count();
+    cur->calls++;
+    cur->seconds += dt;
+    if (dt < cur->min) cur->min = dt;
+    if (dt > cur->max) cur->max = dt;
+    if (tracing_) {
+        event ev;
+        ev.name = cur->name;
+        ev.start = cur->start;
+        ev.stop = now;
+        td.events.push_back(ev);
+    }
+    td.current = cur->parent;
+    return;
+}
+
+std::vector <cal::ProfileStat> cal::Profiler::stats(bool per_thread) const {
+    std::lock_guard <std::mutex> guard(lock_);
+    std::vector <ProfileStat> ret;
+    std::map <std::string, size_t> merged;
+
+    for (auto const & td : threads_) {
+        // Depth-first walk with an explicit stack of (node, depth)
+        std::vector <std::pair <node const *, int> > stack;
+        std::vector <std::string> prefix;
+        for (auto it = td->root.children.rbegin();
+             it != td->root.children.rend(); ++it) {
+            stack.push_back(std::make_pair(*it, 0));
+        }
+        while (!stack.empty()) {
+            node const * nd = stack.back().first;
+            int depth = stack.back().second;
+            stack.pop_back();
+            prefix.resize(depth);
+            std::string path;
+            for (auto const & p : prefix) path += p + "/";
+            path += nd->name;
+            prefix.push_back(nd->name);
+            for (auto it = nd->children.rbegin(); it != nd->children.rend();
+                 ++it) {
+                stack.push_back(std::make_pair(*it, depth + 1));
+            }
+            if (nd->calls == 0) continue;
+
+            if (!per_thread) {
+                auto found = merged.find(path);
+                if (found != merged.end()) {
+                    ProfileStat & st = ret[found->second];
+                    st.calls += nd->calls;
+                    st.seconds += nd->seconds;
+                    if (nd->min < st.min) st.min = nd->min;
+                    if (nd->max > st.max) st.max = nd->max;
+                    continue;
+                }
+                merged[path] = ret.size();
+            }
+            ProfileStat st;
+            st.path = path;
+            st.depth = depth;
+            st.thread = per_thread ? td->index : -1;
+            st.rank = rank_;
+            st.calls = nd->calls;
+            st.seconds = nd->seconds;
+            st.min = nd->min;
+            st.max = nd->max;
+            ret.push_back(st);
+        }
+    }
+    return ret;
+}
+
+void cal::Profiler::report() const {
+    auto st = stats(false);
+    std::ostringstream o;
+    o << std::fixed << std::setprecision(6);
+    for (auto const & s : st) {
+        auto pos = s.path.rfind('/');
+        std::string name = (pos == std::string::npos) ?
+                           s.path : s.path.substr(pos + 1);
+        o << "Profile rank " << s.rank << ": "
+          << std::string(2 * s.depth, ' ') << name << ": " << s.calls
+          << " calls, " << s.seconds << " s (min " << s.min << ", max "
+          << s.max << ")" << std::endl;
+    }
+    std::cout << o.str() << std::flush;
+    return;
+}
+
+void cal::Profiler::clear() {
+    std::lock_guard <std::mutex> guard(lock_);
+    for (auto & td : threads_) {
+        for (auto & nd : td->nodes) {
+            nd.calls = 0;
+            nd.seconds = 0;
+            nd.min = std::numeric_limits <double>::max();
+            nd.max = 0;
+        }
+        td->events.clear();
+    }
+    return;
+}
+
+void cal::Profiler::write_trace(std::string const & path) const {
+    std::lock_guard <std::mutex> guard(lock_);
+
+    std::ofstream f(path);
+    if (!f.good()) {
+        auto here = cal_HERE();
+        auto log = cal::Logger::get();
+        std::string msg = "Cannot open trace file " + path;
+        log.error(msg.c_str(), here);
+        throw std::runtime_error(msg.c_str());
+    }
+    f << std::fixed << std::setprecision(3);
+    f << "{\"traceEvents\":[" << std::endl;
+    f << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << rank_
+      << ",\"tid\":0,\"args\":{\"name\":\"rank " << rank_ << "\"}}";
+    for (auto const & td : threads_) {
+        f << "," << std::endl;
+        f << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << rank_
+          << ",\"tid\":" << td->index << ",\"args\":{\"name\":\"thread "
+          << td->index << "\"}}";
+        for (auto const & ev : td->events) {
+            double ts = trace_epoch_us_ + std::chrono::duration <double,
+                                                                 std::micro> (
+                ev.start - trace_epoch_).count();
+            double dur = std::chrono::duration <double, std::micro> (
+                ev.stop - ev.start).count();
+            f << "," << std::endl;
+            f << "{\"name\":\"" << ev.name << "\",\"ph\":\"X\",\"pid\":"
+              << rank_ << ",\"tid\":" << td->index << ",\"ts\":" << ts
+              << ",\"dur\":" << dur << "}";
+        }
+    }
+    f << std::endl << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+    f.close();
+    return;
+}
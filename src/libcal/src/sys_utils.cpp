@@ -10,6 +10,10 @@
 #include <cstring>
 #include <algorithm>
 
+extern "C" {
+#include <sys/mman.h>
+}
+
 
 std::string cal::format_here(std::pair <std::string, int> const & here) {
     std::ostringstream h;
@@ -17,8 +21,36 @@ std::string cal::format_here(std::pair <std::string, int> const & here) {
     return std::string(h.str());
 }
 
-void * cal::aligned_alloc(size_t size, size_t align) {
+std::string cal::simd_target() {
+    #ifdef CAL_HAVE_TARGET_CLONES
+    // Same order as the ifunc resolver of the CAL_TARGET_CLONES versions.
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return std::string("avx512f");
+    if (__builtin_cpu_supports("avx2")) return std::string("avx2");
+    if (__builtin_cpu_supports("sse4.2")) return std::string("sse4.2");
+    return std::string("default");
+    #else // ifdef CAL_HAVE_TARGET_CLONES
+    return std::string("native");
+    #endif // ifdef CAL_HAVE_TARGET_CLONES
+}
+
+namespace {
+// Size of a transparent huge page on x86_64 and aarch64 Linux.
+size_t const HUGEPAGE_SIZE = 2097152;
+
+void * aligned_alloc_pages(size_t size, size_t align) {
     void * mem = NULL;
+
+    // Large allocations are aligned and padded to whole huge pages
+    // and the kernel is asked to back them with huge pages.
+    auto & env = cal::Environment::get();
+    int64_t threshold = env.hugepage_threshold();
+    bool huge = (threshold > 0) && (size >= (size_t)threshold);
+    if (huge) {
+        align = std::max(align, HUGEPAGE_SIZE);
+        size = (size + HUGEPAGE_SIZE - 1) / HUGEPAGE_SIZE * HUGEPAGE_SIZE;
+    }
+
     int ret = posix_memalign(&mem, align, size);
     if (ret != 0) {
         auto here = cal_HERE();
@@ -29,10 +61,28 @@ void * cal::aligned_alloc(size_t size, size_t align) {
         log.error(o.str().c_str(), here);
         throw std::runtime_error(o.str().c_str());
     }
+
+    #ifdef MADV_HUGEPAGE
+    if (huge) {
+        // This is only advice, failure leaves regular pages in place.
+        madvise(mem, size, MADV_HUGEPAGE);
+    }
+    #endif // ifdef MADV_HUGEPAGE
+
+    return mem;
+}
+}
+
+void * cal::aligned_alloc(size_t size, size_t align) {
+    void * mem = aligned_alloc_pages(size, align);
     memset(mem, 0, size);
     return mem;
 }
 
+void * cal::aligned_alloc_untouched(size_t size, size_t align) {
+    return aligned_alloc_pages(size, align);
+}
+
 void cal::aligned_free(void * ptr) {
     free(ptr);
     return;
@@ -174,6 +224,7 @@ cal::GlobalTimers & cal::GlobalTimers::get() {
 }
 
 std::vector <std::string> cal::GlobalTimers::names() const {
+    std::lock_guard <std::mutex> guard(lock_);
     std::vector <std::string> ret;
     for (auto const & it : data) {
         ret.push_back(it.first);
@@ -183,6 +234,7 @@ std::vector <std::string> cal::GlobalTimers::names() const {
 }
 
 void cal::GlobalTimers::start(std::string const & name) {
+    std::lock_guard <std::mutex> guard(lock_);
     if (data.count(name) == 0) {
         data[name].clear();
     }
@@ -191,11 +243,13 @@ void cal::GlobalTimers::start(std::string const & name) {
 }
 
 void cal::GlobalTimers::clear(std::string const & name) {
+    std::lock_guard <std::mutex> guard(lock_);
     data[name].clear();
     return;
 }
 
 void cal::GlobalTimers::stop(std::string const & name) {
+    std::lock_guard <std::mutex> guard(lock_);
     if (data.count(name) == 0) {
         auto here = cal_HERE();
         auto log = cal::Logger::get();
@@ -209,6 +263,7 @@ void cal::GlobalTimers::stop(std::string const & name) {
 }
 
 double cal::GlobalTimers::seconds(std::string const & name) const {
+    std::lock_guard <std::mutex> guard(lock_);
     if (data.count(name) == 0) {
         auto here = cal_HERE();
         auto log = cal::Logger::get();
@@ -222,6 +277,7 @@ double cal::GlobalTimers::seconds(std::string const & name) const {
 }
 
 size_t cal::GlobalTimers::calls(std::string const & name) const {
+    std::lock_guard <std::mutex> guard(lock_);
     if (data.count(name) == 0) {
         auto here = cal_HERE();
         auto log = cal::Logger::get();
@@ -235,6 +291,7 @@ size_t cal::GlobalTimers::calls(std::string const & name) const {
 }
 
 bool cal::GlobalTimers::is_running(std::string const & name) const {
+    std::lock_guard <std::mutex> guard(lock_);
     if (data.count(name) == 0) {
         return false;
     }
@@ -242,6 +299,7 @@ bool cal::GlobalTimers::is_running(std::string const & name) const {
 }
 
 void cal::GlobalTimers::stop_all() {
+    std::lock_guard <std::mutex> guard(lock_);
     for (auto & tm : data) {
         tm.second.stop();
     }
@@ -249,6 +307,7 @@ void cal::GlobalTimers::stop_all() {
 }
 
 void cal::GlobalTimers::clear_all() {
+    std::lock_guard <std::mutex> guard(lock_);
     for (auto & tm : data) {
         tm.second.clear();
     }
@@ -256,7 +315,10 @@ void cal::GlobalTimers::clear_all() {
 }
 
 void cal::GlobalTimers::report() {
-    stop_all();
+    std::lock_guard <std::mutex> guard(lock_);
+    for (auto & tm : data) {
+        tm.second.stop();
+    }
     std::vector <std::string> names;
     for (auto const & tm : data) {
         names.push_back(tm.first);
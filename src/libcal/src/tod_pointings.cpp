@@ -10,50 +10,105 @@
 
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 
 
-void cal::pointing_matrix_healpix(cal::HealpixPixels const & hpix,
-                                    bool nest, double eps, double cal,
-                                    std::string const & mode, size_t n,
-                                    double const * pdata,
-                                    double const * hwpang,
-                                    uint8_t const * flags,
-                                    int64_t * pixels, double * weights) {
-    double xaxis[3] = {1.0, 0.0, 0.0};
-    double zaxis[3] = {0.0, 0.0, 1.0};
-    double nullquat[4] = {0.0, 0.0, 0.0, 1.0};
+namespace {
+// Number of samples converted per block in pointing_azel.
+size_t const AZEL_BLOCK = 256;
 
-    double eta = (1.0 - eps) / (1.0 + eps);
+// Number of samples processed together by pointing_matrix_healpix.  The
+// scratch space of one chunk stays within the L2 cache.
+size_t const POINTING_CHUNK = 1024;
 
-    cal::AlignedVector <double> dir(3 * n);
-    cal::AlignedVector <double> pin(4 * n);
+/**
+* Scratch space for one chunk of the pointing matrix.  Every thread keeps
+* its own for the lifetime of the thread, so that repeated calls (one per
+* detector) do not allocate.
+*/
+struct pointing_scratch {
+    cal::AlignedVector <double> pin;
+    cal::AlignedVector <double> dir;
+    cal::AlignedVector <double> orient;
+    cal::AlignedVector <double> z;
+    cal::AlignedVector <double> rtz;
+    cal::AlignedVector <double> phi;
+    cal::AlignedVector <int> region;
 
-    if (flags == NULL) {
-        std::copy(pdata, pdata + (4 * n), pin.begin());
-    } else {
-        size_t off;
+    static pointing_scratch & get(bool iqu) {
+        static thread_local pointing_scratch scratch;
+        if (scratch.pin.empty()) {
+            scratch.pin.resize(4 * POINTING_CHUNK);
+            scratch.dir.resize(3 * POINTING_CHUNK);
+            scratch.z.resize(POINTING_CHUNK);
+            scratch.rtz.resize(POINTING_CHUNK);
+            scratch.phi.resize(POINTING_CHUNK);
+            scratch.region.resize(POINTING_CHUNK);
+        }
+        if (iqu && scratch.orient.empty()) {
+            scratch.orient.resize(3 * POINTING_CHUNK);
+        }
+        return scratch;
+    }
+};
+
+void pointing_chunk(cal::HealpixPixels const & hpix, bool nest, double eta,
+                    double cal, bool iqu, size_t n, double const * pdata,
+                    double const * hwpang, uint8_t const * flags,
+                    int64_t * pixels, double * weights,
+                    pointing_scratch & scratch) {
+    double const xaxis[3] = {1.0, 0.0, 0.0};
+    double const zaxis[3] = {0.0, 0.0, 1.0};
+
+    // The quaternions are transposed to SoA streams, where the rotations
+    // and the polarization angle work on unit stride data.  Flagged
+    // samples use the null quaternion.
+
+    double * pin = scratch.pin.data();
+    cal::qa_aos_to_soa(n, 4, pdata, pin);
+
+    if (flags != NULL) {
+        double * px = pin;
+        double * py = px + n;
+        double * pz = py + n;
+        double * pw = pz + n;
+        #pragma omp simd
         for (size_t i = 0; i < n; ++i) {
-            off = 4 * i;
-            if (flags[i] == 0) {
-                pin[off] = pdata[off];
-                pin[off + 1] = pdata[off + 1];
-                pin[off + 2] = pdata[off + 2];
-                pin[off + 3] = pdata[off + 3];
-            } else {
-                pin[off] = nullquat[0];
-                pin[off + 1] = nullquat[1];
-                pin[off + 2] = nullquat[2];
-                pin[off + 3] = nullquat[3];
-            }
+            bool good = (flags[i] == 0);
+            px[i] = good ? px[i] : 0.0;
+            py[i] = good ? py[i] : 0.0;
+            pz[i] = good ? pz[i] : 0.0;
+            pw[i] = good ? pw[i] : 1.0;
         }
     }
 
-    cal::qa_rotate_many_one(n, pin.data(), zaxis, dir.data());
+    double * dx = scratch.dir.data();
+    double * dy = dx + n;
+    double * dz = dy + n;
+    cal::qa_rotate_many_one_soa(n, pin, zaxis, dx);
+
+    // Same as HealpixPixels::vec2zphi, on the SoA direction.
+
+    double * z = scratch.z.data();
+    double * rtz = scratch.rtz.data();
+    double * phi = scratch.phi.data();
+    int * region = scratch.region.data();
+
+    #pragma omp simd
+    for (size_t i = 0; i < n; ++i) {
+        z[i] = dz[i];
+        double za = ::fabs(z[i]);
+        int itemp = (z[i] > 0.0) ? 1 : -1;
+        region[i] = (za <= cal::TWOTHIRDS) ? itemp : itemp + itemp;
+        rtz[i] = 3.0 * (1.0 - za);
+    }
+    cal::vfast_sqrt(n, rtz, rtz);
+    cal::vatan2(n, dy, dx, phi);
 
     if (nest) {
-        hpix.vec2nest(n, dir.data(), pixels);
+        hpix.zphi2nest(n, phi, region, z, rtz, pixels);
     } else {
-        hpix.vec2ring(n, dir.data(), pixels);
+        hpix.zphi2ring(n, phi, region, z, rtz, pixels);
     }
 
     if (flags != NULL) {
@@ -62,55 +117,73 @@ void cal::pointing_matrix_healpix(cal::HealpixPixels const & hpix,
         }
     }
 
-    if (mode == "I") {
+    if (!iqu) {
         for (size_t i = 0; i < n; ++i) {
             weights[i] = cal;
         }
-    } else if (mode == "IQU") {
-        cal::AlignedVector <double> orient(3 * n);
-        cal::AlignedVector <double> buf1(n);
-        cal::AlignedVector <double> buf2(n);
+        return;
+    }
 
-        cal::qa_rotate_many_one(n, pin.data(), xaxis, orient.data());
+    double * ox = scratch.orient.data();
+    double * oy = ox + n;
+    double * oz = oy + n;
+    cal::qa_rotate_many_one_soa(n, pin, xaxis, ox);
 
-        double * bx = buf1.data();
-        double * by = buf2.data();
+    // The pixel buffers are free again and hold the angle terms.
 
-        #pragma omp simd
+    double * bx = z;
+    double * by = rtz;
+    double * detang = phi;
+
+    #pragma omp simd
+    for (size_t i = 0; i < n; ++i) {
+        double bxi = ox[i] * (-dz[i] * dx[i]) +
+                     oy[i] * (-dz[i] * dy[i]) +
+                     oz[i] * (dx[i] * dx[i] + dy[i] * dy[i]);
+        by[i] = ox[i] * dy[i] - oy[i] * dx[i];
+        bx[i] = bxi;
+    }
+
+    // FIXME:  Switch back to fast version after unit tests improved.
+    cal::vatan2(n, by, bx, detang);
+
+    if (hwpang != NULL) {
         for (size_t i = 0; i < n; ++i) {
-            size_t off = 3 * i;
-            by[i] = orient[off + 0] * dir[off + 1] - orient[off + 1] *
-                    dir[off + 0];
-            bx[i] = orient[off + 0] * (-dir[off + 2] * dir[off + 0]) +
-                    orient[off + 1] * (-dir[off + 2] * dir[off + 1]) +
-                    orient[off + 2] * (dir[off + 0] * dir[off + 0] +
-                                       dir[off + 1] * dir[off + 1]);
+            detang[i] += 2.0 * hwpang[i];
+            detang[i] *= 2.0;
         }
+    }
 
-        cal::AlignedVector <double> detang(n);
+    double * sinout = dx;
+    double * cosout = dy;
 
-        // FIXME:  Switch back to fast version after unit tests improved.
-        cal::vatan2(n, by, bx, detang.data());
+    // FIXME:  Switch back to fast version after unit tests pass
+    cal::vsincos(n, detang, sinout, cosout);
 
-        if (hwpang != NULL) {
-            for (size_t i = 0; i < n; ++i) {
-                detang[i] += 2.0 * hwpang[i];
-                detang[i] *= 2.0;
-            }
-        }
+    for (size_t i = 0; i < n; ++i) {
+        size_t off = 3 * i;
+        weights[off + 0] = cal;
+        weights[off + 1] = cosout[i] * eta * cal;
+        weights[off + 2] = sinout[i] * eta * cal;
+    }
 
-        double * sinout = buf1.data();
-        double * cosout = buf2.data();
+    return;
+}
+}
 
-        // FIXME:  Switch back to fast version after unit tests pass
-        cal::vsincos(n, detang.data(), sinout, cosout);
 
-        for (size_t i = 0; i < n; ++i) {
-            size_t off = 3 * i;
-            weights[off + 0] = cal;
-            weights[off + 1] = cosout[i] * eta * cal;
-            weights[off + 2] = sinout[i] * eta * cal;
-        }
+void cal::pointing_matrix_healpix(cal::HealpixPixels const & hpix,
+                                    bool nest, double eps, double cal,
+                                    std::string const & mode, size_t n,
+                                    double const * pdata,
+                                    double const * hwpang,
+                                    uint8_t const * flags,
+                                    int64_t * pixels, double * weights) {
+    bool iqu;
+    if (mode == "I") {
+        iqu = false;
+    } else if (mode == "IQU") {
+        iqu = true;
     } else {
         auto here = cal_HERE();
         auto log = cal::Logger::get();
@@ -119,6 +192,99 @@ void cal::pointing_matrix_healpix(cal::HealpixPixels const & hpix,
         log.error(o.str().c_str(), here);
         throw std::runtime_error(o.str().c_str());
     }
+    size_t nnz = iqu ? 3 : 1;
+
+    double eta = (1.0 - eps) / (1.0 + eps);
+
+    // The samples are processed in chunks, distributed over the threads,
+    // and each thread reuses its scratch space for all of its chunks.
+
+    int64_t nchunk = (n + POINTING_CHUNK - 1) / POINTING_CHUNK;
+
+    #pragma omp parallel if (nchunk > 1)
+    {
+        pointing_scratch & scratch = pointing_scratch::get(iqu);
+
+        #pragma omp for schedule(static)
+        for (int64_t c = 0; c < nchunk; ++c) {
+            size_t off = c * POINTING_CHUNK;
+            size_t nc = std::min(POINTING_CHUNK, n - off);
+            pointing_chunk(hpix, nest, eta, cal, iqu, nc, pdata + 4 * off,
+                           (hwpang == NULL) ? NULL : hwpang + off,
+                           (flags == NULL) ? NULL : flags + off,
+                           pixels + off, weights + nnz * off, scratch);
+        }
+    }
 
     return;
 }
+
+
+CAL_TARGET_CLONES
+size_t cal::pointing_azel(size_t n, double const * boresight,
+                          double const * detquat, uint8_t const * good,
+                          double * az, double * el) {
+    // The detector quaternion is the product of the boresight and the
+    // offset.  Rotating the Z axis by an unnormalized quaternion scales
+    // the direction by its squared norm, which the two arctangents do
+    // not see, so the normalization is skipped.
+
+    double const * d = detquat;
+    double dx[AZEL_BLOCK];
+    double dy[AZEL_BLOCK];
+    double dz[AZEL_BLOCK];
+    double rho[AZEL_BLOCK];
+    double phi[AZEL_BLOCK];
+    double elev[AZEL_BLOCK];
+
+    size_t nout = 0;
+    for (size_t start = 0; start < n; start += AZEL_BLOCK) {
+        size_t nb = std::min(AZEL_BLOCK, n - start);
+        double const * b = boresight + 4 * start;
+
+        #pragma omp simd
+        for (size_t i = 0; i < nb; ++i) {
+            size_t f = 4 * i;
+            double x =  b[f] * d[3] + b[f + 1] * d[2] - b[f + 2] * d[1] +
+                       b[f + 3] * d[0];
+            double y = -b[f] * d[2] + b[f + 1] * d[3] + b[f + 2] * d[0] +
+                       b[f + 3] * d[1];
+            double z =  b[f] * d[1] - b[f + 1] * d[0] + b[f + 2] * d[3] +
+                       b[f + 3] * d[2];
+            double w = -b[f] * d[0] - b[f + 1] * d[1] - b[f + 2] * d[2] +
+                       b[f + 3] * d[3];
+            dx[i] = 2.0 * (y * w + x * z);
+            dy[i] = 2.0 * (y * z - x * w);
+            dz[i] = w * w + z * z - x * x - y * y;
+            rho[i] = ::sqrt(dx[i] * dx[i] + dy[i] * dy[i]);
+        }
+
+        cal::vfast_atan2(nb, dy, dx, phi);
+        cal::vfast_atan2(nb, dz, rho, elev);
+
+        // Azimuth is measured in the opposite direction than longitude.
+
+        if (good == NULL) {
+            #pragma omp simd
+            for (size_t i = 0; i < nb; ++i) {
+                double p = (phi[i] < 0.0) ? phi[i] + cal::TWOPI : phi[i];
+                az[start + i] = cal::TWOPI - p;
+                el[start + i] = elev[i];
+            }
+            nout += nb;
+        } else {
+            uint8_t const * g = good + start;
+            for (size_t i = 0; i < nb; ++i) {
+                if (g[i] == 0) {
+                    continue;
+                }
+                double p = (phi[i] < 0.0) ? phi[i] + cal::TWOPI : phi[i];
+                az[nout] = cal::TWOPI - p;
+                el[nout] = elev[i];
+                ++nout;
+            }
+        }
+    }
+
+    return nout;
+}
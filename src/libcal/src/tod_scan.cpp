@@ -0,0 +1,113 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <cal/sys_utils.hpp>
+#include <cal/math_qarray.hpp>
+#include <cal/tod_pointings.hpp>
+#include <cal/tod_scan.hpp>
+
+#include <cmath>
+#include <sstream>
+
+
+void cal::scan_ces(double t0, double rate, size_t first, size_t n,
+                   double azmin, double azmax, double el_ces,
+                   double scanrate, double scan_accel, double * times,
+                   double * az, double * el, uint8_t * flags) {
+    if ((rate <= 0) || (scanrate <= 0) || (scan_accel <= 0) ||
+        (azmax <= azmin) || (std::fabs(el_ces) >= cal::PI_2)) {
+        auto here = cal_HERE();
+        auto log = cal::Logger::get();
+        std::ostringstream o;
+        o << "Invalid CES: rate = " << rate << ", az = [" << azmin << ", "
+          << azmax << "], el = " << el_ces << ", scanrate = " << scanrate
+          << ", scan_accel = " << scan_accel;
+        log.error(o.str().c_str(), here);
+        throw std::runtime_error(o.str().c_str());
+    }
+
+    // The scan rate is given on the sky, the acceleration in mount
+    // coordinates.  One period is a left-to-right sweep, the turnaround
+    // beyond azmax, a right-to-left sweep and the turnaround below azmin.
+
+    double v = scanrate / ::cos(el_ces);
+    double a = scan_accel;
+    double tsweep = (azmax - azmin) / v;
+    double tturn = 2 * v / a;
+    double period = 2 * (tsweep + tturn);
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; ++i) {
+        double dt = (first + i) / rate;
+        double s = ::fmod(dt, period);
+        double p;
+        uint8_t f;
+        if (s < tsweep) {
+            p = azmin + v * s;
+            f = SCAN_LEFTRIGHT;
+        } else if (s < tsweep + tturn) {
+            s -= tsweep;
+            p = azmax + v * s - 0.5 * a * s * s;
+            f = SCAN_LEFTRIGHT | SCAN_TURNAROUND;
+        } else if (s < 2 * tsweep + tturn) {
+            s -= tsweep + tturn;
+            p = azmax - v * s;
+            f = SCAN_RIGHTLEFT;
+        } else {
+            s -= 2 * tsweep + tturn;
+            p = azmin - v * s + 0.5 * a * s * s;
+            f = SCAN_RIGHTLEFT | SCAN_TURNAROUND;
+        }
+        times[i] = t0 + dt;
+        az[i] = p;
+        el[i] = el_ces;
+        flags[i] = f;
+    }
+
+    return;
+}
+
+void cal::scan_focalplane(size_t ndet, double radius, double * detquat) {
+    size_t side = 1;
+    while (side * side < ndet) ++side;
+
+    cal::AlignedVector <double> theta(ndet);
+    cal::AlignedVector <double> phi(ndet);
+    for (size_t idet = 0; idet < ndet; ++idet) {
+        double x = radius * (2 * (idet % side + 0.5) / side - 1);
+        double y = radius * (2 * (idet / side + 0.5) / side - 1);
+        theta[idet] = ::sqrt(x * x + y * y);
+        phi[idet] = ::atan2(y, x);
+    }
+    cal::qa_from_position(ndet, theta.data(), phi.data(), detquat);
+
+    return;
+}
+
+void cal::scan_detectors_azel(size_t n, double const * az,
+                              double const * el, size_t ndet,
+                              double const * detquat, double * detaz,
+                              double * detel) {
+    // Boresight quaternions, the azimuth is measured in the opposite
+    // direction than longitude.
+
+    cal::AlignedVector <double> theta(n);
+    cal::AlignedVector <double> phi(n);
+    cal::AlignedVector <double> pa(n, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        theta[i] = cal::PI_2 - el[i];
+        phi[i] = -az[i];
+    }
+    cal::AlignedVector <double> boresight(4 * n);
+    cal::qa_from_angles(n, theta.data(), phi.data(), pa.data(),
+                        boresight.data());
+
+    #pragma omp parallel for schedule(static)
+    for (size_t idet = 0; idet < ndet; ++idet) {
+        cal::pointing_azel(n, boresight.data(), detquat + 4 * idet, NULL,
+                           detaz + idet * n, detel + idet * n);
+    }
+
+    return;
+}
@@ -0,0 +1,262 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+
+#include <unistd.h>
+
+
+namespace {
+// Stands in for atm_sim in atm_run_observation: every simulation observes
+// 1 and the chosen call to observe() fails.
+struct FakeAtmSim {
+    int status;
+    int fail_call;
+    int ncall;
+
+    int simulate(bool) {
+        return status;
+    }
+
+    int observe(double *, double *, double *, double * tod, long nsamp) {
+        for (long i = 0; i < nsamp; ++i) tod[i] = 1;
+        return (ncall++ == fail_call) ? -1 : 0;
+    }
+};
+}
+
+
+TEST_F(CALatmConfigTest, parse) {
+    std::istringstream in(
+        "# Defaults\n"
+        "rate = 50\n"
+        "duration = 600\n"
+        "azmin = 1.0\n"
+        "azmax = 1.4\n"
+        "el = 0.9   # radians\n"
+        "T0 = 275\n"
+        "west_wind = 3\n"
+        "south_wind = 4\n"
+        "realization = 2\n"
+        "\n"
+        "[first]\n"
+        "ndet = 16\n"
+        "fp_radius = 0.02\n"
+        "\n"
+        "[second]\n"
+        "el = 1.1\n"
+        "site = 3\n"
+        "xstep = 50\n"
+        "outdir = /tmp/atm out\n");
+    cal::AtmConfig config;
+    config.parse(in, "test");
+    ASSERT_EQ(2, config.size());
+
+    auto first = config.observation(0);
+    EXPECT_EQ("first", first.name);
+    EXPECT_EQ(30000, first.nsamp);
+    EXPECT_DOUBLE_EQ(0.9, first.el);
+    EXPECT_EQ(16, first.ndet);
+    EXPECT_DOUBLE_EQ(5, first.wind_speed);
+    EXPECT_DOUBLE_EQ(atan2(4, 3), first.wind_dir);
+    EXPECT_DOUBLE_EQ(100, first.xstep);
+    EXPECT_EQ((2ull << 32) + 123456, first.key1);
+    EXPECT_EQ(0, first.key2);
+    EXPECT_EQ(".", first.outdir);
+
+    auto second = config.observation(1);
+    EXPECT_DOUBLE_EQ(1.1, second.el);
+    EXPECT_EQ(1, second.ndet);
+    EXPECT_DOUBLE_EQ(50, second.xstep);
+    EXPECT_EQ((3ull << 16) + 1, second.key2);
+    EXPECT_EQ("/tmp/atm out", second.outdir);
+
+    double azmin, azmax, elmin, elmax;
+    cal::atm_scan_range(first, azmin, azmax, elmin, elmax);
+    EXPECT_LT(azmin, first.azmin - first.fp_radius);
+    EXPECT_GT(azmax, first.azmax + first.fp_radius);
+    EXPECT_DOUBLE_EQ(0.88, elmin);
+    EXPECT_DOUBLE_EQ(0.92, elmax);
+}
+
+
+TEST_F(CALatmConfigTest, errors) {
+    auto & env = cal::Environment::get();
+    std::string level = env.log_level();
+    env.set_log_level("CRITICAL");
+
+    // Misspelled key
+    {
+        std::istringstream in("rate = 50\nduraton = 600\n");
+        cal::AtmConfig config;
+        EXPECT_THROW(config.parse(in, "test"), std::runtime_error);
+    }
+
+    // Missing required key and malformed number
+    {
+        std::istringstream in("rate = 50\n[obs]\nduration = 6o0\n");
+        cal::AtmConfig config;
+        config.parse(in, "test");
+        EXPECT_THROW(config.observation(0), std::runtime_error);
+    }
+
+    // Negative duration and ndet
+    {
+        std::istringstream in("rate = 50\nduration = -600\n[obs]\n");
+        cal::AtmConfig config;
+        config.parse(in, "test");
+        EXPECT_THROW(config.observation(0), std::runtime_error);
+    }
+    {
+        std::istringstream in(
+            "rate = 50\nduration = 600\nazmin = 1\nazmax = 2\nel = 1\n"
+            "T0 = 275\nwest_wind = 1\nsouth_wind = 1\nndet = -1\n[obs]\n");
+        cal::AtmConfig config;
+        config.parse(in, "test");
+        EXPECT_THROW(config.observation(0), std::runtime_error);
+    }
+
+    // Duplicate observation
+    {
+        std::istringstream in("[obs]\n[obs]\n");
+        cal::AtmConfig config;
+        EXPECT_THROW(config.parse(in, "test"), std::runtime_error);
+    }
+
+    env.set_log_level(level.c_str());
+}
+
+
+TEST_F(CALatmConfigTest, shells) {
+    std::istringstream in(
+        "rate = 10\n"
+        "duration = 25\n"
+        "azmin = 1.0\n"
+        "azmax = 1.4\n"
+        "el = 0.9\n"
+        "T0 = 275\n"
+        "west_wind = 3\n"
+        "south_wind = 4\n"
+        "nshell = 2\n"
+        "chunk_length = 10\n"
+        "[obs]\n");
+    cal::AtmConfig config;
+    config.parse(in, "test");
+    auto obs = config.observation(0);
+
+    std::vector <double> times(obs.nsamp);
+    for (size_t i = 0; i < obs.nsamp; ++i) times[i] = obs.t0 + i / obs.rate;
+    auto shells = cal::atm_shells(obs, times.data());
+    ASSERT_EQ(6, shells.size());
+
+    // The chunks cover the samples and every simulation has its own
+    // random number stream
+    size_t istart = 0;
+    for (size_t i = 0; i < shells.size(); ++i) {
+        auto const & shell = shells[i];
+        EXPECT_EQ(i % 2, shell.ishell);
+        EXPECT_EQ(i, shell.counter1);
+        EXPECT_EQ(0, shell.counter2);
+        EXPECT_EQ(istart, shell.istart);
+        if (shell.ishell == 1) {
+            EXPECT_DOUBLE_EQ(100, shell.rmin);
+            EXPECT_DOUBLE_EQ(1000, shell.rmax);
+            istart += shell.nsamp;
+        }
+    }
+    EXPECT_EQ(obs.nsamp, istart);
+}
+
+
+TEST_F(CALatmConfigTest, run_observation) {
+    auto & env = cal::Environment::get();
+    std::string level = env.log_level();
+    env.set_log_level("CRITICAL");
+
+    char tmpl[] = "/tmp/cal_atm_run_XXXXXX";
+    char * dir = mkdtemp(tmpl);
+    ASSERT_NE(dir, nullptr);
+    std::string outdir(dir);
+
+    std::istringstream in(
+        "rate = 10\n"
+        "duration = 25\n"
+        "azmin = 1.0\n"
+        "azmax = 1.4\n"
+        "el = 0.9\n"
+        "T0 = 275\n"
+        "west_wind = 3\n"
+        "south_wind = 4\n"
+        "ndet = 4\n"
+        "fp_radius = 0.01\n"
+        "nshell = 2\n"
+        "chunk_length = 10\n"
+        "gain = 2\n"
+        "[obs]\n"
+        "outdir = " + outdir + "\n");
+    cal::AtmConfig config;
+    config.parse(in, "test");
+    auto obs = config.observation(0);
+    size_t nsamp = obs.nsamp;
+
+    // Detector 1 fails to observe the second shell of the second chunk
+    auto make_sim = [](cal::AtmShell const & shell) {
+                        std::unique_ptr <FakeAtmSim> sim(new FakeAtmSim());
+                        sim->status = 0;
+                        sim->fail_call = (shell.counter1 == 3) ? 1 : -1;
+                        sim->ncall = 0;
+                        return sim;
+                    };
+    cal::AtmTOD tod;
+    cal::atm_run_observation(obs, 0, obs.ndet, make_sim, tod);
+    ASSERT_EQ(obs.ndet * nsamp, tod.tod.size());
+
+    auto shells = cal::atm_shells(obs, tod.times.data());
+    size_t istart = shells[3].istart;
+    size_t istop = istart + shells[3].nsamp;
+    EXPECT_EQ(istop - istart, tod.nbad);
+    for (size_t idet = 0; idet < obs.ndet; ++idet) {
+        for (size_t i = 0; i < nsamp; ++i) {
+            bool bad = (idet == 1) && (i >= istart) && (i < istop);
+            size_t off = idet * nsamp + i;
+            EXPECT_EQ(bad ? cal::ATM_FLAG_BAD : 0, tod.flags[off]);
+            EXPECT_DOUBLE_EQ(bad ? 0 : 4, tod.tod[off]);
+        }
+    }
+
+    // The flags are written next to the TOD
+    cal::atm_write_tod(obs, tod);
+    std::string base = outdir + "/" + obs.name;
+    std::ifstream flagfile(base + ".flags", std::ios::binary);
+    std::vector <char> flags((std::istreambuf_iterator <char> (flagfile)),
+                             std::istreambuf_iterator <char> ());
+    ASSERT_EQ(tod.flags.size(), flags.size());
+    for (size_t i = 0; i < flags.size(); ++i) {
+        EXPECT_EQ(tod.flags[i], (uint8_t)flags[i]);
+    }
+    std::ifstream binfile(base + ".bin", std::ios::binary | std::ios::ate);
+    EXPECT_EQ(tod.tod.size() * sizeof(double), (size_t)binfile.tellg());
+
+    // A failed simulation is an error
+    auto fail_sim = [](cal::AtmShell const & shell) {
+                        std::unique_ptr <FakeAtmSim> sim(new FakeAtmSim());
+                        sim->status = (shell.counter1 == 2) ? -1 : 0;
+                        sim->fail_call = -1;
+                        sim->ncall = 0;
+                        return sim;
+                    };
+    EXPECT_THROW(cal::atm_run_observation(obs, 0, obs.ndet, fail_sim, tod),
+                 std::runtime_error);
+
+    std::remove((base + ".bin").c_str());
+    std::remove((base + ".flags").c_str());
+    std::remove((base + ".txt").c_str());
+    rmdir(dir);
+    env.set_log_level(level.c_str());
+}
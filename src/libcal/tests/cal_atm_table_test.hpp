@@ -0,0 +1,366 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <cal_test.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#include <unistd.h>
+
+
+namespace {
+// Multilinear in the atmospheric state and linear in frequency, so the
+// table interpolation must be exact.
+void linear_gen(double alt, double T, double P, double pwv, double fmin,
+                double fmax, size_t nf, double * absorption,
+                double * loading) {
+    double step = (nf > 1) ? (fmax - fmin) / (nf - 1) : 0;
+    for (size_t i = 0; i < nf; ++i) {
+        double f = fmin + i * step;
+        absorption[i] = 1e-3 * pwv * (1 + 1e-2 * f) + 1e-6 * (T - 250);
+        loading[i] = 1e-4 * P + 2 * pwv + 1e-3 * alt * (T - 270)
+                     + 0.1 * f;
+    }
+}
+
+// A smooth line-like feature in frequency that grows with pwv
+void line_gen(double alt, double T, double P, double pwv, double fmin,
+              double fmax, size_t nf, double * absorption,
+              double * loading) {
+    double step = (nf > 1) ? (fmax - fmin) / (nf - 1) : 0;
+    for (size_t i = 0; i < nf; ++i) {
+        double f = fmin + i * step;
+        double line = 1 / (1 + (f - 60) * (f - 60) / 25);
+        absorption[i] = 1 - std::exp(-0.05 * pwv * (1 + 5 * line));
+        loading[i] = T * absorption[i];
+    }
+}
+}
+
+
+TEST_F(CALatmTableTest, linear) {
+    cal::AtmTable table(5000, 5000, 1, 250, 290, 3, 50000, 60000, 2,
+                        0, 4, 5, 20, 150, 14);
+    double err = table.build(1e-10, 0, linear_gen);
+    ASSERT_TRUE(table.built());
+    EXPECT_LT(err, 1e-10);
+
+    size_t const nf = 7;
+    double abs_ref[nf];
+    double load_ref[nf];
+    double abs_tab[nf];
+    double load_tab[nf];
+    linear_gen(5000, 263.7, 51234, 1.37, 33, 141, nf, abs_ref, load_ref);
+    table.absorption_vec(5000, 263.7, 51234, 1.37, 33, 141, nf, abs_tab);
+    table.loading_vec(5000, 263.7, 51234, 1.37, 33, 141, nf, load_tab);
+    for (size_t i = 0; i < nf; ++i) {
+        EXPECT_NEAR(abs_ref[i], abs_tab[i], 1e-12);
+        EXPECT_NEAR(load_ref[i], load_tab[i], 1e-9);
+    }
+    EXPECT_NEAR(load_ref[0], table.loading(5000, 263.7, 51234, 1.37, 33),
+                1e-9);
+    EXPECT_NEAR(abs_ref[nf - 1],
+                table.absorption(5000, 263.7, 51234, 1.37, 141), 1e-12);
+
+    // Grid edges are valid, queries outside the grid are not
+    EXPECT_NO_THROW(table.absorption(5000, 290, 60000, 4, 150));
+    EXPECT_THROW(table.absorption(5000, 250, 50000, 4.5, 100),
+                 std::runtime_error);
+    EXPECT_THROW(table.loading(5000, 250, 50000, 1, 10), std::runtime_error);
+}
+
+
+TEST_F(CALatmTableTest, refine) {
+    double const tol = 1e-3;
+    cal::AtmTable table(5000, 5000, 1, 270, 270, 1, 55000, 55000, 1,
+                        0.5, 3.5, 2, 40, 80, 5);
+    table.build(0, 0, line_gen);
+    size_t nf_coarse = table.axis_size(4);
+    double err = table.build(tol, 6, line_gen);
+    EXPECT_LE(err, tol);
+    EXPECT_GT(table.axis_size(4), nf_coarse);
+    EXPECT_EQ(table.axis_min(4), 40);
+    EXPECT_EQ(table.axis_max(4), 80);
+
+    // Check off-node points against the generator
+    double maxerr = 0;
+    for (int i = 0; i < 50; ++i) {
+        double pwv = 0.5 + 3.0 * (i + 0.37) / 50;
+        double freq = 40 + 40.0 * (i + 0.61) / 50;
+        double abs_ref;
+        double load_ref;
+        line_gen(5000, 270, 55000, pwv, freq, freq, 1, &abs_ref, &load_ref);
+        double abs_tab = table.absorption(5000, 270, 55000, pwv, freq);
+        maxerr = std::max(maxerr, std::fabs(abs_tab - abs_ref) / abs_ref);
+    }
+    EXPECT_LT(maxerr, 10 * tol);
+
+    // The refined table is the table built directly on the final grid
+    cal::AtmTable direct(5000, 5000, 1, 270, 270, 1, 55000, 55000, 1,
+                         0.5, 3.5, table.axis_size(3), 40, 80,
+                         table.axis_size(4));
+    direct.build(0, 0, line_gen);
+    for (int i = 0; i < 50; ++i) {
+        double pwv = 0.5 + 3.0 * (i + 0.23) / 50;
+        double freq = 40 + 40.0 * (i + 0.71) / 50;
+        EXPECT_NEAR(direct.absorption(5000, 270, 55000, pwv, freq),
+                    table.absorption(5000, 270, 55000, pwv, freq), 1e-14);
+    }
+}
+
+
+TEST_F(CALatmTableTest, refine_reuse) {
+    // The loading records the generator call that evaluated each node.
+    // The nodes of the nominal grid must still hold the values of the
+    // first pass after refining.
+    size_t ncall = 0;
+    auto gen = [&ncall](double alt, double T, double P, double pwv,
+                        double fmin, double fmax, size_t nf,
+                        double * absorption, double * loading) {
+                   line_gen(alt, T, P, pwv, fmin, fmax, nf, absorption,
+                            loading);
+                   for (size_t i = 0; i < nf; ++i) loading[i] = ncall;
+                   ++ncall;
+               };
+    cal::AtmTable table(5000, 5000, 1, 270, 270, 1, 55000, 55000, 1,
+                        0.5, 3.5, 2, 40, 80, 5);
+    table.build(1e-3, 3, gen);
+    ASSERT_GT(table.axis_size(3), 2);
+    ASSERT_GT(table.axis_size(4), 5);
+    for (size_t ipwv = 0; ipwv < 2; ++ipwv) {
+        for (size_t j = 0; j < 5; ++j) {
+            double pwv = 0.5 + 3.0 * ipwv;
+            double freq = 40 + 10.0 * j;
+            EXPECT_NEAR(ipwv, table.loading(5000, 270, 55000, pwv, freq),
+                        1e-9);
+        }
+    }
+}
+
+
+TEST_F(CALatmTableTest, cache) {
+    char tmpl[] = "/tmp/cal_atm_table_XXXXXX";
+    char * dir = mkdtemp(tmpl);
+    ASSERT_NE(dir, nullptr);
+    std::string cachedir(dir);
+
+    cal::AtmTable table(5000, 5000, 1, 250, 290, 3, 50000, 60000, 2,
+                        0.5, 3.5, 3, 40, 80, 11);
+    table.load_or_build(cachedir, 1e-3, 5, line_gen);
+    std::string path = cachedir + "/" + table.cache_name(1e-3);
+
+    // The second table must come from the cache: a generator that
+    // produces garbage is never called.
+    int ncall = 0;
+    auto bad_gen = [&ncall](double, double, double, double, double, double,
+                            size_t nf, double * absorption,
+                            double * loading) {
+                       ++ncall;
+                       for (size_t i = 0; i < nf; ++i) {
+                           absorption[i] = -1;
+                           loading[i] = -1;
+                       }
+                   };
+    cal::AtmTable cached(5000, 5000, 1, 250, 290, 3, 50000, 60000, 2,
+                         0.5, 3.5, 3, 40, 80, 11);
+    cached.load_or_build(cachedir, 1e-3, 5, bad_gen);
+    EXPECT_EQ(ncall, 0);
+    for (size_t a = 0; a < cal::AtmTable::NAXIS; ++a) {
+        EXPECT_EQ(table.axis_size(a), cached.axis_size(a));
+    }
+    EXPECT_EQ(table.absorption(5000, 277, 52000, 1.3, 61.5),
+              cached.absorption(5000, 277, 52000, 1.3, 61.5));
+    EXPECT_EQ(table.loading(5000, 251, 59000, 3.4, 42.2),
+              cached.loading(5000, 251, 59000, 3.4, 42.2));
+
+    // A different grid or tolerance does not match the cached file
+    cal::AtmTable other(5000, 5000, 1, 250, 290, 3, 50000, 60000, 2,
+                        0.5, 3.5, 3, 40, 80, 12);
+    EXPECT_NE(other.cache_name(1e-3), table.cache_name(1e-3));
+    EXPECT_NE(table.cache_name(1e-4), table.cache_name(1e-3));
+    EXPECT_FALSE(other.load(path));
+    EXPECT_FALSE(other.built());
+
+    // A truncated file is rejected and leaves the loaded table unchanged
+    std::string bad = cachedir + "/truncated.dat";
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::string data((std::istreambuf_iterator <char> (in)),
+                         std::istreambuf_iterator <char> ());
+        std::ofstream out(bad, std::ios::binary);
+        out.write(data.data(), data.size() - 8);
+    }
+    double before = cached.absorption(5000, 277, 52000, 1.3, 61.5);
+    EXPECT_FALSE(cached.load(bad));
+    EXPECT_TRUE(cached.built());
+    EXPECT_EQ(before, cached.absorption(5000, 277, 52000, 1.3, 61.5));
+    for (size_t a = 0; a < cal::AtmTable::NAXIS; ++a) {
+        EXPECT_EQ(table.axis_size(a), cached.axis_size(a));
+    }
+    std::remove(bad.c_str());
+
+    std::remove(path.c_str());
+    rmdir(dir);
+}
+
+
+TEST_F(CALatmTableTest, spectrum) {
+    size_t const nf = 11;
+    size_t const npwv = 3;
+    double const pwv[npwv] = {0.5, 1.0, 2.5};
+    double ref_abs[nf];
+    double ref_load[nf];
+    try {
+        cal::atm_get_absorption_coefficient_vec(5200, 270, 55000, pwv[0],
+                                                30, 150, nf, ref_abs);
+    } catch (std::runtime_error & e) {
+        // Built without libaatm
+        return;
+    }
+
+    cal::AtmSpectrum spec(4000, 260, 60000);
+    spec.set_state(5200, 270, 55000);
+    double absorption[npwv * nf];
+    double loading[npwv * nf];
+    for (int pass = 0; pass < 2; ++pass) {
+        spec.evaluate(npwv, pwv, 30, 150, nf, absorption, loading);
+        for (size_t p = 0; p < npwv; ++p) {
+            cal::atm_get_absorption_coefficient_vec(5200, 270, 55000, pwv[p],
+                                                    30, 150, nf, ref_abs);
+            cal::atm_get_atmospheric_loading_vec(5200, 270, 55000, pwv[p],
+                                                 30, 150, nf, ref_load);
+            for (size_t i = 0; i < nf; ++i) {
+                EXPECT_DOUBLE_EQ(ref_abs[i], absorption[p * nf + i]);
+                EXPECT_DOUBLE_EQ(ref_load[i], loading[p * nf + i]);
+            }
+        }
+        // A different grid in between must not disturb the first one
+        spec.evaluate(1, pwv, 90, 90, 1, nullptr, loading);
+        EXPECT_DOUBLE_EQ(cal::atm_get_atmospheric_loading(5200, 270, 55000,
+                                                          pwv[0], 90),
+                         loading[0]);
+    }
+}
+
+
+TEST_F(CALatmTableTest, band_average) {
+    double probe;
+    try {
+        probe = cal::atm_get_absorption_coefficient(5200, 270, 55000, 1, 90);
+    } catch (std::runtime_error & e) {
+        // Built without libaatm
+        return;
+    }
+
+    // Two bands sharing a 1 GHz grid, a third one on a 0.5 GHz grid and
+    // a fourth one on a 0.7 GHz grid that is not aligned with the others.
+    // Every band is evaluated on its own grid, so all are exact.
+    size_t const nband = 4;
+    std::vector <double> freq;
+    std::vector <double> weight;
+    std::vector <size_t> offsets(1, 0);
+    for (int i = 0; i < 21; ++i) {
+        freq.push_back(80 + i);
+        weight.push_back(1 + 0.01 * i);
+    }
+    offsets.push_back(freq.size());
+    for (int i = 0; i < 31; ++i) {
+        freq.push_back(140 + i);
+        weight.push_back(std::exp(-0.5 * (i - 15) * (i - 15) / 25.0));
+    }
+    offsets.push_back(freq.size());
+    for (int i = 0; i < 11; ++i) {
+        freq.push_back(85.5 + 0.5 * i);
+        weight.push_back(2);
+    }
+    offsets.push_back(freq.size());
+    for (int i = 0; i < 15; ++i) {
+        freq.push_back(220.3 + 0.7 * i);
+        weight.push_back(1 - 0.02 * i);
+    }
+    offsets.push_back(freq.size());
+
+    double absorption[nband];
+    double loading[nband];
+    cal::atm_get_band_averages(5200, 270, 55000, 1, nband, offsets.data(),
+                               freq.data(), weight.data(), absorption,
+                               loading);
+
+    // Reference: trapezoidal integration of the monochromatic values
+    for (size_t b = 0; b < nband; ++b) {
+        double num_abs = 0;
+        double num_load = 0;
+        double den = 0;
+        for (size_t k = offsets[b]; k + 1 < offsets[b + 1]; ++k) {
+            double df = 0.5 * (freq[k + 1] - freq[k]);
+            double a0 = cal::atm_get_absorption_coefficient(5200, 270, 55000,
+                                                            1, freq[k]);
+            double a1 = cal::atm_get_absorption_coefficient(5200, 270, 55000,
+                                                            1, freq[k + 1]);
+            double l0 = cal::atm_get_atmospheric_loading(5200, 270, 55000,
+                                                         1, freq[k]);
+            double l1 = cal::atm_get_atmospheric_loading(5200, 270, 55000,
+                                                         1, freq[k + 1]);
+            num_abs += df * (weight[k] * a0 + weight[k + 1] * a1);
+            num_load += df * (weight[k] * l0 + weight[k + 1] * l1);
+            den += df * (weight[k] + weight[k + 1]);
+        }
+        EXPECT_NEAR(num_abs / den, absorption[b], 1e-10);
+        EXPECT_NEAR(num_load / den, loading[b], 1e-8);
+    }
+
+    // A single frequency band is the monochromatic value
+    size_t single_offsets[2] = {0, 1};
+    double single_freq = 90;
+    double single_weight = 1;
+    cal::atm_get_band_averages(5200, 270, 55000, 1, 1, single_offsets,
+                               &single_freq, &single_weight, absorption,
+                               loading);
+    EXPECT_DOUBLE_EQ(probe, absorption[0]);
+}
+
+
+TEST_F(CALatmTableTest, batch) {
+    size_t const n = 37;
+    std::vector <double> altitude(n);
+    std::vector <double> temperature(n);
+    std::vector <double> pressure(n);
+    std::vector <double> pwv(n);
+    for (size_t i = 0; i < n; ++i) {
+        // Repeat the sites and weather so that some models are reused
+        altitude[i] = 5000 + 100 * (i % 3);
+        temperature[i] = 260 + (i % 5);
+        pressure[i] = 55000 + 500 * (i % 2);
+        pwv[i] = 0.2 + 0.1 * i;
+    }
+    std::vector <double> absorption(n);
+    std::vector <double> loading(n);
+
+    try {
+        cal::atm_get_absorption_coefficient(5000, 260, 55000, 1, 90);
+    } catch (std::runtime_error & e) {
+        // Built without libaatm, the failure must reach the caller
+        EXPECT_THROW(cal::atm_get_absorption_loading_batch(
+                         n, altitude.data(), temperature.data(),
+                         pressure.data(), pwv.data(), 90, absorption.data(),
+                         loading.data()), std::runtime_error);
+        return;
+    }
+
+    cal::atm_get_absorption_loading_batch(n, altitude.data(),
+                                          temperature.data(), pressure.data(),
+                                          pwv.data(), 90, absorption.data(),
+                                          loading.data());
+    for (size_t i = 0; i < n; ++i) {
+        EXPECT_DOUBLE_EQ(cal::atm_get_absorption_coefficient(
+                             altitude[i], temperature[i], pressure[i], pwv[i],
+                             90), absorption[i]);
+        EXPECT_DOUBLE_EQ(cal::atm_get_atmospheric_loading(
+                             altitude[i], temperature[i], pressure[i], pwv[i],
+                             90), loading[i]);
+    }
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <cal_test.hpp>
+
+#include <cmath>
+
+
+const int64_t CALatmTest::nsamp = 1000;
+
+void CALatmTest::SetUp() {
+    t.resize(nsamp);
+    az.resize(nsamp);
+    el.resize(nsamp);
+
+    // A short constant elevation scan back and forth across the patch
+    for (int64_t i = 0; i < nsamp; ++i) {
+        t[i] = 0.1 * i;
+        az[i] = 0.05 * sin(2 * cal::PI * t[i] / 20.0);
+        el[i] = 1.0;
+    }
+    return;
+}
+
+void CALatmTest::simulate_observe(int nthread,
+                                  cal::AlignedVector <double> & tod) {
+    auto & env = cal::Environment::get();
+    env.set_threads(nthread);
+
+    cal::atm_sim sim(-0.06, 0.06, 0.95, 1.05, 0, t[nsamp - 1],
+                     .01, 0, 10, 0, 10, 0, 0, 0, 1000, 0, 280, 0,
+                     40000, 1000, 100, 100, 100, 1000, 0,
+                     123, 456, 789, 1011, std::string(), 0, 2000);
+    sim.simulate(false);
+
+    tod.resize(nsamp);
+    std::fill(tod.begin(), tod.end(), 0);
+    sim.observe(t.data(), az.data(), el.data(), tod.data(), nsamp);
+    return;
+}
+
+TEST_F(CALatmTest, reprod_threads) {
+    // The realization must be bitwise identical regardless of the
+    // number of threads used to build the covariance.
+    auto & env = cal::Environment::get();
+    int nthread = env.max_threads();
+
+    cal::AlignedVector <double> tod1;
+    cal::AlignedVector <double> tod2;
+
+    simulate_observe(1, tod1);
+    simulate_observe(nthread, tod2);
+    env.set_threads(nthread);
+
+    double rms = 0;
+    for (int64_t i = 0; i < nsamp; ++i) {
+        rms += tod1[i] * tod1[i];
+        EXPECT_EQ(tod1[i], tod2[i]);
+    }
+    ASSERT_GT(rms, 0);
+}
+
+TEST_F(CALatmTest, memory) {
+    // The dry run predicts the memory of the simulation
+    cal::atm_sim sim(-0.06, 0.06, 0.95, 1.05, 0, t[nsamp - 1],
+                     .01, 0, 10, 0, 10, 0, 0, 0, 1000, 0, 280, 0,
+                     40000, 1000, 100, 100, 100, 1000, 0,
+                     123, 456, 789, 1011, std::string(), 0, 2000);
+    auto estimate = sim.estimate_memory();
+
+    auto & mem = cal::MemoryTracker::get();
+    mem.reset_peak();
+    int64_t held = mem.stats().back().current;
+    sim.simulate(false);
+    int64_t total = mem.stats().back().peak - held;
+
+    // CHOLMOD and the total are estimates, the CHOLMOD workspace and
+    // the supernodes are not modelled in detail
+    auto near = [](int64_t est, int64_t measured) {
+                    return (measured > est / 2) && (measured < 2 * est);
+                };
+    for (auto const & est : estimate) {
+        if (est.category == "total") {
+            EXPECT_TRUE(near(est.peak, total))
+                << est.peak << " estimated, " << total << " measured";
+        } else if (est.category == "cholmod") {
+            int64_t peak = mem.peak(mem.category("cholmod"));
+            EXPECT_TRUE(near(est.peak, peak))
+                << est.peak << " estimated, " << peak << " measured";
+        } else {
+            EXPECT_EQ(est.peak, mem.peak(mem.category(est.category)))
+                << est.category;
+        }
+    }
+}
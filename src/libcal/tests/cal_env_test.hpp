@@ -18,3 +18,31 @@ TEST_F(CALenvTest, setlog) {
     ASSERT_STREQ(check.c_str(), "CRITICAL");
     env.set_log_level("INFO");
 }
+
+
+TEST_F(CALenvTest, hugepages) {
+    auto & env = cal::Environment::get();
+    int64_t orig = env.hugepage_threshold();
+    env.set_hugepage_threshold(1048576);
+    EXPECT_EQ(env.hugepage_threshold(), 1048576);
+
+    // Allocations above the threshold are still zeroed and aligned
+    cal::AlignedVector <double> big(1048576);
+    EXPECT_TRUE(cal::is_aligned(big.data()));
+    EXPECT_EQ(big[0], 0.0);
+    EXPECT_EQ(big[1048575], 0.0);
+
+    env.set_hugepage_threshold(orig);
+}
+
+
+TEST_F(CALenvTest, simd_target) {
+    auto & env = cal::Environment::get();
+    std::string target = env.simd_target();
+    EXPECT_EQ(target, cal::simd_target());
+    bool known = false;
+    for (auto const & isa : {"avx512f", "avx2", "sse4.2", "default", "native"}) {
+        if (target == isa) known = true;
+    }
+    EXPECT_TRUE(known);
+}
@@ -3,6 +3,7 @@
 // a BSD-style license that can be found in the LICENSE file.
 
 #include <cmath>
+#include <algorithm>
 
 TEST_F(CALhealpixTest, pixelops) {
     // These numbers were generated with the included script.
@@ -33,3 +34,377 @@ TEST_F(CALhealpixTest, pixelops) {
         EXPECT_EQ(pixnest[i], comp_pixnest[i]);
     }
 }
+
+
+TEST_F(CALhealpixTest, pix2ang) {
+    // Pixel centers map back to the same pixels.
+
+    for (int64_t nside : {1, 2, 16, 256}) {
+        cal::HealpixPixels hpx(nside);
+        int64_t npix = 12 * nside * nside;
+        int64_t n = std::min(npix, (int64_t)20000);
+        int64_t stride = npix / n;
+        cal::AlignedVector <int64_t> pix(n);
+        for (int64_t i = 0; i < n; ++i) {
+            pix[i] = i * stride;
+        }
+
+        cal::AlignedVector <double> theta(n);
+        cal::AlignedVector <double> phi(n);
+        cal::AlignedVector <double> vec(3 * n);
+        cal::AlignedVector <double> check(3 * n);
+        cal::AlignedVector <int64_t> outpix(n);
+
+        hpx.nest2ang(n, pix.data(), theta.data(), phi.data());
+        hpx.ang2nest(n, theta.data(), phi.data(), outpix.data());
+        for (int64_t i = 0; i < n; ++i) {
+            EXPECT_EQ(pix[i], outpix[i]);
+        }
+        hpx.nest2vec(n, pix.data(), vec.data());
+        cal::healpix_ang2vec(n, theta.data(), phi.data(), check.data());
+        for (int64_t i = 0; i < 3 * n; ++i) {
+            EXPECT_NEAR(check[i], vec[i], 1.0e-14);
+        }
+        hpx.vec2nest(n, vec.data(), outpix.data());
+        for (int64_t i = 0; i < n; ++i) {
+            EXPECT_EQ(pix[i], outpix[i]);
+        }
+
+        hpx.ring2ang(n, pix.data(), theta.data(), phi.data());
+        hpx.ang2ring(n, theta.data(), phi.data(), outpix.data());
+        for (int64_t i = 0; i < n; ++i) {
+            EXPECT_EQ(pix[i], outpix[i]);
+        }
+        hpx.ring2vec(n, pix.data(), vec.data());
+        hpx.vec2ring(n, vec.data(), outpix.data());
+        for (int64_t i = 0; i < n; ++i) {
+            EXPECT_EQ(pix[i], outpix[i]);
+        }
+    }
+
+    // Reference values from healpy.
+
+    cal::HealpixPixels hpx(1);
+    int64_t pix = 0;
+    double theta;
+    double phi;
+    hpx.nest2ang(1, &pix, &theta, &phi);
+    EXPECT_DOUBLE_EQ(0.8410686705679303, theta);
+    EXPECT_DOUBLE_EQ(0.7853981633974483, phi);
+}
+
+
+TEST_F(CALhealpixTest, neighbours) {
+    // Reference values from healpy.
+
+    cal::HealpixPixels hpx1(1);
+    int64_t pix = 4;
+    int64_t nb[8];
+    int64_t check[8] = {11, 7, 3, -1, 0, 5, 8, -1};
+    hpx1.neighbours_nest(1, &pix, nb);
+    for (int64_t m = 0; m < 8; ++m) {
+        EXPECT_EQ(check[m], nb[m]);
+    }
+
+    // Every neighbour relation is symmetric, and the RING version agrees.
+    // Only the 3 pixels around each of the 8 vertices where just 3 faces
+    // meet miss a neighbour.
+
+    int64_t nside = 16;
+    cal::HealpixPixels hpx(nside);
+    int64_t npix = 12 * nside * nside;
+    cal::AlignedVector <int64_t> allpix(npix);
+    for (int64_t i = 0; i < npix; ++i) {
+        allpix[i] = i;
+    }
+    cal::AlignedVector <int64_t> nbnest(8 * npix);
+    hpx.neighbours_nest(npix, allpix.data(), nbnest.data());
+
+    cal::AlignedVector <double> vec(3 * npix);
+    hpx.nest2vec(npix, allpix.data(), vec.data());
+
+    int64_t nmissing = 0;
+    for (int64_t i = 0; i < npix; ++i) {
+        for (int64_t m = 0; m < 8; ++m) {
+            int64_t other = nbnest[8 * i + m];
+            if (other < 0) {
+                ++nmissing;
+                continue;
+            }
+            ASSERT_LT(other, npix);
+            int64_t const * back = &nbnest[8 * other];
+            EXPECT_NE(back + 8, std::find(back, back + 8, i));
+            double dot = vec[3 * i] * vec[3 * other] +
+                         vec[3 * i + 1] * vec[3 * other + 1] +
+                         vec[3 * i + 2] * vec[3 * other + 2];
+            EXPECT_LT(::acos(dot), 3.0 / nside);
+        }
+    }
+    EXPECT_EQ(24, nmissing);
+
+    cal::AlignedVector <int64_t> ringpix(npix);
+    cal::AlignedVector <int64_t> nbring(8 * npix);
+    hpx.nest2ring(npix, allpix.data(), ringpix.data());
+    hpx.neighbours_ring(npix, ringpix.data(), nbring.data());
+    for (int64_t i = 0; i < 8 * npix; ++i) {
+        if (nbnest[i] < 0) {
+            EXPECT_EQ(-1, nbring[i]);
+        } else {
+            int64_t r;
+            hpx.nest2ring(1, &nbnest[i], &r);
+            EXPECT_EQ(r, nbring[i]);
+        }
+    }
+}
+
+
+TEST_F(CALhealpixTest, query_disc) {
+    int64_t nside = 32;
+    cal::HealpixPixels hpx(nside);
+    int64_t npix = 12 * nside * nside;
+    cal::AlignedVector <int64_t> allpix(npix);
+    for (int64_t i = 0; i < npix; ++i) {
+        allpix[i] = i;
+    }
+    cal::AlignedVector <double> vec(3 * npix);
+    hpx.ring2vec(npix, allpix.data(), vec.data());
+
+    // Centers at the poles, across phi = 0 and on the equator.
+
+    double centers[][3] = {
+        {0.0, 0.0, 1.0}, {0.0, 0.0, -1.0}, {1.0, -0.01, 0.2},
+        {-0.3, 0.8, 0.1}, {0.5, 0.5, -0.7}
+    };
+    double radii[] = {0.01, 0.1, 0.5, 2.0};
+
+    for (auto const & center : centers) {
+        double norm = ::sqrt(center[0] * center[0] + center[1] * center[1] +
+                             center[2] * center[2]);
+        for (double radius : radii) {
+            std::vector <int64_t> check;
+            for (int64_t i = 0; i < npix; ++i) {
+                double dot = (vec[3 * i] * center[0] +
+                              vec[3 * i + 1] * center[1] +
+                              vec[3 * i + 2] * center[2]) / norm;
+                if (dot >= ::cos(radius)) {
+                    check.push_back(i);
+                }
+            }
+
+            std::vector <int64_t> disc;
+            hpx.query_disc_ring(center, radius, false, disc);
+            EXPECT_EQ(check, disc);
+
+            // The inclusive query contains the exact one and the pixel
+            // of the center.
+
+            std::vector <int64_t> incl;
+            hpx.query_disc_ring(center, radius, true, incl);
+            EXPECT_TRUE(std::includes(incl.begin(), incl.end(),
+                                      disc.begin(), disc.end()));
+            int64_t cpix;
+            hpx.vec2ring(1, center, &cpix);
+            EXPECT_TRUE(std::binary_search(incl.begin(), incl.end(), cpix));
+
+            std::vector <int64_t> nest;
+            hpx.query_disc_nest(center, radius, false, nest);
+            ASSERT_EQ(disc.size(), nest.size());
+            std::vector <int64_t> nestcheck(disc.size());
+            hpx.ring2nest(disc.size(), disc.data(), nestcheck.data());
+            std::sort(nestcheck.begin(), nestcheck.end());
+            EXPECT_EQ(nestcheck, nest);
+        }
+    }
+}
+
+
+TEST_F(CALhealpixTest, pointing_matrix) {
+    int64_t nside = 256;
+    // Several chunks, the last one partial.
+    size_t n = 2501;
+    cal::HealpixPixels hpx(nside);
+
+    cal::AlignedVector <double> theta(n);
+    cal::AlignedVector <double> phi(n);
+    cal::AlignedVector <double> pa(n);
+    cal::AlignedVector <double> quat(4 * n);
+    cal::AlignedVector <double> hwpang(n);
+    cal::AlignedVector <uint8_t> flags(n);
+    for (size_t i = 0; i < n; ++i) {
+        theta[i] = 0.01 + 3.1 * i / n;
+        phi[i] = 6.2 * i / n;
+        pa[i] = 0.3 * i;
+        hwpang[i] = 0.05 * i;
+        flags[i] = (i % 7 == 0) ? 1 : 0;
+    }
+    cal::qa_from_angles(n, theta.data(), phi.data(), pa.data(), quat.data());
+
+    cal::AlignedVector <int64_t> pixels(n);
+    cal::AlignedVector <double> weights(3 * n);
+    double eps = 0.1;
+    double calib = 2.0;
+    cal::pointing_matrix_healpix(hpx, true, eps, calib, "IQU", n,
+                                 quat.data(), hwpang.data(), flags.data(),
+                                 pixels.data(), weights.data());
+
+    // Reference from the interleaved quaternion functions.
+
+    double zaxis[3] = {0.0, 0.0, 1.0};
+    double xaxis[3] = {1.0, 0.0, 0.0};
+    cal::AlignedVector <double> dir(3 * n);
+    cal::AlignedVector <double> orient(3 * n);
+    cal::AlignedVector <int64_t> check(n);
+    cal::qa_rotate(n, quat.data(), 1, zaxis, dir.data());
+    cal::qa_rotate(n, quat.data(), 1, xaxis, orient.data());
+    hpx.vec2nest(n, dir.data(), check.data());
+
+    double eta = (1.0 - eps) / (1.0 + eps);
+    for (size_t i = 0; i < n; ++i) {
+        if (flags[i] != 0) {
+            EXPECT_EQ(-1, pixels[i]);
+            continue;
+        }
+        EXPECT_EQ(check[i], pixels[i]);
+        double const * d = &dir[3 * i];
+        double const * o = &orient[3 * i];
+        double by = o[0] * d[1] - o[1] * d[0];
+        double bx = o[0] * (-d[2] * d[0]) + o[1] * (-d[2] * d[1]) +
+                    o[2] * (d[0] * d[0] + d[1] * d[1]);
+        double ang = 2.0 * (::atan2(by, bx) + 2.0 * hwpang[i]);
+        EXPECT_DOUBLE_EQ(calib, weights[3 * i]);
+        EXPECT_NEAR(::cos(ang) * eta * calib, weights[3 * i + 1], 1.0e-12);
+        EXPECT_NEAR(::sin(ang) * eta * calib, weights[3 * i + 2], 1.0e-12);
+    }
+
+    cal::pointing_matrix_healpix(hpx, true, eps, calib, "I", n,
+                                 quat.data(), NULL, NULL,
+                                 pixels.data(), weights.data());
+    for (size_t i = 0; i < n; ++i) {
+        EXPECT_EQ(check[i], pixels[i]);
+        EXPECT_DOUBLE_EQ(calib, weights[i]);
+    }
+}
+
+
+TEST_F(CALhealpixTest, pointing_matrix_flags) {
+    int64_t nside = 64;
+    size_t n = 1500;
+    cal::HealpixPixels hpx(nside);
+
+    cal::AlignedVector <double> theta(n);
+    cal::AlignedVector <double> phi(n);
+    cal::AlignedVector <double> pa(n);
+    cal::AlignedVector <double> quat(4 * n);
+    cal::AlignedVector <double> null(4 * n, 0.0);
+    cal::AlignedVector <double> hwpang(n);
+    cal::AlignedVector <uint8_t> flags(n);
+    for (size_t i = 0; i < n; ++i) {
+        theta[i] = 0.02 + 3.0 * i / n;
+        phi[i] = 6.0 * i / n;
+        pa[i] = 0.2 * i;
+        hwpang[i] = 0.03 * i;
+        flags[i] = (i % 5 == 2) ? 4 : 0;
+        null[4 * i + 3] = 1.0;
+    }
+    cal::qa_from_angles(n, theta.data(), phi.data(), pa.data(), quat.data());
+
+    // Flagged samples have pixel -1 and the weights of the null
+    // quaternion, the others are the same as without flags.
+
+    double eps = 0.05;
+    double calib = 1.5;
+    for (auto const & mode : {std::string("I"), std::string("IQU")}) {
+        size_t nnz = (mode == "I") ? 1 : 3;
+        cal::AlignedVector <int64_t> pixels(n);
+        cal::AlignedVector <double> weights(nnz * n);
+        cal::AlignedVector <int64_t> check_pixels(n);
+        cal::AlignedVector <double> check_weights(nnz * n);
+        cal::AlignedVector <int64_t> null_pixels(n);
+        cal::AlignedVector <double> null_weights(nnz * n);
+
+        cal::pointing_matrix_healpix(hpx, false, eps, calib, mode, n,
+                                     quat.data(), hwpang.data(),
+                                     flags.data(), pixels.data(),
+                                     weights.data());
+        cal::pointing_matrix_healpix(hpx, false, eps, calib, mode, n,
+                                     quat.data(), hwpang.data(), NULL,
+                                     check_pixels.data(),
+                                     check_weights.data());
+        cal::pointing_matrix_healpix(hpx, false, eps, calib, mode, n,
+                                     null.data(), hwpang.data(), NULL,
+                                     null_pixels.data(), null_weights.data());
+
+        for (size_t i = 0; i < n; ++i) {
+            if (flags[i] != 0) {
+                EXPECT_EQ(-1, pixels[i]);
+            } else {
+                EXPECT_EQ(check_pixels[i], pixels[i]);
+            }
+            for (size_t j = 0; j < nnz; ++j) {
+                size_t off = nnz * i + j;
+                double expected = (flags[i] != 0) ? null_weights[off]
+                                  : check_weights[off];
+                EXPECT_EQ(expected, weights[off]);
+            }
+        }
+    }
+}
+
+
+TEST_F(CALhealpixTest, pointing_azel) {
+    size_t n = 1001;
+
+    cal::AlignedVector <double> theta(n);
+    cal::AlignedVector <double> phi(n);
+    cal::AlignedVector <double> pa(n);
+    cal::AlignedVector <double> bore(4 * n);
+    cal::AlignedVector <uint8_t> good(n);
+    for (size_t i = 0; i < n; ++i) {
+        theta[i] = 0.05 + 1.4 * i / n;
+        phi[i] = 6.2 * i / n;
+        pa[i] = 0.01 * i;
+        good[i] = (i % 5 == 0) ? 0 : 1;
+    }
+    cal::qa_from_angles(n, theta.data(), phi.data(), pa.data(), bore.data());
+
+    double axis[3] = {0.6, 0.0, 0.8};
+    double detquat[4];
+    cal::qa_from_axisangle(1, axis, 1, &pa[500], detquat);
+
+    // Reference from the detector quaternions.
+
+    cal::AlignedVector <double> quat(4 * n);
+    cal::AlignedVector <double> ptheta(n);
+    cal::AlignedVector <double> pphi(n);
+    cal::qa_mult(n, bore.data(), 1, detquat, quat.data());
+    cal::qa_to_position(n, quat.data(), ptheta.data(), pphi.data());
+
+    cal::AlignedVector <double> az(n);
+    cal::AlignedVector <double> el(n);
+    size_t nout = cal::pointing_azel(n, bore.data(), detquat, NULL,
+                                     az.data(), el.data());
+    ASSERT_EQ(n, nout);
+    for (size_t i = 0; i < n; ++i) {
+        EXPECT_NEAR(cal::TWOPI - pphi[i], az[i], 1.0e-12);
+        EXPECT_NEAR(cal::PI_2 - ptheta[i], el[i], 1.0e-12);
+    }
+
+    size_t ngood = 0;
+    for (size_t i = 0; i < n; ++i) {
+        ngood += good[i];
+    }
+    cal::AlignedVector <double> gaz(ngood);
+    cal::AlignedVector <double> gel(ngood);
+    nout = cal::pointing_azel(n, bore.data(), detquat, good.data(),
+                              gaz.data(), gel.data());
+    ASSERT_EQ(ngood, nout);
+    size_t j = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (good[i] == 0) {
+            continue;
+        }
+        EXPECT_DOUBLE_EQ(az[i], gaz[j]);
+        EXPECT_DOUBLE_EQ(el[i], gel[j]);
+        ++j;
+    }
+}
@@ -213,6 +213,66 @@ TEST_F(CALqarrayTest, slerp) {
 }
 
 
+TEST_F(CALqarrayTest, slerp_many) {
+    // Slowly rotating input, interpolated to a higher rate over several
+    // blocks and compared with the textbook formula.
+    size_t n = 50;
+    size_t ninterp = 2000;
+    cal::AlignedVector <double> time(n);
+    cal::AlignedVector <double> q(4 * n);
+    cal::AlignedVector <double> axis = {0.0, 0.6, 0.8};
+    cal::AlignedVector <double> angle(n);
+    for (size_t i = 0; i < n; ++i) {
+        time[i] = 0.1 * i;
+        angle[i] = 0.3 * i + 1.0e-3 * i * i;
+    }
+    cal::qa_from_axisangle(1, axis.data(), n, angle.data(), q.data());
+
+    cal::AlignedVector <double> targettime(ninterp);
+    for (size_t i = 0; i < ninterp; ++i) {
+        targettime[i] = -0.05 + 5.0 * i / ninterp;
+    }
+    cal::AlignedVector <double> qinterp(4 * ninterp);
+    cal::qa_slerp(n, ninterp, time.data(), targettime.data(), q.data(),
+                  qinterp.data());
+
+    for (size_t i = 0; i < ninterp; ++i) {
+        size_t off = 0;
+        while ((off + 2 < n) && (time[off + 1] < targettime[i])) ++off;
+        double frac = (targettime[i] - time[off]) /
+                      (time[off + 1] - time[off]);
+        double ang = angle[off] + frac * (angle[off + 1] - angle[off]);
+        double check[4];
+        cal::qa_from_axisangle_one_one(axis.data(), ang, check);
+        for (size_t k = 0; k < 4; ++k) {
+            ASSERT_NEAR(check[k], qinterp[4 * i + k], 1.0e-14);
+        }
+    }
+
+    // Fused interpolation and detector offsets.
+
+    size_t ndet = 3;
+    cal::AlignedVector <double> qdet(4 * ndet);
+    for (size_t idet = 0; idet < ndet; ++idet) {
+        double detaxis[3] = {1.0, 0.0, 0.0};
+        double detang = 0.01 * (idet + 1);
+        cal::qa_from_axisangle_one_one(detaxis, detang, &qdet[4 * idet]);
+    }
+    cal::AlignedVector <double> qout(4 * ndet * ninterp);
+    cal::qa_slerp_mult(n, ninterp, time.data(), targettime.data(),
+                       q.data(), ndet, qdet.data(), qout.data());
+
+    cal::AlignedVector <double> check(4 * ninterp);
+    for (size_t idet = 0; idet < ndet; ++idet) {
+        cal::qa_mult(ninterp, qinterp.data(), 1, &qdet[4 * idet],
+                     check.data());
+        for (size_t i = 0; i < 4 * ninterp; ++i) {
+            EXPECT_DOUBLE_EQ(check[i], qout[4 * idet * ninterp + i]);
+        }
+    }
+}
+
+
 TEST_F(CALqarrayTest, rotation) {
     cal::AlignedVector <double> result(4);
     cal::AlignedVector <double> axis = {0.0, 0.0, 1.0};
@@ -558,3 +618,107 @@ TEST_F(CALqarrayTest, thetaphipa) {
         ASSERT_NEAR(pa[i], check_pa[i], 1.0e-6);
     }
 }
+
+
+TEST_F(CALqarrayTest, soa) {
+    size_t n = 37;
+    cal::AlignedVector <double> q(4 * n);
+    cal::AlignedVector <double> p(4 * n);
+    cal::AlignedVector <double> v(3 * n);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < 4; ++j) {
+            q[4 * i + j] = q1[j] + 0.01 * i * (j + 1);
+            p[4 * i + j] = q2[j] - 0.02 * i * j;
+        }
+        for (size_t j = 0; j < 3; ++j) {
+            v[3 * i + j] = vec2[3 * (i % 2) + j];
+        }
+    }
+
+    cal::AlignedVector <double> qs(4 * n);
+    cal::AlignedVector <double> ps(4 * n);
+    cal::AlignedVector <double> vs(3 * n);
+    cal::AlignedVector <double> back(4 * n);
+    cal::qa_aos_to_soa(n, 4, q.data(), qs.data());
+    cal::qa_aos_to_soa(n, 4, p.data(), ps.data());
+    cal::qa_aos_to_soa(n, 3, v.data(), vs.data());
+    EXPECT_EQ(q[4 * 5 + 2], qs[2 * n + 5]);
+    cal::qa_soa_to_aos(n, 4, qs.data(), back.data());
+    for (size_t i = 0; i < 4 * n; ++i) {
+        EXPECT_EQ(q[i], back[i]);
+    }
+
+    // Compare every SoA kernel with its interleaved counterpart.
+
+    cal::AlignedVector <double> check(4 * n);
+    cal::AlignedVector <double> result(4 * n);
+
+    cal::qa_normalize(n, 4, 4, q.data(), check.data());
+    cal::qa_normalize_soa(n, qs.data(), result.data());
+    cal::qa_soa_to_aos(n, 4, result.data(), back.data());
+    for (size_t i = 0; i < 4 * n; ++i) {
+        EXPECT_NEAR(check[i], back[i], 1.0e-15);
+    }
+
+    cal::qa_rotate(n, q.data(), 1, vec.data(), check.data());
+    cal::qa_rotate_soa(n, qs.data(), 1, vec.data(), result.data());
+    cal::qa_soa_to_aos(n, 3, result.data(), back.data());
+    for (size_t i = 0; i < 3 * n; ++i) {
+        EXPECT_NEAR(check[i], back[i], 1.0e-14);
+    }
+
+    cal::qa_rotate(n, q.data(), n, v.data(), check.data());
+    cal::qa_rotate_soa(n, qs.data(), n, vs.data(), result.data());
+    cal::qa_soa_to_aos(n, 3, result.data(), back.data());
+    for (size_t i = 0; i < 3 * n; ++i) {
+        EXPECT_NEAR(check[i], back[i], 1.0e-14);
+    }
+
+    cal::qa_mult(n, p.data(), n, q.data(), check.data());
+    cal::qa_mult_soa(n, ps.data(), n, qs.data(), result.data());
+    cal::qa_soa_to_aos(n, 4, result.data(), back.data());
+    for (size_t i = 0; i < 4 * n; ++i) {
+        EXPECT_NEAR(check[i], back[i], 1.0e-14);
+    }
+
+    cal::qa_mult(n, p.data(), 1, q2.data(), check.data());
+    cal::qa_mult_soa(n, ps.data(), 1, q2.data(), result.data());
+    cal::qa_soa_to_aos(n, 4, result.data(), back.data());
+    for (size_t i = 0; i < 4 * n; ++i) {
+        EXPECT_NEAR(check[i], back[i], 1.0e-14);
+    }
+
+    cal::qa_mult(1, q1.data(), n, q.data(), check.data());
+    cal::qa_mult_soa(1, q1.data(), n, qs.data(), result.data());
+    cal::qa_soa_to_aos(n, 4, result.data(), back.data());
+    for (size_t i = 0; i < 4 * n; ++i) {
+        EXPECT_NEAR(check[i], back[i], 1.0e-14);
+    }
+
+    cal::AlignedVector <double> time(n);
+    cal::AlignedVector <double> targettime(2 * n - 1);
+    for (size_t i = 0; i < n; ++i) {
+        time[i] = 2.0 * i;
+    }
+    for (size_t i = 0; i < 2 * n - 1; ++i) {
+        targettime[i] = 1.0 * i;
+    }
+    cal::qa_normalize_inplace(n, 4, 4, q.data());
+    cal::qa_aos_to_soa(n, 4, q.data(), qs.data());
+    check.resize(4 * (2 * n - 1));
+    result.resize(4 * (2 * n - 1));
+    back.resize(4 * (2 * n - 1));
+    cal::qa_slerp(n, 2 * n - 1, time.data(), targettime.data(), q.data(),
+                  check.data());
+    cal::qa_slerp_soa(n, 2 * n - 1, time.data(), targettime.data(),
+                      qs.data(), result.data());
+    cal::qa_soa_to_aos(2 * n - 1, 4, result.data(), back.data());
+    for (size_t i = 0; i < 4 * (2 * n - 1); ++i) {
+        EXPECT_NEAR(check[i], back[i], 1.0e-14);
+    }
+
+    // A single input time does not define an interval
+    EXPECT_THROW(cal::qa_slerp_soa(1, 2 * n - 1, time.data(),
+                                   targettime.data(), qs.data(),
+                                   result.data()), std::runtime_error);
+}
@@ -14,9 +14,13 @@ const uint64_t CALrngTest::key[] = {3405692589, 3131965165};
 const uint64_t CALrngTest::counter00[] = {0, 0};
 const uint64_t CALrngTest::key00[] = {0, 0};
 
-// const double rngTest::array_gaussian[] = { -0.602799, 2.141513, -0.433604,
-// 0.493275, -0.037459, -0.926340, -0.536562, -0.064849, -0.662582, -1.024292,
-// -0.170119 };
+// The normal values are pinned to the last bit, any change to them changes
+// every existing realization.
+const double CALrngTest::array_gaussian[] =
+{0.061441622253760868, -1.5892070174425206, 0.85759380940035146,
+ -0.17836435538479994, 1.1943743872795516, 0.088100791163269063,
+ -0.6537420014383819, 0.35460041532965092, 0.77247558965660357,
+ -0.2343970646070305, -0.72753751932332855};
 
 const double CALrngTest::array_m11[] =
 {-0.951008, 0.112014, -0.391117, 0.858437, -0.232332, -0.929797, 0.513278,
@@ -32,9 +36,11 @@ const uint64_t CALrngTest::array_uint64[] =
  4734154306332135586ul, 11779270208507399991ul, 14390002533568630569ul,
  7514066637753215609ul, 4306362335420736255ul};
 
-// const double rngTest::array00_gaussian[] = { -0.680004, -0.633214,
-// -1.523790, -1.847484, -0.427139, 0.991348, 0.601200, 0.481707, -0.085967,
-// 0.110980, -1.220734 };
+const double CALrngTest::array00_gaussian[] =
+{0.70824413650250706, 0.37958204178317329, -0.62191666546786706,
+ -2.835835882425874, -0.85531664358297588, 0.27158852673770251,
+ 0.88980793405110292, -0.16827024430260892, -0.98306513505847559,
+ 1.1113403099905697, -0.078260834065582985};
 
 const double CALrngTest::array00_m11[] =
 {-0.478794, -0.704256, 0.533997, 0.004571, 0.392376, -0.785938, -0.373569,
@@ -70,6 +76,25 @@ TEST_F(CALrngTest, reprod) {
 }
 
 
+#ifndef HAVE_MKL
+TEST_F(CALrngTest, normal) {
+    double result[size];
+
+    cal::rng_dist_normal(size, key[0], key[1], counter[0], counter[1],
+                         result);
+    for (size_t i = 0; i < size; ++i) {
+        EXPECT_EQ(array_gaussian[i], result[i]);
+    }
+
+    cal::rng_dist_normal(size, key00[0], key00[1], counter00[0],
+                         counter00[1], result);
+    for (size_t i = 0; i < size; ++i) {
+        EXPECT_EQ(array00_gaussian[i], result[i]);
+    }
+}
+#endif // ifndef HAVE_MKL
+
+
 TEST_F(CALrngTest, reprod_multi) {
     // Use one stream per thread
     auto & env = cal::Environment::get();
@@ -293,3 +318,113 @@ TEST_F(CALrngTest, uint64_multi) {
         EXPECT_EQ(compare[i], data[i]);
     }
 }
+
+
+TEST_F(CALrngTest, batch_threefry) {
+    // The batched generator must agree with one counter at a time,
+    // which uses the Random123 functor directly.
+    size_t nbatch = 1003;
+    cal::AlignedVector <uint64_t> word0(nbatch);
+    cal::AlignedVector <uint64_t> word1(nbatch);
+
+    cal::rng_threefry2x64(nbatch, key[0], key[1], counter[0], counter[1],
+                            word0.data(), word1.data());
+
+    for (size_t i = 0; i < nbatch; ++i) {
+        uint64_t check0;
+        uint64_t check1;
+        cal::rng_threefry2x64(1, key[0], key[1], counter[0], counter[1] + i,
+                                &check0, &check1);
+        ASSERT_EQ(check0, word0[i]);
+        ASSERT_EQ(check1, word1[i]);
+    }
+
+    // The first word is the existing stream
+    cal::AlignedVector <uint64_t> result(nbatch);
+    cal::rng_dist_uint64(nbatch, key[0], key[1], counter[0], counter[1],
+                           result.data());
+    for (size_t i = 0; i < nbatch; ++i) {
+        ASSERT_EQ(word0[i], result[i]);
+    }
+    for (size_t i = 0; i < size; ++i) {
+        ASSERT_EQ(array_uint64[i], result[i]);
+    }
+}
+
+
+TEST_F(CALrngTest, batch_philox) {
+    size_t nbatch = 4 * 251 + 3;
+    cal::AlignedVector <uint32_t> result(nbatch);
+
+    cal::rng_philox4x32_uint32(nbatch, key[0], counter[0], counter[1],
+                                 result.data());
+
+    for (size_t i = 0; i < nbatch / 4 + 1; ++i) {
+        uint32_t check[4];
+        cal::rng_philox4x32_uint32(4, key[0], counter[0], counter[1] + i,
+                                     check);
+        for (size_t w = 0; (w < 4) && (4 * i + w < nbatch); ++w) {
+            ASSERT_EQ(check[w], result[4 * i + w]);
+        }
+    }
+}
+
+TEST_F(CALrngTest, normal_threads) {
+    auto & env = cal::Environment::get();
+    int nthread = env.max_threads();
+    size_t n = 100003;
+
+    // Reference: the uniform stream mapped through the inverse error
+    // function in one pass.
+    cal::AlignedVector <double> compare(n);
+    cal::rng_dist_uniform_01(n, key[0], key[1], counter[0], counter[1],
+                               compare.data());
+    for (size_t i = 0; i < n; ++i) {
+        compare[i] = 2.0 * compare[i] - 1.0;
+    }
+    #ifdef HAVE_MKL
+    cal::vfast_erfinv(n, compare.data(), compare.data());
+    #else // ifdef HAVE_MKL
+    cal::verfinv(n, compare.data(), compare.data());
+    #endif // ifdef HAVE_MKL
+    for (size_t i = 0; i < n; ++i) {
+        compare[i] *= ::sqrt(2.0);
+    }
+
+    cal::AlignedVector <double> serial(n);
+    env.set_threads(1);
+    cal::rng_dist_normal(n, key[0], key[1], counter[0], counter[1],
+                           serial.data());
+    env.set_threads(nthread);
+
+    cal::AlignedVector <double> threaded(n);
+    cal::rng_dist_normal(n, key[0], key[1], counter[0], counter[1],
+                           threaded.data());
+
+    // The same stream split unevenly into several pieces.
+    size_t const nstream = 3;
+    size_t ndata[nstream] = {7, 60000, n - 60007};
+    uint64_t key1[nstream];
+    uint64_t key2[nstream];
+    uint64_t counter1[nstream];
+    uint64_t counter2[nstream];
+    double * data[nstream];
+    cal::AlignedVector <double> multi(n);
+    size_t off = 0;
+    for (size_t s = 0; s < nstream; ++s) {
+        key1[s] = key[0];
+        key2[s] = key[1];
+        counter1[s] = counter[0];
+        counter2[s] = counter[1] + off;
+        data[s] = multi.data() + off;
+        off += ndata[s];
+    }
+    cal::rng_multi_dist_normal(nstream, ndata, key1, key2, counter1, counter2,
+                                 data);
+
+    for (size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(compare[i], serial[i]);
+        ASSERT_EQ(compare[i], threaded[i]);
+        ASSERT_EQ(compare[i], multi[i]);
+    }
+}
@@ -0,0 +1,108 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <cmath>
+
+
+TEST_F(CALscanTest, ces) {
+    size_t n = 20000;
+    double rate = 50;
+    double azmin = 1.0;
+    double azmax = 1.4;
+    double el_ces = cal::PI / 3;
+    double scanrate = 0.01;
+    double accel = 0.02;
+    double v = scanrate / cos(el_ces);
+    double overshoot = v * v / (2 * accel);
+
+    cal::AlignedVector <double> t(n);
+    cal::AlignedVector <double> az(n);
+    cal::AlignedVector <double> el(n);
+    cal::AlignedVector <uint8_t> flags(n);
+    cal::scan_ces(100.0, rate, 0, n, azmin, azmax, el_ces, scanrate, accel,
+                  t.data(), az.data(), el.data(), flags.data());
+
+    EXPECT_DOUBLE_EQ(100.0, t[0]);
+    EXPECT_DOUBLE_EQ(azmin, az[0]);
+
+    double az_lo = az[0];
+    double az_hi = az[0];
+    size_t nturn = 0;
+    for (size_t i = 0; i < n; ++i) {
+        EXPECT_DOUBLE_EQ(el_ces, el[i]);
+        az_lo = std::min(az_lo, az[i]);
+        az_hi = std::max(az_hi, az[i]);
+        if (i == 0) continue;
+        double speed = (az[i] - az[i - 1]) * rate;
+        uint8_t f = flags[i] & flags[i - 1];
+        if (f == cal::SCAN_LEFTRIGHT) {
+            EXPECT_NEAR(v, speed, 1e-10);
+        } else if (f == cal::SCAN_RIGHTLEFT) {
+            EXPECT_NEAR(-v, speed, 1e-10);
+        } else if (f & cal::SCAN_TURNAROUND) {
+            EXPECT_LE(fabs(speed), v + 1e-10);
+        }
+        if ((flags[i] & cal::SCAN_TURNAROUND) &&
+            !(flags[i - 1] & cal::SCAN_TURNAROUND)) ++nturn;
+    }
+    EXPECT_NEAR(azmin - overshoot, az_lo, 1e-6);
+    EXPECT_NEAR(azmax + overshoot, az_hi, 1e-6);
+
+    // 400 s cover 18 sweeps of 20 s, each followed by a 2 s turnaround
+    EXPECT_EQ(18, nturn);
+
+    // Any span of samples is the same as in the full scan
+    size_t off = 12345;
+    cal::scan_ces(100.0, rate, off, n - off, azmin, azmax, el_ces, scanrate,
+                  accel, t.data(), az.data(), el.data(), flags.data());
+    cal::AlignedVector <double> t2(n);
+    cal::AlignedVector <double> az2(n);
+    cal::AlignedVector <double> el2(n);
+    cal::AlignedVector <uint8_t> flags2(n);
+    cal::scan_ces(100.0, rate, 0, n, azmin, azmax, el_ces, scanrate, accel,
+                  t2.data(), az2.data(), el2.data(), flags2.data());
+    for (size_t i = 0; i < n - off; ++i) {
+        EXPECT_DOUBLE_EQ(t2[i + off], t[i]);
+        EXPECT_DOUBLE_EQ(az2[i + off], az[i]);
+        EXPECT_EQ(flags2[i + off], flags[i]);
+    }
+}
+
+
+TEST_F(CALscanTest, detectors) {
+    size_t n = 1000;
+    size_t ndet = 9;
+    double radius = 0.02;
+
+    cal::AlignedVector <double> t(n);
+    cal::AlignedVector <double> az(n);
+    cal::AlignedVector <double> el(n);
+    cal::AlignedVector <uint8_t> flags(n);
+    cal::scan_ces(0.0, 10.0, 0, n, 1.0, 1.4, 0.9, 0.02, 0.05, t.data(),
+                  az.data(), el.data(), flags.data());
+
+    cal::AlignedVector <double> detquat(4 * ndet);
+    cal::scan_focalplane(ndet, radius, detquat.data());
+
+    cal::AlignedVector <double> detaz(ndet * n);
+    cal::AlignedVector <double> detel(ndet * n);
+    cal::scan_detectors_azel(n, az.data(), el.data(), ndet, detquat.data(),
+                             detaz.data(), detel.data());
+
+    // The central detector of the 3 x 3 grid follows the boresight, the
+    // others are offset by up to sqrt(2) * radius.
+    for (size_t i = 0; i < n; ++i) {
+        EXPECT_NEAR(az[i], detaz[4 * n + i], 1e-10);
+        EXPECT_NEAR(el[i], detel[4 * n + i], 1e-10);
+    }
+    for (size_t idet = 0; idet < ndet; ++idet) {
+        for (size_t i = 0; i < n; ++i) {
+            double daz = (detaz[idet * n + i] - az[i]) * cos(el[i]);
+            double del = detel[idet * n + i] - el[i];
+            double dist = sqrt(daz * daz + del * del);
+            EXPECT_LT(dist, sqrt(2.0) * radius * 1.01);
+            if (idet != 4) EXPECT_GT(dist, 0.5 * radius);
+        }
+    }
+}
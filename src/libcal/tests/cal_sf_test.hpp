@@ -224,6 +224,66 @@ TEST_F(CALsfTest, fast_sqrtlog) {
 }
 
 
+TEST_F(CALsfTest, fast_special) {
+    // Large arguments, zeros, infinities and NaN must behave like the C
+    // library.
+    double const inf = std::numeric_limits <double>::infinity();
+    double const nan = std::numeric_limits <double>::quiet_NaN();
+    int const nsp = 9;
+    cal::AlignedVector <double> in = {
+        0.0, -0.0, 1.0e-310, -1.0, 1.0e6, -3.0e9, inf, -inf, nan
+    };
+    cal::AlignedVector <double> out(nsp);
+    cal::AlignedVector <double> out2(nsp);
+
+    auto check = [](double out, double expected) {
+        if (std::isnan(expected)) {
+            EXPECT_TRUE(std::isnan(out));
+        } else {
+            EXPECT_DOUBLE_EQ(out, expected);
+            EXPECT_EQ(std::signbit(out), std::signbit(expected));
+        }
+    };
+
+    cal::vfast_sincos(nsp, in.data(), out.data(), out2.data());
+    for (int i = 0; i < nsp; ++i) {
+        check(out[i], ::sin(in[i]));
+        check(out2[i], ::cos(in[i]));
+    }
+
+    // In place, including the arguments redone with the C library
+    out = in;
+    cal::vfast_sin(nsp, out.data(), out.data());
+    for (int i = 0; i < nsp; ++i) {
+        check(out[i], ::sin(in[i]));
+    }
+    out2 = in;
+    cal::vfast_sincos(nsp, out2.data(), out.data(), out2.data());
+    for (int i = 0; i < nsp; ++i) {
+        check(out[i], ::sin(in[i]));
+        check(out2[i], ::cos(in[i]));
+    }
+
+    cal::vfast_exp(nsp, in.data(), out.data());
+    for (int i = 0; i < nsp; ++i) {
+        check(out[i], ::exp(in[i]));
+    }
+
+    cal::vfast_log(nsp, in.data(), out.data());
+    for (int i = 0; i < nsp; ++i) {
+        check(out[i], ::log(in[i]));
+    }
+
+    for (int i = 0; i < nsp; ++i) {
+        for (int j = 0; j < nsp; ++j) {
+            double ang;
+            cal::vfast_atan2(1, &in[i], &in[j], &ang);
+            check(ang, ::atan2(in[i], in[j]));
+        }
+    }
+}
+
+
 TEST_F(CALsfTest, fast_erfinv) {
     cal::AlignedVector <double> in = {
         -9.990000e-01,
@@ -259,3 +319,58 @@ TEST_F(CALsfTest, fast_erfinv) {
         EXPECT_FLOAT_EQ(out[i], check[i]);
     }
 }
+
+
+TEST_F(CALsfTest, erfinv) {
+    cal::AlignedVector <double> in = {
+        -9.990000e-01,
+        -7.770000e-01,
+        -5.550000e-01,
+        -3.330000e-01,
+        -1.110000e-01,
+        1.110000e-01,
+        3.330000e-01,
+        5.550000e-01,
+        7.770000e-01,
+        9.990000e-01
+    };
+
+    cal::AlignedVector <double> out(10);
+
+    cal::verfinv(10, in.data(), out.data());
+
+    // Check against the C library error function.
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_DOUBLE_EQ(::erf(out[i]), in[i]);
+    }
+}
+
+
+TEST_F(CALsfTest, generic_erfinv) {
+    // Cover the central region and both tails, including values close
+    // enough to one to need the last polynomial.
+    int n = 10000;
+    cal::AlignedVector <double> in(n);
+    for (int i = 0; i < n; ++i) {
+        in[i] = -1.0 + 2.0 * (i + 0.5) / n;
+    }
+    in[0] = -1.0 + 1.0e-12;
+    in[n - 1] = 1.0 - 1.0e-15;
+
+    cal::AlignedVector <double> check(n);
+    cal::vgeneric_erfinv(n, in.data(), check.data(), false);
+
+    cal::AlignedVector <double> out(n);
+    cal::vgeneric_erfinv(n, in.data(), out.data(), true);
+
+    for (int i = 0; i < n; ++i) {
+        EXPECT_DOUBLE_EQ(out[i], check[i]);
+        EXPECT_NEAR(::erf(check[i]), in[i], 1.0e-15);
+    }
+
+    // In place
+    cal::vgeneric_erfinv(n, in.data(), in.data(), true);
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(out[i], in[i]);
+    }
+}
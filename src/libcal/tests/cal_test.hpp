@@ -124,5 +124,63 @@ class CALhealpixTest : public ::testing::Test {
 };
 
 
+class CALscanTest : public ::testing::Test {
+    public:
+
+        CALscanTest() {}
+
+        ~CALscanTest() {}
+
+        virtual void SetUp() {}
+
+        virtual void TearDown() {}
+};
+
+
+class CALatmTest : public ::testing::Test {
+    public:
+
+        CALatmTest() {}
+
+        ~CALatmTest() {}
+
+        virtual void SetUp();
+        virtual void TearDown() {}
+
+        void simulate_observe(int nthread, cal::AlignedVector <double> & tod);
+
+        static const int64_t nsamp;
+        cal::AlignedVector <double> t;
+        cal::AlignedVector <double> az;
+        cal::AlignedVector <double> el;
+};
+
+
+class CALatmConfigTest : public ::testing::Test {
+    public:
+
+        CALatmConfigTest() {}
+
+        ~CALatmConfigTest() {}
+
+        virtual void SetUp() {}
+
+        virtual void TearDown() {}
+};
+
+
+class CALatmTableTest : public ::testing::Test {
+    public:
+
+        CALatmTableTest() {}
+
+        ~CALatmTableTest() {}
+
+        virtual void SetUp() {}
+
+        virtual void TearDown() {}
+};
+
+
 
 #endif // ifndef CAL_TEST_HPP
@@ -6,6 +6,16 @@
 
 #include <thread>
 #include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include <unistd.h>
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif // ifdef _OPENMP
 
 
 TEST_F(CALutilsTest, logging) {
@@ -201,3 +211,184 @@ TEST_F(CALutilsTest, globaltimer) {
 
     gtm.report();
 }
+
+
+TEST_F(CALutilsTest, profiler) {
+    auto & prof = cal::Profiler::get();
+    prof.clear();
+
+    for (int i = 0; i < 3; ++i) {
+        cal::ProfileRegion outer("test_outer");
+        {
+            cal::ProfileRegion inner("test_inner");
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (i == 0) {
+            cal::ProfileRegion other("test_other");
+        }
+    }
+
+    // Regions opened on several threads are accumulated per thread
+    int nthread = 1;
+    #pragma omp parallel reduction(max:nthread)
+    {
+        #ifdef _OPENMP
+        nthread = omp_get_num_threads();
+        #endif // ifdef _OPENMP
+        for (int i = 0; i < 4; ++i) {
+            cal::ProfileRegion region("test_threads");
+        }
+    }
+
+    // A disabled profiler records nothing
+    prof.set_enabled(false);
+    {
+        cal::ProfileRegion region("test_disabled");
+    }
+    prof.set_enabled(true);
+
+    auto stats = prof.stats();
+    std::map <std::string, cal::ProfileStat> bypath;
+    for (auto const & st : stats) bypath[st.path] = st;
+
+    ASSERT_EQ(1, bypath.count("test_outer"));
+    ASSERT_EQ(1, bypath.count("test_outer/test_inner"));
+    ASSERT_EQ(1, bypath.count("test_outer/test_other"));
+    ASSERT_EQ(1, bypath.count("test_threads"));
+    EXPECT_EQ(0, bypath.count("test_disabled"));
+
+    auto const & outer = bypath["test_outer"];
+    auto const & inner = bypath["test_outer/test_inner"];
+    EXPECT_EQ(0, outer.depth);
+    EXPECT_EQ(1, inner.depth);
+    EXPECT_EQ(3, outer.calls);
+    EXPECT_EQ(3, inner.calls);
+    EXPECT_EQ(1, bypath["test_outer/test_other"].calls);
+    EXPECT_EQ(4 * nthread, bypath["test_threads"].calls);
+    EXPECT_GE(inner.min, 0.01);
+    EXPECT_LE(inner.min, inner.max);
+    EXPECT_GE(outer.seconds, inner.seconds);
+
+    // Sleeps may overrun arbitrarily on a loaded machine, only the lower
+    // bound is certain.
+    EXPECT_GE(inner.seconds, 0.03);
+    EXPECT_EQ(1, bypath["test_outer/test_other"].depth);
+    EXPECT_EQ(0, bypath["test_threads"].depth);
+
+    size_t nthread_stats = 0;
+    for (auto const & st : prof.stats(true)) {
+        if (st.path == "test_threads") {
+            EXPECT_EQ(4, st.calls);
+            ++nthread_stats;
+        }
+    }
+    EXPECT_EQ(nthread, nthread_stats);
+
+    prof.report();
+    prof.clear();
+    EXPECT_EQ(0, prof.stats().size());
+}
+
+
+TEST_F(CALutilsTest, trace) {
+    auto & prof = cal::Profiler::get();
+    bool tracing = prof.tracing();
+    prof.clear();
+    prof.set_tracing(true);
+
+    for (int i = 0; i < 2; ++i) {
+        cal::ProfileRegion outer("trace_outer");
+        cal::ProfileRegion inner("trace_inner");
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    prof.set_tracing(false);
+    {
+        cal::ProfileRegion region("trace_untraced");
+    }
+    prof.set_tracing(tracing);
+
+    char tmpl[] = "/tmp/cal_trace_XXXXXX";
+    int fd = mkstemp(tmpl);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    std::string path(tmpl);
+    prof.write_trace(path);
+
+    std::ifstream f(path);
+    std::stringstream buf;
+    buf << f.rdbuf();
+    std::string trace = buf.str();
+    std::remove(path.c_str());
+
+    auto count = [&](std::string const & key) {
+        size_t n = 0;
+        for (size_t pos = trace.find(key); pos != std::string::npos;
+             pos = trace.find(key, pos + 1)) ++n;
+        return n;
+    };
+
+    EXPECT_EQ(0, trace.find("{\"traceEvents\":["));
+    EXPECT_EQ(2, count("\"name\":\"trace_outer\",\"ph\":\"X\""));
+    EXPECT_EQ(2, count("\"name\":\"trace_inner\",\"ph\":\"X\""));
+    EXPECT_EQ(0, count("trace_untraced"));
+    EXPECT_EQ(1, count("\"process_name\""));
+    EXPECT_NE(std::string::npos, trace.find("\"displayTimeUnit\":\"ms\"}"));
+
+    prof.clear();
+}
+
+
+TEST_F(CALutilsTest, memory) {
+    auto & mem = cal::MemoryTracker::get();
+    int id = mem.category("test_memory");
+    EXPECT_EQ(id, mem.category("test_memory"));
+    EXPECT_EQ("test_memory", mem.name(id));
+    mem.reset_peak();
+    int64_t cur0 = mem.current(id);
+
+    {
+        cal::AlignedAllocator <double> alloc(id);
+        cal::AlignedVector <double> v(1000, 0.0, alloc);
+        EXPECT_EQ(cur0 + 8000, mem.current(id));
+
+        // The category follows the memory when it is moved or swapped
+        cal::AlignedVector <double> w(alloc);
+        w.resize(500);
+        EXPECT_EQ(cur0 + 12000, mem.current(id));
+        cal::AlignedVector <double> other(100);
+        w.swap(other);
+        EXPECT_EQ(id, other.get_allocator().category());
+        EXPECT_EQ(cal::MemoryTracker::ALIGNED, w.get_allocator().category());
+        cal::AlignedVector <double> moved;
+        moved = std::move(v);
+        EXPECT_EQ(id, moved.get_allocator().category());
+        EXPECT_EQ(cur0 + 12000, mem.current(id));
+    }
+    EXPECT_EQ(cur0, mem.current(id));
+    EXPECT_EQ(cur0 + 12000, mem.peak(id));
+
+    // Sampled memory of two owners
+    int sid = mem.category("test_memory_sampled");
+    int64_t held1 = 0;
+    int64_t held2 = 0;
+    mem.sample(sid, held1, 100, 300);
+    mem.sample(sid, held2, 50);
+    EXPECT_EQ(150, mem.current(sid));
+    EXPECT_EQ(300, mem.peak(sid));
+    mem.sample(sid, held1, 0);
+    mem.sample(sid, held2, 0);
+    EXPECT_EQ(0, mem.current(sid));
+
+    bool found = false;
+    auto stats = mem.stats();
+    for (auto const & st : stats) {
+        if (st.category == "test_memory") {
+            EXPECT_EQ(cur0 + 12000, st.peak);
+            EXPECT_LE(2, st.allocs);
+            found = true;
+        }
+    }
+    EXPECT_TRUE(found);
+    EXPECT_EQ("total", stats.back().category);
+    mem.report();
+}
@@ -0,0 +1,205 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+// Batch atmosphere production with MPI, the same as cal_atm.  The
+// processes are split into groups of --group-size processes (all of them
+// by default) and the observations are dealt to the groups in turn.  The
+// processes of a group simulate every atmosphere together with
+// mpi_atm_sim, then observe it with their share of the detectors and
+// write their rows of <outdir>/<name>.bin and <name>.flags.  The exit
+// status is 2 if any sample could not be observed.
+
+#include <cal_mpi.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+
+namespace {
+void mpi_check(int ret, std::string const & what) {
+    if (ret != MPI_SUCCESS) {
+        auto here = cal_HERE();
+        auto log = cal::Logger::get();
+        std::string msg = "MPI error in " + what;
+        log.error(msg.c_str(), here);
+        throw std::runtime_error(msg.c_str());
+    }
+    return;
+}
+
+// Read the configuration on the first process and parse it on all of them
+void load_config(std::string const & path, MPI_Comm comm,
+                 cal::AtmConfig & config) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    std::string text;
+    long len = -1;
+    if (rank == 0) {
+        std::ifstream in(path);
+        if (in.good()) {
+            std::ostringstream o;
+            o << in.rdbuf();
+            text = o.str();
+            len = text.size();
+        }
+    }
+    MPI_Bcast(&len, 1, MPI_LONG, 0, comm);
+    if (len < 0) {
+        auto here = cal_HERE();
+        auto log = cal::Logger::get();
+        std::string msg = "Cannot open atmosphere configuration " + path;
+        log.error(msg.c_str(), here);
+        throw std::runtime_error(msg.c_str());
+    }
+    text.resize(len);
+    MPI_Bcast(&text[0], len, MPI_CHAR, 0, comm);
+    std::istringstream in(text);
+    config.parse(in, path);
+    return;
+}
+
+void write_tod(cal::AtmObservation const & obs, MPI_Comm comm,
+               cal::AtmTOD const & tod) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    std::string base = obs.outdir + "/" + obs.name;
+
+    MPI_File fh;
+    mpi_check(MPI_File_open(comm, (base + ".bin").c_str(),
+                            MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                            MPI_INFO_NULL, &fh), "opening " + base + ".bin");
+    mpi_check(MPI_File_set_size(fh, 0), "truncating " + base + ".bin");
+    for (size_t idet = 0; idet < tod.ndet; ++idet) {
+        MPI_Offset off = (tod.det0 + idet) * obs.nsamp * sizeof(double);
+        mpi_check(MPI_File_write_at(fh, off, tod.tod.data() + idet * obs.nsamp,
+                                    obs.nsamp, MPI_DOUBLE,
+                                    MPI_STATUS_IGNORE),
+                  "writing " + base + ".bin");
+    }
+    mpi_check(MPI_File_close(&fh), "closing " + base + ".bin");
+
+    mpi_check(MPI_File_open(comm, (base + ".flags").c_str(),
+                            MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                            MPI_INFO_NULL, &fh),
+              "opening " + base + ".flags");
+    mpi_check(MPI_File_set_size(fh, 0), "truncating " + base + ".flags");
+    MPI_Offset off = tod.det0 * obs.nsamp;
+    mpi_check(MPI_File_write_at(fh, off, tod.flags.data(), tod.flags.size(),
+                                MPI_UINT8_T, MPI_STATUS_IGNORE),
+              "writing " + base + ".flags");
+    mpi_check(MPI_File_close(&fh), "closing " + base + ".flags");
+
+    unsigned long nbad_tot = 0;
+    unsigned long nbad_local = tod.nbad;
+    MPI_Reduce(&nbad_local, &nbad_tot, 1, MPI_UNSIGNED_LONG, MPI_SUM, 0,
+               comm);
+    if (rank == 0) cal::atm_write_metadata(obs, nbad_tot);
+    return;
+}
+
+size_t run_observation(cal::AtmObservation const & obs, MPI_Comm comm) {
+    int rank, ntask;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &ntask);
+    cal::Timer tm;
+    MPI_Barrier(comm);
+    tm.start();
+
+    // Every process observes with its share of the detectors
+    size_t det0 = obs.ndet * rank / ntask;
+    size_t ndet = obs.ndet * (rank + 1) / ntask - det0;
+    auto make_sim = [&](cal::AtmShell const & s) {
+                        return std::unique_ptr <cal::mpi_atm_sim> (
+                            new cal::mpi_atm_sim(
+                                s.azmin, s.azmax, s.elmin, s.elmax, s.tmin,
+                                s.tmax, obs.lmin_center, obs.lmin_sigma,
+                                obs.lmax_center, obs.lmax_sigma,
+                                obs.wind_speed, 0, obs.wind_dir, 0,
+                                obs.z0_center, obs.z0_sigma, obs.T0, 0,
+                                obs.zatm, obs.zmax, s.xstep, s.ystep,
+                                s.zstep, obs.nelem_sim_max, obs.verbosity,
+                                comm, obs.key1, obs.key2, s.counter1,
+                                s.counter2, obs.cachedir, s.rmin, s.rmax));
+                    };
+    cal::AtmTOD tod;
+    cal::atm_run_observation(obs, det0, ndet, make_sim, tod);
+    write_tod(obs, comm, tod);
+
+    MPI_Barrier(comm);
+    tm.stop();
+    if (rank == 0) {
+        std::ostringstream o;
+        o << "Observation " << obs.name << ": " << obs.ndet << " x "
+          << obs.nsamp << " samples written by " << ntask << " processes in";
+        tm.report(o.str().c_str());
+    }
+    return tod.nbad;
+}
+}
+
+
+int main(int argc, char * argv[]) {
+    cal::mpi_init(argc, argv);
+
+    int rank, ntask;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ntask);
+
+    int group_size = ntask;
+    char const * path = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if ((std::strcmp(argv[i], "--group-size") == 0) && (i + 1 < argc)) {
+            group_size = std::atoi(argv[++i]);
+        } else if (path == NULL) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if ((path == NULL) || (group_size < 1) || (group_size > ntask)) {
+        if (rank == 0) {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--group-size <processes>] <config>" << std::endl;
+        }
+        cal::mpi_finalize();
+        return 1;
+    }
+
+    // Groups are consecutive ranks, so that they share nodes
+    int ngroup = (ntask + group_size - 1) / group_size;
+    int group = rank / group_size;
+    MPI_Comm comm;
+    MPI_Comm_split(MPI_COMM_WORLD, group, rank, &comm);
+
+    unsigned long nbad = 0;
+    try {
+        cal::AtmConfig config;
+        load_config(path, MPI_COMM_WORLD, config);
+        for (size_t iobs = group; iobs < config.size(); iobs += ngroup) {
+            nbad += run_observation(config.observation(iobs), comm);
+        }
+    } catch (std::exception const & e) {
+        // The other processes of the group would wait in a collective
+        std::cerr << argv[0] << " (process " << rank << "): " << e.what()
+                  << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    unsigned long nbad_tot = 0;
+    MPI_Allreduce(&nbad, &nbad_tot, 1, MPI_UNSIGNED_LONG, MPI_SUM,
+                  MPI_COMM_WORLD);
+    if ((rank == 0) && (nbad_tot > 0)) {
+        std::cerr << argv[0] << ": " << nbad_tot << " samples are flagged"
+                  << std::endl;
+    }
+
+    MPI_Comm_free(&comm);
+    cal::mpi_finalize();
+    return (nbad_tot > 0) ? 2 : 0;
+}
@@ -2,6 +2,7 @@
 #include <gtest/gtest.h>
 #include <tests/cal_mpi_test.hpp>
 
+#include <tests/cal_mpi_test_atm.hpp>
 #include <tests/cal_mpi_test_shmem.hpp>
 
 int main(int argc, char * argv[]) {
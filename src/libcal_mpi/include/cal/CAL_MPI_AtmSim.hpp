@@ -12,6 +12,8 @@ extern "C" {
 }
 #include <cal/sys_env.hpp>
 #include <cal/sys_utils.hpp>
+#include <cal/sys_profile.hpp>
+#include <cal/sys_memory.hpp>
 #include <cal/atm_shm.hpp>
 
 /**
@@ -107,6 +109,20 @@ class mpi_atm_sim{
         /**Helper function for print*/
         void print(std::ostream & out = std::cout) const;
 
+        /**
+        * Predict the memory used by simulate() on this process without
+        * simulating (a dry run).  Collective over the communicator.  The
+        * parameters are drawn and the observed volume is found as in
+        * simulate(), then the random number counters are restored.
+        * Returns the peak bytes of every category and the "total" peak.
+        * The shared arrays count the segment of this process.  The
+        * CHOLMOD peak is estimated from the covariance pattern of the
+        * largest slice and the factor size cholmod_analyze() predicts for
+        * it.  The broadcast buffers assume that no broadcast completes
+        * before the last slice, an upper bound.
+        */
+        std::vector <MemoryStat> estimate_memory();
+
     private:
 
         MPI_Comm comm = MPI_COMM_NULL;
@@ -167,6 +183,8 @@ class mpi_atm_sim{
 
         cholmod_common cholcommon;
         cholmod_common * chcommon;
+        /**CHOLMOD memory last reported to the MemoryTracker*/
+        int64_t cholmod_held = 0;
         /**Draw values of lmin, lmax, w, wdir T0 (and optionally z0).*/
         void draw();
         /**Determine the rectangular volume needed*/
@@ -177,6 +195,15 @@ class mpi_atm_sim{
         /** Find the volume elements really needed*/
         void compress_volume();
 
+        /** Flag the elements in the cone and their neighbors*/
+        void flag_hits(AlignedU8 & hit);
+
+        /** Report the memory held by CHOLMOD to the MemoryTracker*/
+        void sample_cholmod_memory();
+
+        /** CHOLMOD bytes for the slice of the given full indices*/
+        int64_t cholmod_bytes(std::vector <long> const & slice);
+
         mpi_shmem_double * realization = NULL;
 
         /**Find the next range of compressed indices to simulate*/
@@ -194,6 +221,13 @@ class mpi_atm_sim{
         void apply_sparse_covariance(cholmod_sparse * sqrt_cov,
                                      long ind_start, long ind_stop);
 
+        /** Complete pending slice broadcasts into the shared realization */
+        void finish_broadcasts(std::vector <MPI_Request> & requests,
+                               std::vector <AlignedF64> & buffers,
+                               std::vector <long> const & slice_starts,
+                               std::vector <long> const & slice_stops,
+                               bool wait);
+
         /** Compressed index to X Y Z - coordinates*/
         void ind2coord(long i, double * coord);
 
@@ -14,13 +14,18 @@
 namespace cal {
 /**
 * Split the provided communicator into groups that share
-* memory (are on the same node).
+* memory (are on the same node).  Every process accounts its own
+* segment of the shared window to the MemoryTracker category.
 */
 template <typename T>
 class mpi_shmem {
     public:
 
-        mpi_shmem(MPI_Comm comm = MPI_COMM_WORLD) : comm_(comm) {
+        mpi_shmem(MPI_Comm comm = MPI_COMM_WORLD,
+                  std::string const & category = "mpi_shmem")
+            : comm_(comm) {
+            category_ = MemoryTracker::get().category(category);
+
             int ret = MPI_Comm_rank(comm, &world_rank_);
             if (ret != MPI_SUCCESS) {
                 auto here = cal_HERE();
@@ -65,7 +70,9 @@ class mpi_shmem {
             }
         }
 
-        mpi_shmem(int n, MPI_Comm comm = MPI_COMM_WORLD) : mpi_shmem(comm) {
+        mpi_shmem(int n, MPI_Comm comm = MPI_COMM_WORLD,
+                  std::string const & category = "mpi_shmem")
+            : mpi_shmem(comm, category) {
             allocate(n);
         }
 
@@ -109,6 +116,8 @@ class mpi_shmem {
                 }
             }
             n_ = n;
+            nbytes_ = nlocal_ * sizeof(T);
+            MemoryTracker::get().allocated(category_, nbytes_);
 
             MPI_Aint nn;
             int disp;
@@ -143,15 +152,18 @@ class mpi_shmem {
                         throw std::runtime_error(msg.c_str());
                     }
                 }
+                MemoryTracker::get().freed(category_, nbytes_);
                 local_ = NULL;
                 global_ = NULL;
                 n_ = 0;
                 nlocal_ = 0;
+                nbytes_ = 0;
             }
             return;
         }
 
         void set(T val) {
+            # pragma omp parallel for schedule(static)
             for (int64_t i = 0; i < nlocal_; ++i) {
                 local_[i] = val;
             }
@@ -160,12 +172,13 @@ class mpi_shmem {
 
         /**
         * If there is memory already allocated, preserve its
-        * contents.
+        * contents.  The new window is allocated before the old one is
+        * released, so every process copies (and first touches) its own
+        * segment instead of rank zero touching all of the pages.
         */
         T * resize(int64_t n) {
 
             int64_t n_copy = 0;
-            cal::AlignedVector <T> temp;
 
             if (n < n_) {
                 // We are shrinking the memory
@@ -176,16 +189,40 @@ class mpi_shmem {
                 n_copy = n_;
             }
 
-            if ((n_copy > 0) && (rank_ == 0)) {
-                temp.resize(n_copy);
-                std::copy(global_, global_ + n_copy, temp.begin());
-            }
+            T * old_global = global_;
+            MPI_Win old_win = win_;
+            size_t old_nbytes = nbytes_;
 
-            free();
+            global_ = NULL;
+            local_ = NULL;
+            win_ = MPI_WIN_NULL;
             allocate(n);
 
-            if ((n_copy > 0) && (rank_ == 0)) {
-                std::copy(temp.begin(), temp.end(), global_);
+            if ((nlocal_ > 0) && (n_copy > 0)) {
+                int64_t offset = local_ - global_;
+                int64_t n_local_copy = n_copy - offset;
+                if (n_local_copy > nlocal_) n_local_copy = nlocal_;
+                if (n_local_copy > 0) {
+                    std::copy(old_global + offset,
+                              old_global + offset + n_local_copy, local_);
+                }
+            }
+
+            if (old_global) {
+                // Nobody may release the old window before all copies
+                // are done.
+                MPI_Barrier(shmcomm_);
+                int ret = MPI_Win_free(&old_win);
+                if (ret != MPI_SUCCESS) {
+                    if (rank_ == 0) {
+                        auto here = cal_HERE();
+                        auto log = cal::Logger::get();
+                        std::string msg("Failed to free shared memory.");
+                        log.error(msg.c_str(), here);
+                        throw std::runtime_error(msg.c_str());
+                    }
+                }
+                MemoryTracker::get().freed(category_, old_nbytes);
             }
 
             return global_;
@@ -227,6 +264,8 @@ class mpi_shmem {
         int ntasks_;
         int rank_;
         int world_rank_;
+        int category_;
+        size_t nbytes_ = 0;
 };
 }
 
@@ -17,6 +17,8 @@ namespace cal {
 void mpi_init(int argc, char * argv[]);
 
 void mpi_finalize();
+
+std::vector <ProfileStat> mpi_profile_gather(MPI_Comm comm);
 }
 
 #endif // ifndef CAL_MPI_HPP
@@ -169,4 +169,17 @@ cal::mpi_atm_sim::~mpi_atm_sim()
     if (full_index) delete full_index;
     if (realization) delete realization;
     cholmod_finish(chcommon);
+    sample_cholmod_memory();
+}
+
+/**
+* Report the memory held by CHOLMOD and its high water mark since the
+* previous call to the MemoryTracker.
+*/
+void cal::mpi_atm_sim::sample_cholmod_memory()
+{
+    auto & mem = cal::MemoryTracker::get();
+    mem.sample(mem.category("cholmod"), cholmod_held,
+               chcommon->memory_inuse, chcommon->memory_usage);
+    chcommon->memory_usage = chcommon->memory_inuse;
 }
@@ -14,18 +14,20 @@
 */
 void cal::mpi_atm_sim::compress_volume()
 {
+    cal::ProfileRegion region("compress_volume");
     double t1 = MPI_Wtime();
 
     if ((rank == 0) && (verbosity > 0)) {
         std::cerr << "Compressing volume, N = " << nn << std::endl;
     }
 
-    std::vector <unsigned char> hit;
+    AlignedU8 hit(AlignedAllocator <uint8_t> (
+                      cal::MemoryTracker::get().category("hit_mask")));
     try {
-        compressed_index = new mpi_shmem_long(nn, comm);
+        compressed_index = new mpi_shmem_long(nn, comm, "compressed_index");
         compressed_index->set(-1);
 
-        full_index = new mpi_shmem_long(nn, comm);
+        full_index = new mpi_shmem_long(nn, comm, "full_index");
         full_index->set(-1);
 
         hit.resize(nn, false);
@@ -36,6 +38,56 @@ void cal::mpi_atm_sim::compress_volume()
         throw;
     }
 
+    flag_hits(hit);
+
+    if ((rank == 0) && (verbosity > 0)) {
+        std::cerr << "Creating compression table" << std::endl;
+    }
+
+    // Then create the mappings between the compressed and
+    // full indices
+    long i = 0;
+    for (long ifull = 0; ifull < nn; ++ifull) {
+        if (hit[ifull]) {
+            (*full_index)[i] = ifull;
+            (*compressed_index)[ifull] = i;
+            ++i;
+        }
+    }
+
+    hit.clear();
+    hit.shrink_to_fit();
+    nelem = i;
+
+    full_index->resize(nelem);
+
+    double t2 = MPI_Wtime();
+
+    if (rank == 0) {
+        std::cout << "Volume compressed in " << t2 - t1
+          << " s." << std::endl
+          << i << " / " << nn
+          << "(" << i * 100. / nn << " %)"
+          << " volume elements are needed for the simulation"
+          << std::endl
+          << "nx = " << nx << " ny = " << ny << " nz = " << nz
+          << std::endl
+          << "wx = " << wx << " wy = " << wy << " wz = " << wz
+          << std::endl;
+    }
+
+    if (nelem == 0)
+        throw std::runtime_error("No elements in the observation cone.");
+}
+
+
+/**
+* Flag the elements in the observation cone and their neighbors.  The
+* X layers are shared between the processes and the flags are reduced
+* over the communicator.
+*/
+void cal::mpi_atm_sim::flag_hits(AlignedU8 & hit)
+{
     // Start by flagging all elements that are hit
     for (long ix = 0; ix < nx - 1; ++ix) {
         if (ix % ntask != rank){
@@ -70,7 +122,7 @@ void cal::mpi_atm_sim::compress_volume()
                       MPI_UNSIGNED_CHAR, MPI_LOR, comm)) throw std::runtime_error(
                   "Failed to gather hits");
 
-    std::vector <unsigned char> hit2 = hit;
+    AlignedU8 hit2 = hit;
 
     for (long ix = 1; ix < nx - 1; ++ix) {
         if (ix % ntask != rank) continue;
@@ -106,47 +158,12 @@ void cal::mpi_atm_sim::compress_volume()
         }
     }
 
-    hit2.resize(0);
+    hit2.clear();
+    hit2.shrink_to_fit();
 
     if (MPI_Allreduce(MPI_IN_PLACE, hit.data(), (int)nn,
                       MPI_UNSIGNED_CHAR, MPI_LOR, comm)) throw std::runtime_error(
                   "Failed to gather hits");
 
-    if ((rank == 0) && (verbosity > 0)) {
-        std::cerr << "Creating compression table" << std::endl;
-    }
-
-    // Then create the mappings between the compressed and
-    // full indices
-    long i = 0;
-    for (long ifull = 0; ifull < nn; ++ifull) {
-        if (hit[ifull]) {
-            (*full_index)[i] = ifull;
-            (*compressed_index)[ifull] = i;
-            ++i;
-        }
-    }
-
-    hit.resize(0);
-    nelem = i;
-
-    full_index->resize(nelem);
-
-    double t2 = MPI_Wtime();
-
-    if (rank == 0) {
-        std::cout << "Volume compressed in " << t2 - t1
-          << " s." << std::endl
-          << i << " / " << nn
-          << "(" << i * 100. / nn << " %)"
-          << " volume elements are needed for the simulation"
-          << std::endl
-          << "nx = " << nx << " ny = " << ny << " nz = " << nz
-          << std::endl
-          << "wx = " << wx << " wy = " << wy << " wz = " << wz
-          << std::endl;
-    }
-
-    if (nelem == 0)
-        throw std::runtime_error("No elements in the observation cone.");
+    return;
 }
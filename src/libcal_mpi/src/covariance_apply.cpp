@@ -18,6 +18,7 @@
 void cal::mpi_atm_sim::apply_sparse_covariance(cholmod_sparse * sqrt_cov,
                              long ind_start, long ind_stop)
 {
+    cal::ProfileRegion region("apply_sparse_covariance");
     double t1 = MPI_Wtime();
 
     // Number of elements in the slice
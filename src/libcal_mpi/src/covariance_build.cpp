@@ -13,6 +13,7 @@
 */
 cholmod_sparse * cal::mpi_atm_sim::build_sparse_covariance(long ind_start, long ind_stop)
 {
+    cal::ProfileRegion region("build_sparse_covariance");
 
     double t1 = MPI_Wtime();
 
@@ -24,6 +25,11 @@ cholmod_sparse * cal::mpi_atm_sim::build_sparse_covariance(long ind_start, long
     uint64_t nelem = ind_stop - ind_start;
     std::vector <double> diagonal(nelem);
 
+    // Number of retained elements in each column.  Every column is
+    // evaluated by a single thread, so the triplets can be placed in
+    // column-major order regardless of the thread count and schedule.
+    std::vector <uint64_t> colstart(nelem + 1, 0);
+
     // Fill the elements of the covariance matrix.
     # pragma omp parallel
     {
@@ -38,7 +44,7 @@ cholmod_sparse * cal::mpi_atm_sim::build_sparse_covariance(long ind_start, long
             diagonal[i] = cov_eval(coord, coord);
         }
 
-        # pragma omp for schedule(static, 10)
+        # pragma omp for schedule(dynamic, 10)
         for (uint64_t icol = 0; icol < nelem; ++icol) {
             // Translate indices into coordinates
             double colcoord[3];
@@ -64,14 +70,29 @@ cholmod_sparse * cal::mpi_atm_sim::build_sparse_covariance(long ind_start, long
                     myrows.push_back(irow);
                     mycols.push_back(icol);
                     myvals.push_back(val);
+                    ++colstart[icol + 1];
                 }
             }
         }
-        # pragma omp critical
+
+        # pragma omp single
         {
-            rows.insert(rows.end(), myrows.begin(), myrows.end());
-            cols.insert(cols.end(), mycols.begin(), mycols.end());
-            vals.insert(vals.end(), myvals.begin(), myvals.end());
+            for (uint64_t icol = 0; icol < nelem; ++icol) {
+                colstart[icol + 1] += colstart[icol];
+            }
+            rows.resize(colstart[nelem]);
+            cols.resize(colstart[nelem]);
+            vals.resize(colstart[nelem]);
+        }
+
+        // Scatter the thread-local triplets into their columns.  The
+        // column offsets are only advanced by the thread that owns
+        // the column.
+        for (size_t i = 0; i < myvals.size(); ++i) {
+            uint64_t offset = colstart[mycols[i]]++;
+            rows[offset] = myrows[i];
+            cols[offset] = mycols[i];
+            vals[offset] = myvals[i];
         }
     }
 
@@ -16,6 +16,7 @@
 cholmod_sparse * cal::mpi_atm_sim::sqrt_sparse_covariance(cholmod_sparse * cov,
                                         long ind_start, long ind_stop)
 {
+    cal::ProfileRegion region("sqrt_sparse_covariance");
     // Number of elements
     size_t nelem = ind_stop - ind_start;
 
@@ -29,14 +30,20 @@ cholmod_sparse * cal::mpi_atm_sim::sqrt_sparse_covariance(cholmod_sparse * cov,
     cholmod_factor * factorization;
     const int ntry = 4;
     for (int itry = 0; itry < ntry; ++itry) {
-        factorization = cholmod_analyze(cov, chcommon);
+        {
+            cal::ProfileRegion analyze("analyze");
+            factorization = cholmod_analyze(cov, chcommon);
+        }
         if (chcommon->status != CHOLMOD_OK) throw std::runtime_error(
                       "cholmod_analyze failed.");
         if (verbosity > 0) {
             std::cerr << rank
                       << " : Factorizing sparse covariance ... " << std::endl;
         }
-        cholmod_factorize(cov, factorization, chcommon);
+        {
+            cal::ProfileRegion factorize("factorize");
+            cholmod_factorize(cov, factorization, chcommon);
+        }
         if (chcommon->status != CHOLMOD_OK) {
             cholmod_free_factor(&factorization, chcommon);
             if (itry < ntry - 1) {
@@ -98,6 +105,9 @@ cholmod_sparse * cal::mpi_atm_sim::sqrt_sparse_covariance(cholmod_sparse * cov,
     cholmod_sparse * sqrt_cov = cholmod_factor_to_sparse(factorization, chcommon);
     if (chcommon->status != CHOLMOD_OK) throw std::runtime_error(
                   "cholmod_factor_to_sparse failed.");
+
+    // The covariance, the factor and its sparse copy are all held here
+    sample_cholmod_memory();
     cholmod_free_factor(&factorization, chcommon);
 
     // Report memory usage
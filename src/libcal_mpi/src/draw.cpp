@@ -23,6 +23,7 @@
 */
 void cal::mpi_atm_sim::draw()
 {
+    cal::ProfileRegion region("draw");
     // Draw 10 000 gaussian variates to use in the drawing the simulation parameters
     const uint64_t nrand = 10000;
     double randn[nrand];
@@ -13,6 +13,7 @@
 */
 void cal::mpi_atm_sim::initialize_kolmogorov()
 {
+    cal::ProfileRegion region("initialize_kolmogorov");
     MPI_Barrier(comm);
     double t1 = MPI_Wtime();
 
@@ -55,19 +56,14 @@ void cal::mpi_atm_sim::initialize_kolmogorov()
                   << " 1/m. nkappa = " << nkappa << std::endl;
     }
 
-    // Use the Newton's method to integrate the correlation function
-    long nkappa_task = nkappa / ntask + 1;
-    long first_kappa = nkappa_task * rank;
-    long last_kappa = first_kappa + nkappa_task;
-    if (last_kappa > nkappa) last_kappa = nkappa;
-
-    // Precalculate the power spectrum function
-    std::vector <double> phi(last_kappa - first_kappa);
+    // Precalculate the power spectrum function.  Every process needs
+    // the full spectrum since it evaluates complete integrals.
+    std::vector <double> phi(nkappa);
     # pragma omp parallel for schedule(static, 10)
-    for (long ikappa = first_kappa; ikappa < last_kappa; ++ikappa) {
+    for (long ikappa = 0; ikappa < nkappa; ++ikappa) {
         double kappa = ikappa * kappastep;
         double kkl = kappa * invkappal;
-        phi[ikappa - first_kappa] = 
+        phi[ikappa] =
             (1. + 1.802 * kkl - 0.254 * pow(kkl, slope1))
             * exp(-kkl * kkl) * pow(kappa * kappa + kappa0sq, slope2);
     }
@@ -75,7 +71,7 @@ void cal::mpi_atm_sim::initialize_kolmogorov()
     if ((rank == 0) && (verbosity > 0)) {
         std::ofstream f;
         std::ostringstream fname;
-        fname << "kolmogorov_f_" << rank << ".txt";
+        fname << "kolmogorov_f.txt";
         f.open(fname.str(), std::ios::out);
         for (int ikappa = 0; ikappa < nkappa; ++ikappa) {
             f << ikappa * kappastep << " " << phi[ikappa] << std::endl;
@@ -84,8 +80,21 @@ void cal::mpi_atm_sim::initialize_kolmogorov()
     }
 
     // Newton's method factors, not part of the power spectrum
-    if (first_kappa == 0) phi[0] /= 2;
-    if (last_kappa == nkappa) phi[last_kappa - first_kappa - 1] /= 2;
+    phi[0] /= 2;
+    phi[nkappa - 1] /= 2;
+
+    // Distribute the radii across the processes.  Each radius is
+    // integrated over the full kappa range by a single thread, so
+    // the result does not depend on the number of processes or
+    // threads.
+    std::vector <int> nr_task(ntask);
+    std::vector <int> first_r_task(ntask);
+    for (int itask = 0; itask < ntask; ++itask) {
+        first_r_task[itask] = nr * itask / ntask;
+        nr_task[itask] = nr * (itask + 1) / ntask - first_r_task[itask];
+    }
+    long first_r = first_r_task[rank];
+    long last_r = first_r + nr_task[rank];
 
     // Integrate the power spectrum for a spherically symmetric
     // correlation function
@@ -96,37 +105,40 @@ void cal::mpi_atm_sim::initialize_kolmogorov()
 
     # pragma omp parallel for schedule(static, 10)
     for (long ir = 0; ir < nr; ++ir) {
-        double r = rmin_kolmo
-                   + (exp(ir * nri * tau) - 1) * enorm * (rmax_kolmo - rmin_kolmo);
-        double rinv = 1 / r;
+        kolmo_x[ir] = rmin_kolmo
+                      + (exp(ir * nri * tau) - 1) * enorm * (rmax_kolmo - rmin_kolmo);
+    }
+
+    # pragma omp parallel for schedule(dynamic, 1)
+    for (long ir = first_r; ir < last_r; ++ir) {
+        double r = kolmo_x[ir];
         double val = 0;
         if (r * kappamax < 1e-2) {
             // special limit r -> 0,
             // sin(kappa.r)/r -> kappa - kappa^3*r^2/3!
-            for (long ikappa = first_kappa; ikappa < last_kappa - 1; ++ikappa) {
+            for (long ikappa = 0; ikappa < nkappa; ++ikappa) {
                 double kappa = ikappa * kappastep;
                 double kappa2 = kappa * kappa;
                 double kappa4 = kappa2 * kappa2;
                 double r2 = r * r;
 
-                val += phi[ikappa - first_kappa] * (kappa2 - r2 * kappa4 * ifac3);
+                val += phi[ikappa] * (kappa2 - r2 * kappa4 * ifac3);
             }
         } else {
-            for (long ikappa = first_kappa; ikappa < last_kappa - 1; ++ikappa) {
+            for (long ikappa = 0; ikappa < nkappa; ++ikappa) {
                 double kappa = ikappa * kappastep;
-                val += phi[ikappa - first_kappa] * sin(kappa * r) * kappa;
-                
+                val += phi[ikappa] * sin(kappa * r) * kappa;
             }
             val /= r;
         }
         val *= kappastep;
-        kolmo_x[ir] = r;
         kolmo_y[ir] = val;
     }
 
-    if (MPI_Allreduce(MPI_IN_PLACE, kolmo_y.data(), (int)nr,
-                      MPI_DOUBLE, MPI_SUM, comm))
-        throw  std::runtime_error("Failed to allreduce kolmo_y");
+    if (MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
+                       kolmo_y.data(), nr_task.data(), first_r_task.data(),
+                       MPI_DOUBLE, comm))
+        throw  std::runtime_error("Failed to allgather kolmo_y");
 
     // Normalize
     double norm = 1. / kolmo_y[0];
@@ -8,6 +8,7 @@
 #include <fstream>
 
 void cal::mpi_atm_sim::load_realization() {
+    cal::ProfileRegion region("load_realization");
     cached = false;
 
     std::ostringstream name;
@@ -174,10 +175,10 @@ void cal::mpi_atm_sim::load_realization() {
     // Load realization
 
     try {
-        compressed_index = new mpi_shmem_long(nn, comm);
+        compressed_index = new mpi_shmem_long(nn, comm, "compressed_index");
         compressed_index->set(-1);
 
-        full_index = new mpi_shmem_long(nelem, comm);
+        full_index = new mpi_shmem_long(nelem, comm, "full_index");
         full_index->set(-1);
     } catch (...) {
         std::cerr << rank
@@ -186,7 +187,7 @@ void cal::mpi_atm_sim::load_realization() {
         throw;
     }
     try {
-        realization = new mpi_shmem_double(nelem, comm);
+        realization = new mpi_shmem_double(nelem, comm, "realization");
         realization->set(0);
     } catch (...) {
         std::cerr << rank
@@ -247,6 +248,7 @@ void cal::mpi_atm_sim::load_realization() {
 
 
 void cal::mpi_atm_sim::save_realization() {
+    cal::ProfileRegion region("save_realization");
     if (rank == 0) {
         std::ostringstream name;
         name << key1 << "_" << key2 << "_"
@@ -24,6 +24,12 @@ void cal::mpi_init(int argc, char * argv[])
                               &threadprovided);
     }
 
+    // The profile statistics and trace files are labeled by the world
+    // rank, which is unique even when the simulations use split
+    // communicators.
+    ret = MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    cal::Profiler::get().set_rank(rank);
+
     return;
 }
 
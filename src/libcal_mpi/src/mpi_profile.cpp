@@ -0,0 +1,101 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <cal_mpi_internal.hpp>
+
+#include <cstring>
+
+
+namespace {
+// Numbers sent per region: depth, calls, seconds, min, max
+int const PROFILE_NVAL = 5;
+}
+
+/**
+* Gather the thread-merged profile of every process of comm on its rank
+* zero.  The other processes get an empty list.
+*/
+std::vector <cal::ProfileStat> cal::mpi_profile_gather(MPI_Comm comm) {
+    int rank;
+    int ntask;
+    if (MPI_Comm_rank(comm, &rank)) throw std::runtime_error(
+                  "Failed to get rank in MPI communicator.");
+    if (MPI_Comm_size(comm, &ntask)) throw std::runtime_error(
+                  "Failed to get size of MPI communicator.");
+
+    auto local = cal::Profiler::get().stats(false);
+
+    // Paths are sent as one buffer of null-terminated strings
+    std::vector <char> names;
+    std::vector <double> values;
+    for (auto const & st : local) {
+        names.insert(names.end(), st.path.begin(), st.path.end());
+        names.push_back('\0');
+        values.push_back(st.depth);
+        values.push_back(st.calls);
+        values.push_back(st.seconds);
+        values.push_back(st.min);
+        values.push_back(st.max);
+    }
+
+    int counts[2] = {static_cast <int> (names.size()),
+                     static_cast <int> (values.size())};
+    std::vector <int> all_counts(2 * ntask);
+    if (MPI_Gather(counts, 2, MPI_INT, all_counts.data(), 2, MPI_INT, 0,
+                   comm)) {
+        throw std::runtime_error("Failed to gather the profile sizes");
+    }
+
+    std::vector <int> name_counts(ntask);
+    std::vector <int> name_displs(ntask);
+    std::vector <int> value_counts(ntask);
+    std::vector <int> value_displs(ntask);
+    int name_total = 0;
+    int value_total = 0;
+    for (int i = 0; i < ntask; ++i) {
+        name_counts[i] = all_counts[2 * i];
+        value_counts[i] = all_counts[2 * i + 1];
+        name_displs[i] = name_total;
+        value_displs[i] = value_total;
+        name_total += name_counts[i];
+        value_total += value_counts[i];
+    }
+
+    std::vector <char> all_names(rank == 0 ? name_total : 0);
+    std::vector <double> all_values(rank == 0 ? value_total : 0);
+    if (MPI_Gatherv(names.data(), counts[0], MPI_CHAR, all_names.data(),
+                    name_counts.data(), name_displs.data(), MPI_CHAR, 0,
+                    comm)) {
+        throw std::runtime_error("Failed to gather the profile names");
+    }
+    if (MPI_Gatherv(values.data(), counts[1], MPI_DOUBLE, all_values.data(),
+                    value_counts.data(), value_displs.data(), MPI_DOUBLE, 0,
+                    comm)) {
+        throw std::runtime_error("Failed to gather the profile values");
+    }
+
+    std::vector <cal::ProfileStat> ret;
+    if (rank != 0) return ret;
+
+    for (int i = 0; i < ntask; ++i) {
+        char const * name = all_names.data() + name_displs[i];
+        double const * val = all_values.data() + value_displs[i];
+        int nstat = value_counts[i] / PROFILE_NVAL;
+        for (int s = 0; s < nstat; ++s) {
+            cal::ProfileStat st;
+            st.path = std::string(name);
+            name += st.path.size() + 1;
+            st.depth = static_cast <int> (val[0]);
+            st.thread = -1;
+            st.rank = i;
+            st.calls = static_cast <size_t> (val[1]);
+            st.seconds = val[2];
+            st.min = val[3];
+            st.max = val[4];
+            val += PROFILE_NVAL;
+            ret.push_back(st);
+        }
+    }
+    return ret;
+}
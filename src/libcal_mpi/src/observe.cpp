@@ -27,6 +27,7 @@
 int cal::mpi_atm_sim::observe(double * t, double * az, double * el, double * tod,
             long nsamp, double fixed_r)
 {
+    cal::ProfileRegion region("observe");
     if(!cached){
         throw std::runtime_error("There is no cached observation to observe.");
     }
@@ -8,9 +8,13 @@
 #include <iostream>
 #include <cstring>
 
-/** Simulate the atmosphere in indipendent slices, each slice is assigned at one process. */
+/**
+* Simulate the atmosphere in indipendent slices, each slice is assigned at
+* one process.  Returns -1 if the simulation failed.
+*/
 int cal::mpi_atm_sim::simulate(bool use_cache)
 {
+    cal::ProfileRegion region("simulate");
     if (use_cache) load_realization();
 
     if (cached) return 0;
@@ -27,7 +31,7 @@ int cal::mpi_atm_sim::simulate(bool use_cache)
             std::cerr << "Resizing to " << nelem << std::endl;
 
         try {
-            realization = new mpi_shmem_double(nelem, comm);
+            realization = new mpi_shmem_double(nelem, comm, "realization");
             realization->set(0);
         } catch (...) {
             std::cerr << rank
@@ -39,48 +43,98 @@ int cal::mpi_atm_sim::simulate(bool use_cache)
 
         long ind_start = 0, ind_stop = 0, slice = 0;
 
-        // Assign each slice to a process
+        // Assign each slice to a process.  As soon as a slice is
+        // finished its owner posts a nonblocking broadcast so that the
+        // transfer overlaps with the factorization of the next slice.
+        // Every process posts the broadcasts in slice order, which
+        // keeps the collective calls matched across the communicator.
 
-        std::vector <int> slice_starts;
-        std::vector <int> slice_stops;
+        std::vector <long> slice_starts;
+        std::vector <long> slice_stops;
+        std::vector <MPI_Request> requests;
+        std::vector <AlignedF64> buffers;
+        int broadcast = cal::MemoryTracker::get().category("broadcast");
 
-        while(true) {
-            get_slice(ind_start, ind_stop);
-            slice_starts.push_back(ind_start);
-            slice_stops.push_back(ind_stop);
+        double t_compute = 0, t_comm = 0;
 
-            if (slice % ntask == rank) {
-                cholmod_sparse * cov = build_sparse_covariance(ind_start, ind_stop);
-                cholmod_sparse * sqrt_cov = sqrt_sparse_covariance(cov, ind_start, ind_stop);
-                cholmod_free_sparse(&cov, chcommon);
-                apply_sparse_covariance(sqrt_cov,
-                                        ind_start,
-                                        ind_stop);
-                cholmod_free_sparse(&sqrt_cov, chcommon);
+        // A collective broadcast cannot be cancelled, and the buffers of
+        // the pending ones must outlive them.  If a slice fails, the other
+        // processes also wait forever for the broadcast of the failed
+        // slice, so the only safe way out is to abort.
+        try {
+            while(true) {
+                get_slice(ind_start, ind_stop);
+                slice_starts.push_back(ind_start);
+                slice_stops.push_back(ind_stop);
+
+                int nind = ind_stop - ind_start;
+                int root = slice % ntask;
+                buffers.push_back(AlignedF64(nind, 0.0,
+                                             AlignedAllocator <double> (broadcast)));
+
+                if (rank == root) {
+                    double tc1 = MPI_Wtime();
+                    cholmod_sparse * cov = build_sparse_covariance(ind_start, ind_stop);
+                    cholmod_sparse * sqrt_cov = sqrt_sparse_covariance(cov, ind_start, ind_stop);
+                    cholmod_free_sparse(&cov, chcommon);
+                    apply_sparse_covariance(sqrt_cov,
+                                            ind_start,
+                                            ind_stop);
+                    cholmod_free_sparse(&sqrt_cov, chcommon);
+                    sample_cholmod_memory();
+                    t_compute += MPI_Wtime() - tc1;
+
+                    // Send from a private copy: the shared realization may
+                    // be written by the node root while the send is pending.
+                    std::memcpy(buffers.back().data(),
+                                realization->data() + ind_start,
+                                sizeof(double) * nind);
+                }
+
+                double tc2 = MPI_Wtime();
+                MPI_Request request;
+                {
+                    cal::ProfileRegion bcast("broadcast");
+                    if (MPI_Ibcast(buffers.back().data(), nind, MPI_DOUBLE, root,
+                                   comm, &request)) {
+                        throw std::runtime_error(
+                                  "Failed to broadcast the realization");
+                    }
+                }
+                requests.push_back(request);
+                finish_broadcasts(requests, buffers, slice_starts, slice_stops,
+                                  false);
+                t_comm += MPI_Wtime() - tc2;
+
+                counter2 += ind_stop - ind_start;
+
+                if (ind_stop == nelem) break;
+                ++slice;
             }
-            counter2 += ind_stop - ind_start;
-
-            if (ind_stop == nelem) break;
-            ++slice;
-        }
 
-        for (size_t slice = 0; slice < slice_starts.size(); ++slice) {
-            ind_start = slice_starts[slice];
-            ind_stop = slice_stops[slice];
-            int nind = ind_stop - ind_start;
-            int root = slice % ntask;
-            std::vector <double> tempvec(nind);
-            if (rank == root) {
-                std::memcpy(tempvec.data(), realization->data() + ind_start,
-                            sizeof(double) * nind);
+            double tc3 = MPI_Wtime();
+            finish_broadcasts(requests, buffers, slice_starts, slice_stops, true);
+            t_comm += MPI_Wtime() - tc3;
+        } catch (const std::exception & e) {
+            bool pending = (ntask > 1);
+            for (auto const & request : requests) {
+                if (request != MPI_REQUEST_NULL) pending = true;
             }
-            if (MPI_Bcast(tempvec.data(), nind, MPI_DOUBLE, root, comm)) {
-                throw std::runtime_error("Failed to broadcast the realization");
-            }
-            if (realization->rank() == 0) {
-                std::memcpy(realization->data() + ind_start, tempvec.data(),
-                            sizeof(double) * nind);
+            if (pending) {
+                auto here = cal_HERE();
+                auto log = cal::Logger::get();
+                std::string msg = std::string("Simulation failed with "
+                                              "pending broadcasts: ")
+                                  + e.what();
+                log.error(msg.c_str(), here);
+                MPI_Abort(comm, 1);
             }
+            throw;
+        }
+
+        if (verbosity > 0) {
+            std::cerr << rank << " : Realization compute " << t_compute
+                      << " s, communication " << t_comm << " s." << std::endl;
         }
 
         //smooth();
@@ -93,9 +147,22 @@ int cal::mpi_atm_sim::simulate(bool use_cache)
             std::cerr << "Realization constructed in " << t2 - t1 << " s."
                       << std::endl;
         }
+
+        if (verbosity > 0) {
+            double times[2] = {t_compute, t_comm};
+            double max_times[2];
+            MPI_Reduce(times, max_times, 2, MPI_DOUBLE, MPI_MAX, 0, comm);
+            if (rank == 0) {
+                std::cerr << "Maximum compute time " << max_times[0]
+                          << " s, maximum communication time " << max_times[1]
+                          << " s." << std::endl;
+            }
+        }
     } catch (const std::exception & e) {
+        // Leave nothing to observe or to cache
         std::cerr << "WARNING: atm::simulate failed with: " << e.what()
                   << std::endl;
+        return -1;
     }
     cached = true;
 
@@ -103,3 +170,54 @@ int cal::mpi_atm_sim::simulate(bool use_cache)
 
     return 0;
 }
+
+
+/**
+* Complete the pending slice broadcasts.  Finished slices are copied
+* into the shared realization by the node root and their buffers are
+* released.  If wait is false, only already completed requests are
+* processed.
+*/
+void cal::mpi_atm_sim::finish_broadcasts(std::vector <MPI_Request> & requests,
+                                         std::vector <AlignedF64> & buffers,
+                                         std::vector <long> const & slice_starts,
+                                         std::vector <long> const & slice_stops,
+                                         bool wait)
+{
+    cal::ProfileRegion region("finish_broadcasts");
+    int nreq = requests.size();
+    std::vector <int> indices(nreq);
+    int ndone = 0;
+    int ret;
+
+    if (wait) {
+        ret = MPI_Waitsome(nreq, requests.data(), &ndone, indices.data(),
+                           MPI_STATUSES_IGNORE);
+    } else {
+        ret = MPI_Testsome(nreq, requests.data(), &ndone, indices.data(),
+                           MPI_STATUSES_IGNORE);
+    }
+    if (ret != MPI_SUCCESS) {
+        throw std::runtime_error("Failed to complete the realization broadcast");
+    }
+
+    while (ndone != MPI_UNDEFINED) {
+        for (int i = 0; i < ndone; ++i) {
+            long slice = indices[i];
+            if (realization->rank() == 0) {
+                std::memcpy(realization->data() + slice_starts[slice],
+                            buffers[slice].data(),
+                            sizeof(double) * (slice_stops[slice] - slice_starts[slice]));
+            }
+            AlignedF64().swap(buffers[slice]);
+        }
+        if (!wait) break;
+        ret = MPI_Waitsome(nreq, requests.data(), &ndone, indices.data(),
+                           MPI_STATUSES_IGNORE);
+        if (ret != MPI_SUCCESS) {
+            throw std::runtime_error("Failed to complete the realization broadcast");
+        }
+    }
+
+    return;
+}
@@ -33,6 +33,7 @@ double mean(std::vector <double> vec) {
 */
 void cal::mpi_atm_sim::smooth()
 {
+    cal::ProfileRegion region("smooth");
     double t1 = MPI_Wtime();
 
     double coord[3];
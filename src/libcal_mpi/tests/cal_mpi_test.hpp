@@ -24,4 +24,24 @@ class MPICALShmemTest : public testing::Test {
 };
 
 
+class MPICALAtmTest : public testing::Test {
+    public:
+
+        MPICALAtmTest() {}
+
+        ~MPICALAtmTest() {}
+
+        virtual void SetUp();
+
+        virtual void TearDown() {}
+
+        void simulate_observe(MPI_Comm comm, std::vector <double> & tod);
+
+        static const int64_t nsamp;
+        std::vector <double> t;
+        std::vector <double> az;
+        std::vector <double> el;
+};
+
+
 #endif // ifndef CAL_MPI_TEST_TEST_HPP
@@ -0,0 +1,49 @@
+// Copyright (c) 2015-2020 by the parties listed in the AUTHORS file.
+// All rights reserved.  Use of this source code is governed by
+// a BSD-style license that can be found in the LICENSE file.
+
+#include <cmath>
+
+const int64_t MPICALAtmTest::nsamp = 1000;
+
+void MPICALAtmTest::SetUp() {
+    t.resize(nsamp);
+    az.resize(nsamp);
+    el.resize(nsamp);
+
+    // A short constant elevation scan back and forth across the patch
+    for (int64_t i = 0; i < nsamp; ++i) {
+        t[i] = 0.1 * i;
+        az[i] = 0.05 * sin(2 * cal::PI * t[i] / 20.0);
+        el[i] = 1.0;
+    }
+}
+
+void MPICALAtmTest::simulate_observe(MPI_Comm comm,
+                                     std::vector <double> & tod) {
+    cal::mpi_atm_sim sim(-0.06, 0.06, 0.95, 1.05, 0, t[nsamp - 1],
+                         .01, 0, 10, 0, 10, 0, 0, 0, 1000, 0, 280, 0,
+                         40000, 1000, 100, 100, 100, 1000, 0, comm,
+                         123, 456, 789, 1011, std::string(), 0, 2000);
+    sim.simulate(false);
+
+    tod.assign(nsamp, 0);
+    sim.observe(t.data(), az.data(), el.data(), tod.data(), nsamp);
+}
+
+TEST_F(MPICALAtmTest, reprod_ranks) {
+    // The realization must be bitwise identical whether the slices
+    // are distributed over all processes or simulated by one.
+    std::vector <double> tod_world;
+    std::vector <double> tod_self;
+
+    simulate_observe(MPI_COMM_WORLD, tod_world);
+    simulate_observe(MPI_COMM_SELF, tod_self);
+
+    double rms = 0;
+    for (int64_t i = 0; i < nsamp; ++i) {
+        rms += tod_world[i] * tod_world[i];
+        EXPECT_EQ(tod_world[i], tod_self[i]);
+    }
+    ASSERT_GT(rms, 0);
+}
@@ -5,6 +5,47 @@
 
 #include <_libcal_atm.hpp>
 
+#ifdef HAVE_AATM
+
+// Concatenate lists of bandpass frequencies and weights
+void pack_bandpasses(py::list freqs, py::list weights,
+                     std::vector <size_t> & offsets, std::vector <double> & freq,
+                     std::vector <double> & weight) {
+    if (freqs.size() != weights.size()) {
+        auto log = cal::Logger::get();
+        std::ostringstream o;
+        o << "Number of bandpass frequencies and weights do not match";
+        log.error(o.str().c_str());
+        throw std::runtime_error(o.str().c_str());
+    }
+    offsets.assign(1, 0);
+    freq.clear();
+    weight.clear();
+    for (size_t b = 0; b < freqs.size(); ++b) {
+        py::buffer bfreq = freqs[b].cast <py::buffer> ();
+        py::buffer bweight = weights[b].cast <py::buffer> ();
+        pybuffer_check_1D <double> (bfreq);
+        pybuffer_check_1D <double> (bweight);
+        py::buffer_info info_freq = bfreq.request();
+        py::buffer_info info_weight = bweight.request();
+        if (info_freq.size != info_weight.size) {
+            auto log = cal::Logger::get();
+            std::ostringstream o;
+            o << "Bandpass " << b << " frequencies and weights differ in size";
+            log.error(o.str().c_str());
+            throw std::runtime_error(o.str().c_str());
+        }
+        double * rawfreq = reinterpret_cast <double *> (info_freq.ptr);
+        double * rawweight = reinterpret_cast <double *> (info_weight.ptr);
+        freq.insert(freq.end(), rawfreq, rawfreq + info_freq.size);
+        weight.insert(weight.end(), rawweight, rawweight + info_weight.size);
+        offsets.push_back(freq.size());
+    }
+    return;
+}
+
+#endif // ifdef HAVE_AATM
+
 void init_atm(py::module & m) {
 #ifdef HAVE_AATM
     m.def("atm_absorption_coefficient", &cal::atm_get_absorption_coefficient,
@@ -101,8 +142,320 @@ void init_atm(py::module & m) {
                 (array):  The temperatures at the specified frequencies.
 
     )");
+
+    py::class_ <cal::AtmSpectrum, cal::AtmSpectrum::puniq> (
+        m, "AtmSpectrum",
+        R"(
+        Reusable radiative transfer model for one atmospheric state.
+
+        The atmospheric profile is built once and the refractive index profile
+        once per frequency grid.  Sweeps over the PWV and repeated queries on
+        the same frequency grids do not rebuild the model.
+
+        Args:
+            altitude (float):  The observing altitude in meters.
+            temperature (float):  The observing temperature in Kelvin.
+            pressure (float):  The observing pressure in Pascals.
+
+        )")
+    .def(py::init <double, double, double> (), py::arg("altitude"),
+         py::arg("temperature"), py::arg("pressure"))
+    .def("set_state", &cal::AtmSpectrum::set_state, py::arg("altitude"),
+         py::arg("temperature"), py::arg("pressure"), R"(
+        Change the atmospheric state.
+
+        The cached model is kept if the state is unchanged.
+
+    )")
+    .def("evaluate", [](cal::AtmSpectrum & self, py::buffer pwv,
+                        double freqmin, double freqmax, size_t nfreq) {
+             pybuffer_check_1D <double> (pwv);
+             py::buffer_info info_pwv = pwv.request();
+             size_t npwv = info_pwv.size;
+             double * rawpwv = reinterpret_cast <double *> (info_pwv.ptr);
+             py::array_t <double> absorption;
+             absorption.resize({npwv, nfreq});
+             py::array_t <double> loading;
+             loading.resize({npwv, nfreq});
+             py::buffer_info info_abs = absorption.request();
+             py::buffer_info info_load = loading.request();
+             self.evaluate(npwv, rawpwv, freqmin, freqmax, nfreq,
+                           static_cast <double *> (info_abs.ptr),
+                           static_cast <double *> (info_load.ptr));
+             return py::make_tuple(absorption, loading);
+         }, py::arg("pwv"), py::arg("freqmin"), py::arg("freqmax"),
+         py::arg("nfreq"), R"(
+        Compute the absorption and loading for many PWV values.
+
+        Args:
+            pwv (array):  The precipitable water vapor values in mm.
+            freqmin (float):  Minimum observing frequency in GHz.
+            freqmax (float):  Maximum observing frequency in GHz.
+            nfreq (int):  Number of frequency points to compute.
+
+        Returns:
+            (tuple):  The absorption coefficients and the equivalent
+                blackbody temperatures, each of shape (len(pwv), nfreq).
+
+    )")
+    .def("band_average", [](cal::AtmSpectrum & self, py::buffer pwv,
+                            py::list freqs, py::list weights) {
+             pybuffer_check_1D <double> (pwv);
+             py::buffer_info info_pwv = pwv.request();
+             size_t npwv = info_pwv.size;
+             double * rawpwv = reinterpret_cast <double *> (info_pwv.ptr);
+             std::vector <size_t> offsets;
+             std::vector <double> freq;
+             std::vector <double> weight;
+             pack_bandpasses(freqs, weights, offsets, freq, weight);
+             size_t nband = offsets.size() - 1;
+             py::array_t <double> absorption;
+             absorption.resize({npwv, nband});
+             py::array_t <double> loading;
+             loading.resize({npwv, nband});
+             py::buffer_info info_abs = absorption.request();
+             py::buffer_info info_load = loading.request();
+             self.band_average(npwv, rawpwv, nband, offsets.data(),
+                               freq.data(), weight.data(),
+                               static_cast <double *> (info_abs.ptr),
+                               static_cast <double *> (info_load.ptr));
+             return py::make_tuple(absorption, loading);
+         }, py::arg("pwv"), py::arg("freqs"), py::arg("weights"), R"(
+        Compute band-averaged absorption and loading for many PWV values.
+
+        The spectrum of every bandpass is evaluated on its own regular grid
+        covering its frequencies and linearly interpolated between the grid
+        nodes.  The responses are integrated with the trapezoidal rule.
+
+        Args:
+            pwv (array):  The precipitable water vapor values in mm.
+            freqs (list):  Increasing frequencies in GHz of each bandpass.
+            weights (list):  Response of each bandpass at its frequencies.
+
+        Returns:
+            (tuple):  The band-averaged absorption coefficients and
+                equivalent blackbody temperatures, each of shape
+                (len(pwv), len(freqs)).
+
+    )");
+
+    m.def("atm_band_averages", [](double altitude, double temperature,
+                                  double pressure, double pwv,
+                                  py::list freqs, py::list weights) {
+              std::vector <size_t> offsets;
+              std::vector <double> freq;
+              std::vector <double> weight;
+              pack_bandpasses(freqs, weights, offsets, freq, weight);
+              size_t nband = offsets.size() - 1;
+              py::array_t <double> absorption;
+              absorption.resize({nband});
+              py::array_t <double> loading;
+              loading.resize({nband});
+              py::buffer_info info_abs = absorption.request();
+              py::buffer_info info_load = loading.request();
+              cal::atm_get_band_averages(
+                  altitude, temperature, pressure, pwv, nband, offsets.data(),
+                  freq.data(), weight.data(),
+                  static_cast <double *> (info_abs.ptr),
+                  static_cast <double *> (info_load.ptr));
+              return py::make_tuple(absorption, loading);
+          }, py::arg("altitude"), py::arg("temperature"), py::arg("pressure"),
+          py::arg("pwv"), py::arg("freqs"), py::arg("weights"), R"(
+            Compute band-averaged absorption and loading of many bandpasses.
+
+            Args:
+                altitude (float):  The observing altitude in meters.
+                temperature (float):  The observing temperature in Kelvin.
+                pressure (float):  The observing pressure in Pascals.
+                pwv (float):  The precipitable water vapor in mm.
+                freqs (list):  Increasing frequencies in GHz of each bandpass.
+                weights (list):  Response of each bandpass at its frequencies.
+
+            Returns:
+                (tuple):  The band-averaged absorption coefficients and
+                    equivalent blackbody temperatures of each bandpass.
+
+    )");
+
+    m.def("atm_absorption_loading_batch", [](py::buffer altitude,
+                                             py::buffer temperature,
+                                             py::buffer pressure,
+                                             py::buffer pwv, double freq) {
+              pybuffer_check_1D <double> (altitude);
+              pybuffer_check_1D <double> (temperature);
+              pybuffer_check_1D <double> (pressure);
+              pybuffer_check_1D <double> (pwv);
+              py::buffer_info info_alt = altitude.request();
+              py::buffer_info info_temp = temperature.request();
+              py::buffer_info info_pres = pressure.request();
+              py::buffer_info info_pwv = pwv.request();
+              size_t n = info_alt.size;
+              if ((info_temp.size != n) || (info_pres.size != n)
+                  || (info_pwv.size != n)) {
+                  auto log = cal::Logger::get();
+                  std::ostringstream o;
+                  o << "Atmospheric state buffers have inconsistent sizes";
+                  log.error(o.str().c_str());
+                  throw std::runtime_error(o.str().c_str());
+              }
+              double * rawalt = reinterpret_cast <double *> (info_alt.ptr);
+              double * rawtemp = reinterpret_cast <double *> (info_temp.ptr);
+              double * rawpres = reinterpret_cast <double *> (info_pres.ptr);
+              double * rawpwv = reinterpret_cast <double *> (info_pwv.ptr);
+              py::array_t <double> absorption;
+              absorption.resize({n});
+              py::array_t <double> loading;
+              loading.resize({n});
+              py::buffer_info info_abs = absorption.request();
+              py::buffer_info info_load = loading.request();
+              double * rawabs = static_cast <double *> (info_abs.ptr);
+              double * rawload = static_cast <double *> (info_load.ptr);
+              {
+                  // Only raw buffers are touched while the threads run
+                  py::gil_scoped_release release;
+                  cal::atm_get_absorption_loading_batch(
+                      n, rawalt, rawtemp, rawpres, rawpwv, freq, rawabs,
+                      rawload);
+              }
+              return py::make_tuple(absorption, loading);
+          }, py::arg("altitude"), py::arg("temperature"), py::arg("pressure"),
+          py::arg("pwv"), py::arg("freq"), R"(
+            Compute the absorption and loading of many atmospheric states.
+
+            The states are evaluated in parallel with OpenMP and the GIL is
+            released during the computation.
+
+            Args:
+                altitude (array):  The observing altitudes in meters.
+                temperature (array):  The observing temperatures in Kelvin.
+                pressure (array):  The observing pressures in Pascals.
+                pwv (array):  The precipitable water vapor values in mm.
+                freq (float):  Observing frequency in GHz.
+
+            Returns:
+                (tuple):  The absorption coefficients and the equivalent
+                    blackbody temperatures of each state.
+
+    )");
 #endif // ifdef HAVE_AATM
 
+    // The table engine does not require libaatm to load and interpolate a
+    // table saved by a build that had it.
+    py::class_ <cal::AtmTable, cal::AtmTable::puniq> (
+        m, "AtmTable",
+        R"(
+        Absorption and loading tabulated on a regular grid.
+
+        The absorption coefficient and the equivalent blackbody temperature
+        are evaluated once on a regular (altitude, temperature, pressure, pwv,
+        freq) grid and queries are answered by multilinear interpolation.  An
+        axis with a single node is constant.
+
+        Args:
+            altmin, altmax, nalt:  Altitude grid in meters.
+            Tmin, Tmax, nT:  Temperature grid in Kelvin.
+            Pmin, Pmax, nP:  Pressure grid in Pascals.
+            pwvmin, pwvmax, npwv:  PWV grid in mm.
+            freqmin, freqmax, nfreq:  Frequency grid in GHz.
+
+        )")
+    .def(py::init <double, double, size_t, double, double, size_t, double,
+                   double, size_t, double, double, size_t, double, double,
+                   size_t> (),
+         py::arg("altmin"), py::arg("altmax"), py::arg("nalt"),
+         py::arg("Tmin"), py::arg("Tmax"), py::arg("nT"),
+         py::arg("Pmin"), py::arg("Pmax"), py::arg("nP"),
+         py::arg("pwvmin"), py::arg("pwvmax"), py::arg("npwv"),
+         py::arg("freqmin"), py::arg("freqmax"), py::arg("nfreq"))
+    .def("build", [](cal::AtmTable & self, double tol, int max_refine) {
+             return self.build(tol, max_refine);
+         }, py::arg("tol") = 1e-3, py::arg("max_refine") = 3, R"(
+        Evaluate the table with libaatm.
+
+        Axes whose interpolation error at the node midpoints exceeds the
+        relative tolerance are refined by halving the node spacing.
+
+        Args:
+            tol (float):  Relative tolerance, <= 0 disables the check.
+            max_refine (int):  Maximum number of refinements.
+
+        Returns:
+            (float):  The largest relative error found.
+
+    )")
+    .def("load_or_build", [](cal::AtmTable & self, std::string cachedir,
+                             double tol, int max_refine) {
+             self.load_or_build(cachedir, tol, max_refine);
+             return;
+         }, py::arg("cachedir"), py::arg("tol") = 1e-3,
+         py::arg("max_refine") = 3, R"(
+        Load the table from cachedir or build it and save it there.
+
+        Args:
+            cachedir (str):  The cache directory.  Empty string only builds.
+            tol (float):  Relative tolerance.
+            max_refine (int):  Maximum number of refinements.
+
+        Returns:
+            None
+
+    )")
+    .def("cache_name", &cal::AtmTable::cache_name, py::arg("tol"), R"(
+        File name of the table in the cache directory.
+    )")
+    .def("save", &cal::AtmTable::save, py::arg("path"), R"(
+        Save the table to a file.
+    )")
+    .def("load", &cal::AtmTable::load, py::arg("path"), R"(
+        Load the table from a file.
+
+        Returns:
+            (bool):  False if the file does not hold a table for this grid.
+
+    )")
+    .def("built", &cal::AtmTable::built)
+    .def("absorption", &cal::AtmTable::absorption, py::arg("altitude"),
+         py::arg("temperature"), py::arg("pressure"), py::arg("pwv"),
+         py::arg("freq"), R"(
+        Interpolate the absorption coefficient.
+    )")
+    .def("loading", &cal::AtmTable::loading, py::arg("altitude"),
+         py::arg("temperature"), py::arg("pressure"), py::arg("pwv"),
+         py::arg("freq"), R"(
+        Interpolate the equivalent blackbody temperature in Kelvin.
+    )")
+    .def("absorption_vec", [](cal::AtmTable const & self, double altitude,
+                              double temperature, double pressure, double pwv,
+                              double freqmin, double freqmax, size_t nfreq) {
+             py::array_t <double> ret;
+             ret.resize({nfreq});
+             py::buffer_info info = ret.request();
+             double * raw = static_cast <double *> (info.ptr);
+             self.absorption_vec(altitude, temperature, pressure, pwv,
+                                 freqmin, freqmax, nfreq, raw);
+             return ret;
+         }, py::arg("altitude"), py::arg("temperature"), py::arg("pressure"),
+         py::arg("pwv"), py::arg("freqmin"), py::arg("freqmax"),
+         py::arg("nfreq"), R"(
+        Interpolate the absorption coefficients at nfreq frequencies.
+    )")
+    .def("loading_vec", [](cal::AtmTable const & self, double altitude,
+                           double temperature, double pressure, double pwv,
+                           double freqmin, double freqmax, size_t nfreq) {
+             py::array_t <double> ret;
+             ret.resize({nfreq});
+             py::buffer_info info = ret.request();
+             double * raw = static_cast <double *> (info.ptr);
+             self.loading_vec(altitude, temperature, pressure, pwv,
+                              freqmin, freqmax, nfreq, raw);
+             return ret;
+         }, py::arg("altitude"), py::arg("temperature"), py::arg("pressure"),
+         py::arg("pwv"), py::arg("freqmin"), py::arg("freqmax"),
+         py::arg("nfreq"), R"(
+        Interpolate the equivalent blackbody temperatures at nfreq
+        frequencies.
+    )");
+
 #ifdef HAVE_CHOLMOD
     py::class_ <cal::atm_sim, cal::atm_sim::puniq> (
         m, "AtmSim",
@@ -183,6 +536,25 @@ void init_atm(py::module & m) {
         py::arg("counterval2"), py::arg("cachedir"), py::arg("rmin"),
         py::arg("rmax")
         )
+    .def("estimate_memory",
+         [](cal::atm_sim & self) {
+             return memory_stats_list(self.estimate_memory());
+         },
+         R"(
+            Predict the memory used by simulate() without simulating.
+
+            The parameters are drawn and the observed volume is found as in
+            simulate(), then the random number counters are restored so
+            that the simulation is unchanged.  The CHOLMOD memory is
+            estimated from the covariance pattern of the largest slice and
+            the size of its factor predicted by the symbolic analysis.
+
+            Returns:
+                (list):  A dictionary per category with the predicted
+                    "peak" in bytes (see MemoryTracker.stats).  The last
+                    entry, "total", is the predicted peak of the process.
+
+        )")
     .def("simulate", &cal::atm_sim::simulate, py::arg(
              "use_cache"), R"(
         Perform the simulation.
@@ -115,6 +115,27 @@ void init_mpi_atm(py::module & m) {
         py::arg("counterval2"), py::arg("cachedir"), py::arg("rmin"),
         py::arg("rmax")
         )
+    .def("estimate_memory",
+         [](cal::mpi_atm_sim & self) {
+             return memory_stats_list(self.estimate_memory());
+         },
+         R"(
+            Predict the memory used by simulate() without simulating.
+
+            The parameters are drawn and the observed volume is found as in
+            simulate(), then the random number counters are restored so
+            that the simulation is unchanged.  The CHOLMOD memory is
+            estimated from the covariance pattern of the largest slice and
+            the size of its factor predicted by the symbolic analysis.
+            Collective over the communicator.  The shared arrays count the
+            segment of this process.
+
+            Returns:
+                (list):  A dictionary per category with the predicted
+                    "peak" in bytes (see MemoryTracker.stats).  The last
+                    entry, "total", is the predicted peak of the process.
+
+        )")
     .def("simulate", &cal::mpi_atm_sim::simulate, py::arg(
              "use_cache"), R"(
         Perform the simulation.
@@ -183,6 +204,26 @@ void init_mpi_atm(py::module & m) {
              return o.str();
          });
 #endif // ifdef HAVE_CHOLMOD
+
+    m.def("profile_gather", [](py::object & pycomm) {
+              MPI_Comm comm = cal_mpi_extract_comm(pycomm);
+              auto stats = cal::mpi_profile_gather(comm);
+              MPI_Comm_free(&comm);
+              return profile_stats_list(stats);
+          }, py::arg("comm"), R"(
+            Gather the region profile of every process.
+
+            Collective over the communicator.
+
+            Args:
+                comm (mpi4py.MPI.Comm):  The MPI communicator.
+
+            Returns:
+                (list):  On rank zero, the statistics of every process
+                    accumulated over threads (see Profiler.stats).  An empty
+                    list on the other processes.
+
+    )");
     return;
 }
 
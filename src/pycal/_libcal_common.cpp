@@ -57,3 +57,33 @@ template <>
 std::vector <char> align_format <double> () {
     return std::vector <char> ({'d'});
 }
+
+py::list profile_stats_list(std::vector <cal::ProfileStat> const & stats) {
+    py::list ret;
+    for (auto const & st : stats) {
+        py::dict d;
+        d["path"] = st.path;
+        d["depth"] = st.depth;
+        d["thread"] = st.thread;
+        d["rank"] = st.rank;
+        d["calls"] = st.calls;
+        d["seconds"] = st.seconds;
+        d["min"] = st.min;
+        d["max"] = st.max;
+        ret.append(d);
+    }
+    return ret;
+}
+
+py::list memory_stats_list(std::vector <cal::MemoryStat> const & stats) {
+    py::list ret;
+    for (auto const & st : stats) {
+        py::dict d;
+        d["category"] = st.category;
+        d["current"] = st.current;
+        d["peak"] = st.peak;
+        d["allocs"] = st.allocs;
+        ret.append(d);
+    }
+    return ret;
+}
@@ -101,4 +101,10 @@ std::unique_ptr <C> aligned_uptr(size_t n) {
     return std::unique_ptr <C> (new C(n));
 }
 
+// Statistics of the region profiler as a list of dictionaries
+py::list profile_stats_list(std::vector <cal::ProfileStat> const & stats);
+
+// Memory statistics as a list of dictionaries
+py::list memory_stats_list(std::vector <cal::MemoryStat> const & stats);
+
 #endif // ifndef LIBCAL_COMMON_HPP
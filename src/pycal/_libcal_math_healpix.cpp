@@ -340,6 +340,162 @@ void init_math_healpix(py::module & m) {
             Returns:
                 None.
 
+        )")
+    .def("nest2ang", [](cal::HealpixPixels & self, py::buffer pix,
+                        py::buffer theta, py::buffer phi) {
+             pybuffer_check_1D <int64_t> (pix);
+             pybuffer_check_1D <double> (theta);
+             pybuffer_check_1D <double> (phi);
+             py::buffer_info info_pix = pix.request();
+             py::buffer_info info_theta = theta.request();
+             py::buffer_info info_phi = phi.request();
+             if ((info_theta.size != info_phi.size) ||
+                 (info_theta.size != info_pix.size)) {
+                 auto log = cal::Logger::get();
+                 std::ostringstream o;
+                 o << "Buffer sizes are not consistent.";
+                 log.error(o.str().c_str());
+                 throw std::runtime_error(o.str().c_str());
+             }
+             int64_t * rawpix = reinterpret_cast <int64_t *> (info_pix.ptr);
+             double * rawtheta = reinterpret_cast <double *> (info_theta.ptr);
+             double * rawphi = reinterpret_cast <double *> (info_phi.ptr);
+             self.nest2ang(info_pix.size, rawpix, rawtheta, rawphi);
+             return;
+         }, py::arg("pix"), py::arg("theta"), py::arg(
+             "phi"), R"(
+            Convert NESTED ordered pixels to the spherical coordinates of their
+            centers.
+
+            The theta angle is measured down from the North pole and phi is
+            measured from the prime meridian.
+
+            The results are stored in the output buffers.  To guarantee SIMD
+            vectorization, the input and output arrays should be aligned
+            (i.e. use AlignedF64 / AlignedI64).
+
+            Args:
+                pix (array_like): Input pixel indices.
+                theta (array_like): Output spherical coordinate theta angles
+                    in radians.
+                phi (array like): Output spherical coordinate phi angles in
+                    radians.
+
+            Returns:
+                None.
+
+        )")
+    .def("ring2ang", [](cal::HealpixPixels & self, py::buffer pix,
+                        py::buffer theta, py::buffer phi) {
+             pybuffer_check_1D <int64_t> (pix);
+             pybuffer_check_1D <double> (theta);
+             pybuffer_check_1D <double> (phi);
+             py::buffer_info info_pix = pix.request();
+             py::buffer_info info_theta = theta.request();
+             py::buffer_info info_phi = phi.request();
+             if ((info_theta.size != info_phi.size) ||
+                 (info_theta.size != info_pix.size)) {
+                 auto log = cal::Logger::get();
+                 std::ostringstream o;
+                 o << "Buffer sizes are not consistent.";
+                 log.error(o.str().c_str());
+                 throw std::runtime_error(o.str().c_str());
+             }
+             int64_t * rawpix = reinterpret_cast <int64_t *> (info_pix.ptr);
+             double * rawtheta = reinterpret_cast <double *> (info_theta.ptr);
+             double * rawphi = reinterpret_cast <double *> (info_phi.ptr);
+             self.ring2ang(info_pix.size, rawpix, rawtheta, rawphi);
+             return;
+         }, py::arg("pix"), py::arg("theta"), py::arg(
+             "phi"), R"(
+            Convert RING ordered pixels to the spherical coordinates of their
+            centers.
+
+            The theta angle is measured down from the North pole and phi is
+            measured from the prime meridian.
+
+            The results are stored in the output buffers.  To guarantee SIMD
+            vectorization, the input and output arrays should be aligned
+            (i.e. use AlignedF64 / AlignedI64).
+
+            Args:
+                pix (array_like): Input pixel indices.
+                theta (array_like): Output spherical coordinate theta angles
+                    in radians.
+                phi (array like): Output spherical coordinate phi angles in
+                    radians.
+
+            Returns:
+                None.
+
+        )")
+    .def("nest2vec", [](cal::HealpixPixels & self, py::buffer pix,
+                        py::buffer vec) {
+             pybuffer_check_1D <int64_t> (pix);
+             pybuffer_check_1D <double> (vec);
+             py::buffer_info info_pix = pix.request();
+             py::buffer_info info_vec = vec.request();
+             size_t nvec = (size_t)(info_vec.size / 3);
+             if (nvec != info_pix.size) {
+                 auto log = cal::Logger::get();
+                 std::ostringstream o;
+                 o << "Buffer sizes are not consistent.";
+                 log.error(o.str().c_str());
+                 throw std::runtime_error(o.str().c_str());
+             }
+             int64_t * rawpix = reinterpret_cast <int64_t *> (info_pix.ptr);
+             double * rawvec = reinterpret_cast <double *> (info_vec.ptr);
+             self.nest2vec(nvec, rawpix, rawvec);
+             return;
+         }, py::arg("pix"), py::arg(
+             "vec"), R"(
+            Convert NESTED ordered pixels to the unit vectors of their centers.
+
+            The results are stored in the output buffer.  To guarantee SIMD
+            vectorization, the input and output arrays should be aligned
+            (i.e. use AlignedF64 / AlignedI64).
+
+            Args:
+                pix (array_like): Input pixel indices.
+                vec (array_like): Output packed unit vectors.
+
+            Returns:
+                None.
+
+        )")
+    .def("ring2vec", [](cal::HealpixPixels & self, py::buffer pix,
+                        py::buffer vec) {
+             pybuffer_check_1D <int64_t> (pix);
+             pybuffer_check_1D <double> (vec);
+             py::buffer_info info_pix = pix.request();
+             py::buffer_info info_vec = vec.request();
+             size_t nvec = (size_t)(info_vec.size / 3);
+             if (nvec != info_pix.size) {
+                 auto log = cal::Logger::get();
+                 std::ostringstream o;
+                 o << "Buffer sizes are not consistent.";
+                 log.error(o.str().c_str());
+                 throw std::runtime_error(o.str().c_str());
+             }
+             int64_t * rawpix = reinterpret_cast <int64_t *> (info_pix.ptr);
+             double * rawvec = reinterpret_cast <double *> (info_vec.ptr);
+             self.ring2vec(nvec, rawpix, rawvec);
+             return;
+         }, py::arg("pix"), py::arg(
+             "vec"), R"(
+            Convert RING ordered pixels to the unit vectors of their centers.
+
+            The results are stored in the output buffer.  To guarantee SIMD
+            vectorization, the input and output arrays should be aligned
+            (i.e. use AlignedF64 / AlignedI64).
+
+            Args:
+                pix (array_like): Input pixel indices.
+                vec (array_like): Output packed unit vectors.
+
+            Returns:
+                None.
+
         )")
     .def("ring2nest", [](cal::HealpixPixels & self, py::buffer in,
                          py::buffer out) {
@@ -556,6 +712,144 @@ void init_math_healpix(py::module & m) {
             Returns:
                 None.
 
+        )")
+    .def("neighbours_nest", [](cal::HealpixPixels & self, py::buffer pix,
+                               py::buffer neighbours) {
+             pybuffer_check_1D <int64_t> (pix);
+             pybuffer_check_1D <int64_t> (neighbours);
+             py::buffer_info info_pix = pix.request();
+             py::buffer_info info_nb = neighbours.request();
+             if (info_nb.size != 8 * info_pix.size) {
+                 auto log = cal::Logger::get();
+                 std::ostringstream o;
+                 o << "Buffer sizes are not consistent.";
+                 log.error(o.str().c_str());
+                 throw std::runtime_error(o.str().c_str());
+             }
+             int64_t * rawpix = reinterpret_cast <int64_t *> (info_pix.ptr);
+             int64_t * rawnb = reinterpret_cast <int64_t *> (info_nb.ptr);
+             self.neighbours_nest(info_pix.size, rawpix, rawnb);
+             return;
+         }, py::arg("pix"), py::arg(
+             "neighbours"), R"(
+            Find the 8 neighbours of NESTED ordered pixels.
+
+            The neighbours of each pixel are in the order SW, W, NW, N, NE,
+            E, SE and S.  Missing neighbours are -1.
+
+            Args:
+                pix (array_like): Input pixel indices.
+                neighbours (array_like): Output packed neighbour indices,
+                    8 per input pixel.
+
+            Returns:
+                None.
+
+        )")
+    .def("neighbours_ring", [](cal::HealpixPixels & self, py::buffer pix,
+                               py::buffer neighbours) {
+             pybuffer_check_1D <int64_t> (pix);
+             pybuffer_check_1D <int64_t> (neighbours);
+             py::buffer_info info_pix = pix.request();
+             py::buffer_info info_nb = neighbours.request();
+             if (info_nb.size != 8 * info_pix.size) {
+                 auto log = cal::Logger::get();
+                 std::ostringstream o;
+                 o << "Buffer sizes are not consistent.";
+                 log.error(o.str().c_str());
+                 throw std::runtime_error(o.str().c_str());
+             }
+             int64_t * rawpix = reinterpret_cast <int64_t *> (info_pix.ptr);
+             int64_t * rawnb = reinterpret_cast <int64_t *> (info_nb.ptr);
+             self.neighbours_ring(info_pix.size, rawpix, rawnb);
+             return;
+         }, py::arg("pix"), py::arg(
+             "neighbours"), R"(
+            Find the 8 neighbours of RING ordered pixels.
+
+            The neighbours of each pixel are in the order SW, W, NW, N, NE,
+            E, SE and S.  Missing neighbours are -1.
+
+            Args:
+                pix (array_like): Input pixel indices.
+                neighbours (array_like): Output packed neighbour indices,
+                    8 per input pixel.
+
+            Returns:
+                None.
+
+        )")
+    .def("query_disc_nest", [](cal::HealpixPixels & self, py::buffer vec,
+                               double radius, bool inclusive) {
+             pybuffer_check_1D <double> (vec);
+             py::buffer_info info_vec = vec.request();
+             if (info_vec.size != 3) {
+                 auto log = cal::Logger::get();
+                 std::ostringstream o;
+                 o << "The disc center must be one vector.";
+                 log.error(o.str().c_str());
+                 throw std::runtime_error(o.str().c_str());
+             }
+             double * rawvec = reinterpret_cast <double *> (info_vec.ptr);
+             std::vector <int64_t> pix;
+             self.query_disc_nest(rawvec, radius, inclusive, pix);
+             py::array_t <int64_t> ret;
+             ret.resize({pix.size()});
+             py::buffer_info info = ret.request();
+             int64_t * raw = static_cast <int64_t *> (info.ptr);
+             std::copy(pix.begin(), pix.end(), raw);
+             return ret;
+         }, py::arg("vec"), py::arg("radius"), py::arg("inclusive") = false,
+         R"(
+            Find the NESTED ordered pixels within a disc.
+
+            Args:
+                vec (array_like): The unit vector of the disc center.
+                radius (float): The disc radius in radians.
+                inclusive (bool): If True, also return the pixels that
+                    overlap the disc, and possibly a few more close to its
+                    edge.  Otherwise only return the pixels with centers
+                    within the disc.
+
+            Returns:
+                (array): The sorted pixel indices.
+
+        )")
+    .def("query_disc_ring", [](cal::HealpixPixels & self, py::buffer vec,
+                               double radius, bool inclusive) {
+             pybuffer_check_1D <double> (vec);
+             py::buffer_info info_vec = vec.request();
+             if (info_vec.size != 3) {
+                 auto log = cal::Logger::get();
+                 std::ostringstream o;
+                 o << "The disc center must be one vector.";
+                 log.error(o.str().c_str());
+                 throw std::runtime_error(o.str().c_str());
+             }
+             double * rawvec = reinterpret_cast <double *> (info_vec.ptr);
+             std::vector <int64_t> pix;
+             self.query_disc_ring(rawvec, radius, inclusive, pix);
+             py::array_t <int64_t> ret;
+             ret.resize({pix.size()});
+             py::buffer_info info = ret.request();
+             int64_t * raw = static_cast <int64_t *> (info.ptr);
+             std::copy(pix.begin(), pix.end(), raw);
+             return ret;
+         }, py::arg("vec"), py::arg("radius"), py::arg("inclusive") = false,
+         R"(
+            Find the RING ordered pixels within a disc.
+
+            Args:
+                vec (array_like): The unit vector of the disc center.
+                radius (float): The disc radius in radians.
+                inclusive (bool): If True, also return the pixels that
+                    overlap the disc, and possibly a few more close to its
+                    edge.  Otherwise only return the pixels with centers
+                    within the disc.
+
+            Returns:
+                (array): The sorted pixel indices.
+
         )");
 
 
@@ -269,6 +269,61 @@ void init_math_qarray(py::module & m) {
 
     )");
 
+    m.def(
+        "qa_slerp_mult", [](py::buffer time, py::buffer targettime,
+                            py::buffer q_in, py::buffer q_det,
+                            py::buffer q_out) {
+            pybuffer_check_1D <double> (time);
+            pybuffer_check_1D <double> (targettime);
+            pybuffer_check_1D <double> (q_in);
+            pybuffer_check_1D <double> (q_det);
+            pybuffer_check_1D <double> (q_out);
+            py::buffer_info info_time = time.request();
+            py::buffer_info info_tgtime = targettime.request();
+            py::buffer_info info_qin = q_in.request();
+            py::buffer_info info_qdet = q_det.request();
+            py::buffer_info info_qout = q_out.request();
+            size_t ntime = info_time.size;
+            size_t ntgtime = info_tgtime.size;
+            size_t nqin = (size_t)(info_qin.size / 4);
+            size_t ndet = (size_t)(info_qdet.size / 4);
+            size_t nqout = (size_t)(info_qout.size / 4);
+            if ((ntime != nqin) || (ndet * ntgtime != nqout)) {
+                auto log = cal::Logger::get();
+                std::ostringstream o;
+                o << "Buffer sizes are not consistent.";
+                log.error(o.str().c_str());
+                throw std::runtime_error(o.str().c_str());
+            }
+            double * timeraw = reinterpret_cast <double *> (info_time.ptr);
+            double * tgtimeraw = reinterpret_cast <double *> (info_tgtime.ptr);
+            double * qinraw = reinterpret_cast <double *> (info_qin.ptr);
+            double * qdetraw = reinterpret_cast <double *> (info_qdet.ptr);
+            double * qoutraw = reinterpret_cast <double *> (info_qout.ptr);
+            cal::qa_slerp_mult(ntime, ntgtime, timeraw, tgtimeraw, qinraw,
+                               ndet, qdetraw, qoutraw);
+            return;
+        }, py::arg("time"), py::arg("targettime"), py::arg("q_in"),
+        py::arg("q_det"), py::arg("q_out"), R"(
+        Interpolate quaternions and apply detector offsets in one pass.
+
+        The input quaternions are interpolated to the target times as in
+        qa_slerp and multiplied by each of the detector offset
+        quaternions.  The output holds one array of interpolated
+        quaternions per detector, without any intermediate arrays.
+
+        Args:
+            time (array_like):  time values.
+            targettime (array_like): target time values.
+            q_in (array_like):  flattened 1D array of float64 values.
+            q_det (array_like):  flattened 1D array of detector offsets.
+            q_out (array_like):  flattened 1D array of float64 values.
+
+        Returns:
+            None
+
+    )");
+
     m.def(
         "qa_exp", [](py::buffer in, py::buffer out) {
             pybuffer_check_1D <double> (in);
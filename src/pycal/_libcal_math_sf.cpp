@@ -291,6 +291,40 @@ void init_math_sf(py::module & m) {
 
     )");
 
+    m.def(
+        "verfinv", [](py::buffer in, py::buffer out) {
+            pybuffer_check_1D <double> (in);
+            pybuffer_check_1D <double> (out);
+            py::buffer_info info_in = in.request();
+            py::buffer_info info_out = out.request();
+            if (info_in.size != info_out.size) {
+                auto log = cal::Logger::get();
+                std::ostringstream o;
+                o << "Input and output buffers are different sizes";
+                log.error(o.str().c_str());
+                throw std::runtime_error(o.str().c_str());
+            }
+            double * inraw = reinterpret_cast <double *> (info_in.ptr);
+            double * outraw = reinterpret_cast <double *> (info_out.ptr);
+            cal::verfinv(info_in.size, inraw, outraw);
+            return;
+        }, py::arg("in"), py::arg(
+            "out"), R"(
+        Compute the inverse error function for an array of float64 values.
+
+        The results are stored in the output buffer.  To guarantee SIMD
+        vectorization, the input and output arrays should be aligned
+        (i.e. use an AlignedF64).
+
+        Args:
+            in (array_like):  1D array of float64 values.
+            out (array_like):  1D array of float64 values.
+
+        Returns:
+            None
+
+    )");
+
     // Now the "fast" / less accurate versions.
 
     m.def(
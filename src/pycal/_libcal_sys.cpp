@@ -63,6 +63,18 @@ void init_sys(py::module & m) {
          R"(
             Returns the number of samples to buffer for TOD operations.
         )")
+    .def("trace_file", &cal::Environment::trace_file,
+         R"(
+            Returns the root name of the profiler trace files, if any.
+        )")
+    .def("aatm_threads", &cal::Environment::aatm_threads,
+         R"(
+            Returns True if batches of AATM models are evaluated in parallel.
+        )")
+    .def("simd_target", &cal::Environment::simd_target,
+         R"(
+            Returns the instruction set selected for the SIMD kernels.
+        )")
     .def("max_threads", &cal::Environment::max_threads,
          R"(
             Returns the maximum number of threads used by compiled code.
@@ -358,6 +370,127 @@ void init_sys(py::module & m) {
         )");
 
 
+    py::class_ <cal::Profiler,
+                std::unique_ptr <cal::Profiler, py::nodelete> > (
+        m, "Profiler",
+        R"(
+        Hierarchical region profiler.
+
+        This singleton class accumulates the time spent in the nested regions
+        of the compiled code (for example the stages of the atmosphere
+        simulation), per thread and per process.  Query it after simulate()
+        or observe() have returned.
+
+        )")
+    .def("get", []() {
+             return std::unique_ptr <cal::Profiler, py::nodelete>
+                 (&cal::Profiler::get());
+         }, R"(
+            Get a handle to the singleton class.
+        )")
+    .def("enabled", &cal::Profiler::enabled,
+         R"(
+            Return True if regions are being recorded.
+        )")
+    .def("set_enabled", &cal::Profiler::set_enabled, py::arg("enabled"),
+         R"(
+            Enable or disable recording of new regions.
+        )")
+    .def("rank", &cal::Profiler::rank,
+         R"(
+            Return the MPI rank recorded with the statistics.
+        )")
+    .def("set_rank", &cal::Profiler::set_rank, py::arg("rank"),
+         R"(
+            Set the MPI rank recorded with the statistics.
+        )")
+    .def("stats", [](cal::Profiler const & self, bool per_thread) {
+             return profile_stats_list(self.stats(per_thread));
+         }, py::arg("per_thread") = false, R"(
+            Return the accumulated statistics in depth-first order.
+
+            Args:
+                per_thread (bool):  If True, return one entry per thread
+                    instead of accumulating over threads.
+
+            Returns:
+                (list):  One dictionary per region with the keys "path",
+                    "depth", "thread", "rank", "calls", "seconds", "min"
+                    and "max".
+
+        )")
+    .def("report", &cal::Profiler::report,
+         R"(
+            Report the accumulated statistics to STDOUT.
+        )")
+    .def("clear", &cal::Profiler::clear,
+         R"(
+            Reset all statistics and drop the recorded timeline.
+        )")
+    .def("tracing", &cal::Profiler::tracing,
+         R"(
+            Return True if closed regions are recorded on the timeline.
+        )")
+    .def("set_tracing", &cal::Profiler::set_tracing, py::arg("tracing"),
+         R"(
+            Enable or disable the recording of the timeline.
+        )")
+    .def("write_trace", &cal::Profiler::write_trace, py::arg("path"),
+         R"(
+            Write the timeline of this process as Chrome trace event JSON.
+
+            The file can be opened in chrome://tracing or Perfetto.  The
+            process ID of the events is the MPI rank and the thread ID the
+            profiler thread index.
+
+            Args:
+                path (str):  The output file.
+
+            Returns:
+                None
+
+        )");
+
+    py::class_ <cal::MemoryTracker,
+                std::unique_ptr <cal::MemoryTracker, py::nodelete> > (
+        m, "MemoryTracker",
+        R"(
+        Memory accounting per category.
+
+        This singleton class tracks the bytes held by the aligned buffers and
+        the shared memory windows of the compiled code, per category (for
+        example "compressed_index", "realization" or "cholmod"), and their
+        peak values.
+
+        )")
+    .def("get", []() {
+             return std::unique_ptr <cal::MemoryTracker, py::nodelete>
+                 (&cal::MemoryTracker::get());
+         }, R"(
+            Get a handle to the global memory tracker.
+        )")
+    .def("stats", [](cal::MemoryTracker const & self) {
+             return memory_stats_list(self.stats());
+         }, R"(
+            Return the memory statistics.
+
+            Returns:
+                (list):  A dictionary per category that was used, with the
+                    keys "category", "current", "peak" (in bytes) and
+                    "allocs".  The last entry, "total", is the sum over all
+                    categories.
+
+        )")
+    .def("reset_peak", &cal::MemoryTracker::reset_peak,
+         R"(
+            Set the peak values to the current values.
+        )")
+    .def("report", &cal::MemoryTracker::report,
+         R"(
+            Report the memory statistics to STDOUT.
+        )");
+
+
     py::class_ <cal::Logger,
                 std::unique_ptr <cal::Logger, py::nodelete> > (
         m, "Logger",
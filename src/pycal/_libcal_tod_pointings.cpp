@@ -75,5 +75,68 @@ void init_tod_pointing(py::module & m) {
             None.
     )");
 
+    m.def("pointing_azel",
+          [](py::buffer boresight, py::buffer detquat, py::object good,
+             py::buffer az, py::buffer el) {
+              pybuffer_check_1D <double> (boresight);
+              pybuffer_check_1D <double> (detquat);
+              pybuffer_check_1D <double> (az);
+              pybuffer_check_1D <double> (el);
+              py::buffer_info info_boresight = boresight.request();
+              py::buffer_info info_detquat = detquat.request();
+              py::buffer_info info_az = az.request();
+              py::buffer_info info_el = el.request();
+              size_t n = (size_t)(info_boresight.size / 4);
+              if ((info_detquat.size != 4) || (info_az.size < n) ||
+                  (info_el.size < n)) {
+                  auto log = cal::Logger::get();
+                  std::ostringstream o;
+                  o << "Buffer sizes are not consistent.";
+                  log.error(o.str().c_str());
+                  throw std::runtime_error(o.str().c_str());
+              }
+              double * rawboresight =
+                  reinterpret_cast <double *> (info_boresight.ptr);
+              double * rawdetquat = reinterpret_cast <double *> (info_detquat.ptr);
+              double * rawaz = reinterpret_cast <double *> (info_az.ptr);
+              double * rawel = reinterpret_cast <double *> (info_el.ptr);
+              uint8_t * rawgood = NULL;
+              if (!good.is_none()) {
+                  auto goodbuf = py::cast <py::buffer> (good);
+                  pybuffer_check_1D <uint8_t> (goodbuf);
+                  py::buffer_info info_good = goodbuf.request();
+                  if (info_good.size != n) {
+                      auto log = cal::Logger::get();
+                      std::ostringstream o;
+                      o << "Good sample buffer size is not consistent.";
+                      log.error(o.str().c_str());
+                      throw std::runtime_error(o.str().c_str());
+                  }
+                  rawgood = reinterpret_cast <uint8_t *> (info_good.ptr);
+              }
+              size_t nout = cal::pointing_azel(n, rawboresight, rawdetquat,
+                                               rawgood, rawaz, rawel);
+              return nout;
+          }, py::arg("boresight"), py::arg("detquat"), py::arg("good").none(true),
+          py::arg("az"), py::arg("el"), R"(
+        Compute the Azimuth and Elevation of one detector.
+
+        The detector pointing is the product of the boresight Az/El
+        quaternions and the detector offset quaternion.  Azimuth is measured
+        in the opposite direction than longitude.  If good is given, only the
+        good samples are written, contiguously, to the start of az and el.
+
+        Args:
+            boresight (array, float64):  The flat-packed array of boresight
+                Az/El quaternions.
+            detquat (array, float64):  The detector offset quaternion.
+            good (array, uint8):  Nonzero for the samples to convert, or None.
+            az (array, float64):  The output Azimuth, at least as long as the
+                number of boresight samples.
+            el (array, float64):  The output Elevation.
+        Returns:
+            (int):  The number of samples written.
+    )");
+
     return;
 }
\ No newline at end of file
@@ -267,6 +267,190 @@ class Pixels(object):
         else:
             return pix.array()
 
+    def nest2ang(self, pix):
+        """Convert NESTED ordered pixels to spherical coordinates.
+
+        The angles are those of the pixel centers.  The theta angle is
+        measured down from the North pole and phi is measured from the
+        prime meridian.
+
+        Args:
+            pix (array_like): Input pixel indices.
+
+        Returns:
+            (tuple): The (theta, phi) arrays in radians.
+
+        """
+        inpix = ensure_buffer_i64(pix)
+        n = len(inpix)
+        theta = AlignedF64(n)
+        phi = AlignedF64(n)
+        self.hpix.nest2ang(inpix, theta, phi)
+        if n == 1:
+            if object_ndim(pix) == 1:
+                return (theta.array(), phi.array())
+            else:
+                return (theta[0], phi[0])
+        else:
+            return (theta.array(), phi.array())
+
+    def ring2ang(self, pix):
+        """Convert RING ordered pixels to spherical coordinates.
+
+        The angles are those of the pixel centers.  The theta angle is
+        measured down from the North pole and phi is measured from the
+        prime meridian.
+
+        Args:
+            pix (array_like): Input pixel indices.
+
+        Returns:
+            (tuple): The (theta, phi) arrays in radians.
+
+        """
+        inpix = ensure_buffer_i64(pix)
+        n = len(inpix)
+        theta = AlignedF64(n)
+        phi = AlignedF64(n)
+        self.hpix.ring2ang(inpix, theta, phi)
+        if n == 1:
+            if object_ndim(pix) == 1:
+                return (theta.array(), phi.array())
+            else:
+                return (theta[0], phi[0])
+        else:
+            return (theta.array(), phi.array())
+
+    def nest2vec(self, pix):
+        """Convert NESTED ordered pixels to unit vectors.
+
+        Args:
+            pix (array_like): Input pixel indices.
+
+        Returns:
+            (array): The unit vectors of the pixel centers.
+
+        """
+        inpix = ensure_buffer_i64(pix)
+        n = len(inpix)
+        vec = AlignedF64(3 * n)
+        self.hpix.nest2vec(inpix, vec)
+        if n == 1:
+            if object_ndim(pix) == 1:
+                return vec.array().reshape(1, 3)
+            else:
+                return vec.array()
+        else:
+            return vec.array().reshape((-1, 3))
+
+    def ring2vec(self, pix):
+        """Convert RING ordered pixels to unit vectors.
+
+        Args:
+            pix (array_like): Input pixel indices.
+
+        Returns:
+            (array): The unit vectors of the pixel centers.
+
+        """
+        inpix = ensure_buffer_i64(pix)
+        n = len(inpix)
+        vec = AlignedF64(3 * n)
+        self.hpix.ring2vec(inpix, vec)
+        if n == 1:
+            if object_ndim(pix) == 1:
+                return vec.array().reshape(1, 3)
+            else:
+                return vec.array()
+        else:
+            return vec.array().reshape((-1, 3))
+
+    def neighbours_nest(self, pix):
+        """Find the 8 neighbours of NESTED ordered pixels.
+
+        The neighbours are in the order SW, W, NW, N, NE, E, SE and S.
+        Missing neighbours are -1.
+
+        Args:
+            pix (array_like): Input pixel indices.
+
+        Returns:
+            (array): The neighbour indices, with shape (n, 8).
+
+        """
+        inpix = ensure_buffer_i64(pix)
+        n = len(inpix)
+        out = AlignedI64(8 * n)
+        self.hpix.neighbours_nest(inpix, out)
+        if n == 1:
+            if object_ndim(pix) == 1:
+                return out.array().reshape(1, 8)
+            else:
+                return out.array()
+        else:
+            return out.array().reshape((-1, 8))
+
+    def neighbours_ring(self, pix):
+        """Find the 8 neighbours of RING ordered pixels.
+
+        The neighbours are in the order SW, W, NW, N, NE, E, SE and S.
+        Missing neighbours are -1.
+
+        Args:
+            pix (array_like): Input pixel indices.
+
+        Returns:
+            (array): The neighbour indices, with shape (n, 8).
+
+        """
+        inpix = ensure_buffer_i64(pix)
+        n = len(inpix)
+        out = AlignedI64(8 * n)
+        self.hpix.neighbours_ring(inpix, out)
+        if n == 1:
+            if object_ndim(pix) == 1:
+                return out.array().reshape(1, 8)
+            else:
+                return out.array()
+        else:
+            return out.array().reshape((-1, 8))
+
+    def query_disc_nest(self, vec, radius, inclusive=False):
+        """Find the NESTED ordered pixels within a disc.
+
+        Args:
+            vec (array_like): The unit vector of the disc center.
+            radius (float): The disc radius in radians.
+            inclusive (bool): If True, also return the pixels that overlap
+                the disc, and possibly a few more close to its edge.
+                Otherwise only return the pixels with centers within the
+                disc.
+
+        Returns:
+            (array): The sorted pixel indices.
+
+        """
+        invec = ensure_buffer_f64(vec)
+        return self.hpix.query_disc_nest(invec, radius, inclusive)
+
+    def query_disc_ring(self, vec, radius, inclusive=False):
+        """Find the RING ordered pixels within a disc.
+
+        Args:
+            vec (array_like): The unit vector of the disc center.
+            radius (float): The disc radius in radians.
+            inclusive (bool): If True, also return the pixels that overlap
+                the disc, and possibly a few more close to its edge.
+                Otherwise only return the pixels with centers within the
+                disc.
+
+        Returns:
+            (array): The sorted pixel indices.
+
+        """
+        invec = ensure_buffer_f64(vec)
+        return self.hpix.query_disc_ring(invec, radius, inclusive)
+
     def ring2nest(self, ringpix):
         """Convert RING ordered pixel numbers into NESTED ordering.
 
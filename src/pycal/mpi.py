@@ -8,6 +8,7 @@ import itertools
 import numpy as np
 
 from .utils import Environment, Logger, set_numba_threading
+from ._libcal import Profiler
 
 env = Environment.get()
 
@@ -25,6 +26,9 @@ if use_mpi and (MPI is None):
             "not found at run time.  Is mpi4py currently in "
             "your python search path?"
         )
+    # The profile statistics and trace files are labeled by the world rank,
+    # as cal::mpi_init does for the compiled programs.
+    Profiler.get().set_rank(MPI.COMM_WORLD.rank)
 
 # We set the numba threading here, **after** importing MPI.  The reasons are:
 #
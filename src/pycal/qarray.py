@@ -15,6 +15,7 @@ from ._libcal import (
     qa_rotate,
     qa_mult,
     qa_slerp,
+    qa_slerp_mult,
     qa_exp,
     qa_ln,
     qa_pow,
@@ -198,6 +199,37 @@ def slerp(targettime, time, q):
         return out.array().reshape((-1, 4))
 
 
+def slerp_mult(targettime, time, q, qdet):
+    """Interpolate a quaternion array and apply detector offsets.
+
+    This is equivalent to calling mult(slerp(targettime, time, q), d) for
+    every detector offset quaternion d, in a single pass.
+
+    Args:
+        targettime (array_like):  The output target times.
+        time (array_like):  The input times.
+        q (array_like):  The quaternion array.
+        qdet (array_like):  The detector offset quaternions.
+
+    Returns:
+        (array):  The detector quaternions, with shape (ndet, ntarget, 4).
+
+    """
+    tgt = ensure_buffer_f64(targettime)
+    t = ensure_buffer_f64(time)
+    qin = ensure_buffer_f64(q)
+    dets = ensure_buffer_f64(qdet)
+    log = Logger.get()
+    if len(t) < 2:
+        msg = "SLERP input times must have at least two values"
+        log.error(msg)
+        raise RuntimeError(msg)
+    ndet = len(dets) // 4
+    out = AlignedF64(4 * ndet * len(tgt))
+    qa_slerp_mult(t, tgt, qin, dets, out)
+    return out.array().reshape((ndet, -1, 4))
+
+
 def exp(q):
     """Exponential of a quaternion array.
 
@@ -59,6 +59,7 @@ class OpSimAtmosphereTest(MPITestCase):
         dnames_serial, dquat_serial, _, _, _, _, _, _ = boresight_focalplane(
             1, samplerate=self.rate, fknee=0.0, net=self.NET
         )
+        self.dquat_serial = dquat_serial
         
         # Samples per observation
         self.totsamp = 1000
@@ -294,4 +295,51 @@ class OpSimAtmosphereTest(MPITestCase):
                 nt.assert_allclose(ref1[:], ref2, rtol=1e-7)
 
         return
-        
\ No newline at end of file
+        
+
+    def test_atm_pointing_override(self):
+        # A TOD class that changes the detector pointing must be observed
+        # with its own pointing, not with the boresight shortcut.
+
+        class TODPointing(TODGround):
+            npntg = 0
+
+            def _get_pntg(self, detector, start, n, azel=False):
+                TODPointing.npntg += 1
+                return super()._get_pntg(detector, start, n, azel=azel)
+
+        tod_serial = self.data_serial.obs[0]["tod"]
+        tod_override = TODPointing(
+            self.data_serial.comm.comm_group,
+            self.dquat_serial,
+            self.totsamp,
+            detranks=self.data_serial.comm.group_size,
+            firsttime=0.0,
+            rate=self.rate,
+            site_lon=self.site_lon,
+            site_lat=self.site_lat,
+            site_alt=self.site_alt,
+            azmin=self.azmin,
+            azmax=self.azmax,
+            el=self.el,
+            coord=self.coord,
+            scanrate=self.scanrate,
+            scan_accel=self.scan_accel,
+            CES_start=self.CES_start,
+        )
+
+        atm = OpSimAtmosphere(out="atm", cachedir=None, freq=None, **self.common_params)
+        atm.exec(self.data_serial)
+
+        self.data_serial.obs[0]["tod"] = tod_override
+        atm.exec(self.data_serial)
+        self.data_serial.obs[0]["tod"] = tod_serial
+
+        self.assertTrue(TODPointing.npntg > 0)
+        for d in tod_serial.local_dets:
+            cname = "atm_{}".format(d)
+            ref = tod_serial.cache.reference(cname)
+            ref_override = tod_override.cache.reference(cname)
+            nt.assert_allclose(ref_override[:], ref[:], rtol=1e-7)
+
+        return
@@ -8,11 +8,13 @@ from functools import wraps
 
 import csv
 
+import json
+
 from collections import OrderedDict
 
 import numpy as np
 
-from ._libcal import Timer, GlobalTimers
+from ._libcal import Timer, GlobalTimers, Profiler
 
 from .utils import Environment
 
@@ -159,3 +161,27 @@ def dump(results, path):
                 row.append(props[v])
             w.writerow(row)
     return
+
+
+def merge_traces(paths, outpath):
+    """Merge the per-process trace files into a single timeline.
+
+    Every process writes its own file (see Profiler.write_trace() and the
+    CAL_TRACE environment variable) with the rank as process ID, so the
+    events can simply be concatenated.
+
+    Args:
+        paths (list):  The trace files to merge.
+        outpath (str):  The merged trace file.
+
+    Returns:
+        None
+
+    """
+    events = list()
+    for path in paths:
+        with open(path, "r") as f:
+            events.extend(json.load(f)["traceEvents"])
+    with open(outpath, "w") as f:
+        json.dump({"traceEvents": events, "displayTimeUnit": "ms"}, f)
+    return
@@ -13,10 +13,15 @@ if available_utils is None:
             atm_absorption_coefficient_vec,
             atm_atmospheric_loading,
             atm_atmospheric_loading_vec,
+            atm_band_averages,
+            atm_absorption_loading_batch,
+            AtmSpectrum,
         )
     except ImportError:
         available_utils = False
 
+from .._libcal import AtmTable
+
 available = None
 if available is None:
     available = True
@@ -14,8 +14,12 @@ from ..timing import function_timer, Timer
 
 from ..op import Operator
 
+from .._libcal import pointing_azel
+
 from .atm import available_utils, available_mpi
 
+from .sim_tod import TODGround
+
 available = True
 
 if available_utils:
@@ -24,6 +28,7 @@ if available_utils:
         atm_absorption_coefficient_vec,
         atm_atmospheric_loading,
         atm_atmospheric_loading_vec,
+        AtmSpectrum,
     )
 
 if available:
@@ -33,6 +38,20 @@ if available_mpi:
     from .atm import AtmSimMPI
 
 
+def _boresight_pointing(tod):
+    """Check if the detector pointing is the boresight times detoffset().
+
+    The Az/El of the detectors can then be expanded from the boresight
+    without read_pntg().  TOD classes that change the pointing (read_pntg,
+    _get_pntg or detoffset) go through read_pntg().
+    """
+    cls = type(tod)
+    for name in ["read_pntg", "_get_pntg", "detoffset"]:
+        if getattr(cls, name, None) is not getattr(TODGround, name):
+            return False
+    return True
+
+
 class OpSimAtmosphere(Operator):
     """Operator which generates atmosphere timestreams.
 
@@ -537,20 +556,15 @@ class OpSimAtmosphere(Operator):
                     "loading unavailable"
                 )
                 raise RuntimeError(msg)
-            absorption = atm_absorption_coefficient(
-                altitude,
-                weather.air_temperature,
-                weather.surface_pressure,
-                weather.pwv,
-                self._freq,
+            # Both quantities come from the same radiative transfer model
+            spectrum = AtmSpectrum(
+                altitude, weather.air_temperature, weather.surface_pressure
             )
-            loading = atm_atmospheric_loading(
-                altitude,
-                weather.air_temperature,
-                weather.surface_pressure,
-                weather.pwv,
-                self._freq,
+            absorption, loading = spectrum.evaluate(
+                np.array([weather.pwv]), self._freq, self._freq, 1
             )
+            absorption = absorption[0, 0]
+            loading = loading[0, 0]
             tod.meta["loading"] = loading
         else:
             absorption = None
@@ -855,6 +869,15 @@ class OpSimAtmosphere(Operator):
         ngood_tot = 0
         nbad_tot = 0
 
+        # The detector Az/El is computed from the boresight Az/El and the
+        # detector offsets into buffers that are reused for every detector.
+        bore_azel = None
+        detoffset = None
+        azbuf = np.empty(nind, dtype=np.float64)
+        elbuf = np.empty(nind, dtype=np.float64)
+        timesbuf = np.empty(nind, dtype=np.float64)
+        atmbuf = np.empty(nind, dtype=np.float64)
+
         for det in tod.local_dets:
             # Cache the output signal
             cachename = "{}_{}".format(self._out, det)
@@ -882,6 +905,13 @@ class OpSimAtmosphere(Operator):
             if ngood == 0:
                 continue
 
+            if isinstance(good, slice):
+                goodmask = None
+                det_times = times[ind]
+            else:
+                goodmask = good.view(np.uint8)
+                det_times = np.compress(good, times[ind], out=timesbuf[:ngood])
+
             try:
                 # Some TOD classes provide a shortcut to Az/El
                 az, el = tod.read_azel(
@@ -889,68 +919,41 @@ class OpSimAtmosphere(Operator):
                 az = az[good]
                 el = el[good]
             except Exception as e:
-                azelquat = tod.read_pntg(
-                    detector=det, local_start=istart, n=nind, azel=True
-                )[good]
-                # Convert Az/El quaternion of the detector back into
-                # angles for the simulation.
-                theta, phi = qa.to_position(azelquat)
-                # Azimuth is measured in the opposite direction
-                # than longitude
-                az = 2 * np.pi - phi
-                el = np.pi / 2 - theta
-
-            if np.ptp(az) < np.pi:
-                azmin_det = np.amin(az)
-                azmax_det = np.amax(az)
-            else:
-                # Scanning across the zero azimuth.
-                azmin_det = np.amin(az[az > np.pi]) - 2 * np.pi
-                azmax_det = np.amax(az[az < np.pi])
-            elmin_det = np.amin(el)
-            elmax_det = np.amax(el)
-            
-            # if min_az_bore == max_az_bore:
-                # log.info("You are in the spin_scan modality. Feature in Beta version azmin={} and azmax={}".format(azmin, azmax))
-                # Add some controls on the limits
-            # else:
-                # log.info("Not in spin_scan Mod azmin={} and azmax={}".format(azmin, azmax))
-                # if (
-                #     not (azmin <= azmin_det and azmax_det <= azmax)
-                #     and not (
-                #         azmin <= azmin_det - 2 * np.pi and azmax_det - 2 * np.pi <= azmax
-                #     )
-                # ) or not (elmin <= elmin_det and elmin_det <= elmax):
-                #     # DEBUG begin
-                #     import pickle
-
-                #     with open("bad_quats_{}_{}.pck".format(rank, det), "wb") as fout:
-                #         pickle.dump(
-                #             [scan_range, az, el, azelquat, tod._boresight_azel], fout
-                #         )
-                #     # DEBUG end
-                #     # Detector Az/El: [-3.13988, 3.14109], [1.22173, 1.22173] is not contained in [-7.28828, 1.00495], [1.04720 1.39626]
-                #     raise RuntimeError(
-                #         prefix + "Detector Az/El: [{:.5f}, {:.5f}], "
-                #         "[{:.5f}, {:.5f}] is not contained in "
-                #         "[{:.5f}, {:.5f}], [{:.5f} {:.5f}]"
-                #         "".format(
-                #             azmin_det,
-                #             azmax_det,
-                #             elmin_det,
-                #             elmax_det,
-                #             azmin,
-                #             azmax,
-                #             elmin,
-                #             elmax,
-                #         )
-                #     )
+                if bore_azel is None and not _boresight_pointing(tod):
+                    bore_azel = False
+                if bore_azel is None:
+                    try:
+                        bore_azel = tod.read_boresight_azel(
+                            local_start=istart, n=nind
+                        ).reshape(-1)
+                        detoffset = tod.detoffset()
+                    except Exception:
+                        bore_azel = False
+                if bore_azel is not False:
+                    detquat = np.ascontiguousarray(
+                        detoffset[det], dtype=np.float64)
+                    pointing_azel(
+                        bore_azel, detquat, goodmask, azbuf, elbuf)
+                    az = azbuf[:ngood]
+                    el = elbuf[:ngood]
+                else:
+                    azelquat = tod.read_pntg(
+                        detector=det, local_start=istart, n=nind, azel=True
+                    )[good]
+                    # Convert Az/El quaternion of the detector back into
+                    # angles for the simulation.
+                    theta, phi = qa.to_position(azelquat)
+                    # Azimuth is measured in the opposite direction
+                    # than longitude
+                    az = 2 * np.pi - phi
+                    el = np.pi / 2 - theta
 
             # Integrate detector signal
 
-            atmdata = np.zeros(ngood, dtype=np.float64)
+            atmdata = atmbuf[:ngood]
+            atmdata[:] = 0
 
-            err = sim.observe(times[ind][good], az, el, atmdata, -1.0)
+            err = sim.observe(det_times, az, el, atmdata, -1.0)
             if err != 0:
                 # Observing failed
                 bad = np.abs(atmdata) < 1e-30
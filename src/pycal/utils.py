@@ -7,7 +7,7 @@ import gc
 
 import numpy as np
 
-from ._libcal import Environment, Timer, GlobalTimers, Logger
+from ._libcal import Environment, Timer, GlobalTimers, Logger, MemoryTracker
 
 from ._libcal import (
     AlignedI8,
@@ -22,7 +22,17 @@ from ._libcal import (
     AlignedF64,
 )
 
-from ._libcal import vsin, vcos, vsincos, vatan2, vsqrt, vrsqrt, vexp, vlog
+from ._libcal import (
+    vsin,
+    vcos,
+    vsincos,
+    vatan2,
+    vsqrt,
+    vrsqrt,
+    vexp,
+    vlog,
+    verfinv,
+)
 
 from ._libcal import (
     vfast_sin,